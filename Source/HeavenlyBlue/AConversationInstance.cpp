@@ -2,18 +2,60 @@
 
 
 #include "AConversationInstance.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueScriptImporter.h"
+#include "DialogueBank.h"
+#include "DialogueHistory.h"
+#include "DialogueHotReload.h"
+#include "DialogueLocalization.h"
+#include "ProgressSaveSubsystem.h"
+#include "HitchMonitor.h"
+#include "GameplayEvents.h"
+#include "StartupProfiler.h"
+#include "SubtitlePresenter.h"
+#include "VoiceBlipSynth.h"
+#include "VoiceEnvelope.h"
+#include "APlayableSprite.h"
+#include "Components/AudioComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/AssetManager.h"
+#include "WorldStateSubsystem.h"
 #include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Paths.h"
+
+namespace ConversationInstanceOverlap
+{
+	// Only the local player's sprite starts a conversation, and only with its capsule, like the camera volumes (see CameraRig).
+	bool IsPlayerCapsule(AActor* OtherActor, UPrimitiveComponent* OtherComp)
+	{
+		AAPlayableSprite* Sprite = Cast<AAPlayableSprite>(OtherActor);
+		return Sprite != nullptr && OtherComp == Sprite->GetCapsuleComponent() && Sprite->IsLocallyControlled();
+	}
+}
 
 /*
  * Function:  AConversationInstance
  * --------------------
- * This is the constructor. It does nothing right now lol.
+ * This is the constructor. It adds the voice that speaks the typewriter's letters.
  */
 AAConversationInstance::AAConversationInstance() : 
 bInCollision(false),
 bSkippedText(false), 
-bAllowRepeat (true)
-{}
+bAllowRepeat (true),
+bUseVoiceSynth(true),
+ScriptContentHash(0),
+bLoadFromDialogueBank(false),
+bConversationLoaded(false),
+bConversationEvicted(false),
+VoiceLineStartTime(0.0f)
+{
+	VoiceBlips = CreateDefaultSubobject<UVoiceBlipComponent>(TEXT("VoiceBlips"));
+	VoiceBlips->SetupAttachment(RootComponent);
+}
 
 /*
  * Function:  BeginPlay
@@ -22,48 +64,515 @@ bAllowRepeat (true)
  */
 void AAConversationInstance::BeginPlay()
 {
+	HB_HITCH_SCOPE("Load.ConversationBeginPlay");
+	HB_LLM_SCOPE(Dialogue);
+	HB_STARTUP_SCOPE("BeginPlay", this);
+
 	// These allow the conversation instance to recognize collison with an actor.
 	GetCollisionComponent()->OnComponentBeginOverlap.AddDynamic(this, &AAConversationInstance::OnBeginOverlap);
 	GetCollisionComponent()->OnComponentEndOverlap.AddDynamic(this, &AAConversationInstance::OnEndOverlap);
 	PrimaryActorTick.bCanEverTick = true;
+
+	// The level's copy of the text is only needed by the editor, from here on the nodes share the string table.
+	InternStrings(ConversationList, QuestionList);
+	FDialogueLocalization::Get().OnCultureChanged().AddUObject(this, &AAConversationInstance::HandleCultureChanged);
+
+	if (UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(this))
+		SaveSubsystem->Restore(*this);
+
+	FDialogueHotReload::Get().Register(this);
+
+	FGameplayEventBus::Get().Subscribe<FDialogueAnswerEvent>(this, [this](const FDialogueAnswerEvent& Event)
+	{
+		if (Event.Interactable == this)
+			CurrentQuestionIteration = Event.Answer;
+	});
 }
 
 /*
- * Function:  PrintSubtitle
+ * Function:  EndPlay
  * --------------------
- * This function sets the speaker and begins the typewriting process
- *
- *
+ * This lets go of the conversation's localized table and takes its line off the screen, and out of the speakers.
  */
-void AAConversationInstance::PrintSubtitle()
+void AAConversationInstance::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Name: " + CurrentSpeakerName);
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Text: " + CurrentSubtitleText);
+	FDialogueLocalization::Get().OnCultureChanged().RemoveAll(this);
+	FDialogueHotReload::Get().Unregister(this);
+	FGameplayEventBus::Get().UnsubscribeAll(this);
+	StopTypewriter();
+	CancelVoiceSounds();
+	GetWorld()->GetTimerManager().ClearTimer(EvictTimerHandle);
+	if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+		Subtitles->Hide(this);
+	if (bConversationLoaded)
+		FDialogueLocalization::Get().ReleaseConversation(ScriptConversationKey);
+
+	Super::EndPlay(EndPlayReason);
+}
 
+/*
+ * Function:  HandleCultureChanged
+ * --------------------
+ * Conversations that haven't been approached yet are localized when they load.
+ */
+void AAConversationInstance::HandleCultureChanged()
+{
+	if (!bConversationLoaded)
+		return;
+
+	FDialogueLocalization::Get().LocalizeConversation(ScriptConversationKey, ConversationList, QuestionList);
+	RefreshCurrentStrings(ConversationList);
+	RefreshSubtitles();
+}
 
-	// Check if there's a question here
-	if (ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID].SubtitlesNodes[CurrentSubtitleNodeID].bHasQuestion)
+/*
+ * Function:  RefreshSubtitles
+ * --------------------
+ * The line is shown whole, the typewriter picks up from where it was on its next letter.
+ */
+void AAConversationInstance::RefreshSubtitles()
+{
+	USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this);
+	if (Subtitles && Subtitles->IsShowing(this))
 	{
-		if (!bInQuestion)
+		Subtitles->ShowLine(this, CurrentSpeakerHandle, CurrentSubtitleHandle);
+		if (bInQuestion)
 			PrintQuestions(QuestionList, CurrentSubtitleNodeID, CurrentDialogueNodeID, CurrentConversationNodeID);
+	}
+}
 
-		bProceed = false;
-		bInQuestion = true;
-		CurrentLetterIteration = 0;
+/*
+ * Function:  ImportScript
+ * --------------------
+ * This reads ScriptFile and takes the conversation stored under ScriptConversationKey.
+ * The script is read as a whole, use HB.Dialogue.Import to fill every instance in one pass.
+ */
+void AAConversationInstance::ImportScript()
+{
+	FDialogueScriptImporter Importer;
+	TMap<FName, FImportedConversation> Conversations;
+	FString Filename = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), ScriptFile.FilePath);
+
+	if (Importer.ImportFile(Filename, Conversations) && !ApplyImportedConversation(Conversations))
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s has no conversation called %s."), *Filename, *ScriptConversationKey.ToString());
+}
 
-		HandleQuestions(QuestionList, CurrentSubtitleNodeID, CurrentDialogueNodeID, CurrentConversationNodeID, CurrentQuestionIteration);
+/*
+ * Function:  ApplyImportedConversation
+ * --------------------
+ * This copies an imported conversation over the current one and restarts it from the first node.
+ *
+ * Conversations: The result of a script import.
+ */
+bool AAConversationInstance::ApplyImportedConversation(const TMap<FName, FImportedConversation>& Conversations)
+{
+	const FImportedConversation* Imported = Conversations.Find(ScriptConversationKey);
+	if (Imported == nullptr)
+		return false;
+
+	HB_LLM_SCOPE(Dialogue);
+	Modify();
+	CancelVoiceSounds();
+	ConversationList = Imported->ConversationList;
+	QuestionList = Imported->QuestionList;
+	ScriptContentHash = Imported->ContentHash;
+	if (GetWorld() != nullptr && GetWorld()->IsGameWorld())
+	{
+		InternStrings(ConversationList, QuestionList);
+		if (bConversationLoaded)
+		{
+			FDialogueLocalization::Get().LocalizeConversation(ScriptConversationKey, ConversationList, QuestionList);
+			CompileWorldStateScripts();
+		}
 	}
-	else
+	SetNodeID(0, 0, 0);
+	ResetIteration();
+	return true;
+}
+
+/*
+ * Function:  HotReloadConversation
+ * --------------------
+ * 1) Take the new nodes. A banked conversation counts as loaded from here on, the bank has the old lines.
+ * 2) Intern, localize and compile them like a conversation that was just approached.
+ * 3) Keep the conversation where it was, on the nearest node that's still there, and refresh what's on screen.
+ *
+ * Imported: The conversation as it is in the script now.
+ */
+void AAConversationInstance::HotReloadConversation(const FImportedConversation& Imported)
+{
+	HB_LLM_SCOPE(Dialogue);
+	CancelVoiceSounds();
+	bConversationEvicted = false;
+	ConversationList = Imported.ConversationList;
+	QuestionList = Imported.QuestionList;
+	ScriptContentHash = Imported.ContentHash;
+
+	InternStrings(ConversationList, QuestionList);
+	if (!bConversationLoaded && bLoadFromDialogueBank)
+	{
+		bConversationLoaded = true;
+		FDialogueLocalization::Get().AcquireConversation(ScriptConversationKey);
+	}
+	if (bConversationLoaded)
+	{
+		FDialogueLocalization::Get().LocalizeConversation(ScriptConversationKey, ConversationList, QuestionList);
+		CompileWorldStateScripts();
+	}
+
+	ClampToValidNodes();
+	RefreshCurrentStrings(ConversationList);
+	if (ConversationList.IsValidIndex(CurrentConversationNodeID) && ConversationList[CurrentConversationNodeID].DialougeNodes.IsValidIndex(CurrentDialogueNodeID))
+		SetSubtitleProperties(ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID].SubtitlesNodes);
+	RefreshSubtitles();
+}
+
+/*
+ * Function:  ClampToValidNodes
+ * --------------------
+ * A node that was removed is replaced by the last one before it at the same level. If the question
+ * the player was answering is gone, the conversation carries on as if the line never had one.
+ */
+void AAConversationInstance::ClampToValidNodes()
+{
+	if (ConversationList.Num() == 0)
+	{
+		SetNodeID(0, 0, 0);
+		ResetIteration();
+		NextConversationNodeID = 0;
+		return;
+	}
+
+	const int32 Conversation = FMath::Clamp(CurrentConversationNodeID, 0, ConversationList.Num() - 1);
+	const TArray<FDialogueNode>& Dialogues = ConversationList[Conversation].DialougeNodes;
+	const int32 Dialogue = FMath::Clamp(CurrentDialogueNodeID, 0, FMath::Max(Dialogues.Num() - 1, 0));
+	const int32 Subtitle = Dialogues.IsValidIndex(Dialogue) ? FMath::Clamp(CurrentSubtitleNodeID, 0, FMath::Max(Dialogues[Dialogue].SubtitlesNodes.Num() - 1, 0)) : 0;
+
+	SetNodeID(Conversation, Dialogue, Subtitle);
+	NextConversationNodeID = FMath::Clamp(NextConversationNodeID, 0, ConversationList.Num() - 1);
+
+	const bool bHasQuestion = Dialogues.IsValidIndex(Dialogue) && Dialogues[Dialogue].SubtitlesNodes.IsValidIndex(Subtitle) &&
+		Dialogues[Dialogue].SubtitlesNodes[Subtitle].bHasQuestion;
+	if (bInQuestion && !bHasQuestion)
 	{
-		bProceed = true;
 		bInQuestion = false;
-		CurrentLetterIteration = 0;
+		bProceed = true;
 		CurrentQuestionIteration = 0;
+	}
+}
+
+/*
+ * Function:  EnsureConversationLoaded
+ * --------------------
+ * Banked conversations are decoded on the first approach instead of with the level,
+ * so loading the level costs the same however large the script grows.
+ * The localized table is loaded at the same time, so only conversations in reach hold one.
+ * A banked conversation picks up where the save left it, or where it was when it was evicted.
+ * Its voice sounds are loaded in the background, the first lines are typed with blips if they aren't in yet.
+ */
+void AAConversationInstance::EnsureConversationLoaded()
+{
+	HB_HITCH_SCOPE("Dialogue.Load");
+	if (bConversationLoaded)
+		return;
+
+	HB_LLM_SCOPE(Dialogue);
+	bConversationLoaded = true;
+	FDialogueLocalization::Get().AcquireConversation(ScriptConversationKey);
+	if (bLoadFromDialogueBank)
+	{
+		if (FDialogueBank::Get().DecodeConversation(ScriptConversationKey, ConversationList, QuestionList, &VoiceSoundPaths))
+		{
+			LoadVoiceSounds();
+
+			// The save was restored in BeginPlay against no nodes, it's taken again now there are some.
+			// An evicted conversation still knows where it was, which is newer than the save.
+			UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(this);
+			if (bConversationEvicted || (SaveSubsystem && SaveSubsystem->Restore(*this)))
+			{
+				ClampToValidNodes();
+			}
+			else
+			{
+				SetNodeID(0, 0, 0);
+				ResetIteration();
+			}
+		}
+		else
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: the dialogue bank has no conversation called %s."), *GetName(), *ScriptConversationKey.ToString());
+		}
+	}
+
+	bConversationEvicted = false;
+	FDialogueLocalization::Get().LocalizeConversation(ScriptConversationKey, ConversationList, QuestionList);
+	CompileWorldStateScripts();
+}
+
+/*
+ * Function:  EvictConversation
+ * --------------------
+ * 1) Only a banked conversation the player has walked away from is evicted, the bank can decode it again.
+ * 2) Drop its nodes, compiled scripts, pending sounds and localized table. The node IDs stay where they were.
+ *
+ */
+void AAConversationInstance::EvictConversation()
+{
+	if (!bConversationLoaded || !bLoadFromDialogueBank || bInCollision)
+		return;
+
+	HB_LLM_SCOPE(Dialogue);
+	StopTypewriter();
+	CancelVoiceSounds();
+	ConversationList.Empty();
+	QuestionList.Empty();
+	WorldStateScript.Reset();
+	FDialogueLocalization::Get().ReleaseConversation(ScriptConversationKey);
+	CurrentSubtitleVoice = nullptr;
+	bConversationLoaded = false;
+	bConversationEvicted = true;
+}
+
+/*
+ * Function:  LoadVoiceSounds
+ * --------------------
+ * Decoding only took the subtitle sounds that were already in memory, the rest load without stalling the game thread.
+ *
+ */
+void AAConversationInstance::LoadVoiceSounds()
+{
+	TArray<FSoftObjectPath> Missing;
+	for (const FSoftObjectPath& Path : VoiceSoundPaths)
+	{
+		if (Path.IsValid() && Path.ResolveObject() == nullptr)
+			Missing.AddUnique(Path);
+	}
+
+	if (Missing.Num() == 0)
+	{
+		HandleVoiceSoundsLoaded();
+		return;
+	}
+
+	VoiceSoundsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Missing,
+		FStreamableDelegate::CreateUObject(this, &AAConversationInstance::HandleVoiceSoundsLoaded));
+}
+
+/*
+ * Function:  HandleVoiceSoundsLoaded
+ * --------------------
+ * VoiceSoundPaths has one path per subtitle in node order, so the nodes are walked in the same order.
+ * The current line picks its sound up too, from its next letter.
+ *
+ */
+void AAConversationInstance::HandleVoiceSoundsLoaded()
+{
+	int32 Index = 0;
+	for (FConversationNode& Conversation : ConversationList)
+	{
+		for (FDialogueNode& Dialogue : Conversation.DialougeNodes)
+		{
+			for (FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+			{
+				if (VoiceSoundPaths.IsValidIndex(Index) && Subtitle.SubtitleSound == nullptr)
+					Subtitle.SubtitleSound = Cast<USoundWave>(VoiceSoundPaths[Index].ResolveObject());
+				Index++;
+			}
+		}
+	}
+
+	if (ConversationList.IsValidIndex(CurrentConversationNodeID) &&
+		ConversationList[CurrentConversationNodeID].DialougeNodes.IsValidIndex(CurrentDialogueNodeID) &&
+		ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID].SubtitlesNodes.IsValidIndex(CurrentSubtitleNodeID))
+	{
+		CurrentSubtitleVoice = ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID].SubtitlesNodes[CurrentSubtitleNodeID].SubtitleSound;
+	}
+
+	VoiceSoundPaths.Empty();
+	VoiceSoundsHandle.Reset();
+}
+
+void AAConversationInstance::WaitForVoiceSounds()
+{
+	if (VoiceSoundsHandle.IsValid())
+	{
+		VoiceSoundsHandle->WaitUntilComplete();
+		HandleVoiceSoundsLoaded();
+	}
+}
+
+void AAConversationInstance::CancelVoiceSounds()
+{
+	if (VoiceSoundsHandle.IsValid())
+		VoiceSoundsHandle->CancelHandle();
+	VoiceSoundsHandle.Reset();
+	VoiceSoundPaths.Empty();
+}
 
-		Increment(ConversationList);
+/*
+ * Function:  CompileWorldStateScripts
+ * --------------------
+ * Conditions are checked every time the options are printed or picked, so they're compiled once up front.
+ * A condition that doesn't compile is logged and leaves its option always available.
+ */
+void AAConversationInstance::CompileWorldStateScripts()
+{
+	UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this);
+	WorldStateScript.Reset();
+	if (WorldState == nullptr)
+		return;
+
+	for (FQuestionNode& Question : QuestionList)
+	{
+		FString Error;
+		Question.ConditionProgram = WorldStateScript.CompileCondition(Question.Condition, *WorldState, &Error);
+		if (!Error.IsEmpty())
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: condition of option %d (%d.%d.%d): %s."), *GetName(), Question.NodeID,
+				Question.ConversationReferenceID, Question.DialougeReferenceID, Question.SubtitleRefrenceID, *Error);
+
+		Error.Reset();
+		Question.ActionProgram = WorldStateScript.CompileAction(Question.Action, *WorldState, &Error);
+		if (!Error.IsEmpty())
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: action of option %d (%d.%d.%d): %s."), *GetName(), Question.NodeID,
+				Question.ConversationReferenceID, Question.DialougeReferenceID, Question.SubtitleRefrenceID, *Error);
 	}
+}
+
+/*
+ * Function:  PreSave
+ * --------------------
+ * Banked instances never save their nodes with the level, the bank is the only copy.
+ * Nodes the bank doesn't have are kept, so ticking the flag on a written conversation never loses it.
+ */
+void AAConversationInstance::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	Super::PreSave(TargetPlatform);
+
+	if (!bLoadFromDialogueBank)
+		return;
 
-	//TypewriterEffect(CurrentSubtitleText);
+	if (FDialogueBank::Get().Contains(ScriptConversationKey))
+	{
+		ConversationList.Empty();
+		QuestionList.Empty();
+	}
+	else if (ConversationList.Num() > 0 || QuestionList.Num() > 0)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s loads from the dialogue bank, which has no conversation called %s. Its nodes are saved with the level instead."),
+			*GetName(), *ScriptConversationKey.ToString());
+	}
+}
+
+/*
+ * Console Command:  HB.Dialogue.Import <Script>
+ * --------------------
+ * Imports a script once and hands each conversation to the instances that use its key.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GDialogueImportCommand(
+	TEXT("HB.Dialogue.Import"),
+	TEXT("Imports a dialogue script into every conversation instance of the current world. Usage: HB.Dialogue.Import <Script.csv>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (Args.Num() < 1 || World == nullptr)
+			return;
+
+		FDialogueScriptImporter Importer;
+		TMap<FName, FImportedConversation> Conversations;
+		FDialogueImportStats Stats;
+		if (!Importer.ImportFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Args[0]), Conversations, &Stats))
+			return;
+
+		int32 Applied = 0;
+		for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+		{
+			if (It->ApplyImportedConversation(Conversations))
+				Applied++;
+		}
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Imported %d lines in %.2f ms, %d of %d conversations matched an instance."),
+			Stats.Lines, Stats.Seconds * 1000.0, Applied, Conversations.Num());
+	})
+);
+
+/*
+ * Function:  PrintSubtitle
+ * --------------------
+ * This function sets the speaker and begins the typewriting process
+ *
+ *
+ */
+void AAConversationInstance::PrintSubtitle()
+{
+	HB_HITCH_SCOPE("Dialogue.PrintSubtitle");
+	if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+		Subtitles->ShowLine(this, CurrentSpeakerHandle, CurrentSubtitleHandle);
+
+	// The backlog keeps the authored handles, the current ones may be localized and change with the culture.
+	if (UDialogueHistorySubsystem* History = UDialogueHistorySubsystem::Get(this))
+	{
+		const FDialogueNode& Dialogue = ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID];
+		const FSubtitleNode& Subtitle = Dialogue.SubtitlesNodes[CurrentSubtitleNodeID];
+		History->RecordLine(ScriptConversationKey, CurrentConversationNodeID, CurrentDialogueNodeID, CurrentSubtitleNodeID,
+			Dialogue.SpeakerHandle.IsEmpty() ? CurrentSpeakerHandle : Dialogue.SpeakerHandle, Subtitle.TextHandle.IsEmpty() ? CurrentSubtitleHandle : Subtitle.TextHandle);
+	}
+
+	// The line is typed out, its question or the next line comes once it's all there (see TypewriterEffect).
+	// Until then interacting only hurries it along.
+	bProceed = false;
+	bInQuestion = false;
+	bSkippedText = false;
+	CurrentLetterIteration = 0;
+	TypewriterEffect(GetCurrentSubtitleText());
+}
+
+/*
+ * Function:  PrintQuestions
+ * --------------------
+ * The available options go to the subtitle presenter under the current line, laid out once per question.
+ */
+void AAConversationInstance::PrintQuestions(const TArray<FQuestionNode>& List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode)
+{
+	USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this);
+	if (Subtitles == nullptr)
+		return;
+
+	TArray<FDialogueStringHandle> Options;
+	for (const FQuestionNode& Question : List)
+	{
+		if (Question.SubtitleRefrenceID == SubtitleNode && Question.DialougeReferenceID == DialougeNode && Question.ConversationReferenceID == ConversationNode &&
+			IsOptionAvailable(Question))
+		{
+			Options.Add(Question.GetOptionHandle().IsEmpty() ? FDialogueStringTable::Get().Intern(Question.Option) : Question.GetOptionHandle());
+		}
+	}
+
+	Subtitles->ShowChoices(this, Options);
+}
+
+/*
+ * Function:  OnOptionChosen/IsOptionAvailable
+ * --------------------
+ * Options run their action when chosen, this is how choices are remembered for quests. The choice also goes into the backlog.
+ */
+void AAConversationInstance::OnOptionChosen(const FQuestionNode& Option)
+{
+	if (UDialogueHistorySubsystem* History = UDialogueHistorySubsystem::Get(this))
+		History->RecordOption(ScriptConversationKey, Option);
+
+	if (!Option.ActionProgram.IsValid())
+		return;
+
+	if (UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this))
+		WorldStateScript.Execute(Option.ActionProgram, *WorldState);
+}
+
+bool AAConversationInstance::IsOptionAvailable(const FQuestionNode& Option) const
+{
+	if (!Option.ConditionProgram.IsValid())
+		return true;
+
+	const UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this);
+	return WorldState == nullptr || WorldStateScript.Evaluate(Option.ConditionProgram, *WorldState);
 }
 
 /*
@@ -73,11 +582,19 @@ void AAConversationInstance::PrintSubtitle()
  *
  * CurString: This is the text of the current subtitle node
  */
-void AAConversationInstance::TypewriterEffect(FString CurString)
+void AAConversationInstance::TypewriterEffect(const FString& CurString)
 {
+	HB_HITCH_SCOPE("Dialogue.Typewriter");
+	if (CurrentLetterIteration == 0)
+	{
+		if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+			Subtitles->SetVisibleCharacters(this, 0);
+		StartVoiceLine(CurString);
+	}
+
 	if (CurrentLetterIteration < CurString.Len())
 	{
-		AddLetter(GetLetter(CurString, CurrentLetterIteration), (CurrentSubtitleTimer / CurString.Len()));
+		AddLetter(GetLetter(CurString, CurrentLetterIteration), GetLetterDelay(CurString));
 	}
 	else
 	{
@@ -114,7 +631,7 @@ void AAConversationInstance::TypewriterEffect(FString CurString)
  * Start: This is the index to return the character.
  *
  */
-FString AAConversationInstance::GetLetter(FString CurString, int32 Start){	return CurString.Mid(Start, 1); }
+FString AAConversationInstance::GetLetter(const FString& CurString, int32 Start){	return CurString.Mid(Start, 1); }
 
 /*
  * Function:  AddLetter
@@ -125,17 +642,21 @@ FString AAConversationInstance::GetLetter(FString CurString, int32 Start){	retur
  * Start: This is how fast should the typewriter type.
  *
  */
-void AAConversationInstance::AddLetter(FString Letter, float Time)
+void AAConversationInstance::AddLetter(const FString& Letter, float Time)
 {	
+	HB_HITCH_SCOPE("Dialogue.AddLetter");
+	HB_LLM_SCOPE(Dialogue);
 	CurrentLetter = Letter;
-	if(!bSkippedText)
+	// A letter that's already due is added right away, a timer of 0 seconds would never fire.
+	if(!bSkippedText && Time > 0.0f)
 		GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &AAConversationInstance::TimerEnd, Time, false);
 	else
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, CurrentLetter);
-		UGameplayStatics::PlaySound2D(GetWorld(), CurrentSubtitleVoice);
+		if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+			Subtitles->SetVisibleCharacters(this, CurrentLetterIteration + 1);
+		PlayVoice();
 		CurrentLetterIteration++;
-		TypewriterEffect(CurrentSubtitleText);
+		TypewriterEffect(GetCurrentSubtitleText());
 	}
 }
 
@@ -148,10 +669,121 @@ void AAConversationInstance::AddLetter(FString Letter, float Time)
  */
 void AAConversationInstance::TimerEnd()
 {
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, CurrentLetter);
-	UGameplayStatics::PlaySound2D(GetWorld(), CurrentSubtitleVoice);
+	if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+		Subtitles->SetVisibleCharacters(this, CurrentLetterIteration + 1);
+	PlayVoice();
 	CurrentLetterIteration++;
-	TypewriterEffect(CurrentSubtitleText);
+	TypewriterEffect(GetCurrentSubtitleText());
+}
+
+/*
+ * Function:  PlayVoice
+ * --------------------
+ * This voices the current letter. The synth picks its timbre by the speaker's name in the script, not the
+ * localized one, so a speaker sounds the same in every language. The sounds it starts are tagged apart from the dialogue.
+ *
+ */
+void AAConversationInstance::PlayVoice()
+{
+	HB_HITCH_SCOPE("Dialogue.Voice");
+	HB_LLM_SCOPE(Voice);
+
+	// A recorded line is already speaking.
+	if (LetterTimes.Num() > 0)
+		return;
+
+	if (!bUseVoiceSynth || VoiceBlips == nullptr)
+	{
+		UGameplayStatics::PlaySound2D(GetWorld(), CurrentSubtitleVoice);
+		return;
+	}
+
+	if (ConversationList.IsValidIndex(CurrentConversationNodeID) && ConversationList[CurrentConversationNodeID].DialougeNodes.IsValidIndex(CurrentDialogueNodeID))
+	{
+		const FDialogueNode& Dialogue = ConversationList[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID];
+		VoiceBlips->SetSpeaker(Dialogue.SpeakerHandle.IsEmpty() ? Dialogue.SpeakerName : FDialogueStringTable::ResolveText(Dialogue.SpeakerHandle));
+	}
+
+	if (CurrentLetter.Len() > 0)
+		VoiceBlips->PlayCharacter(CurrentLetter[0]);
+}
+
+/*
+ * Function:  StartVoiceLine
+ * --------------------
+ * A subtitle voice with a baked envelope is a recorded line: it's played once, and the letters follow its envelope.
+ * Any other voice is a blip played per letter (see PlayVoice). Nothing is analysed here, the envelope is only read.
+ *
+ */
+void AAConversationInstance::StartVoiceLine(const FString& CurString)
+{
+	StopVoiceLine();
+
+	const FVoiceEnvelope* Envelope = FVoiceEnvelopeTable::Get().Find(CurrentSubtitleVoice);
+	if (Envelope == nullptr)
+		return;
+
+	HB_LLM_SCOPE(Voice);
+	Envelope->GetCharacterTimes(CurString, LetterTimes);
+	VoiceLineStartTime = GetWorld()->GetTimeSeconds();
+	VoiceLine = UGameplayStatics::SpawnSound2D(this, CurrentSubtitleVoice);
+}
+
+/*
+ * Function:  StopTypewriter
+ * --------------------
+ * A line cut off half typed is typed again from the start the next time the player interacts.
+ *
+ */
+void AAConversationInstance::StopTypewriter()
+{
+	if (UWorld* World = GetWorld())
+		World->GetTimerManager().ClearTimer(TimerHandle);
+	StopVoiceLine();
+
+	if (!bProceed && !bInQuestion)
+	{
+		bProceed = true;
+		bSkippedText = false;
+		CurrentLetterIteration = 0;
+	}
+}
+
+void AAConversationInstance::StopVoiceLine()
+{
+	LetterTimes.Reset();
+	if (UAudioComponent* Line = VoiceLine.Get())
+		Line->Stop();
+	VoiceLine.Reset();
+}
+
+/*
+ * Function:  GetLetterDelay
+ * --------------------
+ * Letters of a voice line are timed from when the line started, so a late timer doesn't push back the rest of the line.
+ *
+ */
+float AAConversationInstance::GetLetterDelay(const FString& CurString) const
+{
+	if (LetterTimes.IsValidIndex(CurrentLetterIteration))
+		return LetterTimes[CurrentLetterIteration] - (GetWorld()->GetTimeSeconds() - VoiceLineStartTime);
+
+	return CurrentSubtitleTimer / CurString.Len();
+}
+
+/*
+ * Function:  GetResourceSizeEx
+ * --------------------
+ * The nodes, the strings they still own, the compiled scripts and the typewriter's letter and its timing.
+ * The shared string table and the voice sounds are counted by the memory report on their own.
+ *
+ */
+void AAConversationInstance::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GetNodesAllocatedSize(ConversationList, QuestionList));
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(WorldStateScript.GetAllocatedSize() + CurrentLetter.GetAllocatedSize() + LetterTimes.GetAllocatedSize());
 }
 
 /*
@@ -161,23 +793,38 @@ void AAConversationInstance::TimerEnd()
  */
 void AAConversationInstance::OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	// Other Actor is the actor that triggered the event. Check that is not ourself.  
-	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
+	HB_HITCH_SCOPE("Overlap.Conversation");
+	// Other Actor is the actor that triggered the event, only the player's capsule counts.
+	if (ConversationInstanceOverlap::IsPlayerCapsule(OtherActor, OtherComp))
 	{
+		GetWorld()->GetTimerManager().ClearTimer(EvictTimerHandle);
+		FHitchMonitor::Get().SetActiveConversation(this);
+		EnsureConversationLoaded();
 		bInCollision = true;
+		FGameplayEventBus::Get().Post(FInteractableOverlapEvent{ this, OtherActor, true });
 	}
 }
 
 /*
  * Function:  OnEndOverlap
  * --------------------
- * This is called when an actor exits a collision box.
+ * This is called when an actor exits a collision box. A banked conversation is evicted once the player
+ * has stayed away for [/Script/HeavenlyBlue.DialogueBank] EvictSeconds.
  */
 void AAConversationInstance::OnEndOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	// Other Actor is the actor that triggered the event. Check that is not ourself.  
-	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
+	// Other Actor is the actor that triggered the event, only the player's capsule counts.
+	if (ConversationInstanceOverlap::IsPlayerCapsule(OtherActor, OtherComp))
 	{
 		bInCollision = false;
+		FGameplayEventBus::Get().Post(FInteractableOverlapEvent{ this, OtherActor, false });
+		StopTypewriter();
+		if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(this))
+			Subtitles->Hide(this);
+
+		float EvictSeconds = 30.0f;
+		GConfig->GetFloat(TEXT("/Script/HeavenlyBlue.DialogueBank"), TEXT("EvictSeconds"), EvictSeconds, GGameIni);
+		if (bLoadFromDialogueBank && EvictSeconds > 0.0f)
+			GetWorld()->GetTimerManager().SetTimer(EvictTimerHandle, this, &AAConversationInstance::EvictConversation, EvictSeconds);
 	}
 }
@@ -44,8 +44,12 @@ class HEAVENLYBLUE_API AAConversationInstance : public ATriggerBox, public IIDia
 public:
 	UFUNCTION()
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	UFUNCTION()
 	virtual void PrintSubtitle() override;
+	virtual void PrintQuestions(const TArray<FQuestionNode>& List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode) override;
+	virtual void OnOptionChosen(const FQuestionNode& Option) override;
+	virtual bool IsOptionAvailable(const FQuestionNode& Option) const override;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
 	TArray<FConversationNode> ConversationList;
@@ -60,6 +64,55 @@ public:
 	bool bSkippedText;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
 	bool bAllowRepeat;
+
+	// Speaks the typewriter's letters in the speaker's timbre (see FVoiceTimbre). With bUseVoiceSynth off,
+	// each letter plays the subtitle's voice sound instead.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Conversation Properties")
+	class UVoiceBlipComponent* VoiceBlips;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
+	bool bUseVoiceSynth;
+
+	// Large scripts are written outside of the editor, this is the script and the conversation in it that belongs to this instance.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Script", meta = (FilePathFilter = "csv", RelativeToGameDir))
+	FFilePath ScriptFile;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Script")
+	FName ScriptConversationKey;
+
+	// This replaces the ConversationList and QuestionList with the lines from the script.
+	UFUNCTION(CallInEditor, Category = "Conversation Script")
+	void ImportScript();
+
+	// Replaces the conversation data with an imported conversation, if the script has one for ScriptConversationKey.
+	bool ApplyImportedConversation(const TMap<FName, struct FImportedConversation>& Conversations);
+
+	// The content hash of the imported conversation this instance holds, 0 if it was entered by hand.
+	UPROPERTY()
+	uint32 ScriptContentHash;
+
+	// Swaps in a conversation that changed on disk while the game runs (see FDialogueHotReload).
+	// A conversation in progress carries on from the nearest node that still exists.
+	void HotReloadConversation(const struct FImportedConversation& Imported);
+
+	// If true, the conversation isn't saved with the level. It is decoded from the dialogue bank
+	// (by ScriptConversationKey) the first time the player walks into the trigger.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Script")
+	bool bLoadFromDialogueBank;
+
+	// Decodes the conversation from the dialogue bank and loads its text for the active culture,
+	// if that hasn't been done yet. Safe to call at any time.
+	void EnsureConversationLoaded();
+	bool IsConversationLoaded() const { return bConversationLoaded; }
+
+	// Drops a banked conversation the player has walked away from, EnsureConversationLoaded decodes it again.
+	void EvictConversation();
+
+	// Blocks until the voice sounds of a banked conversation are in, for commandlets that never tick.
+	void WaitForVoiceSounds();
+
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+
+	// The runtime heap of this conversation, for the memory report (see FHeavenlyBlueMemoryReport).
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 protected:
 
 	
@@ -70,16 +123,61 @@ private:
 	UPROPERTY()
 	FString CurrentLetter;
 
+	bool bConversationLoaded;
+	// Evicted since it was last loaded, its node IDs are newer than the save.
+	bool bConversationEvicted;
+	FTimerHandle EvictTimerHandle;
+
+	// The sound of each decoded subtitle, in node order, while they load (see LoadVoiceSounds).
+	TArray<FSoftObjectPath> VoiceSoundPaths;
+	TSharedPtr<struct FStreamableHandle> VoiceSoundsHandle;
+
+	void LoadVoiceSounds();
+	void HandleVoiceSoundsLoaded();
+	void CancelVoiceSounds();
+
+	// When each letter of the current line appears, from the start of its recorded voice line (see FVoiceEnvelope).
+	// Empty if the line isn't a baked voice line, its letters are then spread evenly over CurrentSubtitleTimer.
+	TArray<float> LetterTimes;
+	float VoiceLineStartTime;
+	TWeakObjectPtr<class UAudioComponent> VoiceLine;
+
+	// The compiled conditions and actions of QuestionList.
+	FWorldStateScript WorldStateScript;
+
+	// Compiles the conditions and actions of every option, after the questions were (re)loaded.
+	void CompileWorldStateScripts();
+
+	// Localizes the loaded conversation again when the player switches language.
+	void HandleCultureChanged();
+
+	// Moves the current node IDs onto nodes that exist, after the lists changed under them.
+	void ClampToValidNodes();
+
+	// Shows the current line and options again, if this conversation is on screen.
+	void RefreshSubtitles();
+
 	// This begins the process of printing letters on-to the screen.
 	UFUNCTION()
-	void TypewriterEffect(FString CurString);
+	void TypewriterEffect(const FString& CurString);
 	UFUNCTION()
-	void AddLetter(FString Letter, float Time);
+	void AddLetter(const FString& Letter, float Time);
 	UFUNCTION()
-	FString GetLetter(FString CompleteString, int32 start);
+	FString GetLetter(const FString& CompleteString, int32 start);
 	UFUNCTION()
 	void TimerEnd();
 
+	void PlayVoice();
+
+	// Starts the current subtitle's voice line and times its letters, if the line has a baked envelope.
+	void StartVoiceLine(const FString& CurString);
+	// Cuts the voice line off, the rest of its letters are paced by the subtitle's timer.
+	void StopVoiceLine();
+	// Stops typing the current line and its voice line.
+	void StopTypewriter();
+	// How long until the current letter should appear.
+	float GetLetterDelay(const FString& CurString) const;
+
 	// Overlap Functions
 	UFUNCTION()
 	void OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -2,6 +2,14 @@
 
 
 #include "AInfoBox.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueLocalization.h"
+#include "ProgressSaveSubsystem.h"
+#include "GameplayEvents.h"
+#include "HitchMonitor.h"
+#include "StartupProfiler.h"
+#include "WorldStateSubsystem.h"
 
 /*
  * Function:  BeginPlay
@@ -11,10 +19,136 @@
  */
 void AAInfoBox::BeginPlay() 
 {
+	HB_HITCH_SCOPE("Load.InfoBoxBeginPlay");
+	HB_LLM_SCOPE(Interactables);
+	HB_STARTUP_SCOPE("BeginPlay", this);
+
 	// These allow the conversation instance to recognize collison with an actor.
 	GetCollisionComponent()->OnComponentBeginOverlap.AddDynamic(this, &AAInfoBox::OnBeginOverlap);
 	GetCollisionComponent()->OnComponentEndOverlap.AddDynamic(this, &AAInfoBox::OnEndOverlap);
 	PrimaryActorTick.bCanEverTick = true;
+
+	RegisterInlineItem();
+	const FItemDefinition& Item = GetItem();
+
+	FGameplayEventBus::Get().Subscribe<FDialogueAnswerEvent>(this, [this](const FDialogueAnswerEvent& Event)
+	{
+		if (Event.Interactable == this)
+			InputIndex = Event.Answer;
+	});
+
+	if (UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(this))
+		SaveSubsystem->Restore(*this);
+
+	if (UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this))
+	{
+		FString Error;
+		ConditionProgram = WorldStateScript.CompileCondition(Item.Condition, *WorldState, &Error);
+		if (Error.IsEmpty())
+			TrueActionProgram = WorldStateScript.CompileAction(Item.TrueAction, *WorldState, &Error);
+		if (Error.IsEmpty())
+			FalseActionProgram = WorldStateScript.CompileAction(Item.FalseAction, *WorldState, &Error);
+
+		if (!Error.IsEmpty())
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: %s."), *GetName(), *Error);
+	}
+}
+
+void AAInfoBox::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FGameplayEventBus::Get().UnsubscribeAll(this);
+	FDialogueLocalization::Get().OnCultureChanged().RemoveAll(this);
+	Super::EndPlay(EndPlayReason);
+}
+
+/*
+ * Function:  RegisterInlineItem
+ * --------------------
+ * Info boxes placed before the item table keep their item's text themselves, and many of them share an ID.
+ * 1) A box whose ID the table has reads the table's item.
+ * 2) Otherwise the box uses its own text, localized like the table's items.
+ * 3) The first box with the ID also adds it to the item database for the inventory and the search. Boxes
+ *    sharing it with different text still show their own, but the inventory names the item after the first.
+ *
+ */
+void AAInfoBox::RegisterInlineItem()
+{
+	FItemDatabase& Database = FItemDatabase::Get();
+	InlineItem = FItemDefinition();
+	if (Database.Contains(CurrentItem.ItemID) && !Database.IsInlineItem(CurrentItem.ItemID))
+		return;
+
+	FDialogueStringTable& Strings = FDialogueStringTable::Get();
+	InlineItem.ItemID = CurrentItem.ItemID;
+	InlineItem.Name = Strings.Intern(CurrentItem.ItemName);
+	InlineItem.Description = Strings.Intern(CurrentItem.ItemDescription);
+	InlineItem.Condition = CurrentItem.Condition;
+	InlineItem.TrueAction = CurrentItem.TrueAction;
+	InlineItem.FalseAction = CurrentItem.FalseAction;
+	InlineItem.Type = CurrentItem.ItemType;
+	InlineItem.bHasQuestion = CurrentItem.bHasQuestion;
+	FDialogueLocalization::Get().LocalizeItem(InlineItem);
+	FDialogueLocalization::Get().OnCultureChanged().AddUObject(this, &AAInfoBox::HandleCultureChanged);
+
+	const FItemDefinition* Registered = Database.AddInlineItem(InlineItem);
+	if (Registered == nullptr)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: item ID %d is out of range."), *GetName(), CurrentItem.ItemID);
+	}
+	else if (Registered->Name != InlineItem.Name || Registered->Description != InlineItem.Description || Registered->Condition != InlineItem.Condition ||
+		Registered->TrueAction != InlineItem.TrueAction || Registered->FalseAction != InlineItem.FalseAction ||
+		Registered->Type != InlineItem.Type || Registered->bHasQuestion != InlineItem.bHasQuestion)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: another info box already uses item ID %d for a different item (%s), give this one an ID of its own."),
+			*GetName(), CurrentItem.ItemID, *Registered->GetName());
+	}
+}
+
+void AAInfoBox::HandleCultureChanged()
+{
+	FDialogueLocalization::Get().LocalizeItem(InlineItem);
+}
+
+/*
+ * Function:  GetResourceSizeEx
+ * --------------------
+ * The box's own item text and its compiled condition and actions. A table item is in the item database.
+ *
+ */
+void AAInfoBox::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(CurrentItem.ItemName.GetAllocatedSize() + CurrentItem.ItemDescription.GetAllocatedSize() +
+		CurrentItem.Condition.GetAllocatedSize() + CurrentItem.TrueAction.GetAllocatedSize() + CurrentItem.FalseAction.GetAllocatedSize() +
+		InlineItem.Condition.GetAllocatedSize() + InlineItem.TrueAction.GetAllocatedSize() + InlineItem.FalseAction.GetAllocatedSize() +
+		WorldStateScript.GetAllocatedSize());
+}
+
+/*
+ * Function:  TrueCondition/FalseCondition
+ * --------------------
+ * The answer to the info box's question is kept in the world state by the item's actions.
+ *
+ */
+void AAInfoBox::TrueCondition()
+{
+	IIBaseInteractable::TrueCondition();
+	if (UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this))
+		WorldStateScript.Execute(TrueActionProgram, *WorldState);
+}
+
+void AAInfoBox::FalseCondition()
+{
+	IIBaseInteractable::FalseCondition();
+	if (UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this))
+		WorldStateScript.Execute(FalseActionProgram, *WorldState);
+}
+
+bool AAInfoBox::IsQuestionAvailable(const FItemDefinition& InteractableItem) const
+{
+	const UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(this);
+	return WorldState == nullptr || WorldStateScript.Evaluate(ConditionProgram, *WorldState);
 }
 
 /*
@@ -25,12 +159,16 @@ void AAInfoBox::BeginPlay()
  */
 void AAInfoBox::OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	HB_HITCH_SCOPE("Overlap.InfoBox");
 	// Other Actor is the actor that triggered the event. Check that is not ourself.  
 	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
 	{
+		HB_LLM_SCOPE(Interactables);
+		FHitchMonitor::Get().SetActiveInfoBox(this);
 		CurrentPhase = EInteractablePhase::SD_OVERLAP;
-		PrintInteractableName(CurrentItem);
+		PrintInteractableName(GetItem());
 		bInCollision = true;
+		FGameplayEventBus::Get().Post(FInteractableOverlapEvent{ this, OtherActor, true });
 	}
 }
 
@@ -47,5 +185,6 @@ void AAInfoBox::OnEndOverlap(UPrimitiveComponent* HitComp, AActor* OtherActor, U
 	{
 		CurrentPhase = EInteractablePhase::SD_NO_OVERLAP;
 		bInCollision = false;
+		FGameplayEventBus::Get().Post(FInteractableOverlapEvent{ this, OtherActor, false });
 	}
 }
@@ -24,6 +24,8 @@
 #include "Engine/World.h" 
 #include "GameFramework/Actor.h"
 #include "IBaseInteractable.h"
+#include "ItemDatabase.h"
+#include "WorldStateScript.h"
 #include "AInfoBox.generated.h"
 
 
@@ -35,6 +37,7 @@ class HEAVENLYBLUE_API AAInfoBox : public ATriggerBox, public IIBaseInteractable
 public:
 	UFUNCTION()
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "InfoBox Properties")
 	FInteractableInfo CurrentItem;
@@ -42,8 +45,32 @@ public:
 	UPROPERTY()
 	bool bInCollision;
 
+	// The item of CurrentItem.ItemID, or the box's own if the item table doesn't have the ID.
+	const FItemDefinition& GetItem() const { return InlineItem.IsValid() ? InlineItem : FItemDatabase::Get().GetItem(CurrentItem.ItemID); }
+
+	// These run the item's TrueAction/FalseAction.
+	virtual void TrueCondition() override;
+	virtual void FalseCondition() override;
+	virtual bool IsQuestionAvailable(const FItemDefinition& InteractableItem) const override;
+
+	// The runtime heap of this info box, for the memory report (see FHeavenlyBlueMemoryReport).
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
 protected:
 private:
+	// The item's condition and actions, compiled in BeginPlay.
+	FWorldStateScript WorldStateScript;
+	FWorldStateProgram ConditionProgram;
+	FWorldStateProgram TrueActionProgram;
+	FWorldStateProgram FalseActionProgram;
+
+	// CurrentItem's own text, when the item table doesn't have its ID.
+	FItemDefinition InlineItem;
+
+	// Makes InlineItem from CurrentItem if the item table doesn't have its ID.
+	void RegisterInlineItem();
+	void HandleCultureChanged();
+
 	// Overlap Functions
 	UFUNCTION()
 	void OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
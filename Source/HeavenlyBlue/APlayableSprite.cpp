@@ -1,5 +1,17 @@
 #include "APlayableSprite.h"
+#include "CameraOcclusion.h"
+#include "CameraRig.h"
+#include "GameplayEvents.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueHistory.h"
+#include "Inventory.h"
+#include "HitchMonitor.h"
+#include "StartupProfiler.h"
 #include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
 
 /*
  * Function:  AAPlayableSprite
@@ -8,11 +20,17 @@
  *
  */
 AAPlayableSprite::AAPlayableSprite() :
+FacingInterpSpeed(10.0f),
+PresentationSendInterval(0.05f),
 CurCapsuleSettings(130.0f, 40.0f),
 DEAD_ZONE(0.5),
 CurSpringArmIndex(0),
 MouseSensitivity(9.0f),
-bInAlternativeState(false)
+bInAlternativeState(false),
+LastPresentationSendTime(0.0f),
+bPresentationResendPending(false),
+SmoothedFacingYaw(0.0f),
+bHasSmoothedFacing(false)
 {
 	if(ConversationCollection.IsValidIndex(0))
 		ConversationCollection[0]->SetNodeID(0, 0, 0);
@@ -41,11 +59,16 @@ bInAlternativeState(false)
 	SpringArm->bEnableCameraLag = true;
 	SpringArm->CameraLagSpeed = 6.0f;
 	SpringArm->bDrawDebugLagMarkers = true;
+	// The dorm's corridors would pull the camera into the walls, CameraOcclusion fades them instead.
+	SpringArm->bDoCollisionTest = false;
 
 	//Camera Base Settings
 	FollowCamera = CreateDefaultSubobject<UAFollowCamera>(TEXT("Camera"));
 	FollowCamera->SetupAttachment(SpringArm, USpringArmComponent::SocketName);
 
+	CameraOcclusion = CreateDefaultSubobject<UCameraOcclusionComponent>(TEXT("Camera Occlusion"));
+	CameraRig = CreateDefaultSubobject<UCameraRigComponent>(TEXT("Camera Rig"));
+
 	//Exclamation Icon Settings
 	ExclamationIcon = CreateDefaultSubobject<UPaperSpriteComponent>(TEXT("Exclamation Icon"));
 	ExclamationIcon->SetupAttachment(GetSprite());
@@ -64,32 +87,181 @@ bInAlternativeState(false)
  */
 void AAPlayableSprite::BeginPlay()
 {
+	HB_LLM_SCOPE(Sprites);
+	HB_STARTUP_SCOPE("BeginPlay", this);
+
 	Super::BeginPlay();
 	GEngine->GameViewport->Viewport->LockMouseToViewport(true);
+	CameraRig->Initialize(SpringArm, CurSpringArmIndex);
+
+
+	// Every level loaded now, streamed ones that show up later register through HandleLevelAdded.
+	for (ULevel* Level : GetWorld()->GetLevels())
+		RegisterInteractables(Level);
 
+	FWorldDelegates::LevelAddedToWorld.AddUObject(this, &AAPlayableSprite::HandleLevelAdded);
+	FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &AAPlayableSprite::HandleLevelRemoved);
 
-	// The GetAllActorsOfClass requires the output be an actor just like that of the orignal class.
-	// To directly reference a AConversationInstance object, the FoundConversationInstances must be casted to it.
-	TArray<AActor*> FoundConversationInstances;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AAConversationInstance::StaticClass(), FoundConversationInstances);
-	for (auto FoundConversationCollection : FoundConversationInstances)
+	FGameplayEventBus& Events = FGameplayEventBus::Get();
+	Events.Subscribe<FInteractableOverlapEvent>(this, [this](const FInteractableOverlapEvent& Event) { HandleInteractableOverlap(Event); });
+	Events.Subscribe<FInteractableFinishedEvent>(this, [this](const FInteractableFinishedEvent& Event) { UpdateExclamationIcon(); });
+	Events.Subscribe<FInventoryChangedEvent>(this, [this](const FInventoryChangedEvent& Event)
 	{
-		AAConversationInstance* Output = Cast<AAConversationInstance>(FoundConversationCollection);
+		if (Event.Delta > 0 && IsLocallyControlled() && Event.Inventory == UInventorySubsystem::Get(this))
+			Message("Picked up " + FItemDatabase::Get().GetItem(Event.ItemID).GetName());
+	});
+}
+
+void AAPlayableSprite::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FWorldDelegates::LevelAddedToWorld.RemoveAll(this);
+	FWorldDelegates::LevelRemovedFromWorld.RemoveAll(this);
+	FGameplayEventBus::Get().UnsubscribeAll(this);
 
-		if (Output != nullptr)
-			ConversationCollection.Add(Output);
+	Super::EndPlay(EndPlayReason);
+}
+
+/*
+ * Function:  RegisterInteractables
+ * --------------------
+ * Adds the level's conversation instances and info boxes to the collections.
+ *
+ */
+void AAPlayableSprite::RegisterInteractables(ULevel* Level)
+{
+	if (Level == nullptr)
+		return;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (AAConversationInstance* Conversation = Cast<AAConversationInstance>(Actor))
+			ConversationCollection.AddUnique(Conversation);
+		else if (AAInfoBox* InfoBox = Cast<AAInfoBox>(Actor))
+			InfoBoxCollection.AddUnique(InfoBox);
 	}
+}
+
+/*
+ * Function:  UnregisterInteractables
+ * --------------------
+ * 1) Removes the level's conversation instances and info boxes (and any that are already gone).
+ * 2) If the one being used went with them, the player leaves the interaction.
+ * 3) The collection IDs are pointed back at a valid entry.
+ *
+ */
+void AAPlayableSprite::UnregisterInteractables(ULevel* Level)
+{
+	const AAConversationInstance* CurrentConversation = ConversationCollection.IsValidIndex(ConversationCollectionID) ? ConversationCollection[ConversationCollectionID] : nullptr;
+	const AAInfoBox* CurrentInfoBox = InfoBoxCollection.IsValidIndex(InfoBoxCollectionID) ? InfoBoxCollection[InfoBoxCollectionID] : nullptr;
 
-	TArray<AActor*> FoundInfoBoxInstance;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AAInfoBox::StaticClass(), FoundInfoBoxInstance);
-	for (auto FoundInfoBoxCollection : FoundInfoBoxInstance)
+	const int32 RemovedConversations = ConversationCollection.RemoveAll([Level](const AAConversationInstance* Conversation)
+	{
+		return !IsValid(Conversation) || Conversation->GetLevel() == Level;
+	});
+	const int32 RemovedInfoBoxes = InfoBoxCollection.RemoveAll([Level](const AAInfoBox* InfoBox)
 	{
-		AAInfoBox* Output = Cast<AAInfoBox>(FoundInfoBoxCollection);
+		return !IsValid(InfoBox) || InfoBox->GetLevel() == Level;
+	});
+
+	if (RemovedConversations == 0 && RemovedInfoBoxes == 0)
+		return;
 
-		if (Output != nullptr)
-			InfoBoxCollection.Add(Output);
+	const bool bLostConversation = CurrentConversation != nullptr && !ConversationCollection.Contains(CurrentConversation);
+	const bool bLostInfoBox = CurrentInfoBox != nullptr && !InfoBoxCollection.Contains(CurrentInfoBox);
+	if (bInAlternativeState && (bLostConversation || bLostInfoBox))
+	{
+		bInAlternativeState = false;
+		CurSpriteState = EMainSpriteState::SA_Idle;
 	}
 
+	ConversationCollectionID = FMath::Max(ConversationCollection.IndexOfByKey(CurrentConversation), 0);
+	InfoBoxCollectionID = FMath::Max(InfoBoxCollection.IndexOfByKey(CurrentInfoBox), 0);
+	UpdateExclamationIcon();
+}
+
+/*
+ * Function:  HandleInteractableOverlap
+ * --------------------
+ * 1) Only the sprite's own overlaps count.
+ * 2) Entering a conversation or info box makes it the one interacting picks, and the one the icon is shown for.
+ *
+ */
+void AAPlayableSprite::HandleInteractableOverlap(const FInteractableOverlapEvent& Event)
+{
+	if (Event.Other != this)
+		return;
+
+	if (AAConversationInstance* Conversation = Cast<AAConversationInstance>(Event.Interactable.Get()))
+	{
+		if (Event.bBegin)
+		{
+			const int32 Index = ConversationCollection.IndexOfByKey(Conversation);
+			if (Index != INDEX_NONE)
+				ConversationCollectionID = Index;
+			OverlappedConversation = Conversation;
+		}
+		else if (OverlappedConversation == Conversation)
+		{
+			OverlappedConversation = nullptr;
+		}
+	}
+	else if (AAInfoBox* InfoBox = Cast<AAInfoBox>(Event.Interactable.Get()))
+	{
+		if (Event.bBegin)
+		{
+			const int32 Index = InfoBoxCollection.IndexOfByKey(InfoBox);
+			if (Index != INDEX_NONE)
+				InfoBoxCollectionID = Index;
+			OverlappedInfoBox = InfoBox;
+		}
+		else if (OverlappedInfoBox == InfoBox)
+		{
+			OverlappedInfoBox = nullptr;
+		}
+	}
+	UpdateExclamationIcon();
+}
+
+/*
+ * Function:  UpdateExclamationIcon
+ * --------------------
+ * The icon shows over the sprite while it's in a conversation's or info box's trigger and free to interact: not already
+ * interacting, not turning the camera, and not at an info box whose question has been answered.
+ *
+ */
+void AAPlayableSprite::UpdateExclamationIcon()
+{
+	const AAInfoBox* InfoBox = OverlappedInfoBox.Get();
+	const bool bInfoBoxOpen = InfoBox != nullptr && !(InfoBox->GetItem().bHasQuestion && InfoBox->bFinished);
+	ExclamationIcon->SetVisibility(!bInAlternativeState && CurYaw == 0.0f && (OverlappedConversation.IsValid() || bInfoBoxOpen));
+}
+
+void AAPlayableSprite::HandleLevelAdded(ULevel* Level, UWorld* World)
+{
+	HB_HITCH_SCOPE("Load.LevelAdded");
+	if (World == GetWorld())
+		RegisterInteractables(Level);
+}
+
+void AAPlayableSprite::HandleLevelRemoved(ULevel* Level, UWorld* World)
+{
+	if (World == GetWorld())
+		UnregisterInteractables(Level);
+}
+
+/*
+ * Function:  GetResourceSizeEx
+ * --------------------
+ * The sprite's detail arrays and collections. The flipbooks and their textures are assets,
+ * the memory report counts those on their own.
+ *
+ */
+void AAPlayableSprite::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(SpriteDetails.GetAllocatedSize() + SpringArmDetails.GetAllocatedSize() +
+		ConversationCollection.GetAllocatedSize() + InfoBoxCollection.GetAllocatedSize());
 }
 
 /*
@@ -117,21 +289,21 @@ void AAPlayableSprite::Message(FString Statement)
  */
 void AAPlayableSprite::Tick(float DeltaTime)
 {
+	HB_HITCH_SCOPE("Sprite.Tick");
 	Super::Tick(DeltaTime);
 
+	// Sprites controlled on another machine: simulated proxies on clients, and remote players' sprites on the server.
+	if (IsLocallyControlled())
+		UpdatePresentation();
+	else if (GetLocalRole() == ROLE_SimulatedProxy || GetRemoteRole() == ROLE_AutonomousProxy)
+		ApplyReplicatedPresentation(DeltaTime);
+
 	SetSpriteAnimation(CurDirection, CurSpriteState);
 
 	// During the diagonal movement, both the X and Y vectors are combined thus making the character move 
 	// double the normal speed, this is fixed by normalizing the vector.
 	MovementDisplacement.Normalize();
 
-	// The spring arm's axis are changed to better represent how they appear visually in the blueprint editor
-	SpringArm->SetRelativeLocation(FVector(-SpringArmDetails[CurSpringArmIndex].CustomTargetPosition.Z, 
-										    -SpringArmDetails[CurSpringArmIndex].CustomTargetPosition.X, 
-										   -SpringArmDetails[CurSpringArmIndex].CustomTargetPosition.Y));
-
-	SpringArm->TargetArmLength = SpringArmDetails[CurSpringArmIndex].CustomTargetArmLength;
-
 	// The sprite needs to be facing the camera at all times.
 	// Using GetPlayerCameraManager function, you're able to find the current active camera without specifing it directly.
 	FRotator PlayerRot = UKismetMathLibrary::FindLookAtRotation(this->GetActorLocation(), UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0)->GetCameraLocation());
@@ -139,52 +311,169 @@ void AAPlayableSprite::Tick(float DeltaTime)
 	// subtracts 90 from Yaw because the sprite begins with a yaw of +90, and keeps roll.
 	FRotator Convert = FRotator(0.0f, PlayerRot.Yaw-90.0f, PlayerRot.Roll);
 	GetSprite()->SetRelativeRotation(Convert);
+}
 
-	if (ConversationCollection.IsValidIndex(0))
+
+/*
+ * Function:  FSpritePresentation
+ * --------------------
+ * Only the 5 bits the direction and state use and the quantized yaw go on the wire.
+ *
+ */
+uint64 FSpritePresentation::BitsWritten = 0;
+uint64 FSpritePresentation::BitsRead = 0;
+double FSpritePresentation::StatsStartTime = 0.0;
+
+FSpritePresentation FSpritePresentation::Make(EMainSpriteDirection Direction, EMainSpriteState State, float Yaw)
+{
+	FSpritePresentation Presentation;
+	Presentation.DirectionAndState = (uint8(Direction) & 0x7) | ((uint8(State) & 0x3) << 3);
+	Presentation.QuantizedYaw = FRotator::CompressAxisToByte(Yaw);
+	return Presentation;
+}
+
+bool FSpritePresentation::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	if (StatsStartTime == 0.0)
+		StatsStartTime = FPlatformTime::Seconds();
+
+	uint32 Packed = DirectionAndState;
+	Ar.SerializeInt(Packed, 32);
+	Ar << QuantizedYaw;
+
+	if (Ar.IsLoading())
 	{
-		for (int i = 0; i < ConversationCollection.Num(); i++)
-		{
-			if (ConversationCollection[i]->bInCollision)
-				ConversationCollectionID = i;
+		DirectionAndState = uint8(Packed);
+		BitsRead += 5 + 8;
+	}
+	else
+	{
+		BitsWritten += 5 + 8;
+	}
 
-			if (!bInAlternativeState && ConversationCollection[i]->bInCollision)
-			{
-				ExclamationIcon->SetVisibility(true);
-			}
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
 
-			if (bInAlternativeState || !ConversationCollection[i]->bInCollision || (FMath::Abs(CurYaw) > 0.0f))
-			{
-				ExclamationIcon->SetVisibility(false);
-			}
-		}
+void AAPlayableSprite::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owner already shows its own direction and state.
+	DOREPLIFETIME_CONDITION(AAPlayableSprite, ReplicatedPresentation, COND_SkipOwner);
+}
+
+/*
+ * Function:  UpdatePresentation
+ * --------------------
+ * 1) Pack the direction, state and camera yaw. Nothing happens while they're the same as what was sent.
+ * 2) On the server, setting the property is enough, it's compared and sent with the actor's updates.
+ * 3) A client sends it to the server. Turning the camera changes the yaw every frame, so yaw-only changes
+ *    are held to PresentationSendInterval, and the last one is sent again in case it was dropped.
+ *
+ */
+void AAPlayableSprite::UpdatePresentation()
+{
+	const FSpritePresentation Presentation = FSpritePresentation::Make(CurDirection, CurSpriteState, SpringArm->GetDesiredRotation().Yaw);
+
+	if (HasAuthority())
+	{
+		ReplicatedPresentation = Presentation;
+		return;
 	}
 
-	if (InfoBoxCollection.IsValidIndex(0))
+	const float Now = GetWorld()->GetTimeSeconds();
+	const bool bChanged = Presentation != SentPresentation;
+	const bool bDirectionOrStateChanged = Presentation.DirectionAndState != SentPresentation.DirectionAndState;
+	const bool bIntervalElapsed = Now - LastPresentationSendTime >= PresentationSendInterval;
+
+	if ((bChanged && (bDirectionOrStateChanged || bIntervalElapsed)) || (!bChanged && bPresentationResendPending && Now - LastPresentationSendTime >= 10.0f * PresentationSendInterval))
 	{
-		for (int i = 0; i < InfoBoxCollection.Num(); i++)
-		{
-			if (InfoBoxCollection[i]->bInCollision)
-				InfoBoxCollectionID = i;
+		ServerSetPresentation(Presentation);
+		bPresentationResendPending = bChanged;
+		SentPresentation = Presentation;
+		LastPresentationSendTime = Now;
+	}
+}
 
-			if (!bInAlternativeState && InfoBoxCollection[i]->bInCollision)
-			{
-				ExclamationIcon->SetVisibility(true);
-			}
-			
-			if (InfoBoxCollection[InfoBoxCollectionID]->CurrentItem.bHasQuestion && 
-					InfoBoxCollection[InfoBoxCollectionID]->bFinished)
-			{
-				ExclamationIcon->SetVisibility(false);
-			}
+void AAPlayableSprite::ServerSetPresentation_Implementation(FSpritePresentation Presentation)
+{
+	ReplicatedPresentation = Presentation;
+}
 
-			if (bInAlternativeState || !InfoBoxCollection[i]->bInCollision || (FMath::Abs(CurYaw) > 0.0f))
-			{
-				ExclamationIcon->SetVisibility(false);
-			}
-		}
+bool AAPlayableSprite::ServerSetPresentation_Validate(FSpritePresentation Presentation)
+{
+	return Presentation.DirectionAndState < (1 << 5);
+}
+
+/*
+ * Function:  ApplyReplicatedPresentation
+ * --------------------
+ * The owner's direction is relative to its own camera. Added to that camera's yaw it is a facing in the world,
+ * which is interpolated so the sprite turns through the directions in between instead of snapping. The direction
+ * drawn is that facing relative to the camera looking at the sprite here.
+ *
+ */
+void AAPlayableSprite::ApplyReplicatedPresentation(float DeltaTime)
+{
+	const float TargetYaw = FRotator::NormalizeAxis(ReplicatedPresentation.GetYaw() + uint8(ReplicatedPresentation.GetDirection()) * 45.0f);
+	if (!bHasSmoothedFacing)
+	{
+		SmoothedFacingYaw = TargetYaw;
+		bHasSmoothedFacing = true;
 	}
+	else
+	{
+		SmoothedFacingYaw = FMath::RInterpTo(FRotator(0.0f, SmoothedFacingYaw, 0.0f), FRotator(0.0f, TargetYaw, 0.0f), DeltaTime, FacingInterpSpeed).Yaw;
+	}
+
+	const APlayerCameraManager* Viewer = UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0);
+	const float ViewerYaw = Viewer ? Viewer->GetCameraRotation().Yaw : 0.0f;
+	const int32 Direction = FMath::RoundToInt(FRotator::ClampAxis(SmoothedFacingYaw - ViewerYaw) / 45.0f) % 8;
+
+	CurDirection = EMainSpriteDirection(Direction);
+	CurSpriteState = ReplicatedPresentation.GetState();
 }
 
+/*
+ * Console Command:  HB.Net.SpriteStats [reset]
+ * --------------------
+ * Logs the bandwidth the sprite presentation uses, per sprite. Play as a listen server with a client (or two PIE players)
+ * and run it on either side: the server's sent bits are the replicated property, the client's the RPC.
+ * Packet and property headers aren't counted, "stat net" shows the totals.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GSpriteStatsCommand(
+	TEXT("HB.Net.SpriteStats"),
+	TEXT("Logs the bytes per second each sprite's replicated presentation uses. Usage: HB.Net.SpriteStats [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr)
+			return;
+
+		if (FSpritePresentation::StatsStartTime == 0.0)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("No sprite presentation has been replicated yet."));
+			return;
+		}
+
+		const double Seconds = FMath::Max(FPlatformTime::Seconds() - FSpritePresentation::StatsStartTime, 1e-3);
+		int32 Sprites = 0;
+		for (TActorIterator<AAPlayableSprite> It(World); It; ++It)
+			Sprites++;
+
+		const double PerSprite = 1.0 / (FMath::Max(Sprites, 1) * 8.0 * Seconds);
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%s, %d sprites over %.1f s: %.2f B/s sent and %.2f B/s received per sprite (%llu / %llu bits)."),
+			World->GetNetMode() == NM_ListenServer ? TEXT("Listen server") : World->GetNetMode() == NM_Client ? TEXT("Client") : TEXT("Standalone"),
+			Sprites, Seconds, FSpritePresentation::BitsWritten * PerSprite, FSpritePresentation::BitsRead * PerSprite,
+			FSpritePresentation::BitsWritten, FSpritePresentation::BitsRead);
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			FSpritePresentation::BitsWritten = 0;
+			FSpritePresentation::BitsRead = 0;
+			FSpritePresentation::StatsStartTime = FPlatformTime::Seconds();
+		}
+	}));
 
  /* Function:  SetSpriteAnimation
  * --------------------
@@ -196,13 +485,71 @@ void AAPlayableSprite::Tick(float DeltaTime)
  */
 void AAPlayableSprite::SetSpriteAnimation(EMainSpriteDirection Dir, EMainSpriteState State)
 {
-	if (FindArrayIndex(CurDirection, CurSpriteState) < SpriteDetails.Num())
+	int32 Index = FindArrayIndex(CurDirection, CurSpriteState);
+	if (Index < SpriteDetails.Num())
 	{
-		GetSprite()->SetFlipbook(SpriteDetails[FindArrayIndex(CurDirection, CurSpriteState)].PFB_Animation);
+		UPaperFlipbook* Animation = SpriteDetails[Index].PFB_Animation;
+		bool bMirror = false;
+
+		// Mirrored entries borrow the flipbook of the opposite direction and flip it.
+		if (SpriteDetails[Index].bMirrored)
+		{
+			int32 SourceIndex = FindMirrorSourceIndex(SpriteDetails[Index].MirrorDirection, SpriteDetails[Index].SpriteState);
+			if (SourceIndex != INDEX_NONE)
+			{
+				Animation = SpriteDetails[SourceIndex].PFB_Animation;
+				bMirror = true;
+			}
+		}
+
+		GetSprite()->SetFlipbook(Animation);
+		SetSpriteMirrored(bMirror);
 		GetCapsuleComponent()->SetCapsuleSize(CurCapsuleSettings.Y, CurCapsuleSettings.X);
 	}
 }
 
+/*
+ * Function:  FindMirrorSourceIndex
+ * --------------------
+ * This finds the entry that a mirrored entry is based on. The source itself can't be a mirror,
+ * otherwise two entries could point at each other.
+ *
+ * Dir: The direction the mirrored entry copies.
+ * State: The state of the mirrored entry, the source must match it.
+ *
+ */
+int32 AAPlayableSprite::FindMirrorSourceIndex(EMainSpriteDirection Dir, EMainSpriteState State) const
+{
+	for (int i = 0; i < SpriteDetails.Num(); i++)
+	{
+		if (SpriteDetails[i].Direction == Dir && SpriteDetails[i].SpriteState == State && !SpriteDetails[i].bMirrored)
+			return i;
+	}
+
+	return INDEX_NONE;
+}
+
+/*
+ * Function:  SetSpriteMirrored
+ * --------------------
+ * The sprite is drawn on the X/Z plane, so flipping the sign of the X scale mirrors it horizontally.
+ * The scale is only written when it actually changes since this is called every frame.
+ *
+ * bMirror: True if the sprite should face the opposite way of its flipbook.
+ *
+ */
+void AAPlayableSprite::SetSpriteMirrored(bool bMirror)
+{
+	FVector Scale = GetSprite()->GetRelativeScale3D();
+	float MirroredX = bMirror ? -FMath::Abs(Scale.X) : FMath::Abs(Scale.X);
+
+	if (Scale.X != MirroredX)
+	{
+		Scale.X = MirroredX;
+		GetSprite()->SetRelativeScale3D(Scale);
+	}
+}
+
 /*
 /*
  * Function:  FindArrayIndex
@@ -265,6 +612,9 @@ void AAPlayableSprite::SetupPlayerInputComponent(class UInputComponent* Internal
 	InternalInputComponent->BindAction("Sprint", IE_Repeat, this, &AAPlayableSprite::SprintSelected);
 	InternalInputComponent->BindAction("Sprint", IE_Released, this, &AAPlayableSprite::SprintReleased);
 
+	// Dialogue backlog
+	InternalInputComponent->BindAction("Backlog", IE_Pressed, this, &AAPlayableSprite::BacklogSelected);
+
 	//Debug
 	InternalInputComponent->BindAction("Option1", IE_Pressed, this, &AAPlayableSprite::Option1Selected);
 	InternalInputComponent->BindAction("Option1", IE_Released, this, &AAPlayableSprite::Option1Released);
@@ -403,12 +753,12 @@ void AAPlayableSprite::YawRotation(float AxisValue)
 	// The rotation values are altered because of the orientation of the character in world space 
 	if (!bInAlternativeState)
 	{
+		const bool bWasTurning = CurYaw != 0.0f;
 		CurYaw = FMath::Clamp<float>(AxisValue, -1.0f, 1.0f);
-		// MOUSE_SENSITIVITY functions as the speed value.
-		SpringArmDetails[CurSpringArmIndex].CustomTargetRotation.Roll -= (CurYaw * MouseSensitivity);
-		SpringArm->SetRelativeRotation(FRotator(-SpringArmDetails[CurSpringArmIndex].CustomTargetRotation.Pitch,
-												-SpringArmDetails[CurSpringArmIndex].CustomTargetRotation.Roll,
-												-SpringArmDetails[CurSpringArmIndex].CustomTargetRotation.Yaw));
+		if (bWasTurning != (CurYaw != 0.0f))
+			UpdateExclamationIcon();
+		// MOUSE_SENSITIVITY functions as the speed value. The arm is left alone while there's no input.
+		CameraRig->AddYaw(CurYaw * MouseSensitivity);
 
 		float SpringArmRotation;
 		// Because the input axis is -1 to 1, going left of 0 degrees makes it -180 to 0 from middle to left.
@@ -457,7 +807,12 @@ void AAPlayableSprite::YawRotation(float AxisValue)
  *
  *
  */
-void AAPlayableSprite::InventorySelected() { Message("Inventory Selected"); }
+void AAPlayableSprite::InventorySelected()
+{
+	Message("Inventory Selected");
+	if (UInventorySubsystem* Inventory = UInventorySubsystem::Get(this))
+		Inventory->PrintInventory();
+}
 
 void AAPlayableSprite::InventoryReleased(){ Message("Inventory Released"); }
 
@@ -496,13 +851,16 @@ void AAPlayableSprite::SprintReleased()
 	MouseSensitivity = 9.0f;
 }
 
+void AAPlayableSprite::BacklogSelected()
+{
+	if (UDialogueHistorySubsystem* History = UDialogueHistorySubsystem::Get(this))
+		History->ToggleBacklog();
+}
+
 void AAPlayableSprite::Option1Selected() {
 	Message("Option 1 Selected");
 	Choice = 1;
-	if (ConversationCollection.IsValidIndex(ConversationCollectionID))
-		ConversationCollection[ConversationCollectionID]->CurrentQuestionIteration = Choice;
-	if (InfoBoxCollection.IsValidIndex(InfoBoxCollectionID))
-		InfoBoxCollection[InfoBoxCollectionID]->InputIndex = Choice;
+	PostAnswer();
 }
 
 void AAPlayableSprite::Option1Released() { Message("Option 1 Released"); }
@@ -511,14 +869,33 @@ void AAPlayableSprite::Option2Selected()
 {
 	Message("Option 2 Selected");
 	Choice = 2;
-	if(ConversationCollection.IsValidIndex(ConversationCollectionID))
-		ConversationCollection[ConversationCollectionID]->CurrentQuestionIteration = Choice;
-	if (InfoBoxCollection.IsValidIndex(InfoBoxCollectionID))
-		InfoBoxCollection[InfoBoxCollectionID]->InputIndex = Choice;
+	PostAnswer();
 }
 
 void AAPlayableSprite::Option2Released() { Message("Option 2 Released"); }
 
+/*
+ * Function:  PostAnswer
+ * --------------------
+ * The current conversation and info box take the choice when the event reaches them, at the start of the next frame.
+ *
+ */
+void AAPlayableSprite::PostAnswer()
+{
+	FDialogueAnswerEvent Event;
+	Event.Answer = Choice;
+	if (ConversationCollection.IsValidIndex(ConversationCollectionID))
+	{
+		Event.Interactable = ConversationCollection[ConversationCollectionID];
+		FGameplayEventBus::Get().Post(Event);
+	}
+	if (InfoBoxCollection.IsValidIndex(InfoBoxCollectionID))
+	{
+		Event.Interactable = InfoBoxCollection[InfoBoxCollectionID];
+		FGameplayEventBus::Get().Post(Event);
+	}
+}
+
 /*
  * Function: BEGIN INTERACTION FUNCTIONS
  * --------------------
@@ -527,6 +904,7 @@ void AAPlayableSprite::Option2Released() { Message("Option 2 Released"); }
  */
 void AAPlayableSprite::BeginConversationInteraction()
 {
+	HB_HITCH_SCOPE("Interact.Conversation");
 	// Set the conversation ID to be whatever the player is currently in collision with.
 	for (int i = 0; i < ConversationCollection.Num(); i++)
 	{
@@ -544,6 +922,8 @@ void AAPlayableSprite::BeginConversationInteraction()
 		FindArrayIndex(CurDirection, CurSpriteState);
 
 		bInAlternativeState = true;
+		FHitchMonitor::Get().SetActiveConversation(ConversationCollection[ConversationCollectionID]);
+		ConversationCollection[ConversationCollectionID]->EnsureConversationLoaded();
 
 		if (ConversationCollection[ConversationCollectionID]->bProceed && !ConversationCollection[ConversationCollectionID]->bInQuestion)
 		{
@@ -564,6 +944,7 @@ void AAPlayableSprite::BeginConversationInteraction()
 			ConversationCollection[ConversationCollectionID]->bSkippedText = true;
 		}
 	}
+	UpdateExclamationIcon();
 }
 
 /*
@@ -574,7 +955,8 @@ void AAPlayableSprite::BeginConversationInteraction()
  */
 void AAPlayableSprite::FinishConversationInteraction()
 {
-	if (ConversationCollection[ConversationCollectionID]->bFinished)
+	HB_HITCH_SCOPE("Interact.FinishConversation");
+	if (ConversationCollection.IsValidIndex(ConversationCollectionID) && ConversationCollection[ConversationCollectionID]->bFinished)
 	{
 		bInAlternativeState = false;
 		CurSpriteState = EMainSpriteState::SA_Idle;
@@ -592,10 +974,12 @@ void AAPlayableSprite::FinishConversationInteraction()
 			ConversationCollection[ConversationCollectionID]->bFinished = false;
 		}
 	}
+	UpdateExclamationIcon();
 }
 
 void AAPlayableSprite::BeginInfoBoxInteraction()
 {
+	HB_HITCH_SCOPE("Interact.InfoBox");
 	// Set the conversation ID to be whatever the player is currently in collision with.
 	for (int i = 0; i < InfoBoxCollection.Num(); i++)
 	{
@@ -613,24 +997,32 @@ void AAPlayableSprite::BeginInfoBoxInteraction()
 		FindArrayIndex(CurDirection, CurSpriteState);
 
 		bInAlternativeState = true;
+		FHitchMonitor::Get().SetActiveInfoBox(InfoBoxCollection[InfoBoxCollectionID]);
 
-		InfoBoxCollection[InfoBoxCollectionID]->Traverse(InfoBoxCollection[InfoBoxCollectionID]->CurrentItem);
+		InfoBoxCollection[InfoBoxCollectionID]->Traverse(InfoBoxCollection[InfoBoxCollectionID]->GetItem());
 	}
+	UpdateExclamationIcon();
 }
 
 void AAPlayableSprite::FinishInfoBoxInteraction()
 {
-	if (InfoBoxCollection[InfoBoxCollectionID]->bFinished)
+	HB_HITCH_SCOPE("Interact.FinishInfoBox");
+	if (InfoBoxCollection.IsValidIndex(InfoBoxCollectionID) && InfoBoxCollection[InfoBoxCollectionID]->bFinished)
 	{
 		bInAlternativeState = false;
 		CurSpriteState = EMainSpriteState::SA_Idle;
 
-		if (!InfoBoxCollection[InfoBoxCollectionID]->CurrentItem.bHasQuestion)
+		const FItemDefinition& Item = InfoBoxCollection[InfoBoxCollectionID]->GetItem();
+		if (!Item.bHasQuestion)
 		{
 			InfoBoxCollection[InfoBoxCollectionID]->bProceed = false;
 			InfoBoxCollection[InfoBoxCollectionID]->bFinished = false;
 			InfoBoxCollection[InfoBoxCollectionID]->InputIndex = 0;
 		}
+
+		// Save points write the progress here, see FInteractableHandlers.
+		FInteractableHandlers::Get(Item.Type).Finish(*InfoBoxCollection[InfoBoxCollectionID], Item, this);
 	}
+	UpdateExclamationIcon();
 }
 
@@ -84,6 +84,9 @@ enum class EMainSpriteState : uint8
  * It checks the curDirection and curSpriteState, and from that, it presents an animation
  * By doing this, the struct essentially works likes an dynamic array linked list, and allows
  * these struct components to be visible via. blueprints.
+ * Because the art is symmetric, an entry can be marked as a mirror of another direction. It then
+ * borrows that direction's flipbook (for the same state) and the sprite is flipped horizontally,
+ * so only one side of each Left/Right pair needs its own flipbook and textures.
  */
 USTRUCT(BlueprintType)
 struct FMainSpriteDetails
@@ -101,6 +104,13 @@ struct FMainSpriteDetails
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite State Properties")
 	class UPaperFlipbook* PFB_Animation;
+
+	// If true, PFB_Animation is ignored and the flipbook of MirrorDirection is drawn flipped instead.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite State Properties")
+	bool bMirrored = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite State Properties", meta = (EditCondition = "bMirrored"))
+	EMainSpriteDirection MirrorDirection = EMainSpriteDirection::SD_Forward;
 };
 
 /*
@@ -126,6 +136,53 @@ struct FMainSpringArmDetails
 	FRotator CustomTargetRotation;
 };
 
+/*
+ * Struct:  FSpritePresentation
+ * --------------------
+ * What other players need to draw a sprite: its direction and state, and the yaw of the camera the
+ * direction is relative to. NetSerialize sends 5 bits for the first two and a byte for the yaw, and
+ * the property only goes out when one of them changes.
+ */
+USTRUCT()
+struct FSpritePresentation
+{
+	GENERATED_USTRUCT_BODY()
+
+	// The direction in the low 3 bits, the state in the 2 above them.
+	UPROPERTY()
+	uint8 DirectionAndState = 0;
+
+	// 256 steps per turn.
+	UPROPERTY()
+	uint8 QuantizedYaw = 0;
+
+	static FSpritePresentation Make(EMainSpriteDirection Direction, EMainSpriteState State, float Yaw);
+
+	EMainSpriteDirection GetDirection() const { return EMainSpriteDirection(DirectionAndState & 0x7); }
+	EMainSpriteState GetState() const { return EMainSpriteState((DirectionAndState >> 3) & 0x3); }
+	float GetYaw() const { return FRotator::DecompressAxisFromByte(QuantizedYaw); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FSpritePresentation& Other) const { return DirectionAndState == Other.DirectionAndState && QuantizedYaw == Other.QuantizedYaw; }
+	bool operator!=(const FSpritePresentation& Other) const { return !(*this == Other); }
+
+	// Bits written and read by NetSerialize since the last HB.Net.SpriteStats reset, replication and RPCs alike.
+	static uint64 BitsWritten;
+	static uint64 BitsRead;
+	static double StatsStartTime;
+};
+
+template<>
+struct TStructOpsTypeTraits<FSpritePresentation> : public TStructOpsTypeTraitsBase2<FSpritePresentation>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
 UCLASS()
 class HEAVENLYBLUE_API AAPlayableSprite : public APaperCharacter
 {
@@ -137,6 +194,10 @@ public:
 
 	virtual void Tick(float DeltaTime) override;
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// The runtime heap of the sprite, for the memory report (see FHeavenlyBlueMemoryReport).
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 	// Called to bind functionality to input.
 	virtual void SetupPlayerInputComponent(class UInputComponent* InputComponent) override;
 
@@ -155,6 +216,14 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Current Sprite State Settings")
 	EMainSpriteState CurSpriteState;
 
+	// How fast other players' sprites turn towards the facing they were sent, in interpolation speed units.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking")
+	float FacingInterpSpeed;
+
+	// The owning client sends its presentation to the server at most this often. A change of direction or state goes out at once.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Networking")
+	float PresentationSendInterval;
+
 	// This is to manually add multiple entries for states, directions, and animations.
 	// They are generally referenced by the array index.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite State List")
@@ -163,7 +232,8 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spring Arm Settings")
 	TArray<struct FMainSpringArmDetails> SpringArmDetails;
 
-	// This is the array of objects filled to represent all conversation instances for a map
+	// This is the array of objects filled to represent all conversation instances for a map.
+	// Streamed levels add theirs as they become visible and take them out again as they're removed.
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Find all Actors of: ")
 	TArray<AAConversationInstance*> ConversationCollection;
 
@@ -180,6 +250,14 @@ protected:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite, Category = "Camera Settings")
 	class UAFollowCamera* FollowCamera;
 
+	// Fades the wall tiles between the camera and the sprite, in place of the spring arm's collision probe.
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite, Category = "Camera Settings")
+	class UCameraOcclusionComponent* CameraOcclusion;
+
+	// Places the spring arm from SpringArmDetails, blending between them as the sprite moves through camera preset volumes.
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite, Category = "Spring Arm Settings")
+	class UCameraRigComponent* CameraRig;
+
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadWrite, Category = "Bonus Settings")
 	class UPaperSpriteComponent* ExclamationIcon;
 
@@ -203,7 +281,7 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Movement Settings", meta = (AllowPrivateAccess = "True"))
 	float DEAD_ZONE = 0.5f;
 
-	// The spring arm has settings that describe it's base location.
+	// The spring arm has settings that describe it's base location. This one is used outside every camera preset volume.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spring Arm Settings", meta=(AllowPrivateAccess="True"))
 	int32 CurSpringArmIndex;
 
@@ -266,6 +344,8 @@ private:
 	void SprintSelected();
 	UFUNCTION()
 	void SprintReleased();
+	UFUNCTION()
+	void BacklogSelected();
 
 	//TEMP > (this is to check if the question answer feature works)
 	UFUNCTION()
@@ -288,6 +368,17 @@ private:
 	UFUNCTION()
 	void FinishInfoBoxInteraction();
 
+	// Sends the answer in Choice to the current conversation and info box.
+	void PostAnswer();
+
+	// The conversation and info box whose trigger the sprite is in, kept up to date by their overlap events.
+	TWeakObjectPtr<AAConversationInstance> OverlappedConversation;
+	TWeakObjectPtr<AAInfoBox> OverlappedInfoBox;
+	void HandleInteractableOverlap(const struct FInteractableOverlapEvent& Event);
+
+	// Shows or hides the exclamation icon, called when the overlaps, the interaction or the camera's turning change.
+	void UpdateExclamationIcon();
+
 	// This expidites the process of the "AddOnScreenDebugMessage" function.
 	UFUNCTION()
 	void Message(FString Name);
@@ -296,4 +387,39 @@ private:
 	// and state.
 	UFUNCTION()
 	int32 FindArrayIndex(EMainSpriteDirection Dir, EMainSpriteState State);
+
+	// Unlike FindArrayIndex this does not touch the current direction/state, and returns INDEX_NONE
+	// when there is no entry. Used to look up the flipbook a mirrored entry borrows.
+	int32 FindMirrorSourceIndex(EMainSpriteDirection Dir, EMainSpriteState State) const;
+
+	// Flips the sprite horizontally (negative X scale) when showing a mirrored entry.
+	void SetSpriteMirrored(bool bMirror);
+
+	// The direction and state of the sprite as the other players see it, set by the server. The owner draws its own.
+	UPROPERTY(Replicated)
+	FSpritePresentation ReplicatedPresentation;
+
+	// The owning client's presentation, sent when it changes.
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerSetPresentation(FSpritePresentation Presentation);
+
+	// What the owner last sent, when, and whether it still has to send the final value of a burst of changes.
+	FSpritePresentation SentPresentation;
+	float LastPresentationSendTime;
+	bool bPresentationResendPending;
+
+	// Where a sprite controlled elsewhere is facing in the world, turned smoothly towards the replicated facing.
+	float SmoothedFacingYaw;
+	bool bHasSmoothedFacing;
+
+	// The owner: keeps ReplicatedPresentation (or the server) up to date with the local direction, state and camera.
+	void UpdatePresentation();
+	// Everyone else: turns the sprite towards the replicated facing and picks the direction facing their own camera.
+	void ApplyReplicatedPresentation(float DeltaTime);
+
+	// Adds or removes the conversations and info boxes of a level, as the dorm's cells stream in and out.
+	void RegisterInteractables(ULevel* Level);
+	void UnregisterInteractables(ULevel* Level);
+	void HandleLevelAdded(ULevel* Level, UWorld* World);
+	void HandleLevelRemoved(ULevel* Level, UWorld* World);
 };
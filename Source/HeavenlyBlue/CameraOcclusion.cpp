@@ -0,0 +1,364 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraOcclusion.h"
+#include "HeavenlyBlue.h"
+#include "HitchMonitor.h"
+#include "Camera/CameraComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+UCameraOcclusionComponent::UCameraOcclusionComponent() :
+FadeParameter(TEXT("CameraFade")),
+FadedOpacity(0.25f),
+FadeSpeed(4.0f),
+bHideWhenFaded(true),
+ProbeSpread(40.0f),
+TracesPerFrame(2),
+ReuseDistance(10.0f),
+bUseSpringArmProbe(false),
+Camera(nullptr),
+SpringArm(nullptr),
+NextProbe(0),
+StatsTraces(0),
+StatsCycles(0),
+StatsFrames(0),
+StatsStartTime(0.0)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// After the spring arm has placed the camera for the frame.
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	FadeMeshPrefixes.Add(TEXT("MH_WallTile"));
+	FadeMeshPrefixes.Add(TEXT("MH_BeamTile"));
+}
+
+/*
+ * Function:  BeginPlay
+ * --------------------
+ * 1) Find the owner's camera and spring arm, and switch the arm's probe off unless it's wanted for comparison.
+ * 2) Lay out the probes: the middle of the line and one to each side of it, above and below.
+ *
+ */
+void UCameraOcclusionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Camera = GetOwner()->FindComponentByClass<UCameraComponent>();
+	SpringArm = GetOwner()->FindComponentByClass<USpringArmComponent>();
+	SetUseSpringArmProbe(bUseSpringArmProbe);
+
+	Probes.SetNum(5);
+	Probes[1].Offset = FVector2D(ProbeSpread, 0.0f);
+	Probes[2].Offset = FVector2D(-ProbeSpread, 0.0f);
+	Probes[3].Offset = FVector2D(0.0f, ProbeSpread);
+	Probes[4].Offset = FVector2D(0.0f, -ProbeSpread);
+
+	ResetStats();
+}
+
+void UCameraOcclusionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	RestoreTiles();
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCameraOcclusionComponent::SetUseSpringArmProbe(bool bUse)
+{
+	bUseSpringArmProbe = bUse;
+	if (SpringArm)
+		SpringArm->bDoCollisionTest = bUse;
+
+	if (bUse)
+		RestoreTiles();
+
+	for (FCameraOcclusionProbe& Probe : Probes)
+	{
+		Probe.bTraced = false;
+		Probe.Hits.Reset();
+	}
+}
+
+void UCameraOcclusionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	HB_HITCH_SCOPE("Camera.Occlusion");
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	StatsFrames++;
+	if (bUseSpringArmProbe)
+	{
+		// The arm sweeps once every tick, its time is only measured by Benchmark.
+		StatsTraces++;
+		return;
+	}
+
+	if (Camera == nullptr)
+		return;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	StatsTraces += UpdateProbes(GetOwner()->GetActorLocation(), Camera->GetComponentLocation(), TracesPerFrame);
+	UpdateTiles(DeltaTime);
+	StatsCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+/*
+ * Function:  UpdateProbes
+ * --------------------
+ * 1) Place each probe on the line from the player to the camera, moved sideways by its offset.
+ * 2) A probe never traced, or with an end further than ReuseDistance from where it was traced, is stale.
+ * 3) Trace up to MaxTraces stale probes, going round from the one after the last traced so none waits for long.
+ *
+ */
+int32 UCameraOcclusionComponent::UpdateProbes(const FVector& Target, const FVector& CameraLocation, int32 MaxTraces)
+{
+	const FVector Direction = (CameraLocation - Target).GetSafeNormal();
+	FVector Right = FVector::CrossProduct(Direction, FVector::UpVector).GetSafeNormal();
+	if (Right.IsZero())
+		Right = FVector::RightVector;
+	const FVector Up = FVector::CrossProduct(Right, Direction);
+
+	const float ReuseDistanceSquared = FMath::Square(ReuseDistance);
+	int32 Traced = 0;
+	for (int32 Step = 0; Step < Probes.Num() && Traced < MaxTraces; Step++)
+	{
+		const int32 Index = (NextProbe + Step) % Probes.Num();
+		FCameraOcclusionProbe& Probe = Probes[Index];
+
+		const FVector Offset = Right * Probe.Offset.X + Up * Probe.Offset.Y;
+		const FVector Start = Target + Offset;
+		const FVector End = CameraLocation + Offset;
+		if (Probe.bTraced && FVector::DistSquared(Start, Probe.Start) <= ReuseDistanceSquared && FVector::DistSquared(End, Probe.End) <= ReuseDistanceSquared)
+			continue;
+
+		Probe.Start = Start;
+		Probe.End = End;
+		TraceProbe(Probe);
+		NextProbe = (Index + 1) % Probes.Num();
+		Traced++;
+	}
+	return Traced;
+}
+
+/*
+ * Function:  TraceProbe
+ * --------------------
+ * An object query returns everything along the line instead of stopping at the first wall, so one trace finds
+ * every tile between the player and the camera.
+ *
+ */
+void UCameraOcclusionComponent::TraceProbe(FCameraOcclusionProbe& Probe)
+{
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CameraOcclusion), false, GetOwner());
+
+	GetWorld()->LineTraceMultiByObjectType(HitResults, Probe.Start, Probe.End, ObjectParams, QueryParams);
+
+	Probe.bTraced = true;
+	Probe.Hits.Reset();
+	for (const FHitResult& Hit : HitResults)
+	{
+		UPrimitiveComponent* Component = Hit.GetComponent();
+		if (IsFadeable(Component))
+			Probe.Hits.AddUnique(Component);
+	}
+}
+
+bool UCameraOcclusionComponent::IsFadeable(const UPrimitiveComponent* Component) const
+{
+	const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Component);
+	if (MeshComponent == nullptr || MeshComponent->GetStaticMesh() == nullptr)
+		return false;
+
+	const FString MeshName = MeshComponent->GetStaticMesh()->GetName();
+	for (const FString& Prefix : FadeMeshPrefixes)
+	{
+		if (MeshName.StartsWith(Prefix))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Function:  UpdateTiles
+ * --------------------
+ * 1) A tile is occluding while any probe's last trace hit it, new ones start at full opacity.
+ * 2) Move each opacity towards FadedOpacity or back to 1, the materials only hear about it when it changes.
+ * 3) Hide a tile that reached FadedOpacity if asked to, and drop the ones fully back.
+ *
+ */
+void UCameraOcclusionComponent::UpdateTiles(float DeltaTime)
+{
+	for (FCameraOcclusionTile& Tile : Tiles)
+		Tile.bOccluding = false;
+
+	for (const FCameraOcclusionProbe& Probe : Probes)
+	{
+		for (const TWeakObjectPtr<UPrimitiveComponent>& Hit : Probe.Hits)
+		{
+			FCameraOcclusionTile* Tile = Tiles.FindByPredicate([&Hit](const FCameraOcclusionTile& Other) { return Other.Component == Hit; });
+			if (Tile == nullptr)
+			{
+				Tile = &Tiles.AddDefaulted_GetRef();
+				Tile->Component = Hit;
+			}
+			Tile->bOccluding = true;
+		}
+	}
+
+	for (int32 Index = Tiles.Num() - 1; Index >= 0; Index--)
+	{
+		FCameraOcclusionTile& Tile = Tiles[Index];
+		UPrimitiveComponent* Component = Tile.Component.Get();
+		if (Component == nullptr)
+		{
+			Tiles.RemoveAtSwap(Index);
+			continue;
+		}
+
+		const float Opacity = FMath::FInterpConstantTo(Tile.Opacity, Tile.bOccluding ? FadedOpacity : 1.0f, DeltaTime, FadeSpeed);
+		if (Opacity != Tile.Opacity)
+		{
+			Tile.Opacity = Opacity;
+			Component->SetScalarParameterValueOnMaterials(FadeParameter, Opacity);
+		}
+
+		const bool bHide = bHideWhenFaded && Tile.bOccluding && Opacity <= FadedOpacity;
+		if (bHide != Tile.bHidden)
+		{
+			Tile.bHidden = bHide;
+			Component->SetRenderInMainPass(!bHide);
+		}
+
+		if (!Tile.bOccluding && Opacity >= 1.0f)
+			Tiles.RemoveAtSwap(Index);
+	}
+}
+
+void UCameraOcclusionComponent::RestoreTiles()
+{
+	for (const FCameraOcclusionTile& Tile : Tiles)
+	{
+		if (UPrimitiveComponent* Component = Tile.Component.Get())
+		{
+			Component->SetScalarParameterValueOnMaterials(FadeParameter, 1.0f);
+			if (Tile.bHidden)
+				Component->SetRenderInMainPass(true);
+		}
+	}
+	Tiles.Reset();
+}
+
+void UCameraOcclusionComponent::LogStats() const
+{
+	const double Seconds = FMath::Max(FPlatformTime::Seconds() - StatsStartTime, 1e-3);
+	const double Frames = double(FMath::Max<uint64>(StatsFrames, 1));
+
+	if (bUseSpringArmProbe)
+	{
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Spring arm probe: %llu sweeps in %.1f s, %.1f per second. HB.Camera.Occlusion bench times it."),
+			StatsTraces, Seconds, StatsTraces / Seconds);
+		return;
+	}
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Occlusion fading: %llu traces in %.1f s, %.1f per second and %.2f per frame, %.2f us per frame on the game thread, %d tiles fading."),
+		StatsTraces, Seconds, StatsTraces / Seconds, StatsTraces / Frames, FPlatformTime::ToMilliseconds64(StatsCycles) * 1000.0 / Frames, Tiles.Num());
+}
+
+void UCameraOcclusionComponent::ResetStats()
+{
+	StatsTraces = 0;
+	StatsCycles = 0;
+	StatsFrames = 0;
+	StatsStartTime = FPlatformTime::Seconds();
+}
+
+/*
+ * Function:  Benchmark
+ * --------------------
+ * 1) Walk the player, camera and arm sideways at 600 cm/s for the first half of the frames at 60 per second, then stand.
+ * 2) Per frame, update the probes as the tick does, and do the sweep the spring arm does (its probe sphere along the
+ *    arm, on its probe channel).
+ * 3) Put the probes back so the next tick carries on from the real positions.
+ *
+ */
+void UCameraOcclusionComponent::Benchmark(int32 Frames)
+{
+	if (Camera == nullptr || SpringArm == nullptr)
+		return;
+
+	const TArray<FCameraOcclusionProbe> SavedProbes = Probes;
+	const int32 SavedNextProbe = NextProbe;
+	for (FCameraOcclusionProbe& Probe : Probes)
+		Probe.bTraced = false;
+
+	const FVector Target = GetOwner()->GetActorLocation();
+	const FVector CameraLocation = Camera->GetComponentLocation();
+	const FVector ArmOrigin = SpringArm->GetComponentLocation();
+	const FVector Step = FVector::CrossProduct((CameraLocation - Target).GetSafeNormal(), FVector::UpVector).GetSafeNormal() * (600.0f / 60.0f);
+
+	int32 Traces = 0;
+	uint64 OcclusionCycles = 0;
+	uint64 SpringArmCycles = 0;
+	const FCollisionQueryParams ArmParams(SCENE_QUERY_STAT(SpringArm), false, GetOwner());
+	for (int32 Frame = 0; Frame < Frames; Frame++)
+	{
+		const FVector Moved = Step * FMath::Min(Frame, Frames / 2);
+
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		Traces += UpdateProbes(Target + Moved, CameraLocation + Moved, TracesPerFrame);
+		OcclusionCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		StartCycles = FPlatformTime::Cycles64();
+		FHitResult Result;
+		GetWorld()->SweepSingleByChannel(Result, ArmOrigin + Moved, CameraLocation + Moved, FQuat::Identity, SpringArm->ProbeChannel, FCollisionShape::MakeSphere(SpringArm->ProbeSize), ArmParams);
+		SpringArmCycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+
+	Probes = SavedProbes;
+	NextProbe = SavedNextProbe;
+	FHitchMonitor::Get().DiscardFrame();
+
+	const double OcclusionMs = FPlatformTime::ToMilliseconds64(OcclusionCycles);
+	const double SpringArmMs = FPlatformTime::ToMilliseconds64(SpringArmCycles);
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("%d frames, walking for half: occlusion probes %d traces in %.3f ms (%.2f us per frame), spring arm %d sweeps in %.3f ms (%.2f us per frame)."),
+		Frames, Traces, OcclusionMs, OcclusionMs * 1000.0 / Frames, Frames, SpringArmMs, SpringArmMs * 1000.0 / Frames);
+}
+
+/*
+ * Console Command:  HB.Camera.Occlusion [fade | springarm | reset | bench [Frames]]
+ * --------------------
+ * Logs the player camera's trace counts and cost. fade and springarm switch between the occlusion probes and the spring
+ * arm's own probe, so the stats of both can be read in the same spot. bench times both over the same frames.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GCameraOcclusionCommand(
+	TEXT("HB.Camera.Occlusion"),
+	TEXT("Logs or compares the camera occlusion traces. Usage: HB.Camera.Occlusion [fade | springarm | reset | bench [Frames=1000]]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const APawn* Pawn = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+		UCameraOcclusionComponent* Occlusion = Pawn ? Pawn->FindComponentByClass<UCameraOcclusionComponent>() : nullptr;
+		if (Occlusion == nullptr)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("The player has no camera occlusion component."));
+			return;
+		}
+
+		const FString Mode = Args.Num() > 0 ? Args[0] : FString();
+		if (Mode == TEXT("bench"))
+		{
+			Occlusion->Benchmark(Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 2) : 1000);
+			return;
+		}
+
+		Occlusion->LogStats();
+		if (Mode == TEXT("fade") || Mode == TEXT("springarm"))
+			Occlusion->SetUseSpringArmProbe(Mode == TEXT("springarm"));
+		if (!Mode.IsEmpty())
+			Occlusion->ResetStats();
+	}));
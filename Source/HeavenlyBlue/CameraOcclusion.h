@@ -0,0 +1,152 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : CameraOcclusion
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This keeps the player visible without pulling the camera
+*				   in. A few cached line traces between the player and the
+*				   camera find the wall tiles in the way, a couple are redone
+*				   per frame and only once the ends have moved, and those
+*				   tiles are faded out instead of collapsing the spring arm.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CameraOcclusion.generated.h"
+
+class UCameraComponent;
+class UPrimitiveComponent;
+class USpringArmComponent;
+
+/*
+ * Struct:  FCameraOcclusionProbe
+ * --------------------
+ * One ray from the player to the camera, offset in the camera's plane, and the tiles it hit when it was last traced.
+ */
+struct FCameraOcclusionProbe
+{
+	// Right and up of the line from the player to the camera.
+	FVector2D Offset = FVector2D::ZeroVector;
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	bool bTraced = false;
+	TArray<TWeakObjectPtr<UPrimitiveComponent>, TInlineAllocator<4>> Hits;
+};
+
+/*
+ * Struct:  FCameraOcclusionTile
+ * --------------------
+ * A tile being faded out or back in. It's dropped once it's fully back.
+ */
+struct FCameraOcclusionTile
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	float Opacity = 1.0f;
+	bool bOccluding = false;
+	bool bHidden = false;
+};
+
+/*
+ * Class:  UCameraOcclusionComponent
+ * --------------------
+ * Ticks after the camera has moved. Each frame at most TracesPerFrame of the probes whose player or camera end moved
+ * more than ReuseDistance are traced again, the others keep their hits, so standing still or talking costs no traces.
+ * Tiles any probe hits fade to FadedOpacity through the FadeParameter of their materials, and stop being drawn once
+ * there for materials without it. The owner's spring arm doesn't probe while this is on (HB.Camera.Occlusion springarm
+ * switches back to compare).
+ */
+UCLASS(ClassGroup = Camera, meta = (BlueprintSpawnableComponent))
+class HEAVENLYBLUE_API UCameraOcclusionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCameraOcclusionComponent();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Goes back to the spring arm's own probe (and brings the faded tiles back), or from it to fading.
+	void SetUseSpringArmProbe(bool bUse);
+	bool IsUsingSpringArmProbe() const { return bUseSpringArmProbe; }
+
+	// Logs the traces per second and the game thread time per frame since the last reset.
+	void LogStats() const;
+	void ResetStats();
+
+	// Walks the player and camera along a straight line for half the frames and stands still for the rest, tracing
+	// the probes as the game would and, for the same frames, the sweep the spring arm does each frame. Logs both.
+	void Benchmark(int32 Frames);
+
+	// The components whose static mesh's name starts with one of these are faded, the dorm's wall and beam tiles.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion")
+	TArray<FString> FadeMeshPrefixes;
+
+	// A scalar of the tiles' materials, 1 is opaque.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion")
+	FName FadeParameter;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float FadedOpacity;
+
+	// Opacity per second.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion", meta = (ClampMin = "0.1"))
+	float FadeSpeed;
+
+	// Stops drawing a tile once it's faded, for materials without the fade parameter. Its shadow stays.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion")
+	bool bHideWhenFaded;
+
+	// How far the side probes are from the middle one, so a tile covering part of the sprite counts.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion", meta = (ClampMin = "0.0"))
+	float ProbeSpread;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion", meta = (ClampMin = "1"))
+	int32 TracesPerFrame;
+
+	// A probe whose ends moved less than this keeps its hits.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion", meta = (ClampMin = "0.0"))
+	float ReuseDistance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Occlusion")
+	bool bUseSpringArmProbe;
+
+private:
+	// Traces up to MaxTraces of the probes that moved, starting after the last one traced. Returns how many it traced.
+	int32 UpdateProbes(const FVector& Target, const FVector& CameraLocation, int32 MaxTraces);
+	void TraceProbe(FCameraOcclusionProbe& Probe);
+	bool IsFadeable(const UPrimitiveComponent* Component) const;
+
+	// Marks the tiles the probes hit and moves every tile's opacity towards where it should be.
+	void UpdateTiles(float DeltaTime);
+	void RestoreTiles();
+
+	UPROPERTY(Transient)
+	UCameraComponent* Camera;
+
+	UPROPERTY(Transient)
+	USpringArmComponent* SpringArm;
+
+	TArray<FCameraOcclusionProbe> Probes;
+	int32 NextProbe;
+	TArray<FCameraOcclusionTile> Tiles;
+	// Kept between traces so they don't allocate.
+	TArray<FHitResult> HitResults;
+
+	uint64 StatsTraces;
+	uint64 StatsCycles;
+	uint64 StatsFrames;
+	double StatsStartTime;
+};
@@ -0,0 +1,269 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraRig.h"
+#include "HeavenlyBlue.h"
+#include "APlayableSprite.h"
+#include "HitchMonitor.h"
+#include "Curves/CurveFloat.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+namespace CameraRigVolumes
+{
+	// The rig of the local player's sprite when its capsule is the component overlapping, nothing for other sprites or components.
+	UCameraRigComponent* FindRig(AActor* OtherActor, UPrimitiveComponent* OtherComp)
+	{
+		AAPlayableSprite* Sprite = Cast<AAPlayableSprite>(OtherActor);
+		if (Sprite == nullptr || OtherComp != Sprite->GetCapsuleComponent() || !Sprite->IsLocallyControlled())
+			return nullptr;
+		return Sprite->FindComponentByClass<UCameraRigComponent>();
+	}
+}
+
+void ACameraPresetVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	GetCollisionComponent()->OnComponentBeginOverlap.AddDynamic(this, &ACameraPresetVolume::OnBeginOverlap);
+	GetCollisionComponent()->OnComponentEndOverlap.AddDynamic(this, &ACameraPresetVolume::OnEndOverlap);
+}
+
+void ACameraPresetVolume::OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (UCameraRigComponent* Rig = CameraRigVolumes::FindRig(OtherActor, OtherComp))
+		Rig->EnterVolume(this);
+}
+
+void ACameraPresetVolume::OnEndOverlap(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	if (UCameraRigComponent* Rig = CameraRigVolumes::FindRig(OtherActor, OtherComp))
+		Rig->LeaveVolume(this);
+}
+
+FCameraRigPose FCameraRigPose::Blend(const FCameraRigPose& From, const FCameraRigPose& To, float Alpha)
+{
+	FCameraRigPose Pose;
+	Pose.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+	// The shorter way round.
+	Pose.Rotation = FMath::Lerp(From.Rotation, To.Rotation, Alpha);
+	Pose.ArmLength = FMath::Lerp(From.ArmLength, To.ArmLength, Alpha);
+	return Pose;
+}
+
+UCameraRigComponent::UCameraRigComponent() :
+DefaultBlendTime(0.75f),
+Sprite(nullptr),
+SpringArm(nullptr),
+BlendCurve(nullptr),
+DefaultIndex(0),
+TargetIndex(0),
+BlendElapsed(0.0f),
+BlendDuration(0.0f),
+NumPoses(0),
+NumTickedFrames(0),
+StatsStartTime(0.0)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Only while blending.
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// Before the spring arm places the camera.
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+/*
+ * Function:  Initialize
+ * --------------------
+ * 1) Take the sprite's presets and the arm they place.
+ * 2) Snap to the preset of any volume the sprite started in (overlaps can come before the sprite's BeginPlay), or the default.
+ *
+ */
+void UCameraRigComponent::Initialize(USpringArmComponent* InSpringArm, int32 InDefaultIndex)
+{
+	Sprite = Cast<AAPlayableSprite>(GetOwner());
+	SpringArm = InSpringArm;
+	DefaultIndex = InDefaultIndex;
+	StatsStartTime = FPlatformTime::Seconds();
+
+	TargetIndex = FindPresetIndex();
+	CurrentPose = GetPreset(TargetIndex);
+	ApplyPose(CurrentPose);
+	SetComponentTickEnabled(false);
+}
+
+void UCameraRigComponent::EnterVolume(ACameraPresetVolume* Volume)
+{
+	Volumes.Remove(Volume);
+	Volumes.Add(Volume);
+	SelectPreset(Volume);
+}
+
+void UCameraRigComponent::LeaveVolume(ACameraPresetVolume* Volume)
+{
+	Volumes.Remove(Volume);
+	SelectPreset(Volume);
+}
+
+int32 UCameraRigComponent::FindPresetIndex()
+{
+	Volumes.RemoveAll([](const TWeakObjectPtr<ACameraPresetVolume>& Volume) { return !Volume.IsValid(); });
+
+	const ACameraPresetVolume* Winner = nullptr;
+	for (const TWeakObjectPtr<ACameraPresetVolume>& Volume : Volumes)
+	{
+		if (Winner == nullptr || Volume->Priority >= Winner->Priority)
+			Winner = Volume.Get();
+	}
+	return Winner ? Winner->SpringArmIndex : DefaultIndex;
+}
+
+void UCameraRigComponent::SelectPreset(const ACameraPresetVolume* BlendSettings)
+{
+	if (SpringArm == nullptr)
+		return;
+
+	BlendTo(FindPresetIndex(), BlendSettings->BlendTime, BlendSettings->BlendCurve);
+}
+
+/*
+ * Function:  BlendTo
+ * --------------------
+ * 1) Nothing changes if the preset is already the target, a blend under way carries on.
+ * 2) Otherwise blend from the pose the arm has now, which may be part way through another blend.
+ * 3) A zero time snaps, and the rig stays settled.
+ *
+ */
+void UCameraRigComponent::BlendTo(int32 Index, float BlendTime, UCurveFloat* Curve)
+{
+	if (Sprite == nullptr || !Sprite->SpringArmDetails.IsValidIndex(Index) || Index == TargetIndex)
+		return;
+
+	TargetIndex = Index;
+	BlendStartPose = CurrentPose;
+	BlendElapsed = 0.0f;
+	BlendDuration = BlendTime;
+	BlendCurve = Curve;
+
+	if (BlendTime <= 0.0f)
+	{
+		CurrentPose = GetPreset(TargetIndex);
+		ApplyPose(CurrentPose);
+		SetComponentTickEnabled(false);
+		return;
+	}
+	SetComponentTickEnabled(true);
+}
+
+/*
+ * Function:  TickComponent
+ * --------------------
+ * 1) Move the blend on, through the curve if there is one, otherwise easing in and out.
+ * 2) The target is read again each frame, so turning the camera while blending isn't lost.
+ * 3) At the end land exactly on the preset and stop ticking.
+ *
+ */
+void UCameraRigComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	HB_HITCH_SCOPE("Camera.Rig");
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	NumTickedFrames++;
+	BlendElapsed += DeltaTime;
+	const float Time = BlendDuration > 0.0f ? FMath::Min(BlendElapsed / BlendDuration, 1.0f) : 1.0f;
+
+	if (Time >= 1.0f)
+	{
+		CurrentPose = GetPreset(TargetIndex);
+		SetComponentTickEnabled(false);
+	}
+	else
+	{
+		const float Alpha = BlendCurve ? BlendCurve->GetFloatValue(Time) : FMath::SmoothStep(0.0f, 1.0f, Time);
+		CurrentPose = FCameraRigPose::Blend(BlendStartPose, GetPreset(TargetIndex), Alpha);
+	}
+	ApplyPose(CurrentPose);
+}
+
+/*
+ * Function:  AddYaw
+ * --------------------
+ * While blending the tick picks the change up, settled the arm is turned here, once.
+ *
+ */
+void UCameraRigComponent::AddYaw(float Degrees)
+{
+	if (Sprite == nullptr || !Sprite->SpringArmDetails.IsValidIndex(TargetIndex) || Degrees == 0.0f)
+		return;
+
+	Sprite->SpringArmDetails[TargetIndex].CustomTargetRotation.Roll -= Degrees;
+	if (IsBlending())
+		return;
+
+	CurrentPose = GetPreset(TargetIndex);
+	ApplyPose(CurrentPose);
+}
+
+/*
+ * Function:  GetPreset
+ * --------------------
+ * The spring arm's axes are changed to better represent how they appear visually in the blueprint editor.
+ *
+ */
+FCameraRigPose UCameraRigComponent::GetPreset(int32 Index) const
+{
+	if (Sprite == nullptr || !Sprite->SpringArmDetails.IsValidIndex(Index))
+		return CurrentPose;
+
+	const FMainSpringArmDetails& Details = Sprite->SpringArmDetails[Index];
+	FCameraRigPose Pose;
+	Pose.Location = FVector(-Details.CustomTargetPosition.Z, -Details.CustomTargetPosition.X, -Details.CustomTargetPosition.Y);
+	Pose.Rotation = FRotator(-Details.CustomTargetRotation.Pitch, -Details.CustomTargetRotation.Roll, -Details.CustomTargetRotation.Yaw);
+	Pose.ArmLength = Details.CustomTargetArmLength;
+	return Pose;
+}
+
+void UCameraRigComponent::ApplyPose(const FCameraRigPose& Pose)
+{
+	if (SpringArm == nullptr)
+		return;
+
+	SpringArm->SetRelativeLocationAndRotation(Pose.Location, Pose.Rotation);
+	SpringArm->TargetArmLength = Pose.ArmLength;
+	NumPoses++;
+}
+
+void UCameraRigComponent::LogStats()
+{
+	const double Seconds = FMath::Max(FPlatformTime::Seconds() - StatsStartTime, 1e-3);
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Camera rig: preset %d, %s, %d volumes. In %.1f s it moved the arm %u times (%.1f per second) and ticked %u frames."),
+		TargetIndex, IsBlending() ? TEXT("blending") : TEXT("settled"), Volumes.Num(), Seconds, NumPoses, NumPoses / Seconds, NumTickedFrames);
+
+	NumPoses = 0;
+	NumTickedFrames = 0;
+	StatsStartTime = FPlatformTime::Seconds();
+}
+
+/*
+ * Console Command:  HB.Camera.Rig [Index]
+ * --------------------
+ * Logs how often the player's camera rig moved the arm since the last call, 0 while standing still with a settled camera.
+ * With an index, blends to that preset over the rig's DefaultBlendTime.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GCameraRigCommand(
+	TEXT("HB.Camera.Rig"),
+	TEXT("Logs the camera rig's work since the last call, or blends to a preset. Usage: HB.Camera.Rig [Index]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const APawn* Pawn = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+		UCameraRigComponent* Rig = Pawn ? Pawn->FindComponentByClass<UCameraRigComponent>() : nullptr;
+		if (Rig == nullptr)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("The player has no camera rig."));
+			return;
+		}
+
+		Rig->LogStats();
+		if (Args.Num() > 0)
+			Rig->BlendTo(FCString::Atoi(*Args[0]), Rig->DefaultBlendTime, nullptr);
+	}));
@@ -0,0 +1,150 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : CameraRig
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This places the player's spring arm from the sprite's
+*				   spring arm presets. Preset volumes in the level pick the
+*				   preset, the rig blends to it along a curve, and it only
+*				   moves the arm while blending or turning, so a settled
+*				   camera costs nothing.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/TriggerVolume.h"
+#include "CameraRig.generated.h"
+
+class AAPlayableSprite;
+class UCurveFloat;
+class USpringArmComponent;
+
+/*
+ * Class:  ACameraPresetVolume
+ * --------------------
+ * While the player's sprite is inside, its camera uses the SpringArmIndex entry of the sprite's SpringArmDetails.
+ * Where volumes overlap, the highest Priority wins, and the last entered of those with the same priority.
+ */
+UCLASS()
+class HEAVENLYBLUE_API ACameraPresetVolume : public ATriggerVolume
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginPlay() override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Preset")
+	int32 SpringArmIndex = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Preset")
+	int32 Priority = 0;
+
+	// Seconds to blend to this preset, and back out of it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Preset", meta = (ClampMin = "0.0"))
+	float BlendTime = 0.75f;
+
+	// The blend's progress over its time, both 0 to 1. Without one it eases in and out.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Preset")
+	UCurveFloat* BlendCurve = nullptr;
+
+	UFUNCTION()
+	void OnBeginOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	UFUNCTION()
+	void OnEndOverlap(class UPrimitiveComponent* HitComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+};
+
+/*
+ * Struct:  FCameraRigPose
+ * --------------------
+ * A spring arm preset in the arm's own axes (see FMainSpringArmDetails for how they're swapped).
+ */
+struct FCameraRigPose
+{
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	float ArmLength = 0.0f;
+
+	static FCameraRigPose Blend(const FCameraRigPose& From, const FCameraRigPose& To, float Alpha);
+};
+
+/*
+ * Class:  UCameraRigComponent
+ * --------------------
+ * Owns the sprite's spring arm placement. Its tick is only on while a blend runs; turning the camera and settling
+ * move the arm once, and otherwise the arm's location, rotation and length are left alone.
+ */
+UCLASS(ClassGroup = Camera, meta = (BlueprintSpawnableComponent))
+class HEAVENLYBLUE_API UCameraRigComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCameraRigComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Called by the sprite once it has begun play. DefaultIndex is the preset used outside every volume.
+	void Initialize(USpringArmComponent* InSpringArm, int32 DefaultIndex);
+
+	void EnterVolume(ACameraPresetVolume* Volume);
+	void LeaveVolume(ACameraPresetVolume* Volume);
+
+	// Starts a blend from where the arm is now. A preset out of the sprite's range is ignored.
+	void BlendTo(int32 Index, float BlendTime, UCurveFloat* Curve);
+
+	// Turns the camera by changing the roll of the preset blended to, as the sprite's yaw input always has.
+	void AddYaw(float Degrees);
+
+	// The preset being blended to, or the settled one.
+	int32 GetTargetIndex() const { return TargetIndex; }
+	bool IsBlending() const { return IsComponentTickEnabled(); }
+
+	// Logs whether the rig is settled and how often it moved the arm since the last call.
+	void LogStats();
+
+	// Seconds for blends no volume asked for, e.g. HB.Camera.Rig's.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Rig", meta = (ClampMin = "0.0"))
+	float DefaultBlendTime;
+
+private:
+	FCameraRigPose GetPreset(int32 Index) const;
+	void ApplyPose(const FCameraRigPose& Pose);
+	// The preset of the volume that wins, or the default.
+	int32 FindPresetIndex();
+	// Blends to that preset with the given volume's time and curve.
+	void SelectPreset(const ACameraPresetVolume* BlendSettings);
+
+	UPROPERTY(Transient)
+	AAPlayableSprite* Sprite;
+
+	UPROPERTY(Transient)
+	USpringArmComponent* SpringArm;
+
+	UPROPERTY(Transient)
+	UCurveFloat* BlendCurve;
+
+	// Entered order, so the last entered wins a tie.
+	TArray<TWeakObjectPtr<ACameraPresetVolume>> Volumes;
+
+	FCameraRigPose CurrentPose;
+	FCameraRigPose BlendStartPose;
+	int32 DefaultIndex;
+	int32 TargetIndex;
+	float BlendElapsed;
+	float BlendDuration;
+
+	uint32 NumPoses;
+	uint32 NumTickedFrames;
+	double StatsStartTime;
+};
@@ -0,0 +1,530 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueBank.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueScriptImporter.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Sound/SoundWave.h"
+
+namespace DialogueBankFormat
+{
+	static const uint32 Magic = 0x42444248; // "HBDB"
+	static const uint32 Version = 2;
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumEntries;
+		uint32 EntriesOffset;
+		uint32 NumConversations;
+		uint32 ConversationsOffset;
+		uint32 NumDialogues;
+		uint32 DialoguesOffset;
+		uint32 NumSubtitles;
+		uint32 SubtitlesOffset;
+		uint32 NumQuestions;
+		uint32 QuestionsOffset;
+		uint32 StringPoolOffset;
+		uint32 StringPoolSize;
+	};
+
+	struct FEntry
+	{
+		uint32 KeyHash;
+		uint32 Key;
+		uint32 FirstConversation;
+		uint32 NumConversations;
+		uint32 FirstQuestion;
+		uint32 NumQuestions;
+	};
+
+	struct FConversationRecord
+	{
+		uint32 FirstDialogue;
+		uint32 NumDialogues;
+	};
+
+	struct FDialogueRecord
+	{
+		uint32 Speaker;
+		uint32 FirstSubtitle;
+		uint32 NumSubtitles;
+	};
+
+	struct FSubtitleRecord
+	{
+		uint32 Text;
+		uint32 Sound;
+		float Timer;
+		uint32 bHasQuestion;
+	};
+
+	struct FQuestionRecord
+	{
+		uint32 Option;
+		uint16 ConversationNode;
+		uint16 DialogueNode;
+		uint16 SubtitleNode;
+		uint16 NodeID;
+		uint16 GoToConversationNode;
+		uint16 Padding;
+		// Source of the option's condition and action (see FWorldStateScript), compiled by the instance.
+		uint32 Condition;
+		uint32 Action;
+	};
+
+	static_assert(sizeof(FHeader) == 56 && sizeof(FEntry) == 24 && sizeof(FConversationRecord) == 8 && sizeof(FDialogueRecord) == 12 &&
+		sizeof(FSubtitleRecord) == 16 && sizeof(FQuestionRecord) == 24, "Dialogue bank records must keep their on-disk size.");
+
+	// FName compares case insensitively, so the hash has to as well.
+	uint32 HashKey(const FString& Key) { return FCrc::StrCrc32(*Key.ToLower()); }
+
+	// FString map keys ignore case by default, dialogue text must not.
+	struct FCaseSensitiveKeyFuncs : TDefaultMapHashableKeyFuncs<FString, uint32, false>
+	{
+		static bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+		static uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+	};
+
+	/*
+	 * Struct:  FStringPool
+	 * --------------------
+	 * Used while writing, every unique string is stored once.
+	 */
+	struct FStringPool
+	{
+		TArray<uint8> Bytes;
+		TMap<FString, uint32, FDefaultSetAllocator, FCaseSensitiveKeyFuncs> Offsets;
+
+		FStringPool() { Bytes.Add(0); }
+
+		uint32 Add(const FString& String)
+		{
+			if (String.IsEmpty())
+				return 0;
+			if (const uint32* Existing = Offsets.Find(String))
+				return *Existing;
+
+			const uint32 Offset = Bytes.Num();
+			FTCHARToUTF8 Utf8(*String);
+			Bytes.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+			Bytes.Add(0);
+			Offsets.Add(String, Offset);
+			return Offset;
+		}
+	};
+
+	template<typename RecordType>
+	uint32 AppendSection(TArray<uint8>& Out, const TArray<RecordType>& Records)
+	{
+		const uint32 Offset = Out.Num();
+		Out.Append(reinterpret_cast<const uint8*>(Records.GetData()), Records.Num() * int32(sizeof(RecordType)));
+		return Offset;
+	}
+}
+
+using namespace DialogueBankFormat;
+
+FDialogueBank::FDialogueBank() :
+Data(nullptr),
+Size(0),
+bTriedDefaultOpen(false)
+{}
+
+FDialogueBank::~FDialogueBank()
+{
+	Close();
+}
+
+/*
+ * Function:  Get
+ * --------------------
+ * This returns the game's bank. The first call opens the file named in the config.
+ *
+ */
+FDialogueBank& FDialogueBank::Get()
+{
+	static FDialogueBank Bank;
+	if (!Bank.bTriedDefaultOpen)
+	{
+		Bank.bTriedDefaultOpen = true;
+
+		FString BankFile = TEXT("Dialogue/DialogueBank.hbdb");
+		GConfig->GetString(TEXT("/Script/HeavenlyBlue.DialogueBank"), TEXT("BankFile"), BankFile, GGameIni);
+		Bank.Open(FPaths::ProjectContentDir() / BankFile);
+	}
+	return Bank;
+}
+
+/*
+ * Function:  Open
+ * --------------------
+ * This maps the bank into memory and checks that every section lies inside the file.
+ * Nothing is decoded here, so opening costs the same however big the script is.
+ *
+ */
+bool FDialogueBank::Open(const FString& InFilename)
+{
+	Close();
+	Filename = InFilename;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile.Reset(PlatformFile.OpenMapped(*Filename));
+	if (MappedFile)
+		MappedRegion.Reset(MappedFile->MapRegion());
+
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else
+	{
+		MappedFile.Reset();
+		if (!FFileHelper::LoadFileToArray(FallbackData, *Filename, FILEREAD_Silent))
+			return false;
+
+		Data = FallbackData.GetData();
+		Size = FallbackData.Num();
+	}
+
+	const FHeader* Header = GetSection<FHeader>(0);
+	auto SectionFits = [this](uint32 Offset, uint64 Bytes) { return Offset + Bytes <= uint64(Size); };
+
+	if (Size < int64(sizeof(FHeader)) || Header->Magic != DialogueBankFormat::Magic || Header->Version != DialogueBankFormat::Version ||
+		!SectionFits(Header->EntriesOffset, uint64(Header->NumEntries) * sizeof(FEntry)) ||
+		!SectionFits(Header->ConversationsOffset, uint64(Header->NumConversations) * sizeof(FConversationRecord)) ||
+		!SectionFits(Header->DialoguesOffset, uint64(Header->NumDialogues) * sizeof(FDialogueRecord)) ||
+		!SectionFits(Header->SubtitlesOffset, uint64(Header->NumSubtitles) * sizeof(FSubtitleRecord)) ||
+		!SectionFits(Header->QuestionsOffset, uint64(Header->NumQuestions) * sizeof(FQuestionRecord)) ||
+		!SectionFits(Header->StringPoolOffset, Header->StringPoolSize) || Header->StringPoolSize == 0)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s is not a valid dialogue bank."), *Filename);
+		Close();
+		return false;
+	}
+
+	UE_LOG(LogHeavenlyBlue, Log, TEXT("Opened dialogue bank %s (%d conversations, %lld bytes, %s)."),
+		*Filename, Header->NumEntries, Size, MappedRegion ? TEXT("mapped") : TEXT("loaded"));
+	return true;
+}
+
+void FDialogueBank::Close()
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	FallbackData.Empty();
+	StringHandles.Empty();
+	Data = nullptr;
+	Size = 0;
+}
+
+int32 FDialogueBank::GetNumConversations() const
+{
+	return IsOpen() ? GetSection<FHeader>(0)->NumEntries : 0;
+}
+
+void FDialogueBank::GetConversationKeys(TArray<FName>& OutKeys) const
+{
+	OutKeys.Reset(GetNumConversations());
+	if (!IsOpen())
+		return;
+
+	const FHeader* Header = GetSection<FHeader>(0);
+	const FEntry* Entries = GetSection<FEntry>(Header->EntriesOffset);
+	for (uint32 i = 0; i < Header->NumEntries; i++)
+		OutKeys.Add(FName(*ReadString(Entries[i].Key)));
+}
+
+/*
+ * Function:  ReadString
+ * --------------------
+ * This turns a string pool offset back into an FString.
+ *
+ */
+FString FDialogueBank::ReadString(uint32 Offset) const
+{
+	const FHeader* Header = GetSection<FHeader>(0);
+	if (Offset == 0 || Offset >= Header->StringPoolSize)
+		return FString();
+
+	const ANSICHAR* Begin = reinterpret_cast<const ANSICHAR*>(Data + Header->StringPoolOffset + Offset);
+	const int32 MaxLength = Header->StringPoolSize - Offset;
+	int32 Length = 0;
+	while (Length < MaxLength && Begin[Length] != '\0')
+		Length++;
+
+	FUTF8ToTCHAR Converted(Begin, Length);
+	return FString(Converted.Length(), Converted.Get());
+}
+
+/*
+ * Function:  InternString
+ * --------------------
+ * The pool already stores each string once, so its offset maps to exactly one handle.
+ * Conversations decoded later reuse the handle without converting the text again.
+ */
+FDialogueStringHandle FDialogueBank::InternString(uint32 Offset) const
+{
+	if (Offset == 0)
+		return FDialogueStringHandle();
+
+	if (const FDialogueStringHandle* Handle = StringHandles.Find(Offset))
+		return *Handle;
+
+	return StringHandles.Add(Offset, FDialogueStringTable::Get().Intern(ReadString(Offset)));
+}
+
+/*
+ * Function:  FindEntry
+ * --------------------
+ * This binary searches the index by hash, then compares the keys of every entry sharing that hash.
+ *
+ */
+int32 FDialogueBank::FindEntry(FName ConversationKey) const
+{
+	if (!IsOpen() || ConversationKey.IsNone())
+		return INDEX_NONE;
+
+	const FHeader* Header = GetSection<FHeader>(0);
+	const FEntry* Entries = GetSection<FEntry>(Header->EntriesOffset);
+	const FString Key = ConversationKey.ToString();
+	const uint32 Hash = HashKey(Key);
+
+	int32 Low = 0;
+	int32 High = Header->NumEntries;
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High) / 2;
+		if (Entries[Middle].KeyHash < Hash)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+
+	for (int32 i = Low; i < int32(Header->NumEntries) && Entries[i].KeyHash == Hash; i++)
+	{
+		if (ReadString(Entries[i].Key).Equals(Key, ESearchCase::IgnoreCase))
+			return i;
+	}
+
+	return INDEX_NONE;
+}
+
+/*
+ * Function:  DecodeConversation
+ * --------------------
+ * This rebuilds the nodes of a single conversation key. Only the pages holding its records and
+ * strings are touched, the rest of the file is never read.
+ *
+ * ConversationKey: The key of the conversation, the same one used in the dialogue script.
+ * OutConversationList/OutQuestionList: Replaced with the decoded nodes.
+ * OutSoundPaths: If given, replaced with the sound of each subtitle, and nothing is loaded.
+ *
+ */
+bool FDialogueBank::DecodeConversation(FName ConversationKey, TArray<FConversationNode>& OutConversationList, TArray<FQuestionNode>& OutQuestionList,
+	TArray<FSoftObjectPath>* OutSoundPaths) const
+{
+	const int32 EntryIndex = FindEntry(ConversationKey);
+	if (EntryIndex == INDEX_NONE)
+		return false;
+
+	HB_LLM_SCOPE(Dialogue);
+
+	const FHeader* Header = GetSection<FHeader>(0);
+	const FEntry& Entry = GetSection<FEntry>(Header->EntriesOffset)[EntryIndex];
+	const FConversationRecord* Conversations = GetSection<FConversationRecord>(Header->ConversationsOffset);
+	const FDialogueRecord* Dialogues = GetSection<FDialogueRecord>(Header->DialoguesOffset);
+	const FSubtitleRecord* Subtitles = GetSection<FSubtitleRecord>(Header->SubtitlesOffset);
+	const FQuestionRecord* Questions = GetSection<FQuestionRecord>(Header->QuestionsOffset);
+
+	if (uint64(Entry.FirstConversation) + Entry.NumConversations > Header->NumConversations ||
+		uint64(Entry.FirstQuestion) + Entry.NumQuestions > Header->NumQuestions)
+		return false;
+
+	if (OutSoundPaths != nullptr)
+		OutSoundPaths->Reset();
+
+	OutConversationList.Reset(Entry.NumConversations);
+	for (uint32 c = 0; c < Entry.NumConversations; c++)
+	{
+		const FConversationRecord& ConversationRecord = Conversations[Entry.FirstConversation + c];
+		if (uint64(ConversationRecord.FirstDialogue) + ConversationRecord.NumDialogues > Header->NumDialogues)
+			return false;
+
+		FConversationNode& Conversation = OutConversationList.AddDefaulted_GetRef();
+		Conversation.NodeID = c;
+		Conversation.DialougeNodes.Reserve(ConversationRecord.NumDialogues);
+
+		for (uint32 d = 0; d < ConversationRecord.NumDialogues; d++)
+		{
+			const FDialogueRecord& DialogueRecord = Dialogues[ConversationRecord.FirstDialogue + d];
+			if (uint64(DialogueRecord.FirstSubtitle) + DialogueRecord.NumSubtitles > Header->NumSubtitles)
+				return false;
+
+			FDialogueNode& Dialogue = Conversation.DialougeNodes.AddDefaulted_GetRef();
+			Dialogue.NodeID = d;
+			Dialogue.SpeakerHandle = InternString(DialogueRecord.Speaker);
+			Dialogue.SubtitlesNodes.Reserve(DialogueRecord.NumSubtitles);
+
+			for (uint32 s = 0; s < DialogueRecord.NumSubtitles; s++)
+			{
+				const FSubtitleRecord& SubtitleRecord = Subtitles[DialogueRecord.FirstSubtitle + s];
+
+				FSubtitleNode& Subtitle = Dialogue.SubtitlesNodes.AddDefaulted_GetRef();
+				Subtitle.NodeID = s;
+				Subtitle.TextHandle = InternString(SubtitleRecord.Text);
+				Subtitle.SubtitleTimer = SubtitleRecord.Timer;
+				Subtitle.bHasQuestion = SubtitleRecord.bHasQuestion != 0;
+
+				const FSoftObjectPath Sound = SubtitleRecord.Sound != 0 ? FSoftObjectPath(ReadString(SubtitleRecord.Sound)) : FSoftObjectPath();
+				if (OutSoundPaths != nullptr)
+				{
+					OutSoundPaths->Add(Sound);
+					Subtitle.SubtitleSound = Cast<USoundWave>(Sound.ResolveObject());
+				}
+				else if (Sound.IsValid())
+				{
+					Subtitle.SubtitleSound = Cast<USoundWave>(Sound.TryLoad());
+				}
+			}
+		}
+	}
+
+	OutQuestionList.Reset(Entry.NumQuestions);
+	for (uint32 q = 0; q < Entry.NumQuestions; q++)
+	{
+		const FQuestionRecord& QuestionRecord = Questions[Entry.FirstQuestion + q];
+
+		FQuestionNode& Question = OutQuestionList.AddDefaulted_GetRef();
+		Question.OptionHandle = InternString(QuestionRecord.Option);
+		Question.ConversationReferenceID = QuestionRecord.ConversationNode;
+		Question.DialougeReferenceID = QuestionRecord.DialogueNode;
+		Question.SubtitleRefrenceID = QuestionRecord.SubtitleNode;
+		Question.NodeID = QuestionRecord.NodeID;
+		Question.GoToConversationNodeID = QuestionRecord.GoToConversationNode;
+		Question.Condition = ReadString(QuestionRecord.Condition);
+		Question.Action = ReadString(QuestionRecord.Action);
+	}
+
+	return true;
+}
+
+/*
+ * Function:  Write
+ * --------------------
+ * 1) Flatten every conversation into record arrays, collecting strings into the pool.
+ * 2) Sort the index by key hash so lookups can binary search.
+ * 3) Write the header followed by each section.
+ *
+ */
+bool FDialogueBank::Write(const TMap<FName, FImportedConversation>& Conversations, const FString& OutFilename)
+{
+	FStringPool Strings;
+	TArray<FEntry> Entries;
+	TArray<FConversationRecord> ConversationRecords;
+	TArray<FDialogueRecord> DialogueRecords;
+	TArray<FSubtitleRecord> SubtitleRecords;
+	TArray<FQuestionRecord> QuestionRecords;
+
+	for (const TPair<FName, FImportedConversation>& Pair : Conversations)
+	{
+		const FString Key = Pair.Key.ToString();
+		FEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.KeyHash = HashKey(Key);
+		Entry.Key = Strings.Add(Key);
+		Entry.FirstConversation = ConversationRecords.Num();
+		Entry.NumConversations = Pair.Value.ConversationList.Num();
+		Entry.FirstQuestion = QuestionRecords.Num();
+		Entry.NumQuestions = Pair.Value.QuestionList.Num();
+
+		for (const FConversationNode& Conversation : Pair.Value.ConversationList)
+		{
+			ConversationRecords.Add({ uint32(DialogueRecords.Num()), uint32(Conversation.DialougeNodes.Num()) });
+
+			for (const FDialogueNode& Dialogue : Conversation.DialougeNodes)
+			{
+				DialogueRecords.Add({ Strings.Add(Dialogue.GetSpeakerName()), uint32(SubtitleRecords.Num()), uint32(Dialogue.SubtitlesNodes.Num()) });
+
+				for (const FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+				{
+					const FString Sound = Subtitle.SubtitleSound ? Subtitle.SubtitleSound->GetPathName() : FString();
+					SubtitleRecords.Add({ Strings.Add(Subtitle.GetText()), Strings.Add(Sound), Subtitle.SubtitleTimer, Subtitle.bHasQuestion ? 1u : 0u });
+				}
+			}
+		}
+
+		for (const FQuestionNode& Question : Pair.Value.QuestionList)
+		{
+			QuestionRecords.Add({ Strings.Add(Question.GetOption()), uint16(Question.ConversationReferenceID), uint16(Question.DialougeReferenceID),
+				uint16(Question.SubtitleRefrenceID), uint16(Question.NodeID), uint16(Question.GoToConversationNodeID), 0,
+				Strings.Add(Question.Condition), Strings.Add(Question.Action) });
+		}
+	}
+
+	Entries.Sort([](const FEntry& A, const FEntry& B) { return A.KeyHash < B.KeyHash; });
+
+	// Keep every section 4 byte aligned so the records can be read in place.
+	while (Strings.Bytes.Num() % 4 != 0)
+		Strings.Bytes.Add(0);
+
+	TArray<uint8> Out;
+	Out.AddZeroed(sizeof(FHeader));
+
+	FHeader Header;
+	Header.Magic = DialogueBankFormat::Magic;
+	Header.Version = DialogueBankFormat::Version;
+	Header.NumEntries = Entries.Num();
+	Header.EntriesOffset = AppendSection(Out, Entries);
+	Header.NumConversations = ConversationRecords.Num();
+	Header.ConversationsOffset = AppendSection(Out, ConversationRecords);
+	Header.NumDialogues = DialogueRecords.Num();
+	Header.DialoguesOffset = AppendSection(Out, DialogueRecords);
+	Header.NumSubtitles = SubtitleRecords.Num();
+	Header.SubtitlesOffset = AppendSection(Out, SubtitleRecords);
+	Header.NumQuestions = QuestionRecords.Num();
+	Header.QuestionsOffset = AppendSection(Out, QuestionRecords);
+	Header.StringPoolSize = Strings.Bytes.Num();
+	Header.StringPoolOffset = AppendSection(Out, Strings.Bytes);
+	FMemory::Memcpy(Out.GetData(), &Header, sizeof(FHeader));
+
+	return FFileHelper::SaveArrayToFile(Out, *OutFilename);
+}
+
+/*
+ * Console Command:  HB.Dialogue.BuildBank <Script> [Bank]
+ * --------------------
+ * Imports a dialogue script and compiles it into a bank, by default the one the game loads.
+ */
+static FAutoConsoleCommand GDialogueBuildBankCommand(
+	TEXT("HB.Dialogue.BuildBank"),
+	TEXT("Compiles a dialogue script into a dialogue bank. Usage: HB.Dialogue.BuildBank <Script.csv> [Bank.hbdb]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+			return;
+
+		FString BankFile = TEXT("Dialogue/DialogueBank.hbdb");
+		GConfig->GetString(TEXT("/Script/HeavenlyBlue.DialogueBank"), TEXT("BankFile"), BankFile, GGameIni);
+		const FString OutFilename = Args.Num() > 1 ? Args[1] : FPaths::ProjectContentDir() / BankFile;
+
+		FDialogueScriptImporter Importer;
+		TMap<FName, FImportedConversation> Conversations;
+		if (!Importer.ImportFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Args[0]), Conversations))
+			return;
+
+		if (FDialogueBank::Write(Conversations, OutFilename))
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("Wrote %d conversations to %s (%lld bytes)."), Conversations.Num(), *OutFilename, IFileManager::Get().FileSize(*OutFilename));
+		else
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write %s."), *OutFilename);
+	})
+);
@@ -0,0 +1,93 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueBank
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class reads the compiled dialogue bank, a single binary
+*				   file holding every conversation of the game. The file is
+*				   memory mapped and a conversation is only decoded into nodes
+*				   when its conversation instance asks for it.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IDialogueTree.h"
+#include "UObject/SoftObjectPath.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+struct FImportedConversation;
+
+/*
+ * File layout (little endian, every section 4 byte aligned):
+ *
+ *   Header			Magic, version and the offset/count of each section.
+ *   Index			One entry per conversation key, sorted by key hash.
+ *   Conversations	Fixed size records, each pointing at a range of dialogues.
+ *   Dialogues		Fixed size records, each pointing at a range of subtitles.
+ *   Subtitles		Fixed size records.
+ *   Questions		Fixed size records, grouped per conversation key.
+ *   String pool	Deduplicated UTF-8 strings, records refer to them by offset (0 is the empty string).
+ */
+class HEAVENLYBLUE_API FDialogueBank
+{
+public:
+	FDialogueBank();
+	~FDialogueBank();
+
+	// The bank used by the game, opened on first use. See [/Script/HeavenlyBlue.DialogueBank] in DefaultGame.ini.
+	static FDialogueBank& Get();
+
+	bool Open(const FString& Filename);
+	void Close();
+	bool IsOpen() const { return Data != nullptr; }
+
+	// Decodes one conversation into the node layout used by IIDialogueTree, with its text already interned.
+	// Returns false if the bank doesn't have it. Without OutSoundPaths the subtitle sounds are loaded right
+	// away. With it, they are only taken if already in memory, and OutSoundPaths gets one path per subtitle,
+	// in node order, for the caller to load the rest asynchronously.
+	bool DecodeConversation(FName ConversationKey, TArray<FConversationNode>& OutConversationList, TArray<FQuestionNode>& OutQuestionList,
+		TArray<FSoftObjectPath>* OutSoundPaths = nullptr) const;
+	bool Contains(FName ConversationKey) const { return FindEntry(ConversationKey) != INDEX_NONE; }
+
+	int32 GetNumConversations() const;
+	// The key of every conversation in the bank, in the bank's order.
+	void GetConversationKeys(TArray<FName>& OutKeys) const;
+	int64 GetFileSize() const { return Size; }
+	const FString& GetFilename() const { return Filename; }
+
+	// Compiles imported conversations into a bank file.
+	static bool Write(const TMap<FName, FImportedConversation>& Conversations, const FString& Filename);
+
+private:
+	FString ReadString(uint32 Offset) const;
+	FDialogueStringHandle InternString(uint32 Offset) const;
+	int32 FindEntry(FName ConversationKey) const;
+
+	template<typename RecordType>
+	const RecordType* GetSection(uint32 Offset) const { return reinterpret_cast<const RecordType*>(Data + Offset); }
+
+	FString Filename;
+	const uint8* Data;
+	int64 Size;
+
+	// Mapping is released region first. Platforms that can't map files read the whole bank into FallbackData instead.
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> FallbackData;
+
+	// String pool offset to string table handle, filled as conversations are decoded.
+	mutable TMap<uint32, FDialogueStringHandle> StringHandles;
+
+	bool bTriedDefaultOpen;
+};
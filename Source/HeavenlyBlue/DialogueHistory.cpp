@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueHistory.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueLocalization.h"
+#include "IDialogueTree.h"
+#include "Engine/GameInstance.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Styling/CoreStyle.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Layout/SScrollBox.h"
+#include "Widgets/Text/STextBlock.h"
+
+FDialogueHistory::FDialogueHistory(int32 InCapacity) :
+Head(0),
+Mask(0),
+Count(0)
+{
+	const uint32 Capacity = FMath::RoundUpToPowerOfTwo(uint32(FMath::Max(InCapacity, 1)));
+	Entries.SetNum(Capacity);
+	Mask = Capacity - 1;
+}
+
+/*
+ * Function:  Materialize
+ * --------------------
+ * Each entry takes the line of its conversation's table in the active culture, or the authored text if there isn't one.
+ * The tables of conversations that were released are loaded again, the backlog is rarely open.
+ * Each table is acquired once, so it stays until the caller releases it even if its conversation lets go first.
+ *
+ */
+void FDialogueHistory::Materialize(TArray<FDialogueBacklogLine>& OutLines, TArray<FName>& OutTables) const
+{
+	FDialogueLocalization& Localization = FDialogueLocalization::Get();
+	auto Localize = [&Localization, &OutTables](const FDialogueHistoryEntry& Entry, FDialogueStringHandle Source, uint64 LineKey) -> const FString&
+	{
+		if (!Entry.ConversationKey.IsNone() && !OutTables.Contains(Entry.ConversationKey))
+		{
+			OutTables.Add(Entry.ConversationKey);
+			Localization.AcquireConversation(Entry.ConversationKey);
+		}
+
+		const FDialogueStringHandle Localized = Entry.ConversationKey.IsNone() ? FDialogueStringHandle() : Localization.FindConversationLine(Entry.ConversationKey, LineKey);
+		return FDialogueStringTable::ResolveText(Localized.IsEmpty() ? Source : Localized);
+	};
+
+	OutLines.Reset(Count);
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		const FDialogueHistoryEntry& Entry = (*this)[Index];
+
+		FDialogueBacklogLine& Line = OutLines.AddDefaulted_GetRef();
+		Line.bOption = Entry.IsOption();
+		if (Line.bOption)
+		{
+			Line.Text = Localize(Entry, Entry.Text, FDialogueLocalization::MakeLineKey(FDialogueLocalization::ELineKind::Option, Entry.Conversation, Entry.Dialogue, Entry.Subtitle, Entry.Option));
+		}
+		else
+		{
+			Line.Speaker = Localize(Entry, Entry.Speaker, FDialogueLocalization::MakeLineKey(FDialogueLocalization::ELineKind::Speaker, Entry.Conversation, Entry.Dialogue));
+			Line.Text = Localize(Entry, Entry.Text, FDialogueLocalization::MakeLineKey(FDialogueLocalization::ELineKind::Subtitle, Entry.Conversation, Entry.Dialogue, Entry.Subtitle));
+		}
+	}
+}
+
+void UDialogueHistorySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	int32 Capacity = 256;
+	GConfig->GetInt(TEXT("/Script/HeavenlyBlue.DialogueHistory"), TEXT("Capacity"), Capacity, GGameIni);
+
+	HB_LLM_SCOPE(Dialogue);
+	History = FDialogueHistory(Capacity);
+	BacklogTextBytes = 0;
+}
+
+void UDialogueHistorySubsystem::Deinitialize()
+{
+	CloseBacklog();
+	Super::Deinitialize();
+}
+
+UDialogueHistorySubsystem* UDialogueHistorySubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UDialogueHistorySubsystem>() : nullptr;
+}
+
+void UDialogueHistorySubsystem::RecordLine(FName ConversationKey, int32 Conversation, int32 Dialogue, int32 Subtitle, FDialogueStringHandle Speaker, FDialogueStringHandle Text)
+{
+	FDialogueHistoryEntry Entry;
+	Entry.ConversationKey = ConversationKey;
+	Entry.Speaker = Speaker;
+	Entry.Text = Text;
+	Entry.Conversation = uint16(Conversation);
+	Entry.Dialogue = uint16(Dialogue);
+	Entry.Subtitle = uint16(Subtitle);
+	History.Add(Entry);
+}
+
+void UDialogueHistorySubsystem::RecordOption(FName ConversationKey, const FQuestionNode& Option)
+{
+	FDialogueHistoryEntry Entry;
+	Entry.ConversationKey = ConversationKey;
+	Entry.Text = Option.OptionHandle.IsEmpty() ? FDialogueStringTable::Get().Intern(Option.Option) : Option.OptionHandle;
+	Entry.Conversation = uint16(Option.ConversationReferenceID);
+	Entry.Dialogue = uint16(Option.DialougeReferenceID);
+	Entry.Subtitle = uint16(Option.SubtitleRefrenceID);
+	Entry.Option = uint16(Option.NodeID);
+	History.Add(Entry);
+}
+
+/*
+ * Function:  OpenBacklog
+ * --------------------
+ * 1) Look up the text of every entry.
+ * 2) Build the list over the viewport, scrolled to the latest line.
+ * The text only lives in the widget, closing the backlog frees it.
+ *
+ */
+void UDialogueHistorySubsystem::OpenBacklog()
+{
+	UGameViewportClient* Viewport = GetGameInstance()->GetGameViewportClient();
+	if (IsBacklogOpen() || Viewport == nullptr)
+		return;
+
+	HB_LLM_SCOPE(Dialogue);
+
+	TArray<FDialogueBacklogLine> Lines;
+	History.Materialize(Lines, BacklogTables);
+
+	int32 FontSize = 20;
+	GConfig->GetInt(TEXT("/Script/HeavenlyBlue.SubtitlePresenter"), TEXT("FontSize"), FontSize, GGameIni);
+	const FSlateFontInfo Font = FCoreStyle::GetDefaultFontStyle("Regular", FontSize);
+
+	TSharedRef<SScrollBox> ScrollBox = SNew(SScrollBox);
+	BacklogTextBytes = 0;
+	for (const FDialogueBacklogLine& Line : Lines)
+	{
+		const FString Text = Line.bOption ? TEXT("> ") + Line.Text : Line.Speaker.IsEmpty() ? Line.Text : Line.Speaker + TEXT(": ") + Line.Text;
+		BacklogTextBytes += Text.GetAllocatedSize();
+
+		ScrollBox->AddSlot()
+		.Padding(FMargin(0.0f, 4.0f))
+		[
+			SNew(STextBlock)
+			.Text(FText::FromString(Text))
+			.Font(Font)
+			.AutoWrapText(true)
+			.ColorAndOpacity(Line.bOption ? FLinearColor(1.0f, 0.85f, 0.4f) : FLinearColor::White)
+		];
+	}
+	ScrollBox->ScrollToEnd();
+
+	BacklogWidget = SNew(SBorder)
+		.BorderImage(FCoreStyle::Get().GetBrush("WhiteBrush"))
+		.BorderBackgroundColor(FLinearColor(0.0f, 0.0f, 0.0f, 0.8f))
+		.Padding(FMargin(48.0f, 32.0f))
+		[
+			ScrollBox
+		];
+
+	// Above the subtitles.
+	Viewport->AddViewportWidgetContent(BacklogWidget.ToSharedRef(), 20);
+}
+
+void UDialogueHistorySubsystem::CloseBacklog()
+{
+	if (!IsBacklogOpen())
+		return;
+
+	if (UGameViewportClient* Viewport = GetGameInstance()->GetGameViewportClient())
+		Viewport->RemoveViewportWidgetContent(BacklogWidget.ToSharedRef());
+
+	BacklogWidget.Reset();
+	BacklogTextBytes = 0;
+
+	for (const FName Table : BacklogTables)
+		FDialogueLocalization::Get().ReleaseConversation(Table);
+	BacklogTables.Reset();
+}
+
+void UDialogueHistorySubsystem::ToggleBacklog()
+{
+	if (IsBacklogOpen())
+		CloseBacklog();
+	else
+		OpenBacklog();
+}
+
+void UDialogueHistorySubsystem::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(History.GetAllocatedSize() + BacklogTextBytes);
+}
+
+/*
+ * Console Command:  HB.Dialogue.Backlog [bench]
+ * --------------------
+ * Opens or closes the backlog. With bench, times adding entries to a history of the configured size instead.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GDialogueBacklogCommand(
+	TEXT("HB.Dialogue.Backlog"),
+	TEXT("Opens or closes the dialogue backlog. Usage: HB.Dialogue.Backlog [bench]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UDialogueHistorySubsystem* HistorySubsystem = UDialogueHistorySubsystem::Get(World);
+		if (HistorySubsystem == nullptr)
+			return;
+
+		if (Args.Num() == 0 || Args[0] != TEXT("bench"))
+		{
+			HistorySubsystem->ToggleBacklog();
+			return;
+		}
+
+		const int32 Adds = 10000000;
+		FDialogueHistory History(HistorySubsystem->GetHistory().GetCapacity());
+		FDialogueHistoryEntry Entry;
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Adds; Index++)
+		{
+			Entry.Subtitle = uint16(Index);
+			History.Add(Entry);
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Dialogue history: %d entries of %d bytes (%llu bytes), %.2f ns per add. The session's history has %d entries."),
+			History.GetCapacity(), int32(sizeof(FDialogueHistoryEntry)), (uint64)History.GetAllocatedSize(), Seconds * 1e9 / Adds, HistorySubsystem->GetHistory().Num());
+	})
+);
@@ -0,0 +1,135 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueHistory
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This keeps the backlog of the lines shown and the options
+*				   chosen, so the player can read back what was said. Entries
+*				   are handles into the dialogue, the text is only looked up
+*				   when the backlog is opened.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "DialogueStringTable.h"
+#include "DialogueHistory.generated.h"
+
+class SWidget;
+struct FQuestionNode;
+
+/*
+ * Struct:  FDialogueHistoryEntry
+ * --------------------
+ * One shown line or chosen option. Speaker and Text are handles into the authored table, which lives as long
+ * as the game. The node indices find the line's localized text, which may be in another culture by the time it's read.
+ */
+struct FDialogueHistoryEntry
+{
+	static const uint16 NoOption = 0xFFFF;
+
+	FName ConversationKey;
+	FDialogueStringHandle Speaker;
+	FDialogueStringHandle Text;
+	uint16 Conversation = 0;
+	uint16 Dialogue = 0;
+	uint16 Subtitle = 0;
+	// The option's NodeID, NoOption for a line.
+	uint16 Option = NoOption;
+
+	bool IsOption() const { return Option != NoOption; }
+};
+
+// An entry with its text, made when the backlog is opened.
+struct FDialogueBacklogLine
+{
+	FString Speaker;
+	FString Text;
+	bool bOption = false;
+};
+
+/*
+ * Class:  FDialogueHistory
+ * --------------------
+ * A ring buffer of entries. It's allocated once and the oldest entry is overwritten when it's full,
+ * so adding never allocates and the memory doesn't grow with the length of the session.
+ */
+class HEAVENLYBLUE_API FDialogueHistory
+{
+public:
+	// The capacity is rounded up to a power of two.
+	explicit FDialogueHistory(int32 InCapacity = 256);
+
+	void Add(const FDialogueHistoryEntry& Entry)
+	{
+		Entries[Head] = Entry;
+		Head = (Head + 1) & Mask;
+		Count += Count <= int32(Mask) ? 1 : 0;
+	}
+
+	// Oldest first.
+	const FDialogueHistoryEntry& operator[](int32 Index) const { return Entries[(Head - Count + Index) & Mask]; }
+
+	int32 Num() const { return Count; }
+	int32 GetCapacity() const { return Entries.Num(); }
+	void Reset() { Head = 0; Count = 0; }
+
+	// Looks up the text of every entry in the active culture, oldest first. The conversation tables it
+	// needs are acquired and listed in OutTables, release them with FDialogueLocalization::ReleaseConversation.
+	void Materialize(TArray<FDialogueBacklogLine>& OutLines, TArray<FName>& OutTables) const;
+
+	SIZE_T GetAllocatedSize() const { return Entries.GetAllocatedSize(); }
+
+private:
+	TArray<FDialogueHistoryEntry> Entries;
+	uint32 Head;
+	uint32 Mask;
+	int32 Count;
+};
+
+/*
+ * Class:  UDialogueHistorySubsystem
+ * --------------------
+ * The session's backlog and the widget that shows it. See [/Script/HeavenlyBlue.DialogueHistory] in DefaultGame.ini.
+ */
+UCLASS()
+class HEAVENLYBLUE_API UDialogueHistorySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	static UDialogueHistorySubsystem* Get(const UObject* WorldContextObject);
+
+	void RecordLine(FName ConversationKey, int32 Conversation, int32 Dialogue, int32 Subtitle, FDialogueStringHandle Speaker, FDialogueStringHandle Text);
+	void RecordOption(FName ConversationKey, const FQuestionNode& Option);
+
+	const FDialogueHistory& GetHistory() const { return History; }
+
+	void OpenBacklog();
+	void CloseBacklog();
+	void ToggleBacklog();
+	bool IsBacklogOpen() const { return BacklogWidget.IsValid(); }
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+private:
+	FDialogueHistory History;
+	TSharedPtr<SWidget> BacklogWidget;
+	// The text on screen while the backlog is open.
+	SIZE_T BacklogTextBytes;
+	// The conversation tables the open backlog holds, released when it closes.
+	TArray<FName> BacklogTables;
+};
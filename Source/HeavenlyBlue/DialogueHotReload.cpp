@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueHotReload.h"
+#include "HeavenlyBlue.h"
+#include "AConversationInstance.h"
+#include "DialogueScriptImporter.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Paths.h"
+
+FDialogueHotReload& FDialogueHotReload::Get()
+{
+	static FDialogueHotReload HotReload;
+	return HotReload;
+}
+
+FDialogueHotReload::FDialogueHotReload() :
+PollInterval(0.2f),
+bEnabled(false)
+{
+#if !UE_BUILD_SHIPPING
+	GConfig->GetBool(TEXT("/Script/HeavenlyBlue.DialogueHotReload"), TEXT("bEnabled"), bEnabled, GGameIni);
+	GConfig->GetFloat(TEXT("/Script/HeavenlyBlue.DialogueHotReload"), TEXT("PollInterval"), PollInterval, GGameIni);
+#endif
+}
+
+FString FDialogueHotReload::GetScriptFilename(const AAConversationInstance& Instance)
+{
+	FString Filename = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Instance.ScriptFile.FilePath);
+	FPaths::NormalizeFilename(Filename);
+	return Filename;
+}
+
+/*
+ * Function:  Register
+ * --------------------
+ * The script is timed from when its first instance registers, saves made before that were applied by the editor.
+ * Polling starts with the first script and stops with the last.
+ *
+ */
+void FDialogueHotReload::Register(AAConversationInstance* Instance)
+{
+	if (!bEnabled || Instance == nullptr || Instance->ScriptFile.FilePath.IsEmpty())
+		return;
+
+	const FString Filename = GetScriptFilename(*Instance);
+	FWatchedScript* Script = Scripts.Find(Filename);
+	if (Script == nullptr)
+	{
+		Script = &Scripts.Add(Filename);
+		Script->TimeStamp = IFileManager::Get().GetTimeStamp(*Filename);
+		Script->PendingTimeStamp = Script->TimeStamp;
+	}
+	Script->Instances.AddUnique(Instance);
+
+	if (!TickerHandle.IsValid())
+		TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FDialogueHotReload::Tick), PollInterval);
+}
+
+void FDialogueHotReload::Unregister(AAConversationInstance* Instance)
+{
+	if (Instance == nullptr || Instance->ScriptFile.FilePath.IsEmpty())
+		return;
+
+	const FString Filename = GetScriptFilename(*Instance);
+	FWatchedScript* Script = Scripts.Find(Filename);
+	if (Script == nullptr)
+		return;
+
+	Script->Instances.RemoveAll([Instance](const TWeakObjectPtr<AAConversationInstance>& Watched) { return !Watched.IsValid() || Watched.Get() == Instance; });
+	if (Script->Instances.Num() == 0)
+		Scripts.Remove(Filename);
+
+	if (Scripts.Num() == 0 && TickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+}
+
+/*
+ * Function:  Tick
+ * --------------------
+ * Checks the time stamp of every watched script. A changed time stamp is only trusted once a second poll sees the same one.
+ *
+ */
+bool FDialogueHotReload::Tick(float DeltaTime)
+{
+	for (TPair<FString, FWatchedScript>& Pair : Scripts)
+	{
+		FWatchedScript& Script = Pair.Value;
+		const FDateTime TimeStamp = IFileManager::Get().GetTimeStamp(*Pair.Key);
+
+		// Missing for now, editors may delete and write the file again when they save.
+		if (TimeStamp == FDateTime::MinValue() || TimeStamp == Script.TimeStamp)
+			continue;
+
+		if (TimeStamp != Script.PendingTimeStamp)
+		{
+			Script.PendingTimeStamp = TimeStamp;
+			continue;
+		}
+
+		Script.TimeStamp = TimeStamp;
+		ReloadScript(Pair.Key, Script);
+	}
+
+	return true;
+}
+
+void FDialogueHotReload::ReloadAll()
+{
+	for (TPair<FString, FWatchedScript>& Pair : Scripts)
+		ReloadScript(Pair.Key, Pair.Value);
+}
+
+/*
+ * Function:  ReloadScript
+ * --------------------
+ * 1) Import the whole script, parsing is spread over worker threads so this stays in the milliseconds.
+ * 2) Hand each instance its conversation, unless the content hash matches what it already has.
+ *    Only those are interned, localized and compiled again.
+ * 3) Conversations that are no longer in the script are left as they are.
+ *
+ */
+void FDialogueHotReload::ReloadScript(const FString& Filename, FWatchedScript& Script)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FDialogueScriptImporter Importer;
+	TMap<FName, FImportedConversation> Conversations;
+	FDialogueImportStats Stats;
+	if (!Importer.ImportFile(Filename, Conversations, &Stats))
+		return;
+
+	int32 Reloaded = 0, Unchanged = 0;
+	Script.Instances.RemoveAll([](const TWeakObjectPtr<AAConversationInstance>& Watched) { return !Watched.IsValid(); });
+	for (const TWeakObjectPtr<AAConversationInstance>& Watched : Script.Instances)
+	{
+		AAConversationInstance* Instance = Watched.Get();
+		const FImportedConversation* Imported = Conversations.Find(Instance->ScriptConversationKey);
+		if (Imported == nullptr)
+			continue;
+
+		if (Imported->ContentHash == Instance->ScriptContentHash)
+		{
+			Unchanged++;
+			continue;
+		}
+
+		Instance->HotReloadConversation(*Imported);
+		Reloaded++;
+	}
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Reloaded %s in %.2f ms (parsed %d lines in %.2f ms): %d conversations changed, %d unchanged, %d errors."),
+		*FPaths::GetCleanFilename(Filename), (FPlatformTime::Seconds() - StartTime) * 1000.0, Stats.Lines, Stats.Seconds * 1000.0, Reloaded, Unchanged, Stats.Errors);
+}
+
+/*
+ * Console Command:  HB.Dialogue.Reload
+ * --------------------
+ * Reloads the watched scripts without waiting for them to change. Conversations that are the same are still skipped.
+ */
+static FAutoConsoleCommand GDialogueReloadCommand(
+	TEXT("HB.Dialogue.Reload"),
+	TEXT("Reloads the dialogue scripts of the conversations in play and applies the conversations that changed."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (!FDialogueHotReload::Get().IsEnabled())
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Dialogue hot reload is off, see [/Script/HeavenlyBlue.DialogueHotReload] in DefaultGame.ini."));
+			return;
+		}
+
+		FDialogueHotReload::Get().ReloadAll();
+	})
+);
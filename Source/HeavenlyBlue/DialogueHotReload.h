@@ -0,0 +1,72 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueHotReload
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This watches the dialogue scripts of the conversations in play
+*				   and reloads them as they're saved. Only conversations whose
+*				   lines changed are applied again, the rest keep their nodes,
+*				   compiled scripts and localized text.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class AAConversationInstance;
+
+/*
+ * Class:  FDialogueHotReload
+ * --------------------
+ * Off in shipping builds. See [/Script/HeavenlyBlue.DialogueHotReload] in DefaultGame.ini.
+ */
+class HEAVENLYBLUE_API FDialogueHotReload
+{
+public:
+	static FDialogueHotReload& Get();
+
+	bool IsEnabled() const { return bEnabled; }
+
+	// Conversation instances with a ScriptFile register as they begin play and unregister as they end it.
+	void Register(AAConversationInstance* Instance);
+	void Unregister(AAConversationInstance* Instance);
+
+	// Reloads every watched script now, whether it changed on disk or not.
+	void ReloadAll();
+
+private:
+	FDialogueHotReload();
+
+	/*
+	 * Struct:  FWatchedScript
+	 * --------------------
+	 * A script is reloaded once its time stamp changed and then stayed the same for a poll,
+	 * so a save still being written isn't read half way.
+	 */
+	struct FWatchedScript
+	{
+		FDateTime TimeStamp;
+		FDateTime PendingTimeStamp;
+		TArray<TWeakObjectPtr<AAConversationInstance>> Instances;
+	};
+
+	bool Tick(float DeltaTime);
+	void ReloadScript(const FString& Filename, FWatchedScript& Script);
+
+	static FString GetScriptFilename(const AAConversationInstance& Instance);
+
+	TMap<FString, FWatchedScript> Scripts;
+	FDelegateHandle TickerHandle;
+	float PollInterval;
+	bool bEnabled;
+};
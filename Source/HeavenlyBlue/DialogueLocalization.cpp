@@ -0,0 +1,515 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueLocalization.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "ItemDatabase.h"
+#include "AConversationInstance.h"
+#include "DialogueScriptImporter.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Hash/CityHash.h"
+#include "Internationalization/Culture.h"
+#include "Internationalization/Internationalization.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace DialogueLocalizationPrivate
+{
+	const TCHAR* ConfigSection = TEXT("/Script/HeavenlyBlue.DialogueLocalization");
+	const FName ItemsTable(TEXT("Items"));
+
+	FString Escape(const FString& Text)
+	{
+		return Text.Replace(TEXT("\\"), TEXT("\\\\")).Replace(TEXT("\r"), TEXT("")).Replace(TEXT("\n"), TEXT("\\n"));
+	}
+
+	FString Unescape(const TCHAR* Begin, const TCHAR* End)
+	{
+		FString Out;
+		Out.Reserve(int32(End - Begin));
+		for (const TCHAR* Cursor = Begin; Cursor < End; Cursor++)
+		{
+			if (Cursor[0] == TEXT('\\') && Cursor + 1 < End && (Cursor[1] == TEXT('n') || Cursor[1] == TEXT('\\')))
+			{
+				Out.AppendChar(Cursor[1] == TEXT('n') ? TEXT('\n') : TEXT('\\'));
+				Cursor++;
+			}
+			else
+			{
+				Out.AppendChar(*Cursor);
+			}
+		}
+		return Out;
+	}
+
+	FDialogueStringHandle FindLine(const TMap<uint64, FDialogueStringHandle>& Lines, uint64 LineKey)
+	{
+		const FDialogueStringHandle* Handle = Lines.Find(LineKey);
+		return Handle ? *Handle : FDialogueStringHandle();
+	}
+
+	/*
+	 * Function:  ParseLineKey
+	 * --------------------
+	 * 1) Map the part before the first dot to the kind of line.
+	 * 2) Read up to four dot separated numbers after it.
+	 * Returns false for an ID that isn't one of the forms in DialogueLocalization.h.
+	 *
+	 */
+	bool ParseLineKey(const TCHAR* Begin, const TCHAR* End, uint64& OutKey)
+	{
+		const TCHAR* Dot = Begin;
+		while (Dot < End && *Dot != TEXT('.'))
+			Dot++;
+
+		const int32 PrefixLength = int32(Dot - Begin);
+		FDialogueLocalization::ELineKind Kind;
+		if (PrefixLength == 1 && *Begin == TEXT('N'))
+			Kind = FDialogueLocalization::ELineKind::Speaker;
+		else if (PrefixLength == 1 && *Begin == TEXT('S'))
+			Kind = FDialogueLocalization::ELineKind::Subtitle;
+		else if (PrefixLength == 1 && *Begin == TEXT('O'))
+			Kind = FDialogueLocalization::ELineKind::Option;
+		else if (PrefixLength == 4 && FCString::Strncmp(Begin, TEXT("Name"), 4) == 0)
+			Kind = FDialogueLocalization::ELineKind::ItemName;
+		else if (PrefixLength == 4 && FCString::Strncmp(Begin, TEXT("Desc"), 4) == 0)
+			Kind = FDialogueLocalization::ELineKind::ItemDescription;
+		else
+			return false;
+
+		int32 Numbers[4] = { 0, 0, 0, 0 };
+		int32 NumNumbers = 0;
+		const TCHAR* Cursor = Dot;
+		while (Cursor < End)
+		{
+			if (*Cursor != TEXT('.') || NumNumbers == ARRAY_COUNT(Numbers))
+				return false;
+			Cursor++;
+
+			const bool bNegative = Cursor < End && *Cursor == TEXT('-');
+			Cursor += bNegative ? 1 : 0;
+			const TCHAR* Digits = Cursor;
+			int64 Value = 0;
+			while (Cursor < End && FChar::IsDigit(*Cursor) && Value <= MAX_int32)
+				Value = Value * 10 + (*Cursor++ - TEXT('0'));
+			if (Cursor == Digits || Value > MAX_int32)
+				return false;
+
+			Numbers[NumNumbers++] = int32(bNegative ? -Value : Value);
+		}
+
+		OutKey = FDialogueLocalization::MakeLineKey(Kind, Numbers[0], Numbers[1], Numbers[2], Numbers[3]);
+		return NumNumbers > 0;
+	}
+}
+
+using namespace DialogueLocalizationPrivate;
+
+/*
+ * Function:  FDialogueLocalization
+ * --------------------
+ * The culture comes from the config, or follows the engine's language when the config leaves it empty.
+ *
+ */
+FDialogueLocalization::FDialogueLocalization()
+{
+	GConfig->GetString(ConfigSection, TEXT("Culture"), Culture, GGameIni);
+
+	if (Culture.IsEmpty())
+	{
+		const FCultureRef Current = FInternationalization::Get().GetCurrentLanguage();
+		Culture = Current->GetName();
+		if (!IFileManager::Get().DirectoryExists(*GetCultureDirectory(Culture)))
+			Culture = Current->GetTwoLetterISOLanguageName();
+
+		EngineCultureChangedHandle = FInternationalization::Get().OnCultureChanged().AddRaw(this, &FDialogueLocalization::HandleEngineCultureChanged);
+	}
+}
+
+FDialogueLocalization::~FDialogueLocalization()
+{
+	if (EngineCultureChangedHandle.IsValid() && FInternationalization::IsAvailable())
+		FInternationalization::Get().OnCultureChanged().Remove(EngineCultureChangedHandle);
+}
+
+FDialogueLocalization& FDialogueLocalization::Get()
+{
+	static FDialogueLocalization Localization;
+	return Localization;
+}
+
+FString FDialogueLocalization::GetLocalizationDirectory()
+{
+	FString Directory = TEXT("Dialogue/Localization");
+	GConfig->GetString(ConfigSection, TEXT("Directory"), Directory, GGameIni);
+	return FPaths::ProjectContentDir() / Directory;
+}
+
+FString FDialogueLocalization::GetCultureDirectory(const FString& InCulture)
+{
+	return GetLocalizationDirectory() / InCulture;
+}
+
+FString FDialogueLocalization::MakeSpeakerID(int32 Conversation, int32 Dialogue)
+{
+	return FString::Printf(TEXT("N.%d.%d"), Conversation, Dialogue);
+}
+
+FString FDialogueLocalization::MakeSubtitleID(int32 Conversation, int32 Dialogue, int32 Subtitle)
+{
+	return FString::Printf(TEXT("S.%d.%d.%d"), Conversation, Dialogue, Subtitle);
+}
+
+FString FDialogueLocalization::MakeOptionID(int32 Conversation, int32 Dialogue, int32 Subtitle, int32 Option)
+{
+	return FString::Printf(TEXT("O.%d.%d.%d.%d"), Conversation, Dialogue, Subtitle, Option);
+}
+
+uint64 FDialogueLocalization::MakeLineKey(ELineKind Kind, int32 A, int32 B, int32 C, int32 D)
+{
+	const int32 Parts[] = { int32(Kind), A, B, C, D };
+	return CityHash64(reinterpret_cast<const char*>(Parts), sizeof(Parts));
+}
+
+void FDialogueLocalization::HandleEngineCultureChanged()
+{
+	const FCultureRef Current = FInternationalization::Get().GetCurrentLanguage();
+	if (!SetCulture(Current->GetName()))
+		SetCulture(Current->GetTwoLetterISOLanguageName());
+}
+
+/*
+ * Function:  SetCulture
+ * --------------------
+ * 1) Drop every table and localized string of the old culture.
+ * 2) Tell everyone holding localized handles, they load the tables they need again.
+ *
+ */
+bool FDialogueLocalization::SetCulture(const FString& NewCulture)
+{
+	if (NewCulture == Culture)
+		return true;
+
+	if (!IFileManager::Get().DirectoryExists(*GetCultureDirectory(NewCulture)))
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("There is no dialogue localization for %s, staying on %s."), *NewCulture, *Culture);
+		return false;
+	}
+
+	Culture = NewCulture;
+	Tables.Empty();
+	FDialogueStringTable::GetLocalized().Reset();
+
+	CultureChangedEvent.Broadcast();
+	return true;
+}
+
+/*
+ * Function:  LoadTable
+ * --------------------
+ * This reads the <ID>,<Text> lines of one table. A line whose ID isn't one of the known forms is skipped.
+ *
+ */
+bool FDialogueLocalization::LoadTable(const FString& Filename, FDialogueStringTable& Strings, TMap<uint64, FDialogueStringHandle>& OutLines)
+{
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *Filename))
+		return false;
+
+	const TCHAR* Cursor = *Contents;
+	while (*Cursor)
+	{
+		const TCHAR* LineBegin = Cursor;
+		while (*Cursor && *Cursor != TEXT('\n'))
+			Cursor++;
+		const TCHAR* LineEnd = Cursor;
+		if (*Cursor)
+			Cursor++;
+
+		if (LineEnd > LineBegin && LineEnd[-1] == TEXT('\r'))
+			LineEnd--;
+		if (LineEnd == LineBegin || *LineBegin == TEXT('#'))
+			continue;
+
+		const TCHAR* Separator = LineBegin;
+		while (Separator < LineEnd && *Separator != TEXT(','))
+			Separator++;
+		if (Separator == LineEnd)
+			continue;
+
+		uint64 LineKey = 0;
+		if (!ParseLineKey(LineBegin, Separator, LineKey))
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: %s is not a line ID, skipping it."), *Filename, *FString(int32(Separator - LineBegin), LineBegin));
+			continue;
+		}
+		OutLines.Add(LineKey, Strings.Intern(Unescape(Separator + 1, LineEnd)));
+	}
+
+	OutLines.Compact();
+	return true;
+}
+
+/*
+ * Function:  WriteConversationTable
+ * --------------------
+ * This writes every non empty line of a conversation. The result is the table translators start from.
+ *
+ */
+bool FDialogueLocalization::WriteConversationTable(const FString& Filename, const TArray<FConversationNode>& Conversations, const TArray<FQuestionNode>& Questions)
+{
+	FString Contents;
+	for (int32 c = 0; c < Conversations.Num(); c++)
+	{
+		for (int32 d = 0; d < Conversations[c].DialougeNodes.Num(); d++)
+		{
+			const FDialogueNode& Dialogue = Conversations[c].DialougeNodes[d];
+			if (!Dialogue.GetSpeakerName().IsEmpty())
+				Contents += MakeSpeakerID(c, d) + TEXT(",") + Escape(Dialogue.GetSpeakerName()) + TEXT("\n");
+
+			for (int32 s = 0; s < Dialogue.SubtitlesNodes.Num(); s++)
+			{
+				if (!Dialogue.SubtitlesNodes[s].GetText().IsEmpty())
+					Contents += MakeSubtitleID(c, d, s) + TEXT(",") + Escape(Dialogue.SubtitlesNodes[s].GetText()) + TEXT("\n");
+			}
+		}
+	}
+
+	for (const FQuestionNode& Question : Questions)
+	{
+		if (!Question.GetOption().IsEmpty())
+		{
+			Contents += MakeOptionID(Question.ConversationReferenceID, Question.DialougeReferenceID, Question.SubtitleRefrenceID, Question.NodeID) +
+				TEXT(",") + Escape(Question.GetOption()) + TEXT("\n");
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Contents, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+const TMap<uint64, FDialogueStringHandle>* FDialogueLocalization::FindOrLoadTable(FName TableName)
+{
+	if (TableName.IsNone())
+		return nullptr;
+
+	TMap<uint64, FDialogueStringHandle>* Lines = Tables.Find(TableName);
+	if (Lines == nullptr)
+	{
+		HB_LLM_SCOPE(Dialogue);
+		Lines = &Tables.Add(TableName);
+		LoadTable(GetCultureDirectory(Culture) / TableName.ToString() + TEXT(".csv"), FDialogueStringTable::GetLocalized(), *Lines);
+	}
+	return Lines->Num() > 0 ? Lines : nullptr;
+}
+
+/*
+ * Function:  LocalizeConversation
+ * --------------------
+ * Every node gets the handle of its line in the active culture, or none if the table doesn't have it.
+ *
+ */
+bool FDialogueLocalization::LocalizeConversation(FName ConversationKey, TArray<FConversationNode>& Conversations, TArray<FQuestionNode>& Questions)
+{
+	const TMap<uint64, FDialogueStringHandle>* Lines = FindOrLoadTable(ConversationKey);
+	const TMap<uint64, FDialogueStringHandle> NoLines;
+	if (Lines == nullptr)
+		Lines = &NoLines;
+
+	for (int32 c = 0; c < Conversations.Num(); c++)
+	{
+		for (int32 d = 0; d < Conversations[c].DialougeNodes.Num(); d++)
+		{
+			FDialogueNode& Dialogue = Conversations[c].DialougeNodes[d];
+			Dialogue.LocalizedSpeakerHandle = FindLine(*Lines, MakeLineKey(ELineKind::Speaker, c, d));
+
+			for (int32 s = 0; s < Dialogue.SubtitlesNodes.Num(); s++)
+				Dialogue.SubtitlesNodes[s].LocalizedTextHandle = FindLine(*Lines, MakeLineKey(ELineKind::Subtitle, c, d, s));
+		}
+	}
+
+	for (FQuestionNode& Question : Questions)
+	{
+		Question.LocalizedOptionHandle = FindLine(*Lines, MakeLineKey(ELineKind::Option, Question.ConversationReferenceID, Question.DialougeReferenceID,
+			Question.SubtitleRefrenceID, Question.NodeID));
+	}
+
+	return Lines != &NoLines;
+}
+
+void FDialogueLocalization::AcquireConversation(FName ConversationKey)
+{
+	if (!ConversationKey.IsNone())
+		TableUsers.FindOrAdd(ConversationKey)++;
+}
+
+/*
+ * Function:  ReleaseConversation
+ * --------------------
+ * The table stays while another instance with the same key still uses it.
+ *
+ */
+void FDialogueLocalization::ReleaseConversation(FName ConversationKey)
+{
+	int32* Users = TableUsers.Find(ConversationKey);
+	if (Users == nullptr)
+		return;
+
+	if (--(*Users) <= 0)
+	{
+		TableUsers.Remove(ConversationKey);
+		Tables.Remove(ConversationKey);
+	}
+}
+
+void FDialogueLocalization::LocalizeItem(FItemDefinition& Item)
+{
+	const TMap<uint64, FDialogueStringHandle>* Lines = FindOrLoadTable(ItemsTable);
+	Item.LocalizedName = Lines ? FindLine(*Lines, MakeLineKey(ELineKind::ItemName, Item.ItemID)) : FDialogueStringHandle();
+	Item.LocalizedDescription = Lines ? FindLine(*Lines, MakeLineKey(ELineKind::ItemDescription, Item.ItemID)) : FDialogueStringHandle();
+}
+
+FDialogueStringHandle FDialogueLocalization::FindConversationLine(FName ConversationKey, uint64 LineKey)
+{
+	const TMap<uint64, FDialogueStringHandle>* Lines = FindOrLoadTable(ConversationKey);
+	return Lines ? FindLine(*Lines, LineKey) : FDialogueStringHandle();
+}
+
+SIZE_T FDialogueLocalization::GetResidentSize() const
+{
+	SIZE_T Size = Tables.GetAllocatedSize() + TableUsers.GetAllocatedSize() + FDialogueStringTable::GetLocalized().GetAllocatedSize();
+	for (const TPair<FName, TMap<uint64, FDialogueStringHandle>>& Table : Tables)
+		Size += Table.Value.GetAllocatedSize();
+	return Size;
+}
+
+/*
+ * Console Command:  HB.Loc.Culture [Culture]
+ * --------------------
+ * Prints or switches the dialogue culture while the game runs.
+ */
+static FAutoConsoleCommand GLocCultureCommand(
+	TEXT("HB.Loc.Culture"),
+	TEXT("Prints or switches the dialogue culture. Usage: HB.Loc.Culture [Culture]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FDialogueLocalization& Localization = FDialogueLocalization::Get();
+		if (Args.Num() > 0)
+			Localization.SetCulture(Args[0]);
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Dialogue culture: %s, %d tables loaded, %llu bytes resident."),
+			*Localization.GetCulture(), Localization.GetNumLoadedTables(), (uint64)Localization.GetResidentSize());
+	})
+);
+
+/*
+ * Console Command:  HB.Loc.Export <Culture> [Script]
+ * --------------------
+ * Writes the tables of a culture from a script, or from the conversation instances of the current world.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GLocExportCommand(
+	TEXT("HB.Loc.Export"),
+	TEXT("Writes dialogue string tables for a culture. Usage: HB.Loc.Export <Culture> [Script.csv]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (Args.Num() < 1)
+			return;
+
+		const FString Directory = FDialogueLocalization::GetCultureDirectory(Args[0]);
+		int32 Written = 0;
+
+		if (Args.Num() > 1)
+		{
+			FDialogueScriptImporter Importer;
+			TMap<FName, FImportedConversation> Conversations;
+			if (!Importer.ImportFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Args[1]), Conversations))
+				return;
+
+			for (const TPair<FName, FImportedConversation>& Conversation : Conversations)
+			{
+				if (FDialogueLocalization::WriteConversationTable(Directory / Conversation.Key.ToString() + TEXT(".csv"), Conversation.Value.ConversationList, Conversation.Value.QuestionList))
+					Written++;
+			}
+		}
+		else if (World != nullptr)
+		{
+			for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+			{
+				if (!It->ScriptConversationKey.IsNone() &&
+					FDialogueLocalization::WriteConversationTable(Directory / It->ScriptConversationKey.ToString() + TEXT(".csv"), It->ConversationList, It->QuestionList))
+					Written++;
+			}
+		}
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Wrote %d dialogue tables to %s."), Written, *Directory);
+	})
+);
+
+/*
+ * Console Command:  HB.Loc.Report [Script]
+ * --------------------
+ * Loads every table of every culture (only the script's conversations, if given) and logs what each culture
+ * costs when fully resident, next to what the active culture holds right now.
+ */
+static FAutoConsoleCommand GLocReportCommand(
+	TEXT("HB.Loc.Report"),
+	TEXT("Logs the memory of each culture's dialogue tables. Usage: HB.Loc.Report [Script.csv]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		TArray<FName> Keys;
+		if (Args.Num() > 0)
+		{
+			FDialogueScriptImporter Importer;
+			TMap<FName, FImportedConversation> Conversations;
+			if (!Importer.ImportFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Args[0]), Conversations))
+				return;
+			Conversations.GetKeys(Keys);
+		}
+
+		TArray<FString> Cultures;
+		IFileManager::Get().FindFiles(Cultures, *(FDialogueLocalization::GetLocalizationDirectory() / TEXT("*")), false, true);
+
+		for (const FString& Culture : Cultures)
+		{
+			const FString Directory = FDialogueLocalization::GetCultureDirectory(Culture);
+			TArray<FString> Files;
+			if (Keys.Num() > 0)
+			{
+				for (FName Key : Keys)
+					Files.Add(Key.ToString() + TEXT(".csv"));
+			}
+			else
+			{
+				IFileManager::Get().FindFiles(Files, *(Directory / TEXT("*.csv")), true, false);
+			}
+
+			FDialogueStringTable Strings;
+			SIZE_T TableBytes = 0;
+			int32 Lines = 0;
+			int32 Loaded = 0;
+			const double StartTime = FPlatformTime::Seconds();
+
+			for (const FString& File : Files)
+			{
+				TMap<uint64, FDialogueStringHandle> Table;
+				if (FDialogueLocalization::LoadTable(Directory / File, Strings, Table))
+				{
+					Loaded++;
+					Lines += Table.Num();
+					TableBytes += Table.GetAllocatedSize();
+				}
+			}
+
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%s: %d tables, %d lines, %d unique strings, %llu bytes (%llu text, %llu lookups), loaded in %.2f ms."),
+				*Culture, Loaded, Lines, Strings.Num() - 1, (uint64)(Strings.GetAllocatedSize() + TableBytes), (uint64)Strings.GetAllocatedSize(),
+				(uint64)TableBytes, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+
+		const FDialogueLocalization& Localization = FDialogueLocalization::Get();
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Resident (%s): %d tables, %llu bytes."),
+			*Localization.GetCulture(), Localization.GetNumLoadedTables(), (uint64)Localization.GetResidentSize());
+	})
+);
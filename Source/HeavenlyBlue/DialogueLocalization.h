@@ -0,0 +1,127 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueLocalization
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class swaps dialogue and item text for the text of the
+*				   player's language. Every culture has its own string tables,
+*				   one per conversation, and only the tables of the active
+*				   culture that are in use are kept in memory.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IDialogueTree.h"
+
+struct FItemDefinition;
+
+/*
+ * Table layout (UTF-8, one line per string, '#' starts a comment line):
+ *
+ *   Content/<Directory>/<Culture>/<ConversationKey>.csv	The lines of one conversation.
+ *   Content/<Directory>/<Culture>/Items.csv				Item names and descriptions.
+ *
+ *   <ID>,<Text>
+ *
+ * IDs are stable as long as the script keeps its node IDs:
+ *
+ *   N.<Conversation>.<Dialogue>						Speaker name
+ *   S.<Conversation>.<Dialogue>.<Subtitle>			Subtitle
+ *   O.<Conversation>.<Dialogue>.<Subtitle>.<Option>	Question option
+ *   Name.<ItemID>, Desc.<ItemID>						Item text
+ *
+ * <Text> is the rest of the line, \n is a line break and \\ a backslash.
+ * A line missing from a table keeps the text the conversation was authored with.
+ *
+ * Loaded tables are keyed by a hash of the ID's kind and numbers (see MakeLineKey), not by the ID's text,
+ * so neither loading nor looking a line up makes a name or formats a string.
+ */
+class HEAVENLYBLUE_API FDialogueLocalization
+{
+public:
+	DECLARE_MULTICAST_DELEGATE(FOnCultureChanged);
+
+	FDialogueLocalization();
+	~FDialogueLocalization();
+
+	// See [/Script/HeavenlyBlue.DialogueLocalization] in DefaultGame.ini.
+	static FDialogueLocalization& Get();
+
+	const FString& GetCulture() const { return Culture; }
+
+	// Switches every loaded conversation and item to another culture without reloading the level.
+	// Returns false, keeping the current culture, if the culture has no tables.
+	bool SetCulture(const FString& NewCulture);
+
+	enum class ELineKind : uint8
+	{
+		Speaker,
+		Subtitle,
+		Option,
+		ItemName,
+		ItemDescription,
+	};
+
+	// Sets the localized handles of a conversation's nodes, loading its table first if needed.
+	// Returns false if the active culture has no table for it, the nodes then show their own text.
+	bool LocalizeConversation(FName ConversationKey, TArray<FConversationNode>& Conversations, TArray<FQuestionNode>& Questions);
+
+	// Every instance that loads a conversation holds on to its table until it releases it, instances
+	// sharing a key share the table. The last release drops it, its text stays in the string table until the culture changes.
+	void AcquireConversation(FName ConversationKey);
+	void ReleaseConversation(FName ConversationKey);
+
+	// Sets the localized handles of an item (see FItemDatabase).
+	void LocalizeItem(FItemDefinition& Item);
+
+	// The handle of one line of a conversation's table (see MakeLineKey), loading the table first if needed.
+	// Empty if the active culture doesn't have the line.
+	FDialogueStringHandle FindConversationLine(FName ConversationKey, uint64 LineKey);
+
+	// Everything that holds localized handles has to localize again when this fires.
+	FOnCultureChanged& OnCultureChanged() { return CultureChangedEvent; }
+
+	// The memory of the active culture: its loaded tables and the localized string table.
+	SIZE_T GetResidentSize() const;
+	int32 GetNumLoadedTables() const { return Tables.Num(); }
+
+	static FString GetLocalizationDirectory();
+	static FString GetCultureDirectory(const FString& InCulture);
+	static FString MakeSpeakerID(int32 Conversation, int32 Dialogue);
+	static FString MakeSubtitleID(int32 Conversation, int32 Dialogue, int32 Subtitle);
+	static FString MakeOptionID(int32 Conversation, int32 Dialogue, int32 Subtitle, int32 Option);
+
+	// The key of the line whose ID is <Kind>.<A>[.<B>[.<C>[.<D>]]], the numbers an ID doesn't have are 0.
+	static uint64 MakeLineKey(ELineKind Kind, int32 A, int32 B = 0, int32 C = 0, int32 D = 0);
+
+	// Reads a table file. The text goes into Strings, so tables of other cultures can be read without touching the game's.
+	static bool LoadTable(const FString& Filename, FDialogueStringTable& Strings, TMap<uint64, FDialogueStringHandle>& OutLines);
+
+	// Writes the table of one conversation, taking the text from its nodes.
+	static bool WriteConversationTable(const FString& Filename, const TArray<FConversationNode>& Conversations, const TArray<FQuestionNode>& Questions);
+
+private:
+	const TMap<uint64, FDialogueStringHandle>* FindOrLoadTable(FName TableName);
+	void HandleEngineCultureChanged();
+
+	FString Culture;
+
+	// Loaded tables of the active culture, by conversation key. A table that doesn't exist is stored empty so it's only looked for once.
+	TMap<FName, TMap<uint64, FDialogueStringHandle>> Tables;
+
+	// How many instances hold each conversation's table, kept across culture changes.
+	TMap<FName, int32> TableUsers;
+
+	FOnCultureChanged CultureChangedEvent;
+	FDelegateHandle EngineCultureChangedHandle;
+};
@@ -0,0 +1,517 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueScriptImporter.h"
+#include "HeavenlyBlue.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+namespace DialogueScriptImporterPrivate
+{
+	/*
+	 * Struct:  FField
+	 * --------------------
+	 * A field of a CSV line, pointing into the chunk. Quoted fields still contain their escapes.
+	 */
+	struct FField
+	{
+		const ANSICHAR* Begin = nullptr;
+		const ANSICHAR* End = nullptr;
+		bool bQuoted = false;
+	};
+
+	// Splits a line into at most MaxFields fields. The last field takes the rest of the line, so text may contain commas.
+	int32 SplitFields(const ANSICHAR* Begin, const ANSICHAR* End, FField* OutFields, int32 MaxFields)
+	{
+		int32 Count = 0;
+		const ANSICHAR* Cursor = Begin;
+		while (Count < MaxFields)
+		{
+			FField& Field = OutFields[Count++];
+			if (Cursor < End && *Cursor == '"')
+			{
+				Field.bQuoted = true;
+				Field.Begin = ++Cursor;
+				while (Cursor < End && !(*Cursor == '"' && (Cursor + 1 == End || Cursor[1] != '"')))
+					Cursor += (*Cursor == '"') ? 2 : 1;
+				Field.End = Cursor;
+				// Skip the closing quote.
+				if (Cursor < End)
+					Cursor++;
+			}
+			else
+			{
+				Field.Begin = Cursor;
+				if (Count == MaxFields)
+					Cursor = End;
+				while (Cursor < End && *Cursor != ',')
+					Cursor++;
+				Field.End = Cursor;
+			}
+
+			if (Cursor >= End)
+				break;
+			// Skip the separator.
+			Cursor++;
+		}
+		return Count;
+	}
+
+	bool ParseInt(const FField& Field, int32& Out)
+	{
+		const ANSICHAR* Cursor = Field.Begin;
+		bool bNegative = false;
+		if (Cursor < Field.End && *Cursor == '-')
+		{
+			bNegative = true;
+			Cursor++;
+		}
+		if (Cursor == Field.End)
+			return false;
+
+		// Checked before each digit is added, so the value never leaves int32.
+		int32 Value = 0;
+		for (; Cursor < Field.End; Cursor++)
+		{
+			if (*Cursor < '0' || *Cursor > '9')
+				return false;
+			const int32 Digit = *Cursor - '0';
+			if (Value > (MAX_int32 - Digit) / 10)
+				return false;
+			Value = Value * 10 + Digit;
+		}
+		Out = bNegative ? -Value : Value;
+		return true;
+	}
+
+	bool ParseFloat(const FField& Field, float& Out)
+	{
+		ANSICHAR Buffer[32];
+		const int32 Length = int32(Field.End - Field.Begin);
+		if (Length <= 0 || Length >= ARRAY_COUNT(Buffer))
+			return false;
+		FMemory::Memcpy(Buffer, Field.Begin, Length);
+		Buffer[Length] = '\0';
+		Out = FCStringAnsi::Atof(Buffer);
+		return true;
+	}
+
+	// Converts a field to an FString, resolving "" and \n.
+	FString ToString(const FField& Field)
+	{
+		TArray<ANSICHAR, TInlineAllocator<256>> Unescaped;
+		Unescaped.Reserve(int32(Field.End - Field.Begin) + 1);
+		for (const ANSICHAR* Cursor = Field.Begin; Cursor < Field.End; Cursor++)
+		{
+			if (Field.bQuoted && Cursor[0] == '"' && Cursor + 1 < Field.End && Cursor[1] == '"')
+			{
+				Unescaped.Add('"');
+				Cursor++;
+			}
+			else if (Cursor[0] == '\\' && Cursor + 1 < Field.End && Cursor[1] == 'n')
+			{
+				Unescaped.Add('\n');
+				Cursor++;
+			}
+			else
+			{
+				Unescaped.Add(*Cursor);
+			}
+		}
+
+		FUTF8ToTCHAR Converted(Unescaped.GetData(), Unescaped.Num());
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	template<typename NodeType>
+	NodeType& EnsureNode(TArray<NodeType>& Nodes, int32 NodeID)
+	{
+		// IDs are used as indices at runtime, so any skipped IDs become empty nodes.
+		for (int32 i = Nodes.Num(); i <= NodeID; i++)
+			Nodes.AddDefaulted_GetRef().NodeID = i;
+		return Nodes[NodeID];
+	}
+}
+
+using namespace DialogueScriptImporterPrivate;
+
+/*
+ * Function:  ParseLine
+ * --------------------
+ * This reads one record. Returns false if the line is malformed.
+ *
+ */
+bool FDialogueScriptImporter::ParseLine(const ANSICHAR* Begin, const ANSICHAR* End, FScriptRow& Out)
+{
+	FField Fields[9];
+
+	if (End - Begin < 2 || Begin[1] != ',')
+		return false;
+
+	if (Begin[0] == 'S')
+	{
+		if (SplitFields(Begin, End, Fields, 9) != 9)
+			return false;
+
+		int32 HasQuestion = 0;
+		Out.Kind = FScriptRow::EKind::Subtitle;
+		if (!ParseInt(Fields[2], Out.ConversationNodeID) || !ParseInt(Fields[3], Out.DialogueNodeID) ||
+			!ParseInt(Fields[4], Out.SubtitleNodeID) || !ParseFloat(Fields[5], Out.Timer) || !ParseInt(Fields[6], HasQuestion))
+			return false;
+
+		Out.bHasQuestion = HasQuestion != 0;
+		Out.Speaker = ToString(Fields[7]);
+		Out.Text = ToString(Fields[8]);
+	}
+	else if (Begin[0] == 'Q')
+	{
+		if (SplitFields(Begin, End, Fields, 8) != 8)
+			return false;
+
+		Out.Kind = FScriptRow::EKind::Question;
+		if (!ParseInt(Fields[2], Out.ConversationNodeID) || !ParseInt(Fields[3], Out.DialogueNodeID) ||
+			!ParseInt(Fields[4], Out.SubtitleNodeID) || !ParseInt(Fields[5], Out.OptionNodeID) || !ParseInt(Fields[6], Out.GoToConversationNodeID))
+			return false;
+
+		Out.Text = ToString(Fields[7]);
+	}
+	else if (Begin[0] == 'C' || Begin[0] == 'A')
+	{
+		if (SplitFields(Begin, End, Fields, 7) != 7)
+			return false;
+
+		Out.Kind = Begin[0] == 'C' ? FScriptRow::EKind::Condition : FScriptRow::EKind::Action;
+		if (!ParseInt(Fields[2], Out.ConversationNodeID) || !ParseInt(Fields[3], Out.DialogueNodeID) ||
+			!ParseInt(Fields[4], Out.SubtitleNodeID) || !ParseInt(Fields[5], Out.OptionNodeID))
+			return false;
+
+		Out.Text = ToString(Fields[6]);
+	}
+	else
+	{
+		return false;
+	}
+
+	// IDs become array indices, a typo like 10000000 would otherwise allocate millions of nodes.
+	// The dialogue bank stores every ID, options and jumps included, in 16 bits.
+	const int32 MaxNodeID = 0xFFFF;
+	if (!FMath::IsWithinInclusive(Out.ConversationNodeID, 0, MaxNodeID) || !FMath::IsWithinInclusive(Out.DialogueNodeID, 0, MaxNodeID) ||
+		!FMath::IsWithinInclusive(Out.SubtitleNodeID, 0, MaxNodeID) || !FMath::IsWithinInclusive(Out.OptionNodeID, 0, MaxNodeID) ||
+		!FMath::IsWithinInclusive(Out.GoToConversationNodeID, 0, MaxNodeID))
+		return false;
+
+	Out.ConversationKey = FName(int32(Fields[1].End - Fields[1].Begin), Fields[1].Begin);
+	Out.LineHash = FCrc::MemCrc32(Begin, int32(End - Begin));
+	return !Out.ConversationKey.IsNone();
+}
+
+/*
+ * Function:  ParseChunk
+ * --------------------
+ * This parses every line of a chunk. It runs on a worker thread, so it only writes to its own result.
+ *
+ */
+void FDialogueScriptImporter::ParseChunk(const ANSICHAR* Begin, const ANSICHAR* End, FChunkResult& Out)
+{
+	const ANSICHAR* LineBegin = Begin;
+	while (LineBegin < End)
+	{
+		const ANSICHAR* LineEnd = LineBegin;
+		while (LineEnd < End && *LineEnd != '\n')
+			LineEnd++;
+
+		const ANSICHAR* Next = LineEnd + 1;
+		if (LineEnd > LineBegin && LineEnd[-1] == '\r')
+			LineEnd--;
+
+		if (LineEnd > LineBegin && *LineBegin != '#')
+		{
+			Out.Lines++;
+			FScriptRow Row;
+			if (ParseLine(LineBegin, LineEnd, Row))
+				Out.Rows.Add(MoveTemp(Row));
+			else
+				Out.Errors++;
+		}
+
+		LineBegin = Next;
+	}
+}
+
+/*
+ * Function:  FindOrAddQuestion
+ * --------------------
+ * Condition and action rows normally follow their option, so the list is searched from the back.
+ *
+ */
+FQuestionNode& FDialogueScriptImporter::FindOrAddQuestion(TArray<FQuestionNode>& Questions, const FScriptRow& Row)
+{
+	for (int32 i = Questions.Num() - 1; i >= 0; i--)
+	{
+		FQuestionNode& Question = Questions[i];
+		if (Question.NodeID == Row.OptionNodeID && Question.SubtitleRefrenceID == Row.SubtitleNodeID &&
+			Question.DialougeReferenceID == Row.DialogueNodeID && Question.ConversationReferenceID == Row.ConversationNodeID)
+			return Question;
+	}
+
+	FQuestionNode& Question = Questions.AddDefaulted_GetRef();
+	Question.ConversationReferenceID = Row.ConversationNodeID;
+	Question.DialougeReferenceID = Row.DialogueNodeID;
+	Question.SubtitleRefrenceID = Row.SubtitleNodeID;
+	Question.NodeID = Row.OptionNodeID;
+	return Question;
+}
+
+/*
+ * Function:  MergeRows
+ * --------------------
+ * This turns parsed rows into nodes. Rows must be merged in file order so later lines win,
+ * and so each conversation's content hash comes out the same for the same lines.
+ *
+ */
+void FDialogueScriptImporter::MergeRows(TArray<FScriptRow>& Rows, TMap<FName, FImportedConversation>& OutConversations)
+{
+	FImportedConversation* Conversation = nullptr;
+	FName ConversationKey;
+
+	for (FScriptRow& Row : Rows)
+	{
+		// Scripts are normally grouped by conversation, so the lookup is skipped for runs of the same key.
+		if (Conversation == nullptr || Row.ConversationKey != ConversationKey)
+		{
+			ConversationKey = Row.ConversationKey;
+			Conversation = &OutConversations.FindOrAdd(ConversationKey);
+		}
+		Conversation->ContentHash = HashCombine(Conversation->ContentHash, Row.LineHash);
+
+		if (Row.Kind == FScriptRow::EKind::Question)
+		{
+			FQuestionNode& Question = FindOrAddQuestion(Conversation->QuestionList, Row);
+			Question.Option = MoveTemp(Row.Text);
+			Question.GoToConversationNodeID = Row.GoToConversationNodeID;
+		}
+		else if (Row.Kind == FScriptRow::EKind::Condition)
+		{
+			FindOrAddQuestion(Conversation->QuestionList, Row).Condition = MoveTemp(Row.Text);
+		}
+		else if (Row.Kind == FScriptRow::EKind::Action)
+		{
+			FindOrAddQuestion(Conversation->QuestionList, Row).Action = MoveTemp(Row.Text);
+		}
+		else
+		{
+			FConversationNode& ConversationNode = EnsureNode(Conversation->ConversationList, Row.ConversationNodeID);
+			FDialogueNode& Dialogue = EnsureNode(ConversationNode.DialougeNodes, Row.DialogueNodeID);
+			FSubtitleNode& Subtitle = EnsureNode(Dialogue.SubtitlesNodes, Row.SubtitleNodeID);
+
+			if (!Row.Speaker.IsEmpty())
+				Dialogue.SpeakerName = MoveTemp(Row.Speaker);
+
+			Subtitle.SubtitleText = MoveTemp(Row.Text);
+			Subtitle.SubtitleTimer = Row.Timer;
+			Subtitle.bHasQuestion = Row.bHasQuestion;
+		}
+	}
+}
+
+/*
+ * Function:  ImportLines
+ * --------------------
+ * 1) Cut the batch into chunks that end on a line break.
+ * 2) Parse the chunks in parallel.
+ * 3) Merge the results one chunk at a time, in order.
+ *
+ */
+void FDialogueScriptImporter::ImportLines(const ANSICHAR* Data, int64 Size, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats& Stats) const
+{
+	TArray<TPair<int64, int64>, TInlineAllocator<64>> Ranges;
+	int64 Begin = 0;
+	while (Begin < Size)
+	{
+		int64 End = FMath::Min<int64>(Begin + ChunkSize, Size);
+		while (End < Size && Data[End - 1] != '\n')
+			End++;
+		Ranges.Emplace(Begin, End);
+		Begin = End;
+	}
+
+	TArray<FChunkResult> Results;
+	Results.SetNum(Ranges.Num());
+	ParallelFor(Ranges.Num(), [&](int32 Index)
+	{
+		ParseChunk(Data + Ranges[Index].Key, Data + Ranges[Index].Value, Results[Index]);
+	});
+
+	for (FChunkResult& Result : Results)
+	{
+		MergeRows(Result.Rows, OutConversations);
+		Stats.Lines += Result.Lines;
+		Stats.Errors += Result.Errors;
+	}
+	Stats.Chunks += Ranges.Num();
+}
+
+/*
+ * Function:  ImportBuffer
+ * --------------------
+ * This imports a script that is already in memory.
+ *
+ */
+void FDialogueScriptImporter::ImportBuffer(const ANSICHAR* Data, int64 Size, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats* OutStats) const
+{
+	FDialogueImportStats Stats;
+	const double StartTime = FPlatformTime::Seconds();
+
+	ImportLines(Data, Size, OutConversations, Stats);
+
+	Stats.Bytes = Size;
+	Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+	if (OutStats)
+		*OutStats = Stats;
+}
+
+/*
+ * Function:  ImportFile
+ * --------------------
+ * This streams the script from disk. Only one batch (plus the unfinished line at its end)
+ * is held in memory at a time, however large the script is.
+ *
+ * Filename: The script on disk.
+ * OutConversations: The imported conversations, keyed by their conversation key.
+ *
+ */
+bool FDialogueScriptImporter::ImportFile(const FString& Filename, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats* OutStats) const
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Reader)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("Could not open dialogue script %s."), *Filename);
+		return false;
+	}
+
+	FDialogueImportStats Stats;
+	const double StartTime = FPlatformTime::Seconds();
+	const int64 TotalSize = Reader->TotalSize();
+	const int64 BatchSize = int64(ChunkSize) * ChunksPerBatch;
+
+	TArray<ANSICHAR> Buffer;
+	Buffer.Reserve(BatchSize + ChunkSize);
+	int64 Remaining = TotalSize;
+
+	// Skip a UTF-8 byte order mark.
+	if (TotalSize >= 3)
+	{
+		uint8 Bom[3];
+		Reader->Serialize(Bom, 3);
+		if (Bom[0] == 0xEF && Bom[1] == 0xBB && Bom[2] == 0xBF)
+			Remaining -= 3;
+		else
+			Reader->Seek(0);
+	}
+
+	while (Remaining > 0)
+	{
+		// Whatever is left in the buffer is the unfinished last line of the previous batch.
+		const int32 Carry = Buffer.Num();
+		const int64 ReadSize = FMath::Min(BatchSize, Remaining);
+		Buffer.SetNumUninitialized(Carry + int32(ReadSize), false);
+		Reader->Serialize(Buffer.GetData() + Carry, ReadSize);
+		Remaining -= ReadSize;
+
+		int32 LinesEnd = Buffer.Num();
+		if (Remaining > 0)
+		{
+			while (LinesEnd > 0 && Buffer[LinesEnd - 1] != '\n')
+				LinesEnd--;
+		}
+
+		ImportLines(Buffer.GetData(), LinesEnd, OutConversations, Stats);
+		Buffer.RemoveAt(0, LinesEnd, false);
+	}
+
+	Stats.Bytes = TotalSize;
+	Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+	if (OutStats)
+		*OutStats = Stats;
+
+	if (Stats.Errors > 0)
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: %d of %d lines could not be parsed."), *Filename, Stats.Errors, Stats.Lines);
+
+	return !Reader->IsError();
+}
+
+/*
+ * Function:  WriteSyntheticScript
+ * --------------------
+ * This writes a script shaped like a real one: conversations of 4 dialogues with 10 subtitles each,
+ * where the last subtitle of every dialogue asks a two option question.
+ *
+ */
+bool FDialogueScriptImporter::WriteSyntheticScript(const FString& Filename, int32 NumLines)
+{
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+		return false;
+
+	static const TCHAR* Speakers[] = { TEXT("Juniper"), TEXT("Mika"), TEXT("Aoi"), TEXT("Ren") };
+	int32 Written = 0;
+
+	for (int32 Conversation = 0; Written < NumLines; Conversation++)
+	{
+		for (int32 Dialogue = 0; Dialogue < 4 && Written < NumLines; Dialogue++)
+		{
+			for (int32 Subtitle = 0; Subtitle < 10 && Written < NumLines; Subtitle++)
+			{
+				const bool bQuestion = Subtitle == 9;
+				FString Line = FString::Printf(TEXT("S,Conversation_%d,0,%d,%d,1.5,%d,%s,\"Line %d of dialogue %d, said with \"\"feeling\"\" in the dorm hallway.\"\n"),
+					Conversation, Dialogue, Subtitle, bQuestion ? 1 : 0, Subtitle == 0 ? Speakers[Dialogue % 4] : TEXT(""), Subtitle, Dialogue);
+				FTCHARToUTF8 Utf8(*Line);
+				Writer->Serialize((void*)Utf8.Get(), Utf8.Length());
+				Written++;
+
+				for (int32 Option = 1; bQuestion && Option <= 2 && Written < NumLines; Option++)
+				{
+					Line = FString::Printf(TEXT("Q,Conversation_%d,0,%d,%d,%d,0,Option %d\n"), Conversation, Dialogue, Subtitle, Option, Option);
+					FTCHARToUTF8 OptionUtf8(*Line);
+					Writer->Serialize((void*)OptionUtf8.Get(), OptionUtf8.Length());
+					Written++;
+				}
+			}
+		}
+	}
+
+	return Writer->Close();
+}
+
+/*
+ * Console Command:  HB.Dialogue.ImportBenchmark [Lines]
+ * --------------------
+ * Writes a synthetic script (100k lines by default) to Saved/Dialogue and imports it.
+ */
+static FAutoConsoleCommand GDialogueImportBenchmark(
+	TEXT("HB.Dialogue.ImportBenchmark"),
+	TEXT("Imports a synthetic dialogue script and logs the throughput. Usage: HB.Dialogue.ImportBenchmark [Lines=100000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumLines = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+		const FString Filename = FPaths::ProjectSavedDir() / TEXT("Dialogue") / TEXT("SyntheticScript.csv");
+
+		if (!FDialogueScriptImporter::WriteSyntheticScript(Filename, NumLines))
+		{
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write %s."), *Filename);
+			return;
+		}
+
+		FDialogueScriptImporter Importer;
+		TMap<FName, FImportedConversation> Conversations;
+		FDialogueImportStats Stats;
+		Importer.ImportFile(Filename, Conversations, &Stats);
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Imported %d lines (%.2f MB, %d chunks) into %d conversations in %.2f ms: %.0f lines/s, %.1f MB/s, %d errors."),
+			Stats.Lines, Stats.Bytes / (1024.0 * 1024.0), Stats.Chunks, Conversations.Num(), Stats.Seconds * 1000.0,
+			Stats.Lines / FMath::Max(Stats.Seconds, 1e-9), Stats.Bytes / (1024.0 * 1024.0) / FMath::Max(Stats.Seconds, 1e-9), Stats.Errors);
+	})
+);
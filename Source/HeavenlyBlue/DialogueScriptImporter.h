@@ -0,0 +1,123 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueScriptImporter
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class reads a writer's dialogue script from disk and turns
+*				   it into the same conversation/question nodes that are normally
+*				   entered by hand on an AAConversationInstance.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IDialogueTree.h"
+
+/*
+ * Script format (UTF-8 CSV, one record per line, '#' starts a comment line):
+ *
+ *   S,<Conversation>,<ConversationNode>,<DialogueNode>,<SubtitleNode>,<Timer>,<HasQuestion 0/1>,<Speaker>,<Text>
+ *   Q,<Conversation>,<ConversationNode>,<DialogueNode>,<SubtitleNode>,<OptionNode>,<GoToConversationNode>,<Option>
+ *   C,<Conversation>,<ConversationNode>,<DialogueNode>,<SubtitleNode>,<OptionNode>,<Condition>
+ *   A,<Conversation>,<ConversationNode>,<DialogueNode>,<SubtitleNode>,<OptionNode>,<Action>
+ *
+ * <Conversation> is the key an AAConversationInstance uses to find its lines (ScriptConversationKey).
+ * Node IDs are the array indices used at runtime. An empty <Speaker> keeps the dialogue's current speaker.
+ * C and A rows set the condition and action of an option (see FWorldStateScript for the syntax).
+ * Text fields may be quoted ("" is a literal quote) and use \n for a line break, records never span lines.
+ */
+
+/*
+ * Struct:  FImportedConversation
+ * --------------------
+ * Everything the script holds for one conversation key.
+ */
+struct FImportedConversation
+{
+	TArray<FConversationNode> ConversationList;
+	TArray<FQuestionNode> QuestionList;
+	// A hash of the conversation's lines in file order. Unchanged lines give the same hash, wherever they moved in the file.
+	uint32 ContentHash = 0;
+};
+
+struct FDialogueImportStats
+{
+	int64 Bytes = 0;
+	int32 Lines = 0;
+	int32 Errors = 0;
+	int32 Chunks = 0;
+	double Seconds = 0.0;
+};
+
+class HEAVENLYBLUE_API FDialogueScriptImporter
+{
+public:
+	// The file is read one batch at a time, each batch is cut into chunks that are parsed on worker threads.
+	int32 ChunkSize = 256 * 1024;
+	int32 ChunksPerBatch = 16;
+
+	// Reads the whole script. Results are added to OutConversations in file order.
+	bool ImportFile(const FString& Filename, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats* OutStats = nullptr) const;
+
+	// Same as ImportFile but for a script already in memory.
+	void ImportBuffer(const ANSICHAR* Data, int64 Size, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats* OutStats = nullptr) const;
+
+	// Writes a script of roughly NumLines records, used to benchmark the importer.
+	static bool WriteSyntheticScript(const FString& Filename, int32 NumLines);
+
+private:
+	/*
+	 * Struct:  FScriptRow
+	 * --------------------
+	 * One parsed record. Rows are parsed in parallel and only turned into nodes afterwards,
+	 * since the node arrays can't be shared between threads.
+	 */
+	struct FScriptRow
+	{
+		enum class EKind : uint8
+		{
+			Subtitle,
+			Question,
+			Condition,
+			Action,
+		};
+
+		FName ConversationKey;
+		EKind Kind = EKind::Subtitle;
+		uint32 LineHash = 0;
+		bool bHasQuestion = false;
+		int32 ConversationNodeID = 0;
+		int32 DialogueNodeID = 0;
+		int32 SubtitleNodeID = 0;
+		int32 OptionNodeID = 0;
+		int32 GoToConversationNodeID = 0;
+		float Timer = 0.0f;
+		FString Speaker;
+		FString Text;
+	};
+
+	struct FChunkResult
+	{
+		TArray<FScriptRow> Rows;
+		int32 Lines = 0;
+		int32 Errors = 0;
+	};
+
+	// Parses whole lines in [Begin, End).
+	static void ParseChunk(const ANSICHAR* Begin, const ANSICHAR* End, FChunkResult& Out);
+	static bool ParseLine(const ANSICHAR* Begin, const ANSICHAR* End, FScriptRow& Out);
+
+	// Parses a batch of whole lines in parallel and merges it in order.
+	void ImportLines(const ANSICHAR* Data, int64 Size, TMap<FName, FImportedConversation>& OutConversations, FDialogueImportStats& Stats) const;
+	static void MergeRows(TArray<FScriptRow>& Rows, TMap<FName, FImportedConversation>& OutConversations);
+	static FQuestionNode& FindOrAddQuestion(TArray<FQuestionNode>& Questions, const FScriptRow& Row);
+};
@@ -0,0 +1,420 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueSearch.h"
+#include "HeavenlyBlue.h"
+#include "AConversationInstance.h"
+#include "DialogueBank.h"
+#include "ItemDatabase.h"
+#include "DialogueLocalization.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/Crc.h"
+
+namespace DialogueSearch
+{
+	// Search the text as written, not the active culture's.
+	const FString& GetAuthoredText(FDialogueStringHandle Handle, const FString& Text)
+	{
+		return Handle.IsEmpty() ? Text : FDialogueStringTable::Get().Resolve(Handle);
+	}
+
+	const int32 MaxPrintedResults = 50;
+
+	const FString ItemsSource(TEXT("Items"));
+}
+
+FDialogueSearchIndex& FDialogueSearchIndex::Get()
+{
+	static FDialogueSearchIndex Index;
+	return Index;
+}
+
+uint64 FDialogueSearchIndex::MakeTrigram(TCHAR A, TCHAR B, TCHAR C)
+{
+	return (uint64(uint16(FChar::ToLower(A))) << 32) | (uint64(uint16(FChar::ToLower(B))) << 16) | uint64(uint16(FChar::ToLower(C)));
+}
+
+/*
+ * Function:  UpdateSource
+ * --------------------
+ * 1) Hash the strings, a source that hashes the same is left alone.
+ * 2) Turn the source's old lines into holes and add the new ones at the end, which keeps every list sorted.
+ * 3) Compact once the holes are half of the lines.
+ *
+ */
+bool FDialogueSearchIndex::UpdateSource(const FString& SourceName, const TArray<TPair<FString, FString>>& Strings)
+{
+	uint32 Hash = 0;
+	for (const TPair<FString, FString>& String : Strings)
+		Hash = HashCombine(HashCombine(Hash, FCrc::StrCrc32(*String.Key)), FCrc::StrCrc32(*String.Value));
+
+	if (const int32* Existing = SourceIndices.Find(SourceName))
+	{
+		if (Sources[*Existing].Hash == Hash)
+			return false;
+
+		RemoveSource(SourceName);
+	}
+
+	const int32 SourceIndex = Sources.AddDefaulted();
+	Sources[SourceIndex].Name = SourceName;
+	Sources[SourceIndex].Hash = Hash;
+	SourceIndices.Add(SourceName, SourceIndex);
+
+	for (const TPair<FString, FString>& String : Strings)
+	{
+		if (!String.Value.IsEmpty())
+			AddLine(SourceIndex, String.Key, String.Value);
+	}
+	return true;
+}
+
+void FDialogueSearchIndex::RemoveSource(const FString& SourceName)
+{
+	int32 SourceIndex = INDEX_NONE;
+	if (!SourceIndices.RemoveAndCopyValue(SourceName, SourceIndex))
+		return;
+
+	FSource& Source = Sources[SourceIndex];
+	for (int32 Line : Source.Lines)
+	{
+		Lines[Line].Source = INDEX_NONE;
+		Lines[Line].ID.Empty();
+		Lines[Line].Text.Empty();
+	}
+	NumDeadLines += Source.Lines.Num();
+	Source = FSource();
+
+	if (NumDeadLines > Lines.Num() / 2)
+		Compact();
+}
+
+void FDialogueSearchIndex::AddLine(int32 Source, const FString& ID, const FString& Text)
+{
+	const int32 LineIndex = Lines.Num();
+	FDialogueSearchLine& Line = Lines.AddDefaulted_GetRef();
+	Line.Source = Source;
+	Line.ID = ID;
+	Line.Text = Text;
+	Sources[Source].Lines.Add(LineIndex);
+
+	for (int32 Index = 0; Index + 2 < Text.Len(); Index++)
+	{
+		TArray<int32>& Posting = Postings.FindOrAdd(MakeTrigram(Text[Index], Text[Index + 1], Text[Index + 2]));
+		if (Posting.Num() == 0 || Posting.Last() != LineIndex)
+			Posting.Add(LineIndex);
+	}
+}
+
+/*
+ * Function:  Compact
+ * --------------------
+ * Indexes the live lines again from the start, dropping the holes and the sources that were removed.
+ *
+ */
+void FDialogueSearchIndex::Compact()
+{
+	TArray<FDialogueSearchLine> OldLines = MoveTemp(Lines);
+	TArray<FSource> OldSources = MoveTemp(Sources);
+	Lines.Reset();
+	Sources.Reset();
+	Postings.Reset();
+	NumDeadLines = 0;
+
+	for (TPair<FString, int32>& Pair : SourceIndices)
+	{
+		const FSource& OldSource = OldSources[Pair.Value];
+		Pair.Value = Sources.AddDefaulted();
+		Sources[Pair.Value].Name = OldSource.Name;
+		Sources[Pair.Value].Hash = OldSource.Hash;
+
+		for (int32 Line : OldSource.Lines)
+			AddLine(Pair.Value, OldLines[Line].ID, OldLines[Line].Text);
+	}
+
+	Lines.Shrink();
+	for (TPair<uint64, TArray<int32>>& Posting : Postings)
+		Posting.Value.Shrink();
+}
+
+void FDialogueSearchIndex::Reset()
+{
+	Lines.Empty();
+	Sources.Empty();
+	SourceIndices.Empty();
+	Postings.Empty();
+	NumDeadLines = 0;
+}
+
+/*
+ * Function:  Search
+ * --------------------
+ * 1) Find the list of every trigram of the query, no list means no match.
+ * 2) Intersect them from the shortest up, each line of the shortest is looked for in the others.
+ * 3) Compare the text of what's left, the trigrams don't say where in the line they are.
+ * Queries shorter than a trigram compare every line.
+ *
+ */
+void FDialogueSearchIndex::Search(const FString& Query, TArray<int32>& OutLines, int32 MaxResults) const
+{
+	OutLines.Reset();
+	if (Query.IsEmpty() || MaxResults <= 0)
+		return;
+
+	auto Matches = [this, &Query](int32 Line)
+	{
+		return Lines[Line].Source != INDEX_NONE && Lines[Line].Text.Contains(Query, ESearchCase::IgnoreCase);
+	};
+
+	if (Query.Len() < 3)
+	{
+		for (int32 Line = 0; Line < Lines.Num() && OutLines.Num() < MaxResults; Line++)
+		{
+			if (Matches(Line))
+				OutLines.Add(Line);
+		}
+		return;
+	}
+
+	TArray<const TArray<int32>*, TInlineAllocator<16>> Lists;
+	for (int32 Index = 0; Index + 2 < Query.Len(); Index++)
+	{
+		const TArray<int32>* Posting = Postings.Find(MakeTrigram(Query[Index], Query[Index + 1], Query[Index + 2]));
+		if (Posting == nullptr)
+			return;
+		Lists.AddUnique(Posting);
+	}
+
+	Algo::Sort(Lists, [](const TArray<int32>* A, const TArray<int32>* B) { return A->Num() < B->Num(); });
+
+	TArray<int32> Candidates = *Lists[0];
+	for (int32 List = 1; List < Lists.Num() && Candidates.Num() > 0; List++)
+	{
+		const TArray<int32>& Posting = *Lists[List];
+		Candidates.RemoveAll([&Posting](int32 Line) { return Algo::BinarySearch(Posting, Line) == INDEX_NONE; });
+	}
+
+	for (int32 Line : Candidates)
+	{
+		if (Matches(Line))
+		{
+			OutLines.Add(Line);
+			if (OutLines.Num() >= MaxResults)
+				break;
+		}
+	}
+}
+
+/*
+ * Function:  UpdateFromWorld
+ * --------------------
+ * 1) Conversations kept in the dialogue bank that nobody walked into yet are decoded into a copy, so their lines can be found
+ *    without loading them. The bank doesn't change while the game runs, so that's only done the first time.
+ * 2) Every other conversation, and one the bank doesn't have, is indexed from its own nodes.
+ * Sources are named by their actor's path, the same actor is the same source as long as it exists.
+ *
+ */
+int32 FDialogueSearchIndex::UpdateFromWorld(UWorld* World)
+{
+	using namespace DialogueSearch;
+
+	if (World == nullptr)
+		return 0;
+
+	TSet<FString> Seen;
+	TArray<TPair<FString, FString>> Strings;
+	TArray<FConversationNode> BankConversationList;
+	TArray<FQuestionNode> BankQuestionList;
+	// Only the text is indexed, so the sounds are left unloaded.
+	TArray<FSoftObjectPath> BankSoundPaths;
+	int32 Updated = 0;
+
+	for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+	{
+		const AAConversationInstance* Conversation = *It;
+		const FString Name = Conversation->GetPathName();
+		Seen.Add(Name);
+
+		const TArray<FConversationNode>* ConversationList = &Conversation->ConversationList;
+		const TArray<FQuestionNode>* QuestionList = &Conversation->QuestionList;
+		if (Conversation->bLoadFromDialogueBank && !Conversation->IsConversationLoaded())
+		{
+			if (SourceIndices.Contains(Name))
+				continue;
+
+			if (FDialogueBank::Get().DecodeConversation(Conversation->ScriptConversationKey, BankConversationList, BankQuestionList, &BankSoundPaths))
+			{
+				ConversationList = &BankConversationList;
+				QuestionList = &BankQuestionList;
+			}
+		}
+
+		Strings.Reset();
+		for (int32 c = 0; c < ConversationList->Num(); c++)
+		{
+			for (int32 d = 0; d < (*ConversationList)[c].DialougeNodes.Num(); d++)
+			{
+				const FDialogueNode& Dialogue = (*ConversationList)[c].DialougeNodes[d];
+				Strings.Emplace(FDialogueLocalization::MakeSpeakerID(c, d), GetAuthoredText(Dialogue.SpeakerHandle, Dialogue.SpeakerName));
+
+				for (int32 s = 0; s < Dialogue.SubtitlesNodes.Num(); s++)
+				{
+					const FSubtitleNode& Subtitle = Dialogue.SubtitlesNodes[s];
+					Strings.Emplace(FDialogueLocalization::MakeSubtitleID(c, d, s), GetAuthoredText(Subtitle.TextHandle, Subtitle.SubtitleText));
+				}
+			}
+		}
+
+		for (const FQuestionNode& Question : *QuestionList)
+		{
+			Strings.Emplace(FDialogueLocalization::MakeOptionID(Question.ConversationReferenceID, Question.DialougeReferenceID, Question.SubtitleRefrenceID, Question.NodeID),
+				GetAuthoredText(Question.OptionHandle, Question.Option));
+		}
+
+		Updated += UpdateSource(Name, Strings) ? 1 : 0;
+	}
+
+	// Info boxes only hold an ID, the items are indexed once for all of them.
+	Strings.Reset();
+	FItemDatabase::Get().ForEachItem([&Strings](const FItemDefinition& Item)
+	{
+		Strings.Emplace(FString::Printf(TEXT("Name.%d"), Item.ItemID), FDialogueStringTable::Get().Resolve(Item.Name));
+		Strings.Emplace(FString::Printf(TEXT("Desc.%d"), Item.ItemID), FDialogueStringTable::Get().Resolve(Item.Description));
+	});
+	Seen.Add(DialogueSearch::ItemsSource);
+	Updated += UpdateSource(DialogueSearch::ItemsSource, Strings) ? 1 : 0;
+
+	TArray<FString> Removed;
+	for (const TPair<FString, int32>& Pair : SourceIndices)
+	{
+		if (!Seen.Contains(Pair.Key))
+			Removed.Add(Pair.Key);
+	}
+	for (const FString& Name : Removed)
+		RemoveSource(Name);
+
+	return Updated;
+}
+
+SIZE_T FDialogueSearchIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = Lines.GetAllocatedSize() + Sources.GetAllocatedSize() + SourceIndices.GetAllocatedSize() + Postings.GetAllocatedSize();
+	for (const FDialogueSearchLine& Line : Lines)
+		Size += Line.ID.GetAllocatedSize() + Line.Text.GetAllocatedSize();
+	for (const FSource& Source : Sources)
+		Size += Source.Name.GetAllocatedSize() + Source.Lines.GetAllocatedSize();
+	for (const TPair<uint64, TArray<int32>>& Posting : Postings)
+		Size += Posting.Value.GetAllocatedSize();
+	return Size;
+}
+
+/*
+ * Console Command:  HB.Search <Text>
+ * --------------------
+ * Brings the index up to date with the world (only changed conversations are indexed again) and lists the lines containing the text.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GSearchCommand(
+	TEXT("HB.Search"),
+	TEXT("Finds every dialogue line, option and item text containing the text. Usage: HB.Search <Text>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const FString Query = FString::Join(Args, TEXT(" "));
+		if (Query.IsEmpty())
+			return;
+
+		FDialogueSearchIndex& Index = FDialogueSearchIndex::Get();
+		const double UpdateStart = FPlatformTime::Seconds();
+		const int32 Updated = Index.UpdateFromWorld(World);
+		const double SearchStart = FPlatformTime::Seconds();
+
+		TArray<int32> Results;
+		Index.Search(Query, Results);
+		const double SearchEnd = FPlatformTime::Seconds();
+
+		for (int32 Result = 0; Result < FMath::Min(Results.Num(), DialogueSearch::MaxPrintedResults); Result++)
+		{
+			const FDialogueSearchLine& Line = Index.GetLine(Results[Result]);
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("  %s %s: %s"), *Index.GetSourceName(Line.Source), *Line.ID, *Line.Text);
+		}
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("\"%s\": %d matches in %.1f us%s. Index: %d sources (%d indexed again in %.2f ms), %d lines, %d trigrams, %llu bytes."),
+			*Query, Results.Num(), (SearchEnd - SearchStart) * 1e6, Results.Num() > DialogueSearch::MaxPrintedResults ? TEXT(", the first ones listed") : TEXT(""),
+			Index.GetNumSources(), Updated, (SearchStart - UpdateStart) * 1000.0, Index.GetNumLines(), Index.GetNumTrigrams(), (uint64)Index.GetAllocatedSize());
+	})
+);
+
+/*
+ * Console Command:  HB.Search.Bench [Lines]
+ * --------------------
+ * Indexes made up lines, 50 per source, and times queries of one and two words and changing one source.
+ */
+static FAutoConsoleCommand GSearchBenchCommand(
+	TEXT("HB.Search.Bench"),
+	TEXT("Times the dialogue search index on made up lines. Usage: HB.Search.Bench [Lines=100000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumLines = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 50) : 100000;
+		const int32 LinesPerSource = 50;
+		const int32 NumQueries = 1000;
+
+		FRandomStream Random(0x5EA7C4);
+		const TCHAR* Syllables[] = { TEXT("ka"), TEXT("ri"), TEXT("mo"), TEXT("ne"), TEXT("su"), TEXT("ta"), TEXT("ho"), TEXT("mi"), TEXT("ru"), TEXT("ze"), TEXT("no"), TEXT("ya") };
+		TArray<FString> Words;
+		for (int32 Word = 0; Word < 4000; Word++)
+		{
+			FString Text;
+			for (int32 Syllable = Random.RandRange(1, 4); Syllable > 0; Syllable--)
+				Text += Syllables[Random.RandHelper(ARRAY_COUNT(Syllables))];
+			Words.Add(Text);
+		}
+
+		auto MakeSource = [&Random, &Words](int32 Count)
+		{
+			TArray<TPair<FString, FString>> Strings;
+			for (int32 Line = 0; Line < Count; Line++)
+			{
+				FString Text;
+				for (int32 Word = Random.RandRange(6, 16); Word > 0; Word--)
+					Text += Words[Random.RandHelper(Words.Num())] + TEXT(" ");
+				Strings.Emplace(FString::Printf(TEXT("S.0.0.%d"), Line), Text);
+			}
+			return Strings;
+		};
+
+		FDialogueSearchIndex Index;
+		const double BuildStart = FPlatformTime::Seconds();
+		for (int32 Source = 0; Source * LinesPerSource < NumLines; Source++)
+			Index.UpdateSource(FString::Printf(TEXT("Source%d"), Source), MakeSource(LinesPerSource));
+		const double BuildSeconds = FPlatformTime::Seconds() - BuildStart;
+
+		double TotalSeconds = 0.0, WorstSeconds = 0.0;
+		int64 TotalResults = 0;
+		TArray<int32> Results;
+		for (int32 Query = 0; Query < NumQueries; Query++)
+		{
+			FString Text = Words[Random.RandHelper(Words.Num())];
+			if (Query % 2 == 1)
+				Text += TEXT(" ") + Words[Random.RandHelper(Words.Num())];
+
+			const double Start = FPlatformTime::Seconds();
+			Index.Search(Text, Results);
+			const double Seconds = FPlatformTime::Seconds() - Start;
+			TotalSeconds += Seconds;
+			WorstSeconds = FMath::Max(WorstSeconds, Seconds);
+			TotalResults += Results.Num();
+		}
+
+		const TArray<TPair<FString, FString>> Changed = MakeSource(LinesPerSource);
+		const double UpdateStart = FPlatformTime::Seconds();
+		Index.UpdateSource(TEXT("Source0"), Changed);
+		const double UpdateSeconds = FPlatformTime::Seconds() - UpdateStart;
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Search index: %d lines, %d trigrams, %llu bytes, built in %.1f ms. %d queries: %.1f us average, %.1f us worst, %.1f matches each. Changing one source: %.1f us."),
+			Index.GetNumLines(), Index.GetNumTrigrams(), (uint64)Index.GetAllocatedSize(), BuildSeconds * 1000.0, NumQueries, TotalSeconds * 1e6 / NumQueries,
+			WorstSeconds * 1e6, double(TotalResults) / NumQueries, UpdateSeconds * 1e6);
+	})
+);
@@ -0,0 +1,90 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueSearch
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This indexes the text of every conversation and info box so
+*				   writers and QA can find each line that mentions something
+*				   (HB.Search). The index is kept up to date per conversation,
+*				   only the ones whose text changed are indexed again.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/*
+ * Struct:  FDialogueSearchLine
+ * --------------------
+ * One indexed string. ID is the string's ID in the localization tables (N., S., O., Name., Desc., see FDialogueLocalization).
+ */
+struct FDialogueSearchLine
+{
+	int32 Source = INDEX_NONE;
+	FString ID;
+	FString Text;
+};
+
+/*
+ * Class:  FDialogueSearchIndex
+ * --------------------
+ * A trigram index: every three characters of a line (lower case) map to the sorted list of lines that have them.
+ * A query looks up the lines that have all of its trigrams and only compares the text of those.
+ * Lines of a source that changed are left as holes and the lists are compacted once half of them are holes.
+ */
+class HEAVENLYBLUE_API FDialogueSearchIndex
+{
+public:
+	// The index of the game's conversations and info boxes.
+	static FDialogueSearchIndex& Get();
+
+	// Indexes a source's strings (ID and text) unless they hash the same as last time. Returns true if it indexed them.
+	bool UpdateSource(const FString& SourceName, const TArray<TPair<FString, FString>>& Strings);
+	void RemoveSource(const FString& SourceName);
+
+	// Updates every conversation instance of the world and the item database, and drops the sources that aren't in it anymore.
+	// Returns the number of sources indexed again.
+	int32 UpdateFromWorld(UWorld* World);
+
+	// The lines containing Query (ignoring case), in index order.
+	void Search(const FString& Query, TArray<int32>& OutLines, int32 MaxResults = MAX_int32) const;
+
+	const FDialogueSearchLine& GetLine(int32 Line) const { return Lines[Line]; }
+	const FString& GetSourceName(int32 Source) const { return Sources[Source].Name; }
+
+	int32 GetNumLines() const { return Lines.Num() - NumDeadLines; }
+	int32 GetNumSources() const { return SourceIndices.Num(); }
+	int32 GetNumTrigrams() const { return Postings.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+	void Reset();
+
+private:
+	struct FSource
+	{
+		FString Name;
+		uint32 Hash = 0;
+		TArray<int32> Lines;
+	};
+
+	static uint64 MakeTrigram(TCHAR A, TCHAR B, TCHAR C);
+	void AddLine(int32 Source, const FString& ID, const FString& Text);
+	void Compact();
+
+	TArray<FDialogueSearchLine> Lines;
+	TArray<FSource> Sources;
+	TMap<FString, int32> SourceIndices;
+	TMap<uint64, TArray<int32>> Postings;
+	int32 NumDeadLines = 0;
+};
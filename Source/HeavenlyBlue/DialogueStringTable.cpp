@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DialogueStringTable.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "IDialogueTree.h"
+#include "AConversationInstance.h"
+#include "DialogueScriptImporter.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+/*
+ * Function:  FDialogueStringTable
+ * --------------------
+ * Index 0 is reserved for the empty string so a default handle is always valid.
+ *
+ */
+FDialogueStringTable::FDialogueStringTable(bool bInLocalized) :
+NumStrings(0),
+bLocalized(bInLocalized)
+{
+	Add(FString());
+}
+
+FDialogueStringTable& FDialogueStringTable::Get()
+{
+	static FDialogueStringTable Table;
+	return Table;
+}
+
+FDialogueStringTable& FDialogueStringTable::GetLocalized()
+{
+	static FDialogueStringTable Table(true);
+	return Table;
+}
+
+void FDialogueStringTable::Reset()
+{
+	Chunks.Empty();
+	Lookup.Empty();
+	NumStrings = 0;
+	Add(FString());
+}
+
+int32 FDialogueStringTable::Add(FString&& String)
+{
+	if (NumStrings % ChunkSize == 0)
+		Chunks.AddDefaulted_GetRef().Reserve(ChunkSize);
+
+	Chunks.Last().Add(MoveTemp(String));
+	return NumStrings++;
+}
+
+int32 FDialogueStringTable::Find(const FString& String, uint32 Hash) const
+{
+	for (auto It = Lookup.CreateConstKeyIterator(Hash); It; ++It)
+	{
+		if (GetString(It.Value()).Equals(String, ESearchCase::CaseSensitive))
+			return It.Value();
+	}
+	return INDEX_NONE;
+}
+
+/*
+ * Function:  Intern
+ * --------------------
+ * This returns the handle for a string, storing it only if no equal string exists yet.
+ *
+ */
+FDialogueStringHandle FDialogueStringTable::Intern(const FString& String)
+{
+	return Intern(FString(String));
+}
+
+FDialogueStringHandle FDialogueStringTable::Intern(FString&& String)
+{
+	HB_LLM_SCOPE(Dialogue);
+
+	FDialogueStringHandle Handle;
+	if (String.IsEmpty())
+		return Handle;
+
+	const uint32 Hash = FCrc::StrCrc32(*String);
+	const int32 Existing = Find(String, Hash);
+	if (Existing != INDEX_NONE)
+	{
+		Handle.Index = Existing | (bLocalized ? FDialogueStringHandle::LocalizedBit : 0);
+		return Handle;
+	}
+
+	String.Shrink();
+	const int32 Index = Add(MoveTemp(String));
+	Lookup.Add(Hash, Index);
+	Handle.Index = Index | (bLocalized ? FDialogueStringHandle::LocalizedBit : 0);
+	return Handle;
+}
+
+SIZE_T FDialogueStringTable::GetAllocatedSize() const
+{
+	SIZE_T Size = Chunks.GetAllocatedSize() + Lookup.GetAllocatedSize();
+	for (const TArray<FString>& Chunk : Chunks)
+	{
+		Size += Chunk.GetAllocatedSize();
+		for (const FString& String : Chunk)
+			Size += String.GetAllocatedSize();
+	}
+	return Size;
+}
+
+namespace DialogueStringReport
+{
+	/*
+	 * Struct:  FLayoutSize
+	 * --------------------
+	 * The bytes spent on dialogue text when every node owns its strings, and when it holds handles.
+	 */
+	struct FLayoutSize
+	{
+		int32 Fields = 0;
+		SIZE_T OwnedBytes = 0;
+		SIZE_T HandleBytes = 0;
+	};
+
+	void AddField(FLayoutSize& Size, FDialogueStringTable& Table, const FString& Owned, FDialogueStringHandle Handle)
+	{
+		const FString& Text = Handle.IsEmpty() ? Owned : FDialogueStringTable::ResolveText(Handle);
+		Size.Fields++;
+		Size.OwnedBytes += sizeof(FString) + (Text.IsEmpty() ? 0 : (Text.Len() + 1) * sizeof(TCHAR));
+		Size.HandleBytes += sizeof(FDialogueStringHandle);
+		Table.Intern(Text);
+	}
+
+	void AddConversation(FLayoutSize& Size, FDialogueStringTable& Table, const TArray<FConversationNode>& Conversations, const TArray<FQuestionNode>& Questions)
+	{
+		for (const FConversationNode& Conversation : Conversations)
+		{
+			for (const FDialogueNode& Dialogue : Conversation.DialougeNodes)
+			{
+				AddField(Size, Table, Dialogue.SpeakerName, Dialogue.SpeakerHandle);
+				for (const FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+					AddField(Size, Table, Subtitle.SubtitleText, Subtitle.TextHandle);
+			}
+		}
+
+		for (const FQuestionNode& Question : Questions)
+			AddField(Size, Table, Question.Option, Question.OptionHandle);
+	}
+}
+
+/*
+ * Console Command:  HB.Dialogue.StringReport [Script]
+ * --------------------
+ * Compares the memory of per-node strings with the interned layout, either for the conversations
+ * in the current world or for a script on disk.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GDialogueStringReportCommand(
+	TEXT("HB.Dialogue.StringReport"),
+	TEXT("Compares per-node dialogue strings with the interned string table. Usage: HB.Dialogue.StringReport [Script.csv]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		using namespace DialogueStringReport;
+
+		FLayoutSize Size;
+		FDialogueStringTable Table;
+		int32 Instances = 0;
+
+		if (Args.Num() > 0)
+		{
+			FDialogueScriptImporter Importer;
+			TMap<FName, FImportedConversation> Conversations;
+			if (!Importer.ImportFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Args[0]), Conversations))
+				return;
+
+			for (const TPair<FName, FImportedConversation>& Conversation : Conversations)
+				AddConversation(Size, Table, Conversation.Value.ConversationList, Conversation.Value.QuestionList);
+			Instances = Conversations.Num();
+		}
+		else if (World != nullptr)
+		{
+			for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+			{
+				AddConversation(Size, Table, It->ConversationList, It->QuestionList);
+				Instances++;
+			}
+		}
+
+		// Each instance used to hold its own copy of the current speaker and subtitle as well.
+		const SIZE_T RuntimeOwned = Instances * 2 * sizeof(FString);
+		const SIZE_T RuntimeHandles = Instances * 2 * sizeof(FDialogueStringHandle);
+
+		const SIZE_T Before = Size.OwnedBytes + RuntimeOwned;
+		const SIZE_T After = Size.HandleBytes + RuntimeHandles + Table.GetAllocatedSize();
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Dialogue strings: %d conversations, %d text fields, %d unique strings."), Instances, Size.Fields, Table.Num() - 1);
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("  Per-node strings: %llu bytes (%llu in nodes, at least %llu in runtime copies)."),
+			(uint64)Before, (uint64)Size.OwnedBytes, (uint64)RuntimeOwned);
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("  Interned table:   %llu bytes (%llu in handles, %llu in the table). Saved %.1f%%."),
+			(uint64)After, (uint64)(Size.HandleBytes + RuntimeHandles), (uint64)Table.GetAllocatedSize(), Before > 0 ? 100.0 * (1.0 - double(After) / double(Before)) : 0.0);
+	})
+);
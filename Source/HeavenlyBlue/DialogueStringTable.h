@@ -0,0 +1,92 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DialogueStringTable
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class stores every speaker name, subtitle and option
+*				   once for all conversations. Nodes and the runtime dialogue
+*				   state keep a small handle into it instead of their own copy.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Struct:  FDialogueStringHandle
+ * --------------------
+ * An index into the dialogue string table. The default handle is the empty string.
+ * Handles into the localized table have the top bit set.
+ */
+struct FDialogueStringHandle
+{
+	static const uint32 LocalizedBit = 0x80000000u;
+
+	uint32 Index = 0;
+
+	bool IsEmpty() const { return Index == 0; }
+	bool IsLocalized() const { return (Index & LocalizedBit) != 0; }
+	bool operator==(const FDialogueStringHandle& Other) const { return Index == Other.Index; }
+	bool operator!=(const FDialogueStringHandle& Other) const { return Index != Other.Index; }
+	friend uint32 GetTypeHash(const FDialogueStringHandle& Handle) { return Handle.Index; }
+};
+
+// The table is only touched from the game thread. Strings are stored in fixed size chunks that are never
+// reallocated, so a reference to a resolved string stays valid while more are interned, until Reset.
+class HEAVENLYBLUE_API FDialogueStringTable
+{
+public:
+	explicit FDialogueStringTable(bool bInLocalized = false);
+
+	// The text authored with the conversations. It lives as long as the game.
+	static FDialogueStringTable& Get();
+
+	// The text of the active culture (see FDialogueLocalization). It is emptied whenever the culture changes.
+	static FDialogueStringTable& GetLocalized();
+
+	// Resolves a handle from either table.
+	static const FString& ResolveText(FDialogueStringHandle Handle) { return (Handle.IsLocalized() ? GetLocalized() : Get()).Resolve(Handle); }
+
+	// Returns the handle of an equal (case sensitive) string, adding it if it's new.
+	FDialogueStringHandle Intern(const FString& String);
+	FDialogueStringHandle Intern(FString&& String);
+
+	const FString& Resolve(FDialogueStringHandle Handle) const
+	{
+		const uint32 Index = Handle.Index & ~FDialogueStringHandle::LocalizedBit;
+		return GetString(Index < uint32(NumStrings) ? Index : 0);
+	}
+
+	int32 Num() const { return NumStrings; }
+
+	// Drops every string. Handles given out before are no longer valid.
+	void Reset();
+
+	// The table's own memory: the strings, their array and the lookup.
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	static const int32 ChunkSize = 512;
+
+	const FString& GetString(uint32 Index) const { return Chunks[Index / ChunkSize][Index % ChunkSize]; }
+	int32 Add(FString&& String);
+	int32 Find(const FString& String, uint32 Hash) const;
+
+	// Each chunk is reserved to ChunkSize up front and never grows past it, so its strings never move.
+	TArray<TArray<FString>> Chunks;
+	int32 NumStrings;
+
+	// String hash to index. A multimap, so the strings themselves are never stored twice.
+	TMultiMap<uint32, uint32> Lookup;
+
+	bool bLocalized;
+};
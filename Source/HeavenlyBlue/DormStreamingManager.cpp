@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DormStreamingManager.h"
+#include "HeavenlyBlue.h"
+#include "HitchMonitor.h"
+#include "StartupProfiler.h"
+#include "CoreGlobals.h"
+#include "EngineUtils.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/PackageName.h"
+
+ADormStreamingManager::ADormStreamingManager() :
+LoadDistance(600.0f),
+UnloadDistance(1000.0f),
+LookAheadSeconds(1.0f),
+MaxLoadRequestsPerFrame(1),
+MaxPendingLoads(2),
+HitchThresholdMs(33.3f)
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+/*
+ * Function:  BeginPlay
+ * --------------------
+ * 1) Find each cell's streaming level.
+ * 2) Load what's around the player right away. The cell they start in blocks, it's part of loading the map.
+ *
+ */
+void ADormStreamingManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UnloadDistance < LoadDistance)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: UnloadDistance is below LoadDistance, using %.0f for both."), *GetName(), LoadDistance);
+		UnloadDistance = LoadDistance;
+	}
+
+	BindCells();
+	UpdateCells(true);
+}
+
+void ADormStreamingManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EndPlayReason == EEndPlayReason::EndPlayInEditor || EndPlayReason == EEndPlayReason::Quit)
+		LogStats();
+
+	CellStates.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void ADormStreamingManager::Tick(float DeltaSeconds)
+{
+	HB_HITCH_SCOPE("Streaming.Tick");
+	Super::Tick(DeltaSeconds);
+
+	// The last frame was spent streaming if a cell was changing when it started.
+	const bool bWasStreaming = UpdatePendingLoads();
+	if (bWasStreaming)
+	{
+		const float FrameMs = float(FApp::GetDeltaTime() * 1000.0);
+		Stats.WorstFrameMs = FMath::Max(Stats.WorstFrameMs, FrameMs);
+		if (FrameMs > HitchThresholdMs)
+		{
+			Stats.Hitches++;
+			UE_LOG(LogHeavenlyBlue, Verbose, TEXT("Streaming hitch: %.1f ms frame."), FrameMs);
+		}
+	}
+
+	UpdateCells(false);
+}
+
+/*
+ * Function:  BindCells
+ * --------------------
+ * Cells match the persistent map's streaming levels by package name. In PIE those are prefixed, the prefix is dropped.
+ *
+ */
+void ADormStreamingManager::BindCells()
+{
+	CellStates.Reset();
+	CellStates.SetNum(Cells.Num());
+
+	UWorld* World = GetWorld();
+	for (int32 Index = 0; Index < Cells.Num(); Index++)
+	{
+		const FString PackageName = Cells[Index].Level.ToSoftObjectPath().GetLongPackageName();
+		if (PackageName.IsEmpty())
+			continue;
+
+		for (ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+		{
+			if (StreamingLevel == nullptr || UWorld::RemovePIEPrefix(StreamingLevel->GetWorldAssetPackageName()) != PackageName)
+				continue;
+
+			if (StreamingLevel->ShouldBeAlwaysLoaded())
+			{
+				UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: %s is always loaded, set its streaming method to Blueprint to stream it."), *GetName(), *PackageName);
+				break;
+			}
+
+			CellStates[Index].StreamingLevel = StreamingLevel;
+			CellStates[Index].bWanted = StreamingLevel->ShouldBeLoaded();
+			break;
+		}
+
+		if (!CellStates[Index].StreamingLevel.IsValid())
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: cell %d's level %s isn't a streaming level of %s."), *GetName(), Index, *PackageName, *World->GetMapName());
+	}
+}
+
+bool ADormStreamingManager::GetPlayerLocations(FVector& OutLocation, FVector& OutPredicted) const
+{
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (Player == nullptr)
+		return false;
+
+	OutLocation = Player->GetActorLocation();
+	OutPredicted = OutLocation + Player->GetVelocity() * LookAheadSeconds;
+	return true;
+}
+
+/*
+ * Function:  UpdateCells
+ * --------------------
+ * 1) A cell the player is standing in has to be there now, it loads blocking.
+ * 2) A loaded cell stays until both the player and where they're headed are past UnloadDistance.
+ * 3) Other cells in LoadDistance of either are queued by distance, and the nearest started within the budget.
+ *
+ */
+void ADormStreamingManager::UpdateCells(bool bStartup)
+{
+	FVector Location, Predicted;
+	if (!GetPlayerLocations(Location, Predicted))
+		return;
+
+	int32 PendingLoads = 0;
+	TArray<TPair<float, int32>> Candidates;
+	for (int32 Index = 0; Index < CellStates.Num(); Index++)
+	{
+		FCellState& State = CellStates[Index];
+		if (!State.StreamingLevel.IsValid())
+			continue;
+
+		const FBox& Bounds = Cells[Index].Bounds;
+		const float Distance = FMath::Sqrt(Bounds.ComputeSquaredDistanceToPoint(Location));
+		const float PredictedDistance = FMath::Sqrt(Bounds.ComputeSquaredDistanceToPoint(Predicted));
+
+		if (State.bWanted)
+		{
+			if (Distance > UnloadDistance && PredictedDistance > UnloadDistance)
+				RequestUnload(Index);
+			else if (State.LoadRequestTime >= 0.0)
+				PendingLoads++;
+		}
+		else if (Distance <= 0.0f)
+		{
+			RequestLoad(Index, true);
+			if (!bStartup)
+				Stats.BlockingLoads++;
+		}
+		else if (FMath::Min(Distance, PredictedDistance) <= LoadDistance)
+		{
+			Candidates.Add(TPair<float, int32>(FMath::Min(Distance, PredictedDistance), Index));
+		}
+	}
+
+	Candidates.Sort();
+
+	const int32 Budget = bStartup ? Candidates.Num() : FMath::Min(MaxLoadRequestsPerFrame, MaxPendingLoads - PendingLoads);
+	for (int32 Candidate = 0; Candidate < FMath::Min(Budget, Candidates.Num()); Candidate++)
+		RequestLoad(Candidates[Candidate].Value, false);
+}
+
+void ADormStreamingManager::RequestLoad(int32 CellIndex, bool bBlocking)
+{
+	FCellState& State = CellStates[CellIndex];
+	ULevelStreaming* StreamingLevel = State.StreamingLevel.Get();
+
+	State.bWanted = true;
+	State.LoadRequestTime = FPlatformTime::Seconds();
+
+	StreamingLevel->bShouldBlockOnLoad = bBlocking;
+	StreamingLevel->SetShouldBeLoaded(true);
+	StreamingLevel->SetShouldBeVisible(true);
+}
+
+void ADormStreamingManager::RequestUnload(int32 CellIndex)
+{
+	FCellState& State = CellStates[CellIndex];
+	ULevelStreaming* StreamingLevel = State.StreamingLevel.Get();
+
+	State.bWanted = false;
+	State.LoadRequestTime = -1.0;
+	Stats.Unloads++;
+
+	StreamingLevel->bShouldBlockOnLoad = false;
+	StreamingLevel->SetShouldBeVisible(false);
+	StreamingLevel->SetShouldBeLoaded(false);
+}
+
+/*
+ * Function:  UpdatePendingLoads
+ * --------------------
+ * A load is done once the level is visible, its actors have begun play by then.
+ * The load is also added to the startup timeline when that's recording.
+ *
+ */
+bool ADormStreamingManager::UpdatePendingLoads()
+{
+	bool bStreaming = false;
+	for (int32 Index = 0; Index < CellStates.Num(); Index++)
+	{
+		FCellState& State = CellStates[Index];
+		ULevelStreaming* StreamingLevel = State.StreamingLevel.Get();
+		if (StreamingLevel == nullptr)
+			continue;
+
+		if (State.LoadRequestTime >= 0.0 && StreamingLevel->IsLevelVisible())
+		{
+			const double Now = FPlatformTime::Seconds();
+			const double Seconds = Now - State.LoadRequestTime;
+			Stats.Loads++;
+			Stats.TotalLoadSeconds += Seconds;
+			Stats.LongestLoadSeconds = FMath::Max(Stats.LongestLoadSeconds, Seconds);
+
+			FStartupProfiler::Get().AddSpan(TEXT("Streaming"), FPackageName::GetShortName(StreamingLevel->GetWorldAssetPackageName()), State.LoadRequestTime - GStartTime, Now - GStartTime);
+
+			StreamingLevel->bShouldBlockOnLoad = false;
+			State.LoadRequestTime = -1.0;
+		}
+
+		if (State.LoadRequestTime >= 0.0 || StreamingLevel->IsStreamingStatePending())
+			bStreaming = true;
+	}
+
+	return bStreaming;
+}
+
+bool ADormStreamingManager::IsCellVisible(int32 CellIndex) const
+{
+	const ULevelStreaming* StreamingLevel = CellStates.IsValidIndex(CellIndex) ? CellStates[CellIndex].StreamingLevel.Get() : nullptr;
+	return StreamingLevel != nullptr && StreamingLevel->IsLevelVisible();
+}
+
+void ADormStreamingManager::LogStats() const
+{
+	int32 Visible = 0;
+	for (int32 Index = 0; Index < CellStates.Num(); Index++)
+		Visible += IsCellVisible(Index) ? 1 : 0;
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("%s: %d/%d cells visible, %d loads (avg %.0f ms, longest %.0f ms), %d unloads, %d blocking, %d hitches over %.1f ms, worst frame %.1f ms."),
+		*GetName(), Visible, Cells.Num(), Stats.Loads, Stats.Loads > 0 ? Stats.TotalLoadSeconds * 1000.0 / Stats.Loads : 0.0, Stats.LongestLoadSeconds * 1000.0,
+		Stats.Unloads, Stats.BlockingLoads, Stats.Hitches, HitchThresholdMs, Stats.WorstFrameMs);
+}
+
+/*
+ * Console Command:  HB.Streaming.Stats [reset]
+ * --------------------
+ * Logs what streaming the dorm's cells cost so far, reset starts counting again.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GStreamingStatsCommand(
+	TEXT("HB.Streaming.Stats"),
+	TEXT("Logs the dorm streaming loads, unloads and hitches. Usage: HB.Streaming.Stats [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr)
+			return;
+
+		const bool bReset = Args.Num() > 0 && Args[0] == TEXT("reset");
+		for (TActorIterator<ADormStreamingManager> It(World); It; ++It)
+		{
+			It->LogStats();
+			if (bReset)
+				It->ResetStats();
+		}
+	}));
@@ -0,0 +1,141 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : DormStreamingManager
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This actor splits the dorm into cells and streams each cell's
+*				   sublevel in and out around the player. A cell is loaded when
+*				   the player, or where they're headed, gets within LoadDistance
+*				   of it and is only dropped past UnloadDistance, so walking
+*				   along a cell's edge doesn't load and unload it every frame.
+*				   New loads are started a few per frame, the engine then
+*				   spreads each one over frames ([/Script/Engine.StreamingSettings]).
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "DormStreamingManager.generated.h"
+
+class ULevelStreaming;
+
+/*
+ * Struct:  FDormStreamingCell
+ * --------------------
+ * A room or stretch of hallway. Its sublevel has to be in the persistent map's Levels list with
+ * the Blueprint streaming method, the manager decides when it's loaded.
+ */
+USTRUCT(BlueprintType)
+struct FDormStreamingCell
+{
+	GENERATED_BODY()
+
+	// The sublevel with the cell's MH_* tiles, sprites, conversations and info boxes.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Cell")
+	TSoftObjectPtr<UWorld> Level;
+
+	// The area the cell covers, in world space. Distances are measured to this box.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Cell")
+	FBox Bounds = FBox(ForceInit);
+};
+
+/*
+ * Struct:  FDormStreamingStats
+ * --------------------
+ * What streaming cost since the level started (or HB.Streaming.Stats reset).
+ */
+struct FDormStreamingStats
+{
+	int32 Loads = 0;
+	int32 Unloads = 0;
+	// Cells the player walked into before they were visible, the game waited on those.
+	int32 BlockingLoads = 0;
+	// Frames over HitchThresholdMs while a cell was loading, becoming visible or unloading.
+	int32 Hitches = 0;
+	float WorstFrameMs = 0.0f;
+	// From the load request until the cell was visible.
+	double TotalLoadSeconds = 0.0;
+	double LongestLoadSeconds = 0.0;
+};
+
+UCLASS()
+class HEAVENLYBLUE_API ADormStreamingManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ADormStreamingManager();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming")
+	TArray<FDormStreamingCell> Cells;
+
+	// A cell starts loading when the player is this close to it.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "0"))
+	float LoadDistance;
+
+	// ...and is unloaded once they're further than this. Keep it above LoadDistance.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "0"))
+	float UnloadDistance;
+
+	// Where the player will be this many seconds ahead at their current velocity also counts for loading,
+	// so the room they're walking towards starts early. It never keeps a cell loaded.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "0"))
+	float LookAheadSeconds;
+
+	// New load requests started per frame, the nearest cells first.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "1"))
+	int32 MaxLoadRequestsPerFrame;
+
+	// Cells loading at once. The rest wait their turn.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "1"))
+	int32 MaxPendingLoads;
+
+	// Frames longer than this while streaming count as hitches.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Streaming", meta = (ClampMin = "0"))
+	float HitchThresholdMs;
+
+	const FDormStreamingStats& GetStats() const { return Stats; }
+	void ResetStats() { Stats = FDormStreamingStats(); }
+	void LogStats() const;
+
+	// Whether the cell's sublevel is loaded and visible.
+	bool IsCellVisible(int32 CellIndex) const;
+
+protected:
+private:
+	struct FCellState
+	{
+		TWeakObjectPtr<ULevelStreaming> StreamingLevel;
+		bool bWanted = false;
+		// When the cell was asked to load, negative when it isn't loading.
+		double LoadRequestTime = -1.0;
+	};
+
+	TArray<FCellState> CellStates;
+	FDormStreamingStats Stats;
+
+	// Finds the streaming level of every cell in the persistent map.
+	void BindCells();
+	// Where the player is, and where they'll be LookAheadSeconds from now.
+	bool GetPlayerLocations(FVector& OutLocation, FVector& OutPredicted) const;
+	// Decides which cells should be loaded. At startup every load starts at once and none count as blocking.
+	void UpdateCells(bool bStartup);
+	void RequestLoad(int32 CellIndex, bool bBlocking);
+	void RequestUnload(int32 CellIndex);
+	// Picks up the loads that finished this frame, returns true while any cell is still changing.
+	bool UpdatePendingLoads();
+};
@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEvents.h"
+#include "HeavenlyBlue.h"
+#include "HitchMonitor.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+FGameplayEventBus FGameplayEventBus::Bus;
+
+namespace GameplayEventBenchmark
+{
+	struct FBenchmarkEvent
+	{
+		static constexpr EGameplayEventType Type = EGameplayEventType::Benchmark;
+
+		int32 Producer = 0;
+		int32 Sequence = 0;
+	};
+}
+
+FGameplayEventBus::FGameplayEventBus() :
+NextSubscriberID(1),
+DispatchDepth(0),
+bHasUnsubscribed(false),
+bStarted(false),
+NumDispatched(0),
+MostInOneFrame(0)
+{}
+
+void FGameplayEventBus::Start()
+{
+	if (bStarted || IsRunningCommandlet())
+		return;
+
+	FCoreDelegates::OnBeginFrame.AddRaw(this, &FGameplayEventBus::HandleBeginFrame);
+	bStarted = true;
+}
+
+void FGameplayEventBus::Stop()
+{
+	if (!bStarted)
+		return;
+
+	bStarted = false;
+	FCoreDelegates::OnBeginFrame.RemoveAll(this);
+
+	FQueuedEvent Discarded;
+	while (Queue.Dequeue(Discarded));
+	for (TArray<FSubscriber>& TypeSubscribers : Subscribers)
+		TypeSubscribers.Empty();
+	PendingSubscribers.Empty();
+}
+
+void FGameplayEventBus::HandleBeginFrame()
+{
+	HB_HITCH_SCOPE("Events.Drain");
+	const int32 Dispatched = Drain();
+	MostInOneFrame = FMath::Max(MostInOneFrame, Dispatched);
+
+	if (Dispatched == MaxEventsPerDrain)
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("The gameplay event bus dispatched %d events in one frame, the rest wait for the next."), Dispatched);
+}
+
+FGameplayEventHandle FGameplayEventBus::AddSubscriber(EGameplayEventType Type, const UObject* Owner, TFunction<void(const void*)>&& Callback)
+{
+	check(IsInGameThread());
+
+	FSubscriber Subscriber;
+	Subscriber.ID = NextSubscriberID++;
+	Subscriber.Owner = Owner;
+	Subscriber.bHasOwner = Owner != nullptr;
+	Subscriber.Callback = MoveTemp(Callback);
+
+	FGameplayEventHandle Handle;
+	Handle.Type = Type;
+	Handle.ID = Subscriber.ID;
+
+	if (DispatchDepth > 0)
+		PendingSubscribers.Emplace(Type, MoveTemp(Subscriber));
+	else
+		Subscribers[int32(Type)].Add(MoveTemp(Subscriber));
+	return Handle;
+}
+
+/*
+ * Function:  Unsubscribe
+ * --------------------
+ * During a dispatch the entry is only cleared, so the walk over the array isn't disturbed, and removed after it.
+ *
+ */
+void FGameplayEventBus::Unsubscribe(FGameplayEventHandle& Handle)
+{
+	check(IsInGameThread());
+	if (!Handle.IsValid())
+		return;
+
+	const uint32 ID = Handle.ID;
+	TArray<FSubscriber>& TypeSubscribers = Subscribers[int32(Handle.Type)];
+	Handle = FGameplayEventHandle();
+
+	PendingSubscribers.RemoveAll([ID](const TPair<EGameplayEventType, FSubscriber>& Pending) { return Pending.Value.ID == ID; });
+
+	const int32 Index = TypeSubscribers.IndexOfByPredicate([ID](const FSubscriber& Subscriber) { return Subscriber.ID == ID; });
+	if (Index == INDEX_NONE)
+		return;
+
+	if (DispatchDepth > 0)
+	{
+		TypeSubscribers[Index].Callback = nullptr;
+		bHasUnsubscribed = true;
+	}
+	else
+	{
+		TypeSubscribers.RemoveAt(Index);
+	}
+}
+
+void FGameplayEventBus::UnsubscribeAll(const UObject* Owner)
+{
+	check(IsInGameThread());
+
+	PendingSubscribers.RemoveAll([Owner](const TPair<EGameplayEventType, FSubscriber>& Pending) { return Pending.Value.Owner.Get() == Owner; });
+
+	for (TArray<FSubscriber>& TypeSubscribers : Subscribers)
+	{
+		for (FSubscriber& Subscriber : TypeSubscribers)
+		{
+			if (Subscriber.bHasOwner && Subscriber.Owner.Get() == Owner)
+			{
+				Subscriber.Callback = nullptr;
+				bHasUnsubscribed = true;
+			}
+		}
+	}
+	if (DispatchDepth == 0)
+		FlushSubscribers();
+}
+
+/*
+ * Function:  Drain
+ * --------------------
+ * 1) Take the events out one at a time and walk the subscribers of the event's type. Ones whose owner is gone are
+ *    cleared instead of called.
+ * 2) Events posted by a subscriber are in the queue behind the others and go out in the same drain, up to MaxEventsPerDrain.
+ * 3) Afterwards, add who subscribed during the drain and remove who left.
+ *
+ */
+int32 FGameplayEventBus::Drain()
+{
+	check(IsInGameThread());
+
+	DispatchDepth++;
+	int32 Dispatched = 0;
+	FQueuedEvent Event;
+	while (Dispatched < MaxEventsPerDrain && Queue.Dequeue(Event))
+	{
+		Dispatched++;
+		TArray<FSubscriber>& TypeSubscribers = Subscribers[int32(Event.Type)];
+		for (FSubscriber& Subscriber : TypeSubscribers)
+		{
+			if (!Subscriber.Callback)
+				continue;
+
+			if (Subscriber.bHasOwner && !Subscriber.Owner.IsValid())
+			{
+				Subscriber.Callback = nullptr;
+				bHasUnsubscribed = true;
+				continue;
+			}
+			Subscriber.Callback(Event.Payload);
+		}
+	}
+	DispatchDepth--;
+
+	NumDispatched += Dispatched;
+	if (DispatchDepth == 0)
+		FlushSubscribers();
+	return Dispatched;
+}
+
+void FGameplayEventBus::FlushSubscribers()
+{
+	if (bHasUnsubscribed)
+	{
+		bHasUnsubscribed = false;
+		for (TArray<FSubscriber>& TypeSubscribers : Subscribers)
+			TypeSubscribers.RemoveAll([](const FSubscriber& Subscriber) { return !Subscriber.Callback; });
+	}
+
+	for (TPair<EGameplayEventType, FSubscriber>& Pending : PendingSubscribers)
+		Subscribers[int32(Pending.Key)].Add(MoveTemp(Pending.Value));
+	PendingSubscribers.Reset();
+}
+
+int32 FGameplayEventBus::GetNumSubscribers() const
+{
+	int32 Num = PendingSubscribers.Num();
+	for (const TArray<FSubscriber>& TypeSubscribers : Subscribers)
+		Num += TypeSubscribers.Num();
+	return Num;
+}
+
+/*
+ * Console Command:  HB.Events [bench [Events] [Producers]]
+ * --------------------
+ * Logs the game bus's counts. With bench, producers on worker threads post to a bus of its own while the game thread
+ * drains it to one subscriber, and then the same number of events is posted and drained on the game thread alone.
+ */
+static FAutoConsoleCommand GEventsCommand(
+	TEXT("HB.Events"),
+	TEXT("Logs the gameplay event bus's counts or measures its throughput. Usage: HB.Events [bench [Events=1000000] [Producers=4]]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() == 0 || Args[0] != TEXT("bench"))
+		{
+			const FGameplayEventBus& Bus = FGameplayEventBus::Get();
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%llu events posted, %llu dispatched, at most %d in a frame, %d subscribers."),
+				Bus.GetNumPosted(), Bus.GetNumDispatched(), Bus.GetMostInOneFrame(), Bus.GetNumSubscribers());
+			return;
+		}
+
+		using GameplayEventBenchmark::FBenchmarkEvent;
+		const int32 Producers = Args.Num() > 2 ? FMath::Clamp(FCString::Atoi(*Args[2]), 1, 32) : 4;
+		const int32 PerProducer = (Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1000) : 1000000) / Producers;
+		const int32 Total = PerProducer * Producers;
+
+		FGameplayEventBus BenchBus;
+		int64 Received = 0;
+		int64 Checksum = 0;
+		BenchBus.Subscribe<FBenchmarkEvent>(nullptr, [&Received, &Checksum](const FBenchmarkEvent& Event)
+		{
+			Received++;
+			Checksum += Event.Sequence;
+		});
+
+		// Several producers, the game thread draining as they post.
+		double StartTime = FPlatformTime::Seconds();
+		TArray<TFuture<void>> Futures;
+		for (int32 Producer = 0; Producer < Producers; Producer++)
+		{
+			Futures.Add(Async(EAsyncExecution::ThreadPool, [&BenchBus, Producer, PerProducer]()
+			{
+				FBenchmarkEvent Event;
+				Event.Producer = Producer;
+				for (int32 Sequence = 0; Sequence < PerProducer; Sequence++)
+				{
+					Event.Sequence = Sequence;
+					BenchBus.Post(Event);
+				}
+			}));
+		}
+		while (Received < Total)
+		{
+			if (BenchBus.Drain() == 0)
+				FPlatformProcess::Yield();
+		}
+		for (TFuture<void>& Future : Futures)
+			Future.Wait();
+		const double ThreadedSeconds = FPlatformTime::Seconds() - StartTime;
+		const bool bThreadedComplete = Checksum == int64(Producers) * PerProducer * (PerProducer - 1) / 2;
+
+		// One thread posting everything, then draining.
+		Received = 0;
+		StartTime = FPlatformTime::Seconds();
+		FBenchmarkEvent Event;
+		for (int32 Sequence = 0; Sequence < Total; Sequence++)
+		{
+			Event.Sequence = Sequence;
+			BenchBus.Post(Event);
+		}
+		const double PostSeconds = FPlatformTime::Seconds() - StartTime;
+		while (BenchBus.Drain() > 0);
+		const double SingleSeconds = FPlatformTime::Seconds() - StartTime;
+		FHitchMonitor::Get().DiscardFrame();
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%d producers, %d events: %.2f ms, %.1f M events/s%s."),
+			Producers, Total, ThreadedSeconds * 1000.0, Total / ThreadedSeconds / 1e6, bThreadedComplete ? TEXT("") : TEXT(" (events were lost!)"));
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Game thread alone, %d events: %.2f ms (%.1f ns to post and %.1f ns to dispatch each), %.1f M events/s."),
+			Total, SingleSeconds * 1000.0, PostSeconds * 1e9 / Total, (SingleSeconds - PostSeconds) * 1e9 / Total, Total / SingleSeconds / 1e6);
+	})
+);
@@ -0,0 +1,200 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : GameplayEvents
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This carries interaction, dialogue, inventory and save
+*				   events between objects, so they react when something
+*				   happens instead of checking each other's flags every
+*				   frame. Any thread can post, the game thread dispatches
+*				   them once per frame.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Templates/Function.h"
+#include "Templates/IsTriviallyDestructible.h"
+
+class AActor;
+class UInventorySubsystem;
+
+/*
+ * Enumeration:  EGameplayEventType
+ * --------------------
+ * One per event struct, each struct names its own in a static Type.
+ */
+enum class EGameplayEventType : uint8
+{
+	InteractableOverlap,
+	InteractableFinished,
+	DialogueAnswer,
+	InventoryChanged,
+	ProgressSaved,
+	// Only posted by HB.Events bench, to a bus of its own.
+	Benchmark,
+
+	Count
+};
+
+/*
+ * Events are copied through the queue as bytes, so they hold only numbers, names and weak pointers (nothing that
+ * frees memory), and fit in FGameplayEventBus::MaxEventSize.
+ */
+
+// An actor (usually the player's sprite) entered or left a conversation's or an info box's trigger.
+struct FInteractableOverlapEvent
+{
+	static constexpr EGameplayEventType Type = EGameplayEventType::InteractableOverlap;
+
+	TWeakObjectPtr<AActor> Interactable;
+	TWeakObjectPtr<AActor> Other;
+	bool bBegin = false;
+};
+
+// A conversation ran out of dialogue, or an info box reached its exit.
+struct FInteractableFinishedEvent
+{
+	static constexpr EGameplayEventType Type = EGameplayEventType::InteractableFinished;
+
+	TWeakObjectPtr<AActor> Interactable;
+};
+
+// The player picked an answer for the conversation or info box, 1 or 2.
+struct FDialogueAnswerEvent
+{
+	static constexpr EGameplayEventType Type = EGameplayEventType::DialogueAnswer;
+
+	TWeakObjectPtr<AActor> Interactable;
+	int32 Answer = 0;
+};
+
+// The player's stack of an item changed size.
+struct FInventoryChangedEvent
+{
+	static constexpr EGameplayEventType Type = EGameplayEventType::InventoryChanged;
+
+	// Each game instance has its own inventory.
+	TWeakObjectPtr<UInventorySubsystem> Inventory;
+	int32 ItemID = INDEX_NONE;
+	int32 Count = 0;
+	int32 Delta = 0;
+};
+
+/*
+ * Struct:  FGameplayEventHandle
+ * --------------------
+ * Returned by Subscribe, for Unsubscribe.
+ */
+struct FGameplayEventHandle
+{
+	EGameplayEventType Type = EGameplayEventType::Count;
+	uint32 ID = 0;
+
+	bool IsValid() const { return ID != 0; }
+};
+
+/*
+ * Class:  FGameplayEventBus
+ * --------------------
+ * Post copies the event into a lock-free queue with many producers and one consumer. Drain, on the game thread at the
+ * start of each frame, takes the events out in the order they were posted and calls the event type's subscribers,
+ * which are kept in one array per type (in the order they subscribed) so a dispatch is an index and a walk.
+ * Subscribing and unsubscribing are game thread only; a subscriber with an owner is dropped once the owner is gone.
+ */
+class HEAVENLYBLUE_API FGameplayEventBus
+{
+public:
+	static const int32 MaxEventSize = 64;
+	// An event handler posting events keeps them coming, past this many a frame the rest wait for the next one.
+	static const int32 MaxEventsPerDrain = 65536;
+
+	FGameplayEventBus();
+
+	// The game's bus, drained every frame between Start and Stop (called by the game module).
+	static FGameplayEventBus& Get() { return Bus; }
+	void Start();
+	void Stop();
+
+	// Any thread.
+	template<typename EventType>
+	void Post(const EventType& Event)
+	{
+		static_assert(sizeof(EventType) <= MaxEventSize && alignof(EventType) <= 8, "Gameplay events have to fit in MaxEventSize.");
+		static_assert(TIsTriviallyDestructible<EventType>::Value, "Gameplay events are copied as bytes, they can't own memory.");
+
+		FQueuedEvent Queued;
+		Queued.Type = EventType::Type;
+		new (Queued.Payload) EventType(Event);
+		Queue.Enqueue(Queued);
+		NumPosted.Increment();
+	}
+
+	template<typename EventType>
+	FGameplayEventHandle Subscribe(const UObject* Owner, TFunction<void(const EventType&)>&& Callback)
+	{
+		return AddSubscriber(EventType::Type, Owner, [Callback = MoveTemp(Callback)](const void* Payload)
+		{
+			Callback(*static_cast<const EventType*>(Payload));
+		});
+	}
+
+	void Unsubscribe(FGameplayEventHandle& Handle);
+	void UnsubscribeAll(const UObject* Owner);
+
+	// Dispatches the queued events, returns how many.
+	int32 Drain();
+
+	int32 GetNumSubscribers() const;
+	uint64 GetNumPosted() const { return uint64(NumPosted.GetValue()); }
+	uint64 GetNumDispatched() const { return NumDispatched; }
+	int32 GetMostInOneFrame() const { return MostInOneFrame; }
+
+private:
+	struct FQueuedEvent
+	{
+		EGameplayEventType Type = EGameplayEventType::Count;
+		alignas(8) uint8 Payload[MaxEventSize];
+	};
+
+	struct FSubscriber
+	{
+		uint32 ID = 0;
+		FWeakObjectPtr Owner;
+		bool bHasOwner = false;
+		// Unset once unsubscribed during a dispatch, the entry goes after it.
+		TFunction<void(const void*)> Callback;
+	};
+
+	static FGameplayEventBus Bus;
+
+	FGameplayEventHandle AddSubscriber(EGameplayEventType Type, const UObject* Owner, TFunction<void(const void*)>&& Callback);
+	void HandleBeginFrame();
+	// Adds the pending subscribers and takes out the unsubscribed ones, once no dispatch is running.
+	void FlushSubscribers();
+
+	TQueue<FQueuedEvent, EQueueMode::Mpsc> Queue;
+	TArray<FSubscriber> Subscribers[int32(EGameplayEventType::Count)];
+	// Subscribed during a dispatch, added after it so the arrays being walked don't move.
+	TArray<TPair<EGameplayEventType, FSubscriber>> PendingSubscribers;
+
+	uint32 NextSubscriberID;
+	int32 DispatchDepth;
+	bool bHasUnsubscribed;
+	bool bStarted;
+
+	FThreadSafeCounter64 NumPosted;
+	uint64 NumDispatched;
+	int32 MostInOneFrame;
+};
@@ -1,6 +1,34 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "GameplayEvents.h"
+#include "HitchMonitor.h"
+#include "StartupProfiler.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, HeavenlyBlue, "HeavenlyBlue" );
+DEFINE_LOG_CATEGORY(LogHeavenlyBlue);
+
+class FHeavenlyBlueModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		RegisterHeavenlyBlueLLMTags();
+#endif
+		FStartupProfiler::Get().Start();
+		FHitchMonitor::Get().Start();
+		// After the hitch monitor, so its frame timing starts before the events are dispatched.
+		FGameplayEventBus::Get().Start();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FGameplayEventBus::Get().Stop();
+		FHitchMonitor::Get().Stop();
+		FStartupProfiler::Get().Stop();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FHeavenlyBlueModule, HeavenlyBlue, "HeavenlyBlue" );
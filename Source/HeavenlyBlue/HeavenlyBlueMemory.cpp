@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HeavenlyBlueMemory.h"
+#include "HeavenlyBlue.h"
+#include "AConversationInstance.h"
+#include "AInfoBox.h"
+#include "APlayableSprite.h"
+#include "DialogueBank.h"
+#include "DialogueLocalization.h"
+#include "DialogueStringTable.h"
+#include "Inventory.h"
+#include "ItemDatabase.h"
+#include "SubtitlePresenter.h"
+#include "VoiceEnvelope.h"
+#include "WorldStateSubsystem.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "Engine/Level.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Sound/SoundWave.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Sprites"), STAT_HBSpritesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Dialogue"), STAT_HBDialogueLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Voice"), STAT_HBVoiceLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Interactables"), STAT_HBInteractablesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Subtitles"), STAT_HBSubtitlesLLM, STATGROUP_LLMFULL);
+
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Sprites"), STAT_HBSpritesSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Dialogue"), STAT_HBDialogueSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Voice"), STAT_HBVoiceSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Interactables"), STAT_HBInteractablesSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("HB Subtitles"), STAT_HBSubtitlesSummaryLLM, STATGROUP_LLM);
+
+namespace HeavenlyBlueLLM
+{
+	struct FTagInfo
+	{
+		EHeavenlyBlueLLMTag Tag;
+		const TCHAR* Name;
+	};
+
+	// In EHeavenlyBlueLLMTag order.
+	static const FTagInfo Tags[] =
+	{
+		{ EHeavenlyBlueLLMTag::Sprites, TEXT("HBSprites") },
+		{ EHeavenlyBlueLLMTag::Dialogue, TEXT("HBDialogue") },
+		{ EHeavenlyBlueLLMTag::Voice, TEXT("HBVoice") },
+		{ EHeavenlyBlueLLMTag::Interactables, TEXT("HBInteractables") },
+		{ EHeavenlyBlueLLMTag::Subtitles, TEXT("HBSubtitles") },
+	};
+}
+
+/*
+ * Function:  RegisterHeavenlyBlueLLMTags
+ * --------------------
+ * Gives the project tags their names and stats. Without this LLM still tracks them, but only by number.
+ *
+ */
+void RegisterHeavenlyBlueLLMTags()
+{
+	const FName Stats[][2] =
+	{
+		{ GET_STATFNAME(STAT_HBSpritesLLM), GET_STATFNAME(STAT_HBSpritesSummaryLLM) },
+		{ GET_STATFNAME(STAT_HBDialogueLLM), GET_STATFNAME(STAT_HBDialogueSummaryLLM) },
+		{ GET_STATFNAME(STAT_HBVoiceLLM), GET_STATFNAME(STAT_HBVoiceSummaryLLM) },
+		{ GET_STATFNAME(STAT_HBInteractablesLLM), GET_STATFNAME(STAT_HBInteractablesSummaryLLM) },
+		{ GET_STATFNAME(STAT_HBSubtitlesLLM), GET_STATFNAME(STAT_HBSubtitlesSummaryLLM) },
+	};
+	static_assert(ARRAY_COUNT(Stats) == ARRAY_COUNT(HeavenlyBlueLLM::Tags), "Every tag needs its stats.");
+
+	for (int32 i = 0; i < ARRAY_COUNT(HeavenlyBlueLLM::Tags); i++)
+		FLowLevelMemTracker::Get().RegisterProjectTag(int32(HeavenlyBlueLLM::Tags[i].Tag), HeavenlyBlueLLM::Tags[i].Name, Stats[i][0], Stats[i][1]);
+}
+
+#endif
+
+namespace HeavenlyBlueMemory
+{
+	/*
+	 * Function:  ForEachActor
+	 * --------------------
+	 * This runs Function on every actor of a class in the world's loaded levels. A map loaded by a
+	 * commandlet is never initialized and has no level list, its persistent level is all there is.
+	 */
+	template<typename ActorType, typename FunctionType>
+	void ForEachActor(UWorld* World, FunctionType Function)
+	{
+		TArray<ULevel*> Levels = World->GetLevels();
+		if (Levels.Num() == 0 && World->PersistentLevel != nullptr)
+			Levels.Add(World->PersistentLevel);
+
+		for (ULevel* Level : Levels)
+		{
+			if (Level == nullptr)
+				continue;
+
+			for (AActor* Actor : Level->Actors)
+			{
+				if (ActorType* Typed = Cast<ActorType>(Actor))
+					Function(*Typed);
+			}
+		}
+	}
+
+	int64 GetHeapBytes(UObject* Object)
+	{
+		return Object ? int64(Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive)) : 0;
+	}
+
+	FHeavenlyBlueMemoryRow MakeRow(const TCHAR* System)
+	{
+		FHeavenlyBlueMemoryRow Row;
+		Row.System = System;
+		return Row;
+	}
+}
+
+bool FHeavenlyBlueMemoryReport::AddAsset(FHeavenlyBlueMemoryRow& Row, UObject* Asset)
+{
+	if (Asset == nullptr)
+		return false;
+
+	bool bAlreadyCounted = false;
+	CountedAssets.Add(Asset, &bAlreadyCounted);
+	if (bAlreadyCounted)
+		return false;
+
+	// With every mip and chunk loaded, so the number doesn't depend on what streaming happened to do (or, headless, never did).
+	Row.AssetBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+	return true;
+}
+
+/*
+ * Function:  Gather
+ * --------------------
+ * 1) Sprites: the actors' own arrays, and every flipbook, sprite and texture they can show.
+ * 2) Dialogue: each conversation's nodes and scripts, the voices its lines play, and the shared string table,
+ *    localization tables and dialogue bank.
+ * 3) Info boxes, the world state and the subtitle cache.
+ *
+ * World: The world to measure. Assets are only counted once, by the first system that uses them.
+ *
+ */
+void FHeavenlyBlueMemoryReport::Gather(UWorld* World)
+{
+	using namespace HeavenlyBlueMemory;
+
+	Rows.Reset();
+	CountedAssets.Reset();
+	TrackedTags.Reset();
+	if (World == nullptr)
+		return;
+
+	FHeavenlyBlueMemoryRow Sprites = MakeRow(TEXT("Sprites"));
+	ForEachActor<AAPlayableSprite>(World, [this, &Sprites](AAPlayableSprite& Sprite)
+	{
+		Sprites.Count++;
+		Sprites.HeapBytes += GetHeapBytes(&Sprite);
+
+		for (const FMainSpriteDetails& Details : Sprite.SpriteDetails)
+		{
+			UPaperFlipbook* Flipbook = Details.PFB_Animation;
+			if (Flipbook == nullptr)
+				continue;
+
+			AddAsset(Sprites, Flipbook);
+			for (int32 i = 0; i < Flipbook->GetNumKeyFrames(); i++)
+			{
+				UPaperSprite* Frame = Flipbook->GetKeyFrameChecked(i).Sprite;
+				AddAsset(Sprites, Frame);
+				if (Frame != nullptr)
+					AddAsset(Sprites, Frame->GetBakedTexture());
+			}
+		}
+	});
+	Rows.Add(Sprites);
+
+	FHeavenlyBlueMemoryRow Conversations = MakeRow(TEXT("Conversations"));
+	FHeavenlyBlueMemoryRow Voice = MakeRow(TEXT("Voice"));
+	ForEachActor<AAConversationInstance>(World, [this, &Conversations, &Voice](AAConversationInstance& Conversation)
+	{
+		Conversations.Count++;
+		Conversations.HeapBytes += GetHeapBytes(&Conversation);
+
+		for (const FConversationNode& Node : Conversation.ConversationList)
+		{
+			for (const FDialogueNode& Dialogue : Node.DialougeNodes)
+			{
+				for (const FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+				{
+					if (AddAsset(Voice, Subtitle.SubtitleSound))
+						Voice.Count++;
+				}
+			}
+		}
+	});
+	Rows.Add(Conversations);
+	Rows.Add(Voice);
+
+	FHeavenlyBlueMemoryRow Strings = MakeRow(TEXT("Dialogue strings"));
+	Strings.Count = FDialogueStringTable::Get().Num() - 1;
+	Strings.HeapBytes = FDialogueStringTable::Get().GetAllocatedSize();
+	Rows.Add(Strings);
+
+	FHeavenlyBlueMemoryRow Localization = MakeRow(TEXT("Localization"));
+	Localization.Count = FDialogueLocalization::Get().GetNumLoadedTables();
+	Localization.HeapBytes = FDialogueLocalization::Get().GetResidentSize();
+	Rows.Add(Localization);
+
+	// The bank is mapped, the pages of conversations that were decoded are the part really resident.
+	// The whole file is reported since that's what a platform without mapping loads.
+	FHeavenlyBlueMemoryRow Bank = MakeRow(TEXT("Dialogue bank"));
+	Bank.Count = FDialogueBank::Get().GetNumConversations();
+	Bank.AssetBytes = FDialogueBank::Get().GetFileSize();
+	Rows.Add(Bank);
+
+	FHeavenlyBlueMemoryRow Envelopes = MakeRow(TEXT("Voice envelopes"));
+	Envelopes.Count = FVoiceEnvelopeTable::Get().Num();
+	Envelopes.HeapBytes = FVoiceEnvelopeTable::Get().GetAllocatedSize();
+	Rows.Add(Envelopes);
+
+	FHeavenlyBlueMemoryRow InfoBoxes = MakeRow(TEXT("Info boxes"));
+	ForEachActor<AAInfoBox>(World, [&InfoBoxes](AAInfoBox& InfoBox)
+	{
+		InfoBoxes.Count++;
+		InfoBoxes.HeapBytes += GetHeapBytes(&InfoBox);
+	});
+	Rows.Add(InfoBoxes);
+
+	FHeavenlyBlueMemoryRow Items = MakeRow(TEXT("Items"));
+	Items.Count = FItemDatabase::Get().Num();
+	Items.HeapBytes = FItemDatabase::Get().GetAllocatedSize();
+	Rows.Add(Items);
+
+	// Subsystems only exist in a running game.
+	if (UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(World))
+	{
+		FHeavenlyBlueMemoryRow Row = MakeRow(TEXT("World state"));
+		Row.Count = 1;
+		Row.HeapBytes = GetHeapBytes(WorldState);
+		Rows.Add(Row);
+	}
+
+	if (UInventorySubsystem* InventorySubsystem = UInventorySubsystem::Get(World))
+	{
+		FHeavenlyBlueMemoryRow Row = MakeRow(TEXT("Inventory"));
+		Row.Count = InventorySubsystem->GetInventory().Num();
+		Row.HeapBytes = GetHeapBytes(InventorySubsystem);
+		Rows.Add(Row);
+	}
+
+	if (USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(World))
+	{
+		FHeavenlyBlueMemoryRow Row = MakeRow(TEXT("Subtitles"));
+		Row.Count = 1;
+		Row.HeapBytes = GetHeapBytes(Subtitles);
+		Rows.Add(Row);
+	}
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (FLowLevelMemTracker::IsEnabled())
+	{
+		for (const HeavenlyBlueLLM::FTagInfo& Tag : HeavenlyBlueLLM::Tags)
+			TrackedTags.Emplace(Tag.Name, FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, ELLMTag(Tag.Tag)));
+	}
+#endif
+}
+
+int64 FHeavenlyBlueMemoryReport::GetTotalBytes() const
+{
+	int64 Total = 0;
+	for (const FHeavenlyBlueMemoryRow& Row : Rows)
+		Total += Row.GetTotalBytes();
+	return Total;
+}
+
+void FHeavenlyBlueMemoryReport::Log() const
+{
+	int64 AssetBytes = 0, HeapBytes = 0;
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("%-18s %6s %12s %12s"), TEXT("System"), TEXT("Count"), TEXT("Asset KB"), TEXT("Heap KB"));
+	for (const FHeavenlyBlueMemoryRow& Row : Rows)
+	{
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%-18s %6d %12.1f %12.1f"), *Row.System, Row.Count, Row.AssetBytes / 1024.0, Row.HeapBytes / 1024.0);
+		AssetBytes += Row.AssetBytes;
+		HeapBytes += Row.HeapBytes;
+	}
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("%-18s %6s %12.1f %12.1f  (%.1f KB)"), TEXT("Total"), TEXT(""), AssetBytes / 1024.0, HeapBytes / 1024.0, (AssetBytes + HeapBytes) / 1024.0);
+
+	for (const TPair<FString, int64>& Tag : TrackedTags)
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("LLM %-14s %12.1f KB"), *Tag.Key, Tag.Value / 1024.0);
+}
+
+bool FHeavenlyBlueMemoryReport::SaveCSV(const FString& Filename) const
+{
+	TArray<FString> Lines;
+	Lines.Add(TEXT("System,Count,AssetBytes,HeapBytes,TotalBytes"));
+	for (const FHeavenlyBlueMemoryRow& Row : Rows)
+		Lines.Add(FString::Printf(TEXT("%s,%d,%lld,%lld,%lld"), *Row.System, Row.Count, Row.AssetBytes, Row.HeapBytes, Row.GetTotalBytes()));
+	Lines.Add(FString::Printf(TEXT("Total,,,,%lld"), GetTotalBytes()));
+
+	if (TrackedTags.Num() > 0)
+	{
+		Lines.Add(TEXT(""));
+		Lines.Add(TEXT("LLMTag,Bytes"));
+		for (const TPair<FString, int64>& Tag : TrackedTags)
+			Lines.Add(FString::Printf(TEXT("%s,%lld"), *Tag.Key, Tag.Value));
+	}
+
+	return FFileHelper::SaveStringArrayToFile(Lines, *Filename);
+}
+
+FString FHeavenlyBlueMemoryReport::GetDefaultFilename(const FString& MapName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Memory") / UWorld::RemovePIEPrefix(MapName) + TEXT(".csv");
+}
+
+/*
+ * Console Command:  HB.Memory.Report [csv]
+ * --------------------
+ * Logs what the game's systems use in the current level, and writes Saved/Memory/<Map>.csv with csv.
+ * Start with -llm to also get the totals of the LLM tags. UMemoryReportCommandlet does the same headless.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GMemoryReportCommand(
+	TEXT("HB.Memory.Report"),
+	TEXT("Logs the memory of the sprites, dialogue, voices and interactables in the level. Usage: HB.Memory.Report [csv]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr)
+			return;
+
+		FHeavenlyBlueMemoryReport Report;
+		Report.Gather(World);
+		Report.Log();
+
+		if (Args.Num() > 0 && Args[0].Equals(TEXT("csv"), ESearchCase::IgnoreCase))
+		{
+			const FString Filename = FHeavenlyBlueMemoryReport::GetDefaultFilename(World->GetMapName());
+			if (Report.SaveCSV(Filename))
+				UE_LOG(LogHeavenlyBlue, Display, TEXT("Memory report written to %s."), *Filename);
+		}
+	})
+);
@@ -0,0 +1,100 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : HeavenlyBlueMemory
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This declares the game's Low-Level Memory tracker tags and the
+*				   memory report. The report splits each system into the assets it
+*				   keeps resident (textures, sound waves, the mapped dialogue bank)
+*				   and the heap its own code allocated, so it can be compared
+*				   against a budget per level.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+class UWorld;
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+/*
+ * Enumeration:  EHeavenlyBlueLLMTag
+ * --------------------
+ * Project tags, they show up in "stat LLM", "stat LLMFULL" and -llmcsv captures next to the engine's own.
+ * Run with -llm to track them.
+ */
+enum class EHeavenlyBlueLLMTag : uint8
+{
+	Sprites = uint8(ELLMTag::ProjectTagStart),
+	Dialogue,
+	Voice,
+	Interactables,
+	Subtitles,
+
+	Count
+};
+
+// Names the tags, has to happen before the first allocation under one of them (see FHeavenlyBlueModule).
+void RegisterHeavenlyBlueLLMTags();
+
+#define HB_LLM_SCOPE(Tag) LLM_SCOPE(ELLMTag(EHeavenlyBlueLLMTag::Tag))
+
+#else
+
+#define HB_LLM_SCOPE(Tag)
+
+#endif
+
+/*
+ * Struct:  FHeavenlyBlueMemoryRow
+ * --------------------
+ * One system in the report. Assets shared by several systems are only counted by the first that reaches them.
+ */
+struct FHeavenlyBlueMemoryRow
+{
+	FString System;
+	int32 Count = 0;
+	// Resident size of the assets the system holds on to.
+	int64 AssetBytes = 0;
+	// Memory the system allocated itself: nodes, strings, tables, caches.
+	int64 HeapBytes = 0;
+
+	int64 GetTotalBytes() const { return AssetBytes + HeapBytes; }
+};
+
+class HEAVENLYBLUE_API FHeavenlyBlueMemoryReport
+{
+public:
+	// Measures the sprites, conversations and info boxes of every loaded level in the world, and the shared dialogue systems.
+	void Gather(UWorld* World);
+
+	const TArray<FHeavenlyBlueMemoryRow>& GetRows() const { return Rows; }
+	int64 GetTotalBytes() const;
+
+	void Log() const;
+	bool SaveCSV(const FString& Filename) const;
+
+	// Saved/Memory/<Map>.csv
+	static FString GetDefaultFilename(const FString& MapName);
+
+private:
+	// Adds the asset's resident size to the row, unless some row already counted it. Returns true if it was added.
+	bool AddAsset(FHeavenlyBlueMemoryRow& Row, UObject* Asset);
+
+	TArray<FHeavenlyBlueMemoryRow> Rows;
+	TSet<const UObject*> CountedAssets;
+
+	// The tag totals when LLM is running, in EHeavenlyBlueLLMTag order.
+	TArray<TPair<FString, int64>> TrackedTags;
+};
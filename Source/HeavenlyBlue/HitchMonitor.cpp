@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitchMonitor.h"
+#include "HeavenlyBlue.h"
+#include "AConversationInstance.h"
+#include "AInfoBox.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FHitchMonitor FHitchMonitor::Monitor;
+
+namespace HitchMonitoring
+{
+	const TCHAR* ConfigSection = TEXT("/Script/HeavenlyBlue.HitchMonitor");
+
+	// One line of the log: a run of the same scope.
+	struct FScopeRun
+	{
+		int32 First = 0;
+		int32 Count = 0;
+		double Ms = 0.0;
+		double MaxMs = 0.0;
+	};
+}
+
+FHitchMonitor::FHitchMonitor() :
+Mask(0),
+NextSequence(1),
+Depth(0),
+FrameFirstSequence(1),
+FrameStartCycles(0),
+NumFrames(0),
+NumHitches(0),
+MaxHitches(100),
+WorstFrameMs(0.0),
+ThresholdMs(50.0f),
+bEnabled(false)
+{}
+
+/*
+ * Function:  Start
+ * --------------------
+ * 1) Read the threshold and the size of the ring, which bounds the scopes one frame can record.
+ * 2) Allocate the ring once and watch the frames.
+ *
+ */
+void FHitchMonitor::Start()
+{
+#if HB_HITCH_MONITOR
+	bool bConfigEnabled = true;
+	GConfig->GetBool(HitchMonitoring::ConfigSection, TEXT("bEnabled"), bConfigEnabled, GGameIni);
+	if (bEnabled || !bConfigEnabled || FParse::Param(FCommandLine::Get(), TEXT("NoHitchMonitor")) || IsRunningCommandlet())
+		return;
+
+	int32 Capacity = 8192;
+	GConfig->GetFloat(HitchMonitoring::ConfigSection, TEXT("ThresholdMs"), ThresholdMs, GGameIni);
+	GConfig->GetInt(HitchMonitoring::ConfigSection, TEXT("ScopesPerFrame"), Capacity, GGameIni);
+	GConfig->GetInt(HitchMonitoring::ConfigSection, TEXT("MaxHitches"), MaxHitches, GGameIni);
+	SetThresholdMs(ThresholdMs);
+
+	const uint32 RoundedCapacity = FMath::RoundUpToPowerOfTwo(uint32(FMath::Max(Capacity, 64)));
+	Events.SetNum(RoundedCapacity);
+	Mask = RoundedCapacity - 1;
+	Filename = FPaths::ProjectLogDir() / TEXT("Hitches.log");
+
+	FCoreDelegates::OnBeginFrame.AddRaw(this, &FHitchMonitor::HandleBeginFrame);
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FHitchMonitor::HandleEndFrame);
+	bEnabled = true;
+#endif
+}
+
+void FHitchMonitor::Stop()
+{
+	if (!bEnabled)
+		return;
+
+	bEnabled = false;
+	FCoreDelegates::OnBeginFrame.RemoveAll(this);
+	FCoreDelegates::OnEndFrame.RemoveAll(this);
+}
+
+void FHitchMonitor::SetActiveConversation(const AAConversationInstance* Instance)
+{
+	ActiveConversation = Instance;
+}
+
+void FHitchMonitor::SetActiveInfoBox(const AAInfoBox* InfoBox)
+{
+	ActiveInfoBox = InfoBox;
+}
+
+void FHitchMonitor::HandleBeginFrame()
+{
+	FrameFirstSequence = NextSequence;
+	FrameStartCycles = FPlatformTime::Cycles64();
+}
+
+void FHitchMonitor::HandleEndFrame()
+{
+	if (FrameStartCycles == 0)
+		return;
+
+	const double FrameMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+	NumFrames++;
+	WorstFrameMs = FMath::Max(WorstFrameMs, FrameMs);
+
+	if (FrameMs > ThresholdMs && NumHitches < MaxHitches)
+	{
+		NumHitches++;
+		WriteHitch(FrameMs);
+	}
+}
+
+/*
+ * Function:  WriteHitch
+ * --------------------
+ * 1) Take the frame's events still in the ring, the oldest are lost if the frame had more than it holds.
+ * 2) Write them in start order, indented by depth. A run of the same scope at the same depth without
+ *    children (a tick or overlap per actor) is one line with its count, total and longest.
+ * 3) Add the time no scope covered and the active conversation and info box.
+ * Writing happens after the frame was timed, so the file isn't part of the next frame's time either.
+ *
+ */
+void FHitchMonitor::WriteHitch(double FrameMs)
+{
+	const uint32 Recorded = NextSequence - FrameFirstSequence;
+	const uint32 Kept = FMath::Min(Recorded, uint32(Events.Num()));
+	const uint32 FirstSequence = NextSequence - Kept;
+
+	FString Text;
+	Text.Reserve(4096);
+	Text += FString::Printf(TEXT("[%s] Frame %llu took %.2f ms (threshold %.1f ms), %u scopes"), *FDateTime::Now().ToString(), NumFrames, FrameMs, ThresholdMs, Recorded);
+	if (Kept < Recorded)
+		Text += FString::Printf(TEXT(", the first %u were overwritten"), Recorded - Kept);
+	Text += TEXT("\n");
+
+	double CoveredMs = 0.0;
+	HitchMonitoring::FScopeRun Run;
+	auto FlushRun = [this, &Text, &Run, FirstSequence]()
+	{
+		if (Run.Count == 0)
+			return;
+
+		const FHitchScopeEvent& Event = Events[(FirstSequence + Run.First) & Mask];
+		const double OffsetMs = FPlatformTime::ToMilliseconds64(Event.StartCycles - FrameStartCycles);
+		Text += FString::Printf(TEXT("  %9.3f ms  @%8.3f  %s%s"), Run.Ms, OffsetMs, FCString::Spc(FMath::Min(int32(Event.Depth) * 2, 64)), Event.Name);
+		if (Run.Count > 1)
+			Text += FString::Printf(TEXT(" x%d (longest %.3f ms)"), Run.Count, Run.MaxMs);
+		Text += TEXT("\n");
+		Run = HitchMonitoring::FScopeRun();
+	};
+
+	for (uint32 Index = 0; Index < Kept; Index++)
+	{
+		const FHitchScopeEvent& Event = Events[(FirstSequence + Index) & Mask];
+		// Still open at the end of the frame, or started before it.
+		if (Event.EndCycles == 0 || Event.StartCycles < FrameStartCycles)
+			continue;
+
+		const double Ms = FPlatformTime::ToMilliseconds64(Event.EndCycles - Event.StartCycles);
+		if (Event.Depth == 0)
+			CoveredMs += Ms;
+
+		const bool bNextIsChild = Index + 1 < Kept && Events[(FirstSequence + Index + 1) & Mask].Depth > Event.Depth;
+		if (Run.Count > 0)
+		{
+			const FHitchScopeEvent& RunEvent = Events[(FirstSequence + Run.First) & Mask];
+			if (RunEvent.Name != Event.Name || RunEvent.Depth != Event.Depth || bNextIsChild)
+				FlushRun();
+		}
+
+		if (Run.Count == 0)
+			Run.First = Index;
+		Run.Count++;
+		Run.Ms += Ms;
+		Run.MaxMs = FMath::Max(Run.MaxMs, Ms);
+
+		if (bNextIsChild)
+			FlushRun();
+	}
+	FlushRun();
+
+	Text += FString::Printf(TEXT("  %9.3f ms  outside the game's scopes (engine, rendering, physics, GC)\n"), FMath::Max(FrameMs - CoveredMs, 0.0));
+
+	if (const AAConversationInstance* Conversation = ActiveConversation.Get())
+	{
+		Text += FString::Printf(TEXT("  Conversation: %s, key %s, node %d.%d.%d%s\n"), *Conversation->GetName(), *Conversation->ScriptConversationKey.ToString(),
+			Conversation->CurrentConversationNodeID, Conversation->CurrentDialogueNodeID, Conversation->CurrentSubtitleNodeID,
+			Conversation->bInQuestion ? TEXT(", in a question") : TEXT(""));
+	}
+	if (const AAInfoBox* InfoBox = ActiveInfoBox.Get())
+	{
+		Text += FString::Printf(TEXT("  Info box: %s, interactable %d, item %d, phase %d\n"), *InfoBox->GetName(), InfoBox->CurrentItem.InteractableID,
+			InfoBox->CurrentItem.ItemID, int32(InfoBox->CurrentPhase));
+	}
+	Text += TEXT("\n");
+
+	FFileHelper::SaveStringToFile(Text, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+	UE_LOG(LogHeavenlyBlue, Warning, TEXT("Hitch: frame took %.2f ms, scopes written to %s."), FrameMs, *Filename);
+}
+
+/*
+ * Console Command:  HB.Hitch [ThresholdMs | bench]
+ * --------------------
+ * Logs the hitches so far or sets the threshold. With bench, times a million nested scopes to show what leaving it on costs.
+ */
+static FAutoConsoleCommand GHitchCommand(
+	TEXT("HB.Hitch"),
+	TEXT("Logs the hitch monitor's stats, sets its threshold or times its scopes. Usage: HB.Hitch [ThresholdMs | bench]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FHitchMonitor& Monitor = FHitchMonitor::Get();
+		if (!Monitor.IsEnabled())
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("The hitch monitor is off (shipping build, -NoHitchMonitor or bEnabled=False)."));
+			return;
+		}
+
+		if (Args.Num() > 0 && Args[0] == TEXT("bench"))
+		{
+			const int32 Scopes = 1000000;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Scopes / 2; Index++)
+			{
+				FHitchScope Outer(TEXT("HitchBench.Outer"));
+				FHitchScope Inner(TEXT("HitchBench.Inner"));
+			}
+			const double Seconds = FPlatformTime::Seconds() - StartTime;
+			Monitor.DiscardFrame();
+
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%d scopes in %.2f ms: %.1f ns per scope. The ring holds %d scopes per frame."),
+				Scopes, Seconds * 1000.0, Seconds * 1e9 / Scopes, Monitor.GetCapacity());
+			return;
+		}
+
+		if (Args.Num() > 0)
+			Monitor.SetThresholdMs(FCString::Atof(*Args[0]));
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%d hitches over %.1f ms in %llu frames, the worst took %.2f ms."),
+			Monitor.GetNumHitches(), Monitor.GetThresholdMs(), Monitor.GetNumFrames(), Monitor.GetWorstFrameMs());
+	})
+);
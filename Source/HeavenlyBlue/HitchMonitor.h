@@ -0,0 +1,157 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : HitchMonitor
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This times the game's own code paths every frame (ticks,
+*				   interactions, dialogue, overlaps and loads) and, when a frame
+*				   takes longer than the threshold, writes what ran in it and
+*				   which conversation and info box were active to a log.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoreGlobals.h"
+
+class AAConversationInstance;
+class AAInfoBox;
+
+// Compiled out of shipping builds, test builds keep it on (see [/Script/HeavenlyBlue.HitchMonitor] in DefaultGame.ini).
+#define HB_HITCH_MONITOR !UE_BUILD_SHIPPING
+
+/*
+ * Struct:  FHitchScopeEvent
+ * --------------------
+ * One timed scope. Events are in the order the scopes started, Depth rebuilds the tree.
+ */
+struct FHitchScopeEvent
+{
+	const TCHAR* Name = nullptr;
+	uint64 StartCycles = 0;
+	uint64 EndCycles = 0;
+	// Which event of the ring this is, so a scope that outlived its slot doesn't write into another one.
+	uint32 Sequence = 0;
+	uint32 Depth = 0;
+};
+
+/*
+ * Class:  FHitchMonitor
+ * --------------------
+ * Scopes go into a fixed ring of events on the game thread, a scope costs two cycle counter reads and
+ * no allocation. At the end of a frame longer than the threshold the frame's events are written to
+ * Saved/Logs/Hitches.log as a tree, merging runs of the same scope (e.g. every info box's overlap).
+ */
+class HEAVENLYBLUE_API FHitchMonitor
+{
+public:
+	static FHitchMonitor& Get() { return Monitor; }
+
+	// Called by the game module.
+	void Start();
+	void Stop();
+	bool IsEnabled() const { return bEnabled; }
+
+	// Returns the sequence of the event to pass to EndScope, 0 if nothing is recorded.
+	uint32 BeginScope(const TCHAR* Name)
+	{
+		if (!bEnabled || !IsInGameThread())
+			return 0;
+
+		uint32 Sequence = NextSequence++;
+		if (Sequence == 0)
+			Sequence = NextSequence++;
+
+		FHitchScopeEvent& Event = Events[Sequence & Mask];
+		Event.Name = Name;
+		Event.Sequence = Sequence;
+		Event.Depth = Depth++;
+		Event.EndCycles = 0;
+		Event.StartCycles = FPlatformTime::Cycles64();
+		return Sequence;
+	}
+
+	void EndScope(uint32 Sequence)
+	{
+		if (Sequence == 0)
+			return;
+
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+		Depth--;
+		FHitchScopeEvent& Event = Events[Sequence & Mask];
+		if (Event.Sequence == Sequence)
+			Event.EndCycles = EndCycles;
+	}
+
+	// What the player is talking to or reading, written with a hitch.
+	void SetActiveConversation(const AAConversationInstance* Instance);
+	void SetActiveInfoBox(const AAInfoBox* InfoBox);
+
+	// Drops the frame's scopes so far and starts timing it again, e.g. after a benchmark.
+	void DiscardFrame() { HandleBeginFrame(); }
+
+	float GetThresholdMs() const { return ThresholdMs; }
+	void SetThresholdMs(float InThresholdMs) { ThresholdMs = FMath::Max(InThresholdMs, 1.0f); }
+
+	int32 GetNumHitches() const { return NumHitches; }
+	uint64 GetNumFrames() const { return NumFrames; }
+	double GetWorstFrameMs() const { return WorstFrameMs; }
+	int32 GetCapacity() const { return Events.Num(); }
+
+private:
+	FHitchMonitor();
+
+	void HandleBeginFrame();
+	void HandleEndFrame();
+	// Appends the frame's scope tree and the active conversation and info box to the hitch log.
+	void WriteHitch(double FrameMs);
+
+	static FHitchMonitor Monitor;
+
+	TArray<FHitchScopeEvent> Events;
+	uint32 Mask;
+	// 0 is never used, it means a scope wasn't recorded.
+	uint32 NextSequence;
+	uint32 Depth;
+
+	uint32 FrameFirstSequence;
+	uint64 FrameStartCycles;
+	uint64 NumFrames;
+	int32 NumHitches;
+	int32 MaxHitches;
+	double WorstFrameMs;
+	float ThresholdMs;
+	bool bEnabled;
+
+	TWeakObjectPtr<const AAConversationInstance> ActiveConversation;
+	TWeakObjectPtr<const AAInfoBox> ActiveInfoBox;
+	FString Filename;
+};
+
+/*
+ * Struct:  FHitchScope
+ * --------------------
+ * Times its lifetime. Name has to outlive the frame, use a literal.
+ */
+struct FHitchScope
+{
+	explicit FHitchScope(const TCHAR* Name) : Sequence(FHitchMonitor::Get().BeginScope(Name)) {}
+	~FHitchScope() { FHitchMonitor::Get().EndScope(Sequence); }
+
+	uint32 Sequence;
+};
+
+#if HB_HITCH_MONITOR
+#define HB_HITCH_SCOPE(Name) FHitchScope ANONYMOUS_VARIABLE(HitchScope)(TEXT(Name))
+#else
+#define HB_HITCH_SCOPE(Name)
+#endif
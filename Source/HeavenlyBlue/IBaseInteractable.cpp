@@ -2,6 +2,9 @@
 
 
 #include "IBaseInteractable.h"
+#include "GameplayEvents.h"
+#include "ItemDatabase.h"
+#include "ProgressSaveSubsystem.h"
 
 /*
  * Function:  IIBaseInteractable
@@ -10,8 +13,10 @@
  *
  */
 IIBaseInteractable::IIBaseInteractable() :
-bProceed(false),
-CurrentPhase(EInteractablePhase::SD_NO_OVERLAP)
+CurrentPhase(EInteractablePhase::SD_NO_OVERLAP),
+InputIndex(0),
+bFinished(false),
+bProceed(false)
 {}
 
 /*
@@ -20,7 +25,7 @@ CurrentPhase(EInteractablePhase::SD_NO_OVERLAP)
  * This changes the behavior of the object after a traversal
  *
  */
-void IIBaseInteractable::Refresh(FInteractableInfo InteractableItem)
+void IIBaseInteractable::Refresh(const FItemDefinition& InteractableItem)
 {
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Interact called");
 	switch (CurrentPhase)
@@ -41,7 +46,7 @@ void IIBaseInteractable::Refresh(FInteractableInfo InteractableItem)
 
 		case EInteractablePhase::SD_ACTIVE:
 		{
-			if (InteractableItem.bHasQuestion)
+			if (FInteractableHandlers::Get(InteractableItem.Type).HasQuestion(*this, InteractableItem))
 				CurrentPhase = EInteractablePhase::SD_QUESTION;
 			else
 				CurrentPhase = EInteractablePhase::SD_EXIT;
@@ -58,6 +63,8 @@ void IIBaseInteractable::Refresh(FInteractableInfo InteractableItem)
 		case EInteractablePhase::SD_EXIT:
 		{
 			bProceed = false;
+			if (!bFinished)
+				FGameplayEventBus::Get().Post(FInteractableFinishedEvent{ Cast<AActor>(_getUObject()) });
 			bFinished = true;
 			break;
 		}
@@ -70,16 +77,16 @@ void IIBaseInteractable::Refresh(FInteractableInfo InteractableItem)
  * This creates these are the results of the names and descriptions.
  *
  */
-void IIBaseInteractable::PrintInteractableName(FInteractableInfo InteractableItem)
+void IIBaseInteractable::PrintInteractableName(const FItemDefinition& InteractableItem)
 {
 	if (CurrentPhase == EInteractablePhase::SD_OVERLAP)
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Item Name: " + InteractableItem.ItemName);
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Item Name: " + InteractableItem.GetName());
 }
 
-void IIBaseInteractable::PrintInteractableDescription(FInteractableInfo InteractableItem)
+void IIBaseInteractable::PrintInteractableDescription(const FItemDefinition& InteractableItem)
 {
 	if (CurrentPhase == EInteractablePhase::SD_ACTIVE)
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Item Description: " + InteractableItem.ItemDescription);
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Item Description: " + InteractableItem.GetDescription());
 }
 
 /*
@@ -88,10 +95,10 @@ void IIBaseInteractable::PrintInteractableDescription(FInteractableInfo Interact
  * This controls the behavior of the states.
  *
  */
-void IIBaseInteractable::Traverse(FInteractableInfo InteractableItem)
+void IIBaseInteractable::Traverse(const FItemDefinition& InteractableItem)
 {
 	PrintInteractableDescription(InteractableItem);
-	if (InteractableItem.bHasQuestion && bProceed)
+	if (bProceed && FInteractableHandlers::Get(InteractableItem.Type).HasQuestion(*this, InteractableItem))
 	{
 		HandleQuestion(InteractableItem);
 	}
@@ -104,34 +111,19 @@ void IIBaseInteractable::Traverse(FInteractableInfo InteractableItem)
 /*
  * Function: QUESTIONS
  * --------------------
- * This creates the base behavior of the questions
+ * The item's handler shows the answers and runs the one picked.
  *
  */
-void IIBaseInteractable::HandleQuestion(FInteractableInfo InteractableItem)
+void IIBaseInteractable::HandleQuestion(const FItemDefinition& InteractableItem)
 {
 	CurrentPhase = EInteractablePhase::SD_QUESTION;
 
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "1. B");
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "2. N");
+	const IInteractableTypeHandler& Handler = FInteractableHandlers::Get(InteractableItem.Type);
+	Handler.AskQuestion(*this, InteractableItem);
 
-	if (InteractableItem.bHasQuestion && CurrentPhase == EInteractablePhase::SD_QUESTION)
-	{
-		if (InputIndex == 1)
-		{
-			TrueCondition();
-			bProceed = false;
-		}
-		else if (InputIndex == 2)
-		{
-			FalseCondition();
-			bProceed = false;
-		}
-		else
-		{
-			InputIndex = 0;
-			bProceed = false;
-		}
-	}
+	if (!Handler.Answer(*this, InteractableItem, InputIndex))
+		InputIndex = 0;
+	bProceed = false;
 }
 
 void IIBaseInteractable::TrueCondition()
@@ -145,3 +137,78 @@ void IIBaseInteractable::FalseCondition()
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "False");
 	CurrentPhase = EInteractablePhase::SD_EXIT;
 }
+
+/*
+ * Function:  IInteractableTypeHandler
+ * --------------------
+ * Info items ask a yes or no question, answered by the item's true and false actions.
+ *
+ */
+bool IInteractableTypeHandler::HasQuestion(const IIBaseInteractable& Interactable, const FItemDefinition& Item) const
+{
+	return Item.bHasQuestion && Interactable.IsQuestionAvailable(Item);
+}
+
+void IInteractableTypeHandler::AskQuestion(const IIBaseInteractable& Interactable, const FItemDefinition& Item) const
+{
+	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "1. B");
+	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "2. N");
+}
+
+bool IInteractableTypeHandler::Answer(IIBaseInteractable& Interactable, const FItemDefinition& Item, int32 Answer) const
+{
+	switch (Answer)
+	{
+		case 1:		Interactable.TrueCondition(); return true;
+		case 2:		Interactable.FalseCondition(); return true;
+		default:	return false;
+	}
+}
+
+namespace InteractableHandlers
+{
+	// Save points write the progress once the player is done reading them.
+	class FSaveHandler : public IInteractableTypeHandler
+	{
+	public:
+		virtual void Finish(IIBaseInteractable& Interactable, const FItemDefinition& Item, UObject* WorldContextObject) const override
+		{
+			if (UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(WorldContextObject))
+				SaveSubsystem->Save();
+		}
+	};
+
+	const int32 NumTypes = 256;
+}
+
+/*
+ * Function:  FInteractableHandlers
+ * --------------------
+ * The table has a slot for every value of the enum's byte, so the lookup is an index.
+ *
+ */
+TUniquePtr<IInteractableTypeHandler>* FInteractableHandlers::GetTable()
+{
+	static TUniquePtr<IInteractableTypeHandler> Table[InteractableHandlers::NumTypes];
+	static bool bInitialized = false;
+	if (!bInitialized)
+	{
+		bInitialized = true;
+		Table[uint8(EInteractableType::SD_Info)] = MakeUnique<IInteractableTypeHandler>();
+		Table[uint8(EInteractableType::SD_Save)] = MakeUnique<InteractableHandlers::FSaveHandler>();
+	}
+	return Table;
+}
+
+const IInteractableTypeHandler& FInteractableHandlers::Get(EInteractableType Type)
+{
+	TUniquePtr<IInteractableTypeHandler>* Table = GetTable();
+	const IInteractableTypeHandler* Handler = Table[uint8(Type)].Get();
+	return Handler ? *Handler : *Table[uint8(EInteractableType::SD_Info)];
+}
+
+void FInteractableHandlers::Register(EInteractableType Type, TUniquePtr<IInteractableTypeHandler>&& Handler)
+{
+	check(Handler.IsValid());
+	GetTable()[uint8(Type)] = MoveTemp(Handler);
+}
@@ -52,12 +52,14 @@ enum class EInteractableType : uint8
 {
 	SD_Save 	UMETA(DisplayName = "Save"),
 	SD_Info 	UMETA(DisplayName = "Info"),
+	SD_Pickup 	UMETA(DisplayName = "Pickup"),
 };
 
 /*
  * Struct:  FInteractableInfo
  * --------------------
- * These set the properties for a single item in the game.
+ * These set the properties for a single item in the game. The item itself is looked up by ItemID in the
+ * item database (see FItemDatabase), the rest is only used for an item the item table doesn't have.
  */
 USTRUCT(BlueprintType)
 struct FInteractableInfo
@@ -73,20 +75,74 @@ struct FInteractableInfo
 	int32 ItemID;
 
 	// This is the name of the item.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
 	FString ItemName;
 
 	// This is the description of the item.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
 	FString ItemDescription;
 
 	// This detials the specific version of an items
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
 	EInteractableType ItemType;
 	
 	// After the interaction has finished, it checks for a question
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
 	bool bHasQuestion;
+
+	// The question is only asked while this is true. Empty is always true (see FWorldStateScript for the syntax).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
+	FString Condition;
+
+	// Run for each answer to the question, e.g. "Read_Sign = true" or "give(Key)".
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
+	FString TrueAction;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Interactable Properties|Not In Item Table")
+	FString FalseAction;
+};
+
+struct FItemDefinition;
+class IIBaseInteractable;
+
+/*
+ * Class:  IInteractableTypeHandler
+ * --------------------
+ * What an item of one EInteractableType does during its interaction. A new type adds its value to
+ * EInteractableType and registers a handler with FInteractableHandlers, the interaction doesn't change.
+ */
+class HEAVENLYBLUE_API IInteractableTypeHandler
+{
+public:
+	virtual ~IInteractableTypeHandler() {}
+
+	// Whether the question is asked once the description has been read.
+	virtual bool HasQuestion(const IIBaseInteractable& Interactable, const FItemDefinition& Item) const;
+
+	// Shows the question's answers, InputIndex picks one of them (1 is the first).
+	virtual void AskQuestion(const IIBaseInteractable& Interactable, const FItemDefinition& Item) const;
+
+	// Runs the answer picked, the question is over once it returns true.
+	virtual bool Answer(IIBaseInteractable& Interactable, const FItemDefinition& Item, int32 Answer) const;
+
+	// Once the player has finished reading the item.
+	virtual void Finish(IIBaseInteractable& Interactable, const FItemDefinition& Item, UObject* WorldContextObject) const {}
+};
+
+/*
+ * Class:  FInteractableHandlers
+ * --------------------
+ * The handler of each EInteractableType, looked up by the type's value. Types without one use the info handler.
+ */
+class HEAVENLYBLUE_API FInteractableHandlers
+{
+public:
+	static const IInteractableTypeHandler& Get(EInteractableType Type);
+
+	// Replaces the handler of a type. The handler lives as long as the game.
+	static void Register(EInteractableType Type, TUniquePtr<IInteractableTypeHandler>&& Handler);
+
+private:
+	static TUniquePtr<IInteractableTypeHandler>* GetTable();
 };
 
 // This class does not need to be modified.
@@ -104,16 +160,18 @@ class HEAVENLYBLUE_API IIBaseInteractable
 public:
 	IIBaseInteractable();
 
-	FInteractableInfo CurrentItem;
 	EInteractablePhase CurrentPhase;
 
-	virtual void PrintInteractableName(FInteractableInfo InteractableItem);
-	virtual void PrintInteractableDescription(FInteractableInfo InteractableItem);
-	virtual void Traverse(FInteractableInfo InteractableItem);
-	virtual void HandleQuestion(FInteractableInfo InteractableItem);
-	virtual void Refresh(FInteractableInfo InteractableItem);
+	// The item is read in place from the item database, nothing is copied per step.
+	virtual void PrintInteractableName(const FItemDefinition& InteractableItem);
+	virtual void PrintInteractableDescription(const FItemDefinition& InteractableItem);
+	virtual void Traverse(const FItemDefinition& InteractableItem);
+	virtual void HandleQuestion(const FItemDefinition& InteractableItem);
+	virtual void Refresh(const FItemDefinition& InteractableItem);
 	virtual void TrueCondition();
 	virtual void FalseCondition();
+	// If false, the interaction ends without asking the item's question.
+	virtual bool IsQuestionAvailable(const FItemDefinition& InteractableItem) const { return true; }
 
 	int32 InputIndex;
 	bool bFinished;
@@ -2,6 +2,8 @@
 
 
 #include "IDialogueTree.h"
+#include "GameplayEvents.h"
+#include "HeavenlyBlueMemory.h"
 #include "Engine/Engine.h"
 
 /*
@@ -11,16 +13,17 @@
  *
  */
 IIDialogueTree::IIDialogueTree() : 
-CurrentSubtitleText(""),
-CurrentSpeakerName(""),
 CurrentSubtitleTimer(0.0f),
+CurrentConversationNodeID(0),
 NextConversationNodeID(0),
 CurrentDialogueNodeID(0),
 CurrentSubtitleNodeID(0),
 CurrentLetterIteration(0),
 CurrentQuestionIteration(0),
 CurrentSubtitleVoice(nullptr),
-bProceed(true)
+bFinished(false),
+bProceed(true),
+bInQuestion(false)
 {}
 
 /*
@@ -57,9 +60,9 @@ void IIDialogueTree::SetNodeID(int32 ConversationNode, int32 DialougeNode, int32
  * This does what you think it does.
  *
  */
-int32 IIDialogueTree::GetDialougeListSize(TArray<FDialogueNode> List){return List.Num();}
+int32 IIDialogueTree::GetDialougeListSize(const TArray<FDialogueNode>& List){return List.Num();}
 
-int32 IIDialogueTree::GetSubtitlesListSize(TArray<FSubtitleNode> List){return List.Num();}
+int32 IIDialogueTree::GetSubtitlesListSize(const TArray<FSubtitleNode>& List){return List.Num();}
 
 /*
  * Function:  TraverseDialouge/TraverseSubtitle
@@ -67,7 +70,7 @@ int32 IIDialogueTree::GetSubtitlesListSize(TArray<FSubtitleNode> List){return Li
  * This goes through the entries of the dialouges and subtitles
  *
  */
-void IIDialogueTree::TraverseDialouge(TArray<FConversationNode> List)
+void IIDialogueTree::TraverseDialouge(const TArray<FConversationNode>& List)
 {
 	if (List.IsValidIndex(CurrentConversationNodeID))
 	{
@@ -80,11 +83,12 @@ void IIDialogueTree::TraverseDialouge(TArray<FConversationNode> List)
 
 }
 
-void IIDialogueTree::TraverseSubtitle(TArray<struct FDialogueNode> List)
+void IIDialogueTree::TraverseSubtitle(const TArray<struct FDialogueNode>& List)
 {
 	if (List.IsValidIndex(CurrentDialogueNodeID))
 	{
-		CurrentSpeakerName = List[CurrentDialogueNodeID].SpeakerName;
+		const FDialogueNode& Dialogue = List[CurrentDialogueNodeID];
+		CurrentSpeakerHandle = Dialogue.GetSpeakerHandle().IsEmpty() ? FDialogueStringTable::Get().Intern(Dialogue.SpeakerName) : Dialogue.GetSpeakerHandle();
 		SetSubtitleProperties(List[CurrentDialogueNodeID].SubtitlesNodes);
 		PrintSubtitle();
 	}
@@ -96,13 +100,34 @@ void IIDialogueTree::TraverseSubtitle(TArray<struct FDialogueNode> List)
  * This sets the current properties of the current subtitle to the one recieved from the new list.
  *
  */
-void IIDialogueTree::SetSubtitleProperties(TArray<struct FSubtitleNode> List)
+void IIDialogueTree::SetSubtitleProperties(const TArray<struct FSubtitleNode>& List)
 {
 	if (List.IsValidIndex(CurrentSubtitleNodeID))
 	{
-		CurrentSubtitleText = List[CurrentSubtitleNodeID].SubtitleText;
-		CurrentSubtitleTimer = List[CurrentSubtitleNodeID].SubtitleTimer;
-		CurrentSubtitleVoice = List[CurrentSubtitleNodeID].SubtitleSound;
+		const FSubtitleNode& Subtitle = List[CurrentSubtitleNodeID];
+		CurrentSubtitleHandle = Subtitle.GetTextHandle().IsEmpty() ? FDialogueStringTable::Get().Intern(Subtitle.SubtitleText) : Subtitle.GetTextHandle();
+		CurrentSubtitleTimer = Subtitle.SubtitleTimer;
+		CurrentSubtitleVoice = Subtitle.SubtitleSound;
+	}
+}
+
+/*
+ * Function:  RefreshCurrentStrings
+ * --------------------
+ * The current speaker and subtitle are handles, this re-reads them when the culture changes mid line.
+ *
+ */
+void IIDialogueTree::RefreshCurrentStrings(const TArray<FConversationNode>& List)
+{
+	CurrentSpeakerHandle = FDialogueStringHandle();
+	CurrentSubtitleHandle = FDialogueStringHandle();
+
+	if (List.IsValidIndex(CurrentConversationNodeID) && List[CurrentConversationNodeID].DialougeNodes.IsValidIndex(CurrentDialogueNodeID))
+	{
+		const FDialogueNode& Dialogue = List[CurrentConversationNodeID].DialougeNodes[CurrentDialogueNodeID];
+		CurrentSpeakerHandle = Dialogue.GetSpeakerHandle();
+		if (Dialogue.SubtitlesNodes.IsValidIndex(CurrentSubtitleNodeID))
+			CurrentSubtitleHandle = Dialogue.SubtitlesNodes[CurrentSubtitleNodeID].GetTextHandle();
 	}
 }
 
@@ -115,14 +140,15 @@ void IIDialogueTree::SetSubtitleProperties(TArray<struct FSubtitleNode> List)
  * SubtitleID/DialougeID: The specific subtitle used to activate the question handling.
  * 
  */
-void IIDialogueTree::HandleQuestions(TArray<struct FQuestionNode> List, int32 SubtitleID, int32 DialougeID, int32 ConversationID, int32 Input)
+void IIDialogueTree::HandleQuestions(const TArray<struct FQuestionNode>& List, int32 SubtitleID, int32 DialougeID, int32 ConversationID, int32 Input)
 {
 	for (int i = 0; i < List.Num(); i++)
 	{
 		if (Input == List[i].NodeID && SubtitleID == List[i].SubtitleRefrenceID && 
 			DialougeID == List[i].DialougeReferenceID && 
-			ConversationID == List[i].ConversationReferenceID)
+			ConversationID == List[i].ConversationReferenceID && IsOptionAvailable(List[i]))
 		{
+			OnOptionChosen(List[i]);
 			SetNodeID(List[i].GoToConversationNodeID, 0, 0);
 			ResetIteration();
 		}
@@ -137,7 +163,7 @@ void IIDialogueTree::HandleQuestions(TArray<struct FQuestionNode> List, int32 Su
  */
 void IIDialogueTree::PrintSubtitle()
 {
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Name: " + CurrentSpeakerName);
+	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Name: " + GetCurrentSpeakerName());
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Text: ");
 }
 
@@ -147,15 +173,16 @@ void IIDialogueTree::PrintSubtitle()
  * This prints the options for the subtitle with a question.
  *
  */
-void IIDialogueTree::PrintQuestions(TArray<struct FQuestionNode> List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode)
+void IIDialogueTree::PrintQuestions(const TArray<struct FQuestionNode>& List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode)
 {
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "");
 
 	for (int i = 0; i < List.Num(); i++)
 	{
-		if (List[i].SubtitleRefrenceID == SubtitleNode && List[i].DialougeReferenceID == DialougeNode && List[i].ConversationReferenceID == ConversationNode)
+		if (List[i].SubtitleRefrenceID == SubtitleNode && List[i].DialougeReferenceID == DialougeNode && List[i].ConversationReferenceID == ConversationNode &&
+			IsOptionAvailable(List[i]))
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, List[i].Option);
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, List[i].GetOption());
 		}
 	}
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "");
@@ -168,7 +195,7 @@ void IIDialogueTree::PrintQuestions(TArray<struct FQuestionNode> List, int32 Sub
  * 2) If the subtitle entry is maxed out, increase the dialouge entry and try again.
  * 3) If there's no more dialouge, then you're done.
  */
-void IIDialogueTree::Increment(TArray <FConversationNode> List)
+void IIDialogueTree::Increment(const TArray<FConversationNode>& List)
 {
 	
 	if (bProceed && !bInQuestion)
@@ -188,8 +215,73 @@ void IIDialogueTree::Increment(TArray <FConversationNode> List)
 			}
 			else
 			{
+				if (!bFinished)
+					FGameplayEventBus::Get().Post(FInteractableFinishedEvent{ Cast<AActor>(_getUObject()) });
 				bFinished = true;
 			}
 		}
 	}
 }
+
+/*
+ * Function:  InternStrings
+ * --------------------
+ * Every instance used to keep its own copy of each line. This hands the text to the shared string table
+ * and empties the node strings, so repeated speakers and lines are only stored once. Those strings are
+ * authoring data Blueprints can't see, everything at runtime reads the text through the handles.
+ */
+void IIDialogueTree::InternStrings(TArray<FConversationNode>& Conversations, TArray<FQuestionNode>& Questions)
+{
+	HB_LLM_SCOPE(Dialogue);
+	FDialogueStringTable& Table = FDialogueStringTable::Get();
+
+	for (FConversationNode& Conversation : Conversations)
+	{
+		for (FDialogueNode& Dialogue : Conversation.DialougeNodes)
+		{
+			if (!Dialogue.SpeakerName.IsEmpty())
+				Dialogue.SpeakerHandle = Table.Intern(MoveTemp(Dialogue.SpeakerName));
+			Dialogue.SpeakerName.Empty();
+
+			for (FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+			{
+				if (!Subtitle.SubtitleText.IsEmpty())
+					Subtitle.TextHandle = Table.Intern(MoveTemp(Subtitle.SubtitleText));
+				Subtitle.SubtitleText.Empty();
+			}
+		}
+	}
+
+	for (FQuestionNode& Question : Questions)
+	{
+		if (!Question.Option.IsEmpty())
+			Question.OptionHandle = Table.Intern(MoveTemp(Question.Option));
+		Question.Option.Empty();
+	}
+}
+
+/*
+ * Function:  GetNodesAllocatedSize
+ * --------------------
+ * Once the strings are interned only the arrays are left, before that (in the editor) every node owns its text.
+ */
+SIZE_T IIDialogueTree::GetNodesAllocatedSize(const TArray<FConversationNode>& Conversations, const TArray<FQuestionNode>& Questions)
+{
+	SIZE_T Size = Conversations.GetAllocatedSize() + Questions.GetAllocatedSize();
+
+	for (const FConversationNode& Conversation : Conversations)
+	{
+		Size += Conversation.DialougeNodes.GetAllocatedSize();
+		for (const FDialogueNode& Dialogue : Conversation.DialougeNodes)
+		{
+			Size += Dialogue.SpeakerName.GetAllocatedSize() + Dialogue.SubtitlesNodes.GetAllocatedSize();
+			for (const FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+				Size += Subtitle.SubtitleText.GetAllocatedSize();
+		}
+	}
+
+	for (const FQuestionNode& Question : Questions)
+		Size += Question.Option.GetAllocatedSize() + Question.Condition.GetAllocatedSize() + Question.Action.GetAllocatedSize();
+
+	return Size;
+}
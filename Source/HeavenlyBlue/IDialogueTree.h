@@ -21,37 +21,59 @@
 #include "CoreMinimal.h"
 #include "UObject/Interface.h"
 #include "GenericPlatform/GenericPlatformProcess.h" 
+#include "DialogueStringTable.h"
+#include "WorldStateScript.h"
 #include "IDialogueTree.generated.h"
 
 /*
  * Struct:  FQuestion
  * --------------------
  * Each node contains options (option name), and it checks if a specific dialouge and subtitle contains a question.
- * It also can set global bools to be true or false (important for quests).
+ * It also can check and set the world state (important for quests), see FWorldStateScript for the syntax.
  */
 USTRUCT(BlueprintType)
 struct FQuestionNode // Optional Forth Level
 {
 	GENERATED_USTRUCT_BODY()
 
-	// Data
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Subtitle Properties")
+	// Data, authoring only: it's moved into the string table once the conversation plays, use GetOption().
+	UPROPERTY(EditAnywhere, Category = "Subtitle Properties")
 	FString Option;
 
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 SubtitleRefrenceID;
+	int32 SubtitleRefrenceID = 0;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 DialougeReferenceID;
+	int32 DialougeReferenceID = 0;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 ConversationReferenceID;
+	int32 ConversationReferenceID = 0;
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 NodeID;
+	int32 NodeID = 0;
 
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 GoToConversationNodeID;
+	int32 GoToConversationNodeID = 0;
+
+	// The option is only offered while this is true, e.g. "has(Key) and not Door_Open". Empty is always true.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World State")
+	FString Condition;
+
+	// Run when this option is chosen, e.g. "Door_Open = true; Visits += 1".
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World State")
+	FString Action;
+
+	// Condition and Action, compiled when the conversation is loaded.
+	FWorldStateProgram ConditionProgram;
+	FWorldStateProgram ActionProgram;
+
+	// Interned copy of Option, set once the conversation is loaded (see IIDialogueTree::InternStrings).
+	FDialogueStringHandle OptionHandle;
+	// The option in the active culture, if it has one (see FDialogueLocalization).
+	FDialogueStringHandle LocalizedOptionHandle;
+
+	FDialogueStringHandle GetOptionHandle() const { return LocalizedOptionHandle.IsEmpty() ? OptionHandle : LocalizedOptionHandle; }
+	const FString& GetOption() const { return GetOptionHandle().IsEmpty() ? Option : FDialogueStringTable::ResolveText(GetOptionHandle()); }
 };
 
 
@@ -66,25 +88,32 @@ struct FSubtitleNode // Third Level
 {
 	GENERATED_USTRUCT_BODY()
 
-	// Data
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Subtitle Properties")
+	// Data, authoring only: it's moved into the string table once the conversation plays, use GetText().
+	UPROPERTY(EditAnywhere, Category = "Subtitle Properties")
 	FString SubtitleText;
 
 	// Data
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Subtitle Properties")
-	float SubtitleTimer;
+	float SubtitleTimer = 0.0f;
 
 	// Data
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Subtitle Properties")
-	bool bHasQuestion;
+	bool bHasQuestion = false;
 
 	// Data
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Subtitle Properties")
-	class USoundWave* SubtitleSound;
+	class USoundWave* SubtitleSound = nullptr;
 
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 NodeID;
+	int32 NodeID = 0;
+
+	// Interned copy of SubtitleText, and the line in the active culture.
+	FDialogueStringHandle TextHandle;
+	FDialogueStringHandle LocalizedTextHandle;
+
+	FDialogueStringHandle GetTextHandle() const { return LocalizedTextHandle.IsEmpty() ? TextHandle : LocalizedTextHandle; }
+	const FString& GetText() const { return GetTextHandle().IsEmpty() ? SubtitleText : FDialogueStringTable::ResolveText(GetTextHandle()); }
 };
 
 /*
@@ -98,19 +127,26 @@ struct FDialogueNode // Second Level
 {
 	GENERATED_USTRUCT_BODY()
 
-	// Data
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dialogue Properties")
+	// Data, authoring only: it's moved into the string table once the conversation plays, use GetSpeakerName().
+	UPROPERTY(EditAnywhere, Category = "Dialogue Properties")
 	FString SpeakerName;
 
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 NodeID;
+	int32 NodeID = 0;
 
 	// Children Nodes
 	// Note: This would be a pointer if TArray didn't already allocate the memory. 
 	// This is also why we can't check if index == nullptr.	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dialogue Properties")
 	TArray<struct FSubtitleNode> SubtitlesNodes;
+
+	// Interned copy of SpeakerName, and the name in the active culture.
+	FDialogueStringHandle SpeakerHandle;
+	FDialogueStringHandle LocalizedSpeakerHandle;
+
+	FDialogueStringHandle GetSpeakerHandle() const { return LocalizedSpeakerHandle.IsEmpty() ? SpeakerHandle : LocalizedSpeakerHandle; }
+	const FString& GetSpeakerName() const { return GetSpeakerHandle().IsEmpty() ? SpeakerName : FDialogueStringTable::ResolveText(GetSpeakerHandle()); }
 };
 
 /*
@@ -127,7 +163,7 @@ struct FConversationNode // First Level (Root)
 
 	// Node Identication
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
-	int32 NodeID;
+	int32 NodeID = 0;
 
 	// Children Nodes
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation Properties")
@@ -151,28 +187,45 @@ public:
 
 	virtual void SetNodeID(int32 convo, int32 dia, int32 sub);
 	virtual void ResetIteration();
-	virtual int32 GetDialougeListSize(TArray<struct FDialogueNode> List);
-	virtual int32 GetSubtitlesListSize(TArray<struct FSubtitleNode> List);
+	virtual int32 GetDialougeListSize(const TArray<struct FDialogueNode>& List);
+	virtual int32 GetSubtitlesListSize(const TArray<struct FSubtitleNode>& List);
 
-	virtual void TraverseDialouge(TArray <FConversationNode> List);
-	virtual void TraverseSubtitle(TArray<struct FDialogueNode> List);
-	virtual void SetSubtitleProperties(TArray<struct FSubtitleNode> List);
-	virtual void HandleQuestions(TArray<struct FQuestionNode> List, int32 SubtitleID, int32 DialougeNode, int32 ConversationNode, int32 Input);
+	virtual void TraverseDialouge(const TArray<FConversationNode>& List);
+	virtual void TraverseSubtitle(const TArray<struct FDialogueNode>& List);
+	virtual void SetSubtitleProperties(const TArray<struct FSubtitleNode>& List);
+	virtual void HandleQuestions(const TArray<struct FQuestionNode>& List, int32 SubtitleID, int32 DialougeNode, int32 ConversationNode, int32 Input);
+
+	// Called by HandleQuestions with the option the player picked, before jumping to its conversation.
+	virtual void OnOptionChosen(const FQuestionNode& Option) {}
+	// Options that aren't available are neither printed nor chosen.
+	virtual bool IsOptionAvailable(const FQuestionNode& Option) const { return true; }
 
 	// Print Nodes
 	virtual void PrintSubtitle();
-	virtual void PrintQuestions(TArray<struct FQuestionNode> List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode);
+	virtual void PrintQuestions(const TArray<struct FQuestionNode>& List, int32 SubtitleNode, int32 DialougeNode, int32 ConversationNode);
 
 	// This progresses to new subtitle/dialouge
-	virtual void Increment(TArray<FConversationNode> List);
+	virtual void Increment(const TArray<FConversationNode>& List);
+
+	// Moves every speaker, subtitle and option into the shared string table, leaving only handles in the nodes.
+	static void InternStrings(TArray<FConversationNode>& Conversations, TArray<FQuestionNode>& Questions);
+
+	// The memory held by the node arrays and the strings they still own, not counting the shared string table.
+	static SIZE_T GetNodesAllocatedSize(const TArray<FConversationNode>& Conversations, const TArray<FQuestionNode>& Questions);
+
+	// Points the current speaker and subtitle at the current nodes again, after their text changed.
+	void RefreshCurrentStrings(const TArray<FConversationNode>& List);
+
+	const FString& GetCurrentSubtitleText() const { return FDialogueStringTable::ResolveText(CurrentSubtitleHandle); }
+	const FString& GetCurrentSpeakerName() const { return FDialogueStringTable::ResolveText(CurrentSpeakerHandle); }
 
 	// The base collection of root nodes
 	TArray <FConversationNode> ConversationList;
 	TArray<FQuestionNode> QuestionList;
 
 	// Refrences to current node information and IDs
-	FString CurrentSubtitleText;
-	FString CurrentSpeakerName;
+	FDialogueStringHandle CurrentSubtitleHandle;
+	FDialogueStringHandle CurrentSpeakerHandle;
 	float CurrentSubtitleTimer;
 	int32 CurrentConversationNodeID;
 	int32 NextConversationNodeID;
@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Inventory.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "ItemDatabase.h"
+#include "GameplayEvents.h"
+#include "Algo/Sort.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+/*
+ * Function:  Add
+ * --------------------
+ * 1) Add to the item's stack if there is one.
+ * 2) Otherwise append a slot, growing SlotOfItem to cover the ID.
+ *
+ */
+void FInventory::Add(int32 ItemID, int32 Count)
+{
+	if (Count < 0)
+	{
+		Remove(ItemID, FMath::Min(-Count, GetCount(ItemID)));
+		return;
+	}
+	if (Count == 0 || ItemID < 0 || ItemID > FItemDatabase::MaxItemID)
+		return;
+
+	if (ItemID >= SlotOfItem.Num())
+	{
+		const int32 OldNum = SlotOfItem.Num();
+		SlotOfItem.SetNumUninitialized(ItemID + 1);
+		for (int32 Index = OldNum; Index < SlotOfItem.Num(); Index++)
+			SlotOfItem[Index] = INDEX_NONE;
+	}
+
+	int32& Slot = SlotOfItem[ItemID];
+	if (Slot != INDEX_NONE)
+	{
+		Counts[Slot] += Count;
+		return;
+	}
+
+	HB_LLM_SCOPE(Interactables);
+	Slot = ItemIDs.Add(ItemID);
+	Counts.Add(Count);
+	Types.Add(FItemDatabase::Get().GetItem(ItemID).Type);
+	Acquired.Add(NextAcquired++);
+}
+
+bool FInventory::Remove(int32 ItemID, int32 Count)
+{
+	const int32 Slot = SlotOfItem.IsValidIndex(ItemID) ? SlotOfItem[ItemID] : INDEX_NONE;
+	if (Slot == INDEX_NONE || Counts[Slot] < Count)
+		return false;
+
+	Counts[Slot] -= Count;
+	if (Counts[Slot] > 0)
+		return true;
+
+	// The last stack takes the emptied slot.
+	const int32 Last = ItemIDs.Num() - 1;
+	SlotOfItem[ItemIDs[Last]] = Slot;
+	SlotOfItem[ItemID] = INDEX_NONE;
+
+	ItemIDs.RemoveAtSwap(Slot, 1, false);
+	Counts.RemoveAtSwap(Slot, 1, false);
+	Types.RemoveAtSwap(Slot, 1, false);
+	Acquired.RemoveAtSwap(Slot, 1, false);
+	return true;
+}
+
+void FInventory::Filter(EInteractableType Type, TArray<int32>& OutSlots) const
+{
+	OutSlots.Reset();
+	for (int32 Slot = 0; Slot < Types.Num(); Slot++)
+	{
+		if (Types[Slot] == Type)
+			OutSlots.Add(Slot);
+	}
+}
+
+void FInventory::GetAll(TArray<int32>& OutSlots) const
+{
+	OutSlots.SetNumUninitialized(ItemIDs.Num(), false);
+	for (int32 Slot = 0; Slot < OutSlots.Num(); Slot++)
+		OutSlots[Slot] = Slot;
+}
+
+/*
+ * Function:  Sort
+ * --------------------
+ * Each order compares one array only. Names are the items' text in the active culture, ties go to the lower ID
+ * so the order doesn't change from one query to the next.
+ *
+ */
+void FInventory::Sort(TArray<int32>& Slots, EInventorySort By) const
+{
+	const int32* IDs = ItemIDs.GetData();
+	switch (By)
+	{
+		case EInventorySort::ItemID:
+		{
+			Algo::Sort(Slots, [IDs](int32 A, int32 B) { return IDs[A] < IDs[B]; });
+			break;
+		}
+
+		case EInventorySort::Name:
+		{
+			const FItemDatabase& Database = FItemDatabase::Get();
+			Algo::Sort(Slots, [IDs, &Database](int32 A, int32 B)
+			{
+				const int32 Order = Database.GetItem(IDs[A]).GetName().Compare(Database.GetItem(IDs[B]).GetName(), ESearchCase::IgnoreCase);
+				return Order != 0 ? Order < 0 : IDs[A] < IDs[B];
+			});
+			break;
+		}
+
+		case EInventorySort::Count:
+		{
+			const int32* SlotCounts = Counts.GetData();
+			Algo::Sort(Slots, [IDs, SlotCounts](int32 A, int32 B)
+			{
+				return SlotCounts[A] != SlotCounts[B] ? SlotCounts[A] > SlotCounts[B] : IDs[A] < IDs[B];
+			});
+			break;
+		}
+
+		case EInventorySort::Acquired:
+		{
+			const uint32* Order = Acquired.GetData();
+			Algo::Sort(Slots, [Order](int32 A, int32 B) { return Order[A] > Order[B]; });
+			break;
+		}
+	}
+}
+
+void FInventory::Reset()
+{
+	ItemIDs.Reset();
+	Counts.Reset();
+	Types.Reset();
+	Acquired.Reset();
+	SlotOfItem.Reset();
+	NextAcquired = 0;
+}
+
+SIZE_T FInventory::GetAllocatedSize() const
+{
+	return ItemIDs.GetAllocatedSize() + Counts.GetAllocatedSize() + Types.GetAllocatedSize() + Acquired.GetAllocatedSize() + SlotOfItem.GetAllocatedSize();
+}
+
+namespace InventoryHandlers
+{
+	// Picking an item up puts it in the inventory and takes the box out of the level until it's loaded again.
+	class FPickupHandler : public IInteractableTypeHandler
+	{
+	public:
+		virtual void Finish(IIBaseInteractable& Interactable, const FItemDefinition& Item, UObject* WorldContextObject) const override
+		{
+			UInventorySubsystem* InventorySubsystem = UInventorySubsystem::Get(WorldContextObject);
+			if (InventorySubsystem == nullptr)
+				return;
+
+			// The sprite shows what was picked up when the inventory's event reaches it.
+			InventorySubsystem->AddItem(Item.ItemID, 1);
+
+			if (AActor* Actor = Cast<AActor>(Interactable._getUObject()))
+			{
+				Actor->SetActorHiddenInGame(true);
+				Actor->SetActorEnableCollision(false);
+			}
+		}
+	};
+}
+
+void UInventorySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Collection.InitializeDependency(UWorldStateSubsystem::StaticClass());
+
+	if (UWorldStateSubsystem* WorldState = GetGameInstance()->GetSubsystem<UWorldStateSubsystem>())
+		WorldState->SetItems(this);
+
+	FInteractableHandlers::Register(EInteractableType::SD_Pickup, MakeUnique<InventoryHandlers::FPickupHandler>());
+}
+
+void UInventorySubsystem::Deinitialize()
+{
+	if (UWorldStateSubsystem* WorldState = GetGameInstance()->GetSubsystem<UWorldStateSubsystem>())
+	{
+		if (WorldState->GetItems() == this)
+			WorldState->SetItems(nullptr);
+	}
+	Super::Deinitialize();
+}
+
+UInventorySubsystem* UInventorySubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UInventorySubsystem>() : nullptr;
+}
+
+int32 UInventorySubsystem::FindItemID(FName ItemName) const
+{
+	return FItemDatabase::Get().FindItemID(ItemName);
+}
+
+void UInventorySubsystem::AddItem(int32 ItemID, int32 Count)
+{
+	const int32 OldCount = Inventory.GetCount(ItemID);
+	Inventory.Add(ItemID, Count);
+
+	FInventoryChangedEvent Event;
+	Event.Inventory = this;
+	Event.ItemID = ItemID;
+	Event.Count = Inventory.GetCount(ItemID);
+	Event.Delta = Event.Count - OldCount;
+	if (Event.Delta != 0)
+		FGameplayEventBus::Get().Post(Event);
+}
+
+void UInventorySubsystem::PrintInventory()
+{
+	Inventory.GetAll(QuerySlots);
+	Inventory.Sort(QuerySlots, EInventorySort::Name);
+
+	// On screen messages stack upwards, so the first item goes last.
+	const FItemDatabase& Database = FItemDatabase::Get();
+	for (int32 Index = QuerySlots.Num() - 1; Index >= 0; Index--)
+	{
+		const int32 Slot = QuerySlots[Index];
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, FString::Printf(TEXT("%s x%d"), *Database.GetItem(Inventory.GetItemID(Slot)).GetName(), Inventory.GetSlotCount(Slot)));
+	}
+	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, Inventory.Num() > 0 ? "Inventory" : "Inventory is empty");
+}
+
+void UInventorySubsystem::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Inventory.GetAllocatedSize() + QuerySlots.GetAllocatedSize());
+}
+
+/*
+ * Console Command:  HB.Inventory [give <Item> [Count] | bench [Items=5000]]
+ * --------------------
+ * Lists the inventory, gives an item by name or ID, or times an inventory of the given size: random adds,
+ * removes and counts, then filter and sort queries into one reused array.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GInventoryCommand(
+	TEXT("HB.Inventory"),
+	TEXT("Lists the inventory, gives an item or benchmarks the inventory. Usage: HB.Inventory [give <Item> [Count] | bench [Items=5000]]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (Args.Num() > 0 && Args[0] == TEXT("bench"))
+		{
+			const int32 NumItems = FMath::Clamp(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 5000, 1, FItemDatabase::MaxItemID + 1);
+			const int32 Operations = 10000000;
+			const int32 Queries = 1000;
+
+			FInventory Bench;
+			FRandomStream Random(NumItems);
+			for (int32 ItemID = 0; ItemID < NumItems; ItemID++)
+				Bench.Add(ItemID, 1 + Random.RandHelper(99));
+
+			int64 Total = 0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Operations; Index++)
+			{
+				const int32 ItemID = Random.RandHelper(NumItems);
+				switch (Index & 3)
+				{
+					case 0:		Bench.Add(ItemID, 1); break;
+					case 1:		Bench.Remove(ItemID, 1); break;
+					default:	Total += Bench.GetCount(ItemID); break;
+				}
+			}
+			const double OperationSeconds = FPlatformTime::Seconds() - StartTime;
+
+			TArray<int32> Slots;
+			Slots.Reserve(Bench.Num());
+			const SIZE_T ReservedBytes = Slots.GetAllocatedSize();
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Queries; Index++)
+			{
+				Bench.Filter([&Bench](int32 Slot) { return Bench.GetSlotCount(Slot) > 50; }, Slots);
+				Bench.Sort(Slots, (Index & 1) ? EInventorySort::Count : EInventorySort::Acquired);
+				Total += Slots.Num();
+			}
+			const double QuerySeconds = FPlatformTime::Seconds() - StartTime;
+
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("Inventory of %d stacks (%llu bytes): %.2f ns per add/remove/count, %.1f us per filter and sort, %s (%lld)."),
+				Bench.Num(), (uint64)Bench.GetAllocatedSize(), OperationSeconds * 1e9 / Operations, QuerySeconds * 1e6 / Queries,
+				Slots.GetAllocatedSize() == ReservedBytes ? TEXT("no query allocated") : TEXT("queries allocated"), Total);
+			return;
+		}
+
+		UInventorySubsystem* InventorySubsystem = UInventorySubsystem::Get(World);
+		if (InventorySubsystem == nullptr)
+			return;
+
+		if (Args.Num() > 1 && Args[0] == TEXT("give"))
+		{
+			const int32 ItemID = Args[1].IsNumeric() ? FCString::Atoi(*Args[1]) : InventorySubsystem->FindItemID(FName(*Args[1]));
+			InventorySubsystem->AddItem(ItemID, Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 1);
+		}
+
+		const FInventory& Inventory = InventorySubsystem->GetInventory();
+		for (int32 Slot = 0; Slot < Inventory.Num(); Slot++)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%5d %-24s x%d"), Inventory.GetItemID(Slot),
+				*FItemDatabase::Get().GetItem(Inventory.GetItemID(Slot)).GetName(), Inventory.GetSlotCount(Slot));
+		}
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%d stacks."), Inventory.Num());
+	})
+);
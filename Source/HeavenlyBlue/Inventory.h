@@ -0,0 +1,134 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : Inventory
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This keeps the items the player carries. Stacks are stored
+*				   as parallel arrays so counting, filtering and sorting only
+*				   walk the fields they need, and items are found by ItemID
+*				   without a search.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "IBaseInteractable.h"
+#include "WorldStateSubsystem.h"
+#include "Inventory.generated.h"
+
+enum class EInventorySort : uint8
+{
+	ItemID,
+	Name,
+	Count,
+	// Latest first.
+	Acquired,
+};
+
+/*
+ * Class:  FInventory
+ * --------------------
+ * One stack per item. Slot i is ItemIDs[i], Counts[i], Types[i] and Acquired[i]; SlotOfItem maps an ItemID to its slot.
+ * Adding, removing and counting are O(1), removing a stack moves the last one into its slot. Queries return slots
+ * in an array the caller keeps, so they don't allocate once it has grown to the size of the inventory.
+ */
+class HEAVENLYBLUE_API FInventory
+{
+public:
+	// Adds Count of an item, or removes -Count. Removing more than there are empties the stack.
+	void Add(int32 ItemID, int32 Count);
+	// Returns false, leaving the stack alone, if there are fewer than Count.
+	bool Remove(int32 ItemID, int32 Count);
+
+	int32 GetCount(int32 ItemID) const
+	{
+		const int32 Slot = SlotOfItem.IsValidIndex(ItemID) ? SlotOfItem[ItemID] : INDEX_NONE;
+		return Slot != INDEX_NONE ? Counts[Slot] : 0;
+	}
+
+	int32 Num() const { return ItemIDs.Num(); }
+	int32 GetItemID(int32 Slot) const { return ItemIDs[Slot]; }
+	int32 GetSlotCount(int32 Slot) const { return Counts[Slot]; }
+	EInteractableType GetType(int32 Slot) const { return Types[Slot]; }
+
+	// The slots of the items of one type.
+	void Filter(EInteractableType Type, TArray<int32>& OutSlots) const;
+
+	// The slots a predicate taking the slot accepts, e.g. [&](int32 Slot) { return Inventory.GetSlotCount(Slot) > 1; }.
+	template<typename PredicateType>
+	void Filter(PredicateType&& Predicate, TArray<int32>& OutSlots) const
+	{
+		OutSlots.Reset();
+		for (int32 Slot = 0; Slot < ItemIDs.Num(); Slot++)
+		{
+			if (Predicate(Slot))
+				OutSlots.Add(Slot);
+		}
+	}
+
+	// Every slot.
+	void GetAll(TArray<int32>& OutSlots) const;
+
+	// Sorts slots returned by a query in place.
+	void Sort(TArray<int32>& Slots, EInventorySort By) const;
+
+	void Reset();
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	TArray<int32> ItemIDs;
+	TArray<int32> Counts;
+	TArray<EInteractableType> Types;
+	TArray<uint32> Acquired;
+
+	// By ItemID, INDEX_NONE for items the inventory doesn't have. Item IDs are small (see FItemDatabase).
+	TArray<int32> SlotOfItem;
+	uint32 NextAcquired = 0;
+};
+
+/*
+ * Class:  UInventorySubsystem
+ * --------------------
+ * The player's inventory. World state scripts check and change it through IWorldStateItems (has(Key), give(Key)),
+ * and info boxes of the Pickup type put their item in it.
+ */
+UCLASS()
+class HEAVENLYBLUE_API UInventorySubsystem : public UGameInstanceSubsystem, public IWorldStateItems
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	static UInventorySubsystem* Get(const UObject* WorldContextObject);
+
+	FInventory& GetInventory() { return Inventory; }
+	const FInventory& GetInventory() const { return Inventory; }
+
+	// Shows the stacks on screen, sorted by name.
+	void PrintInventory();
+
+	// IWorldStateItems
+	virtual int32 FindItemID(FName ItemName) const override;
+	virtual int32 GetItemCount(int32 ItemID) const override { return Inventory.GetCount(ItemID); }
+	// Posts an FInventoryChangedEvent when the stack changes.
+	virtual void AddItem(int32 ItemID, int32 Count) override;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+private:
+	FInventory Inventory;
+	// Kept between queries so printing doesn't allocate.
+	TArray<int32> QuerySlots;
+};
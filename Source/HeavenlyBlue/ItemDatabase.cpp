@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemDatabase.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "DialogueLocalization.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "Misc/ConfigCacheIni.h"
+
+const FItemDefinition FItemDatabase::InvalidItem;
+
+/*
+ * Function:  Get
+ * --------------------
+ * 1) Read the table named in the config, a game without one only has the items its info boxes add.
+ * 2) Keep the text in the active culture from then on, and drop the info boxes' items with their world.
+ *
+ */
+FItemDatabase& FItemDatabase::Get()
+{
+	static FItemDatabase Database;
+	static bool bLoaded = false;
+	if (!bLoaded)
+	{
+		bLoaded = true;
+
+		FString Table;
+		GConfig->GetString(TEXT("/Script/HeavenlyBlue.ItemDatabase"), TEXT("Table"), Table, GGameIni);
+		if (!Table.IsEmpty())
+		{
+			const UDataTable* DataTable = Cast<UDataTable>(FSoftObjectPath(Table).TryLoad());
+			if (DataTable == nullptr || !Database.Load(DataTable))
+				UE_LOG(LogHeavenlyBlue, Warning, TEXT("Item table %s could not be loaded."), *Table);
+		}
+
+		FDialogueLocalization::Get().OnCultureChanged().AddRaw(&Database, &FItemDatabase::Localize);
+		FWorldDelegates::OnWorldCleanup.AddRaw(&Database, &FItemDatabase::HandleWorldCleanup);
+	}
+	return Database;
+}
+
+/*
+ * Function:  Load
+ * --------------------
+ * Copies the rows out of the table, the table itself isn't kept.
+ *
+ */
+bool FItemDatabase::Load(const UDataTable* Table)
+{
+	if (Table == nullptr || Table->GetRowStruct() == nullptr || !Table->GetRowStruct()->IsChildOf(FItemRow::StaticStruct()))
+		return false;
+
+	HB_LLM_SCOPE(Interactables);
+
+	Reset();
+	FDialogueStringTable& Strings = FDialogueStringTable::Get();
+	for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+	{
+		const FItemRow& ItemRow = *reinterpret_cast<const FItemRow*>(Row.Value);
+
+		FItemDefinition Item;
+		Item.Key = Row.Key;
+		Item.ItemID = ItemRow.ItemID;
+		Item.Name = Strings.Intern(ItemRow.Name);
+		Item.Description = Strings.Intern(ItemRow.Description);
+		Item.Condition = ItemRow.Condition;
+		Item.TrueAction = ItemRow.TrueAction;
+		Item.FalseAction = ItemRow.FalseAction;
+		Item.Type = ItemRow.Type;
+		Item.bHasQuestion = ItemRow.bHasQuestion;
+
+		if (!AddItem(Item))
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: item %s has ID %d, which is out of range or already used."), *Table->GetName(), *Row.Key.ToString(), ItemRow.ItemID);
+	}
+
+	Items.Shrink();
+	return true;
+}
+
+bool FItemDatabase::AddItem(const FItemDefinition& Item)
+{
+	if (Item.ItemID < 0 || Item.ItemID > MaxItemID || Contains(Item.ItemID))
+		return false;
+
+	HB_LLM_SCOPE(Interactables);
+
+	if (Item.ItemID >= Items.Num())
+		Items.SetNum(Item.ItemID + 1);
+
+	FItemDefinition& Added = Items[Item.ItemID];
+	Added = Item;
+	FDialogueLocalization::Get().LocalizeItem(Added);
+
+	if (!Item.Key.IsNone())
+		KeyToID.Add(Item.Key, Item.ItemID);
+	NumItems++;
+	return true;
+}
+
+/*
+ * Function:  AddInlineItem
+ * --------------------
+ * 1) The table's items are never replaced by a box's.
+ * 2) The first box with an ID adds its item, the others get that one back to compare with their own.
+ *
+ */
+const FItemDefinition* FItemDatabase::AddInlineItem(const FItemDefinition& Item)
+{
+	if (IsInlineItem(Item.ItemID))
+		return &Items[Item.ItemID];
+	if (!AddItem(Item))
+		return nullptr;
+
+	InlineItemIDs.Add(Item.ItemID);
+	return &Items[Item.ItemID];
+}
+
+void FItemDatabase::RemoveInlineItems()
+{
+	for (const int32 ItemID : InlineItemIDs)
+	{
+		if (!Items[ItemID].Key.IsNone())
+			KeyToID.Remove(Items[ItemID].Key);
+		Items[ItemID] = FItemDefinition();
+		NumItems--;
+	}
+	InlineItemIDs.Reset();
+}
+
+void FItemDatabase::HandleWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	if (World != nullptr && World->IsGameWorld())
+		RemoveInlineItems();
+}
+
+int32 FItemDatabase::FindItemID(FName Key) const
+{
+	const int32* ItemID = KeyToID.Find(Key);
+	return ItemID ? *ItemID : INDEX_NONE;
+}
+
+void FItemDatabase::Localize()
+{
+	HB_LLM_SCOPE(Interactables);
+
+	FDialogueLocalization& Localization = FDialogueLocalization::Get();
+	for (FItemDefinition& Item : Items)
+	{
+		if (Item.IsValid())
+			Localization.LocalizeItem(Item);
+	}
+}
+
+SIZE_T FItemDatabase::GetAllocatedSize() const
+{
+	SIZE_T Size = Items.GetAllocatedSize() + KeyToID.GetAllocatedSize() + InlineItemIDs.GetAllocatedSize();
+	for (const FItemDefinition& Item : Items)
+		Size += Item.Condition.GetAllocatedSize() + Item.TrueAction.GetAllocatedSize() + Item.FalseAction.GetAllocatedSize();
+	return Size;
+}
+
+void FItemDatabase::Reset()
+{
+	Items.Reset();
+	KeyToID.Reset();
+	InlineItemIDs.Reset();
+	NumItems = 0;
+}
+
+/*
+ * Console Command:  HB.Items
+ * --------------------
+ * Lists the items in the active culture.
+ */
+static FAutoConsoleCommand GItemsCommand(
+	TEXT("HB.Items"),
+	TEXT("Lists the items of the item database."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		const FItemDatabase& Database = FItemDatabase::Get();
+		Database.ForEachItem([](const FItemDefinition& Item)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%5d %-16s %-8s %s"), Item.ItemID, *Item.Key.ToString(),
+				*StaticEnum<EInteractableType>()->GetNameStringByValue(int64(Item.Type)), *Item.GetName());
+		});
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%d items, %llu bytes."), Database.Num(), (uint64)Database.GetAllocatedSize());
+	})
+);
@@ -0,0 +1,148 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : ItemDatabase
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This holds every item of the game, read once from the item
+*				   DataTable into an array indexed by ItemID. Info boxes only
+*				   keep the ID of their item and look it up here.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "IBaseInteractable.h"
+#include "DialogueStringTable.h"
+#include "ItemDatabase.generated.h"
+
+/*
+ * Struct:  FItemRow
+ * --------------------
+ * One row of the item DataTable. The row name is the item's name in world state scripts, e.g. give(Key).
+ */
+USTRUCT(BlueprintType)
+struct FItemRow : public FTableRowBase
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	int32 ItemID = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	FString Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item", meta = (MultiLine = true))
+	FString Description;
+
+	// Picks the handler of the item (see FInteractableHandlers).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	EInteractableType Type = EInteractableType::SD_Info;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	bool bHasQuestion = false;
+
+	// See FInteractableInfo.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	FString Condition;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	FString TrueAction;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item")
+	FString FalseAction;
+};
+
+/*
+ * Struct:  FItemDefinition
+ * --------------------
+ * An item as the game uses it. The text is handles into the authored string table, plus the active culture's if it has them.
+ */
+struct HEAVENLYBLUE_API FItemDefinition
+{
+	FName Key;
+	FDialogueStringHandle Name;
+	FDialogueStringHandle Description;
+	FDialogueStringHandle LocalizedName;
+	FDialogueStringHandle LocalizedDescription;
+	FString Condition;
+	FString TrueAction;
+	FString FalseAction;
+	int32 ItemID = INDEX_NONE;
+	EInteractableType Type = EInteractableType::SD_Info;
+	bool bHasQuestion = false;
+
+	bool IsValid() const { return ItemID != INDEX_NONE; }
+
+	const FString& GetName() const { return FDialogueStringTable::ResolveText(LocalizedName.IsEmpty() ? Name : LocalizedName); }
+	const FString& GetDescription() const { return FDialogueStringTable::ResolveText(LocalizedDescription.IsEmpty() ? Description : LocalizedDescription); }
+};
+
+/*
+ * Class:  FItemDatabase
+ * --------------------
+ * Items by ID. IDs are small and dense, so the lookup is an array index.
+ */
+class HEAVENLYBLUE_API FItemDatabase
+{
+public:
+	// Larger IDs are refused, they would only make the array sparse.
+	static const int32 MaxItemID = 0xFFFF;
+
+	// The game's items. The first call reads the table named in [/Script/HeavenlyBlue.ItemDatabase] in DefaultGame.ini.
+	static FItemDatabase& Get();
+
+	// Replaces the items with the rows of a table of FItemRow. Returns false if it isn't one.
+	bool Load(const UDataTable* Table);
+
+	// Adds an item the table doesn't have. Returns false if the ID is out of range or already used.
+	bool AddItem(const FItemDefinition& Item);
+
+	// Adds an info box's own item under an ID the table doesn't have, so the inventory and the search know its name.
+	// Boxes sharing an ID share the first one added. Returns the item under the ID, or null if the table has it or it's out of range.
+	const FItemDefinition* AddInlineItem(const FItemDefinition& Item);
+	bool IsInlineItem(int32 ItemID) const { return InlineItemIDs.Contains(ItemID); }
+	// Inline items only last as long as the world whose boxes added them.
+	void RemoveInlineItems();
+
+	// The item, or an invalid one without text if there isn't one with this ID.
+	const FItemDefinition& GetItem(int32 ItemID) const { return Items.IsValidIndex(ItemID) ? Items[ItemID] : InvalidItem; }
+	bool Contains(int32 ItemID) const { return GetItem(ItemID).IsValid(); }
+
+	// INDEX_NONE if no item has this name.
+	int32 FindItemID(FName Key) const;
+
+	// Looks up the text of every item in the active culture.
+	void Localize();
+
+	template<typename FunctionType>
+	void ForEachItem(FunctionType&& Function) const
+	{
+		for (const FItemDefinition& Item : Items)
+		{
+			if (Item.IsValid())
+				Function(Item);
+		}
+	}
+
+	int32 Num() const { return NumItems; }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void Reset();
+	void HandleWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	TArray<FItemDefinition> Items;
+	TMap<FName, int32> KeyToID;
+	TSet<int32> InlineItemIDs;
+	int32 NumItems = 0;
+
+	static const FItemDefinition InvalidItem;
+};
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MemoryReportCommandlet.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "AConversationInstance.h"
+#include "DialogueLocalization.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+/*
+ * Function:  UMemoryReportCommandlet
+ * --------------------
+ * Maps are only loaded, never played, so no renderer or game is needed.
+ *
+ */
+UMemoryReportCommandlet::UMemoryReportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+namespace MemoryReport
+{
+	// What BeginPlay and the first approach do to a conversation, so the report shows it as it is in game.
+	void LoadConversations(ULevel& Level)
+	{
+		for (AActor* Actor : Level.Actors)
+		{
+			if (AAConversationInstance* Conversation = Cast<AAConversationInstance>(Actor))
+			{
+				AAConversationInstance::InternStrings(Conversation->ConversationList, Conversation->QuestionList);
+				Conversation->EnsureConversationLoaded();
+				Conversation->WaitForVoiceSounds();
+			}
+		}
+	}
+
+	void ReleaseConversations(ULevel& Level)
+	{
+		for (AActor* Actor : Level.Actors)
+		{
+			AAConversationInstance* Conversation = Cast<AAConversationInstance>(Actor);
+			if (Conversation && Conversation->IsConversationLoaded())
+				FDialogueLocalization::Get().ReleaseConversation(Conversation->ScriptConversationKey);
+		}
+	}
+}
+
+/*
+ * Function:  Main
+ * --------------------
+ * 1) Load a map and bring its conversations to their in game state.
+ * 2) Gather, log and save its report, and compare the total with its budget.
+ * 3) Let go of the map and the text it interned before the next one, so every map is measured on its own.
+ *
+ * Params: The command line, see the header for the switches.
+ *
+ */
+int32 UMemoryReportCommandlet::Main(const FString& Params)
+{
+	using namespace MemoryReport;
+
+	FString MapList;
+	FString OutFolder = FPaths::ProjectSavedDir() / TEXT("Memory");
+	FParse::Value(*Params, TEXT("Map="), MapList);
+	FParse::Value(*Params, TEXT("Out="), OutFolder);
+	const bool bLoad = !FParse::Param(*Params, TEXT("NoLoad"));
+
+	int32 BudgetOverrideKB = 0;
+	FParse::Value(*Params, TEXT("BudgetKB="), BudgetOverrideKB);
+
+	TArray<FString> Maps;
+	MapList.ParseIntoArray(Maps, TEXT("+"));
+	if (Maps.Num() == 0)
+	{
+		UE_LOG(LogHeavenlyBlue, Error, TEXT("No maps given. Usage: -run=MemoryReport -Map=/Game/Maps/A[+/Game/Maps/B]"));
+		return 1;
+	}
+
+	int32 Failures = 0;
+	for (const FString& Map : Maps)
+	{
+		UPackage* Package = LoadPackage(nullptr, *Map, LOAD_None);
+		UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr || World->PersistentLevel == nullptr)
+		{
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Couldn't load the map %s."), *Map);
+			Failures++;
+			continue;
+		}
+
+		if (bLoad)
+			LoadConversations(*World->PersistentLevel);
+
+		const FString MapName = FPackageName::GetShortName(Map);
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Memory report for %s:"), *MapName);
+
+		FHeavenlyBlueMemoryReport Report;
+		Report.Gather(World);
+		Report.Log();
+
+		const FString Filename = OutFolder / MapName + TEXT(".csv");
+		if (!Report.SaveCSV(Filename))
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Couldn't write %s."), *Filename);
+
+		// The budget of a map is read by its name, falling back to DefaultBudgetKB. Zero means none.
+		int32 BudgetKB = BudgetOverrideKB;
+		if (BudgetKB <= 0 && !GConfig->GetInt(TEXT("/Script/HeavenlyBlue.MemoryReport"), *MapName, BudgetKB, GGameIni))
+			GConfig->GetInt(TEXT("/Script/HeavenlyBlue.MemoryReport"), TEXT("DefaultBudgetKB"), BudgetKB, GGameIni);
+
+		const double TotalKB = Report.GetTotalBytes() / 1024.0;
+		if (BudgetKB > 0 && TotalKB > BudgetKB)
+		{
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("%s is over budget: %.1f KB of %d KB."), *MapName, TotalKB, BudgetKB);
+			Failures++;
+		}
+		else if (BudgetKB > 0)
+		{
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("%s is within budget: %.1f KB of %d KB."), *MapName, TotalKB, BudgetKB);
+		}
+
+		if (bLoad)
+			ReleaseConversations(*World->PersistentLevel);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		FDialogueStringTable::Get().Reset();
+	}
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Memory report done: %d maps, %d failed. Reports: %s"), Maps.Num(), Failures, *OutFolder);
+	return Failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : MemoryReportCommandlet
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This commandlet loads maps without running them and writes the
+*				   memory report of each (see FHeavenlyBlueMemoryReport), failing
+*				   when a map goes over its budget.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MemoryReportCommandlet.generated.h"
+
+/*
+ * Usage:
+ *   UE4Editor-Cmd HeavenlyBlue.uproject -run=MemoryReport -nullrhi [-llm]
+ *		-Map=/Game/Maps/A[+/Game/Maps/B]	The maps to measure, one after another.
+ *		[-Out=<folder>]					Where <Map>.csv is written, defaults to Saved/Memory.
+ *		[-NoLoad]						Measure the map as saved. By default every conversation is interned,
+ *										decoded and localized first, as it is once the player has met everyone.
+ *		[-BudgetKB=<N>]					Overrides the budgets in [/Script/HeavenlyBlue.MemoryReport].
+ *
+ * Returns 1 if any map is over budget or can't be loaded.
+ */
+UCLASS()
+class HEAVENLYBLUE_API UMemoryReportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMemoryReportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PaletteBakeCommandlet.h"
+#include "HeavenlyBlue.h"
+#include "PaletteQuantizer.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "Engine/Texture2D.h"
+#include "AssetRegistryModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+
+/*
+ * Function:  UPaletteBakeCommandlet
+ * --------------------
+ * The bake only touches source art, so it never needs a renderer.
+ *
+ */
+UPaletteBakeCommandlet::UPaletteBakeCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+#if WITH_EDITOR
+namespace PaletteBake
+{
+	/*
+	 * Struct:  FSourceTexture
+	 * --------------------
+	 * A texture used by at least one sprite, decoded to FColor so it can be quantized.
+	 */
+	struct FSourceTexture
+	{
+		UTexture2D* Texture = nullptr;
+		int32 Width = 0;
+		int32 Height = 0;
+		TArray<FColor> Pixels;
+		TArray<UPaperSprite*> Sprites;
+	};
+
+	bool ReadSource(UTexture2D* Texture, FSourceTexture& Out)
+	{
+		if (Texture->Source.GetFormat() != TSF_BGRA8)
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Skipping %s, source art is not BGRA8."), *Texture->GetPathName());
+			return false;
+		}
+
+		TArray<uint8> MipData;
+		if (!Texture->Source.GetMipData(MipData, 0))
+			return false;
+
+		Out.Texture = Texture;
+		Out.Width = Texture->Source.GetSizeX();
+		Out.Height = Texture->Source.GetSizeY();
+		Out.Pixels.SetNumUninitialized(Out.Width * Out.Height);
+
+		// TSF_BGRA8 has the same memory layout as FColor.
+		FMemory::Memcpy(Out.Pixels.GetData(), MipData.GetData(), FMath::Min<int64>(MipData.Num(), Out.Pixels.Num() * sizeof(FColor)));
+		return true;
+	}
+
+	// The bytes the texture occupies once its platform data is streamed in, and the bytes loaded to get there.
+	void MeasureTexture(UTexture2D* Texture, int64& OutResident, int64& OutLoad)
+	{
+		OutResident += Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+		if (FTexturePlatformData* PlatformData = Texture->PlatformData)
+		{
+			for (const FTexture2DMipMap& Mip : PlatformData->Mips)
+				OutLoad += Mip.BulkData.GetBulkDataSize();
+		}
+	}
+
+	UTexture2D* CreateTexture(const FString& PackageName, int32 Width, int32 Height, ETextureSourceFormat Format, const uint8* Data, TextureCompressionSettings Compression)
+	{
+		UPackage* Package = CreatePackage(nullptr, *PackageName);
+		UTexture2D* Texture = NewObject<UTexture2D>(Package, *FPackageName::GetShortName(PackageName), RF_Public | RF_Standalone);
+
+		// Indices and palette entries must come back exactly as written, so no filtering, mips or sRGB.
+		Texture->Source.Init(Width, Height, 1, 1, Format, Data);
+		Texture->SRGB = false;
+		Texture->CompressionSettings = Compression;
+		Texture->Filter = TF_Nearest;
+		Texture->MipGenSettings = TMGS_NoMipmaps;
+		Texture->LODGroup = TEXTUREGROUP_Pixels2D;
+		Texture->NeverStream = true;
+		Texture->PostEditChange();
+
+		Package->MarkPackageDirty();
+		return Texture;
+	}
+
+	bool SaveTexture(UTexture2D* Texture)
+	{
+		UPackage* Package = Texture->GetOutermost();
+		FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+		return UPackage::SavePackage(Package, Texture, RF_Public | RF_Standalone, *Filename);
+	}
+}
+#endif
+
+/*
+ * Function:  Main
+ * --------------------
+ * 1) Find every flipbook under the search path and group them by character folder.
+ * 2) Build one palette from every texture the character's sprites use.
+ * 3) Quantize each texture, measure the error of each sprite frame and save the results.
+ *
+ * Params: The command line, see the header for the switches.
+ *
+ */
+int32 UPaletteBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace PaletteBake;
+
+	FString SearchPath = TEXT("/Game/Characters");
+	FString OutFolder = TEXT("Palettized");
+	FString ReportPath = FPaths::ProjectSavedDir() / TEXT("Palette") / TEXT("PaletteBake.csv");
+	FParse::Value(*Params, TEXT("Path="), SearchPath);
+	FParse::Value(*Params, TEXT("Out="), OutFolder);
+	FParse::Value(*Params, TEXT("Report="), ReportPath);
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(FName(*SearchPath));
+	Filter.ClassNames.Add(UPaperFlipbook::StaticClass()->GetFName());
+	Filter.bRecursivePaths = true;
+
+	TArray<FAssetData> FlipbookAssets;
+	AssetRegistry.GetAssets(Filter, FlipbookAssets);
+
+	// The character is the first folder below the search path.
+	TMap<FString, TArray<FAssetData>> Characters;
+	for (const FAssetData& Asset : FlipbookAssets)
+	{
+		FString Relative = Asset.PackagePath.ToString().RightChop(SearchPath.Len() + 1);
+		FString Character;
+		if (!Relative.Split(TEXT("/"), &Character, nullptr))
+			Character = Relative;
+		Characters.FindOrAdd(Character).Add(Asset);
+	}
+
+	TArray<FString> Report;
+	Report.Add(TEXT("Character,Sprite,Texture,Width,Height,OpaquePixels,MSE,PSNR,MaxChannelError"));
+
+	int64 TotalOldResident = 0, TotalOldLoad = 0, TotalNewResident = 0, TotalNewLoad = 0;
+
+	for (const TPair<FString, TArray<FAssetData>>& Character : Characters)
+	{
+		// Every texture is decoded once, however many sprites point into it.
+		TMap<UTexture2D*, FSourceTexture> Sources;
+		for (const FAssetData& Asset : Character.Value)
+		{
+			UPaperFlipbook* Flipbook = Cast<UPaperFlipbook>(Asset.GetAsset());
+			if (Flipbook == nullptr)
+				continue;
+
+			for (int32 i = 0; i < Flipbook->GetNumKeyFrames(); i++)
+			{
+				UPaperSprite* Sprite = Flipbook->GetKeyFrameChecked(i).Sprite;
+				UTexture2D* Texture = Sprite ? Sprite->GetSourceTexture() : nullptr;
+				if (Texture == nullptr)
+					continue;
+
+				if (FSourceTexture* Existing = Sources.Find(Texture))
+				{
+					Existing->Sprites.AddUnique(Sprite);
+				}
+				else
+				{
+					FSourceTexture Source;
+					if (ReadSource(Texture, Source))
+					{
+						Source.Sprites.Add(Sprite);
+						Sources.Add(Texture, MoveTemp(Source));
+					}
+				}
+			}
+		}
+
+		if (Sources.Num() == 0)
+			continue;
+
+		FPaletteQuantizer Quantizer;
+		for (const TPair<UTexture2D*, FSourceTexture>& Source : Sources)
+			Quantizer.AddFrame(Source.Value.Pixels);
+		if (Quantizer.GetUniqueColorCount() == 0)
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s: %d textures without an opaque pixel, skipped."), *Character.Key, Sources.Num());
+			continue;
+		}
+		Quantizer.BuildPalette();
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%s: %d textures, %d unique colors reduced to %d."),
+			*Character.Key, Sources.Num(), Quantizer.GetUniqueColorCount(), FPaletteQuantizer::PaletteSize);
+
+		const FString OutPath = SearchPath / Character.Key / OutFolder;
+		int64 OldResident = 0, OldLoad = 0, NewResident = 0, NewLoad = 0;
+
+		UTexture2D* PaletteTexture = CreateTexture(OutPath / FString::Printf(TEXT("TP_%s_Palette"), *Character.Key),
+			FPaletteQuantizer::PaletteSize, 1, TSF_BGRA8, (const uint8*)Quantizer.GetPalette().GetData(), TC_VectorDisplacementmap);
+		MeasureTexture(PaletteTexture, NewResident, NewLoad);
+		if (bSave)
+			SaveTexture(PaletteTexture);
+
+		for (const TPair<UTexture2D*, FSourceTexture>& Source : Sources)
+		{
+			const FSourceTexture& Texture = Source.Value;
+
+			TArray<uint8> Indices;
+			Quantizer.Quantize(Texture.Pixels, Indices);
+
+			// The error is reported per frame, a frame being the region a sprite cuts out of the texture.
+			for (UPaperSprite* Sprite : Texture.Sprites)
+			{
+				const FIntPoint Origin(FMath::RoundToInt(Sprite->GetSourceUV().X), FMath::RoundToInt(Sprite->GetSourceUV().Y));
+				const FIntPoint Size(FMath::RoundToInt(Sprite->GetSourceSize().X), FMath::RoundToInt(Sprite->GetSourceSize().Y));
+
+				TArray<FColor> Frame;
+				Frame.Reserve(Size.X * Size.Y);
+				for (int32 Y = Origin.Y; Y < FMath::Min(Origin.Y + Size.Y, Texture.Height); Y++)
+				{
+					for (int32 X = Origin.X; X < FMath::Min(Origin.X + Size.X, Texture.Width); X++)
+						Frame.Add(Texture.Pixels[Y * Texture.Width + X]);
+				}
+
+				TArray<uint8> FrameIndices;
+				FPaletteFrameError Error = Quantizer.Quantize(Frame, FrameIndices);
+				Report.Add(FString::Printf(TEXT("%s,%s,%s,%d,%d,%d,%.3f,%.2f,%d"), *Character.Key, *Sprite->GetName(), *Texture.Texture->GetName(),
+					Size.X, Size.Y, Error.OpaquePixels, Error.MeanSquaredError, Error.PSNR, Error.MaxChannelError));
+			}
+
+			MeasureTexture(Texture.Texture, OldResident, OldLoad);
+
+			UTexture2D* IndexTexture = CreateTexture(OutPath / (TEXT("TI_") + Texture.Texture->GetName()),
+				Texture.Width, Texture.Height, TSF_G8, Indices.GetData(), TC_Grayscale);
+			MeasureTexture(IndexTexture, NewResident, NewLoad);
+			if (bSave)
+				SaveTexture(IndexTexture);
+		}
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%s: resident %lld -> %lld bytes, load %lld -> %lld bytes."),
+			*Character.Key, OldResident, NewResident, OldLoad, NewLoad);
+
+		TotalOldResident += OldResident;
+		TotalOldLoad += OldLoad;
+		TotalNewResident += NewResident;
+		TotalNewLoad += NewLoad;
+	}
+
+	Report.Add(TEXT(""));
+	Report.Add(TEXT("Memory,Before,After"));
+	Report.Add(FString::Printf(TEXT("ResidentBytes,%lld,%lld"), TotalOldResident, TotalNewResident));
+	Report.Add(FString::Printf(TEXT("LoadBytes,%lld,%lld"), TotalOldLoad, TotalNewLoad));
+	FFileHelper::SaveStringArrayToFile(Report, *ReportPath);
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Palette bake done: resident %lld -> %lld bytes, load %lld -> %lld bytes. Report: %s"),
+		TotalOldResident, TotalNewResident, TotalOldLoad, TotalNewLoad, *ReportPath);
+	return 0;
+#else
+	UE_LOG(LogHeavenlyBlue, Error, TEXT("The palette bake needs editor data, run it from the editor executable."));
+	return 1;
+#endif
+}
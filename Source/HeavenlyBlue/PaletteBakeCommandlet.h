@@ -0,0 +1,47 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : PaletteBakeCommandlet
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This commandlet bakes each character's sprite textures into
+*				   8-bit palette index textures that share one palette texture,
+*				   and reports the quantization error and memory savings.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PaletteBakeCommandlet.generated.h"
+
+/*
+ * Usage:
+ *   UE4Editor-Cmd HeavenlyBlue.uproject -run=PaletteBake -nullrhi
+ *		[-Path=/Game/Characters]	Every folder directly below this is treated as one character.
+ *		[-Out=Palettized]			Folder (inside each character) the baked textures are saved to.
+ *		[-Report=<file>]			CSV with the error of every frame, defaults to Saved/Palette/PaletteBake.csv.
+ *		[-NoSave]					Only measure, don't write any assets.
+ *
+ * For each character this writes TP_<Character>_Palette (256x1, BGRA8) and one TI_<Texture> (G8)
+ * per source texture. Index 0 is transparent. The sprite material rebuilds the color with
+ * a point sampled lookup: Palette.SampleLevel(PaletteSampler, float2(Index.r * (255.0 / 256.0) + (0.5 / 256.0), 0.5), 0)
+ */
+UCLASS()
+class HEAVENLYBLUE_API UPaletteBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPaletteBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PaletteQuantizer.h"
+#include "Algo/Sort.h"
+
+namespace PaletteQuantizerPrivate
+{
+	uint32 PackRGB(const FColor& Color) { return (uint32(Color.R) << 16) | (uint32(Color.G) << 8) | uint32(Color.B); }
+
+	uint8 Channel(uint32 Packed, int32 Axis) { return uint8(Packed >> (16 - Axis * 8)); }
+
+	// A box of the median cut. It owns the range [Begin, End) of the sorted color list.
+	struct FColorBox
+	{
+		int32 Begin;
+		int32 End;
+		int32 LongestAxis;
+		int32 LongestRange;
+		uint64 Weight;
+	};
+}
+
+using namespace PaletteQuantizerPrivate;
+
+/*
+ * Function:  AddFrame
+ * --------------------
+ * This adds every opaque pixel of a frame to the histogram that the palette is built from.
+ *
+ * Pixels: The frame in row order.
+ *
+ */
+void FPaletteQuantizer::AddFrame(const TArray<FColor>& Pixels)
+{
+	for (const FColor& Pixel : Pixels)
+	{
+		if (Pixel.A >= AlphaCutoff)
+			Histogram.FindOrAdd(PackRGB(Pixel))++;
+	}
+}
+
+/*
+ * Function:  BuildPalette
+ * --------------------
+ * 1) Put all unique colors in one box.
+ * 2) Split the heaviest box along its longest channel at the weighted median.
+ * 3) Repeat until there are 255 boxes (or nothing left to split), each box becomes its weighted mean color.
+ */
+void FPaletteQuantizer::BuildPalette()
+{
+	Palette.Reset(PaletteSize);
+	NearestCache.Reset();
+	Palette.Add(FColor(0, 0, 0, 0));
+
+	// Without opaque pixels there's one empty box, the palette is still filled out to PaletteSize below.
+	TArray<uint32> Colors;
+	Histogram.GenerateKeyArray(Colors);
+
+	auto MeasureBox = [this, &Colors](FColorBox& Box)
+	{
+		int32 Min[3] = { 255, 255, 255 };
+		int32 Max[3] = { 0, 0, 0 };
+		Box.Weight = 0;
+		for (int32 i = Box.Begin; i < Box.End; i++)
+		{
+			for (int32 Axis = 0; Axis < 3; Axis++)
+			{
+				Min[Axis] = FMath::Min<int32>(Min[Axis], Channel(Colors[i], Axis));
+				Max[Axis] = FMath::Max<int32>(Max[Axis], Channel(Colors[i], Axis));
+			}
+			Box.Weight += Histogram[Colors[i]];
+		}
+
+		Box.LongestAxis = 0;
+		Box.LongestRange = 0;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (Max[Axis] - Min[Axis] > Box.LongestRange)
+			{
+				Box.LongestRange = Max[Axis] - Min[Axis];
+				Box.LongestAxis = Axis;
+			}
+		}
+	};
+
+	TArray<FColorBox> Boxes;
+	Boxes.Add({ 0, Colors.Num(), 0, 0, 0 });
+	MeasureBox(Boxes[0]);
+
+	while (Boxes.Num() < PaletteSize - 1)
+	{
+		// Only boxes with more than one color and some spread can be split.
+		int32 SplitIndex = INDEX_NONE;
+		for (int32 i = 0; i < Boxes.Num(); i++)
+		{
+			if (Boxes[i].End - Boxes[i].Begin > 1 && Boxes[i].LongestRange > 0 &&
+				(SplitIndex == INDEX_NONE || Boxes[i].Weight * Boxes[i].LongestRange > Boxes[SplitIndex].Weight * Boxes[SplitIndex].LongestRange))
+			{
+				SplitIndex = i;
+			}
+		}
+
+		if (SplitIndex == INDEX_NONE)
+			break;
+
+		FColorBox Box = Boxes[SplitIndex];
+		const int32 Axis = Box.LongestAxis;
+		Algo::Sort(MakeArrayView(Colors.GetData() + Box.Begin, Box.End - Box.Begin), [Axis](uint32 A, uint32 B) { return Channel(A, Axis) < Channel(B, Axis); });
+
+		// Weighted median, but never leave either half empty.
+		uint64 Accumulated = 0;
+		int32 Median = Box.Begin + 1;
+		for (int32 i = Box.Begin; i < Box.End - 1; i++)
+		{
+			Accumulated += Histogram[Colors[i]];
+			Median = i + 1;
+			if (Accumulated * 2 >= Box.Weight)
+				break;
+		}
+
+		FColorBox Upper = { Median, Box.End, 0, 0, 0 };
+		Box.End = Median;
+		MeasureBox(Box);
+		MeasureBox(Upper);
+		Boxes[SplitIndex] = Box;
+		Boxes.Add(Upper);
+	}
+
+	for (const FColorBox& Box : Boxes)
+	{
+		uint64 Sum[3] = { 0, 0, 0 };
+		for (int32 i = Box.Begin; i < Box.End; i++)
+		{
+			uint32 Count = Histogram[Colors[i]];
+			for (int32 Axis = 0; Axis < 3; Axis++)
+				Sum[Axis] += uint64(Channel(Colors[i], Axis)) * Count;
+		}
+
+		uint64 Weight = FMath::Max<uint64>(Box.Weight, 1);
+		Palette.Add(FColor(uint8((Sum[0] + Weight / 2) / Weight), uint8((Sum[1] + Weight / 2) / Weight), uint8((Sum[2] + Weight / 2) / Weight), 255));
+	}
+
+	// Unused entries stay black so the palette texture is always PaletteSize wide.
+	while (Palette.Num() < PaletteSize)
+		Palette.Add(FColor(0, 0, 0, 255));
+}
+
+/*
+ * Function:  FindNearest
+ * --------------------
+ * This returns the opaque palette entry closest to a color. Frames share most of their colors,
+ * so the answer is cached per unique color.
+ *
+ */
+uint8 FPaletteQuantizer::FindNearest(const FColor& Color)
+{
+	const uint32 Packed = PackRGB(Color);
+	if (const uint8* Cached = NearestCache.Find(Packed))
+		return *Cached;
+
+	uint8 Best = 1;
+	int32 BestDistance = MAX_int32;
+	for (int32 i = 1; i < Palette.Num(); i++)
+	{
+		const int32 DR = int32(Color.R) - Palette[i].R;
+		const int32 DG = int32(Color.G) - Palette[i].G;
+		const int32 DB = int32(Color.B) - Palette[i].B;
+		const int32 Distance = DR * DR + DG * DG + DB * DB;
+		if (Distance < BestDistance)
+		{
+			BestDistance = Distance;
+			Best = uint8(i);
+		}
+	}
+
+	NearestCache.Add(Packed, Best);
+	return Best;
+}
+
+/*
+ * Function:  Quantize
+ * --------------------
+ * This converts a frame to palette indices and measures how far the result is from the original.
+ * Transparent pixels map to TransparentIndex and are left out of the error.
+ *
+ * Pixels: The frame in row order.
+ * OutIndices: One index per pixel.
+ *
+ */
+FPaletteFrameError FPaletteQuantizer::Quantize(const TArray<FColor>& Pixels, TArray<uint8>& OutIndices)
+{
+	check(Palette.Num() == PaletteSize);
+
+	FPaletteFrameError Error;
+	uint64 SquaredSum = 0;
+
+	OutIndices.SetNumUninitialized(Pixels.Num());
+	for (int32 i = 0; i < Pixels.Num(); i++)
+	{
+		if (Pixels[i].A < AlphaCutoff)
+		{
+			OutIndices[i] = TransparentIndex;
+			continue;
+		}
+
+		const uint8 Index = FindNearest(Pixels[i]);
+		const FColor& Result = Palette[Index];
+		OutIndices[i] = Index;
+
+		const int32 DR = FMath::Abs(int32(Pixels[i].R) - Result.R);
+		const int32 DG = FMath::Abs(int32(Pixels[i].G) - Result.G);
+		const int32 DB = FMath::Abs(int32(Pixels[i].B) - Result.B);
+		SquaredSum += DR * DR + DG * DG + DB * DB;
+		Error.MaxChannelError = FMath::Max(Error.MaxChannelError, FMath::Max3(DR, DG, DB));
+		Error.OpaquePixels++;
+	}
+
+	if (Error.OpaquePixels > 0)
+	{
+		Error.MeanSquaredError = double(SquaredSum) / (double(Error.OpaquePixels) * 3.0);
+		Error.PSNR = Error.MeanSquaredError > 0.0 ? 10.0 * FMath::LogX(10.0, (255.0 * 255.0) / Error.MeanSquaredError) : 99.0;
+	}
+	else
+	{
+		Error.PSNR = 99.0;
+	}
+
+	return Error;
+}
@@ -0,0 +1,69 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : PaletteQuantizer
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class builds a shared 256 color palette for a set of
+*				   sprite frames and converts frames into 8-bit palette indices.
+*				   It is pure CPU code so the bake can run headless.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Struct:  FPaletteFrameError
+ * --------------------
+ * This is the quantization error of a single frame, measured over the opaque pixels only.
+ */
+struct FPaletteFrameError
+{
+	double MeanSquaredError = 0.0;
+	double PSNR = 0.0;
+	int32 MaxChannelError = 0;
+	int32 OpaquePixels = 0;
+};
+
+class HEAVENLYBLUE_API FPaletteQuantizer
+{
+public:
+	// Index 0 is always fully transparent, the remaining entries are opaque colors.
+	static constexpr int32 PaletteSize = 256;
+	static constexpr uint8 TransparentIndex = 0;
+
+	// Pixels with alpha below this are treated as transparent.
+	static constexpr uint8 AlphaCutoff = 128;
+
+	// Adds every opaque pixel of a frame to the color histogram.
+	void AddFrame(const TArray<FColor>& Pixels);
+
+	// Runs median cut over the histogram. Must be called after all frames were added.
+	void BuildPalette();
+
+	// Converts a frame to palette indices. Returns the error against the original pixels.
+	FPaletteFrameError Quantize(const TArray<FColor>& Pixels, TArray<uint8>& OutIndices);
+
+	const TArray<FColor>& GetPalette() const { return Palette; }
+	int32 GetUniqueColorCount() const { return Histogram.Num(); }
+
+private:
+	uint8 FindNearest(const FColor& Color);
+
+	// Packed RGB (alpha dropped) to the number of pixels using it.
+	TMap<uint32, uint32> Histogram;
+
+	// Packed RGB to the palette index it maps to, filled lazily during Quantize.
+	TMap<uint32, uint8> NearestCache;
+
+	TArray<FColor> Palette;
+};
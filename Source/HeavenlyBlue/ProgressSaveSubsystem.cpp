@@ -0,0 +1,650 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProgressSaveSubsystem.h"
+#include "HeavenlyBlue.h"
+#include "HitchMonitor.h"
+#include "AConversationInstance.h"
+#include "AInfoBox.h"
+#include "Async/Async.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace ProgressSaveFormat
+{
+	const uint32 Magic = 0x56534248; // "HBSV"
+	const uint16 Version = 1;
+
+	enum class EFileKind : uint8
+	{
+		Snapshot,
+		Delta,
+		WorldState,
+	};
+
+	// A full snapshot replaces the deltas once there are this many of them.
+	const int32 MaxDeltas = 16;
+
+	/*
+	 * Struct:  FHeader
+	 * --------------------
+	 * Every save file starts with this, followed by NumRecords records.
+	 */
+	struct FHeader
+	{
+		uint32 Magic = ProgressSaveFormat::Magic;
+		uint16 Version = ProgressSaveFormat::Version;
+		EFileKind Kind = EFileKind::Snapshot;
+		uint32 Sequence = 0;
+		uint32 NumRecords = 0;
+		uint32 Crc = 0;
+
+		friend FArchive& operator<<(FArchive& Ar, FHeader& Header)
+		{
+			uint8 Kind = uint8(Header.Kind);
+			Ar << Header.Magic << Header.Version << Kind << Header.Sequence << Header.NumRecords << Header.Crc;
+			Header.Kind = EFileKind(Kind);
+			return Ar;
+		}
+	};
+}
+
+bool FProgressRecord::operator==(const FProgressRecord& Other) const
+{
+	return ID == Other.ID && Kind == Other.Kind && Flags == Other.Flags && Phase == Other.Phase &&
+		FMemory::Memcmp(Nodes, Other.Nodes, sizeof(Nodes)) == 0;
+}
+
+FArchive& operator<<(FArchive& Ar, FProgressRecord& Record)
+{
+	uint8 Kind = uint8(Record.Kind);
+	Ar << Record.ID << Kind << Record.Flags << Record.Phase;
+	for (uint16& Node : Record.Nodes)
+		Ar << Node;
+	Record.Kind = FProgressRecord::EKind(Kind);
+	return Ar;
+}
+
+/*
+ * Class:  FProgressSaveWriter
+ * --------------------
+ * The save on disk is a snapshot plus the deltas written after it:
+ *
+ *   Saved/SaveGames/Progress/Progress.snap			Every record, as of its sequence number.
+ *   Saved/SaveGames/Progress/Progress.<Seq>.delta	The records that changed in save <Seq>.
+ *   Saved/SaveGames/Progress/Progress.world			The world state flags and counters, rewritten when they change.
+ *
+ * Each file is written and flushed next to its final name, then the old file is moved aside to
+ * <Name>.bak and the new one into place. A move that replaces a file isn't atomic everywhere, so
+ * reading falls back to the .bak when the file itself is missing or broken; the deltas the old
+ * snapshot needs are only cleaned up once the new one is in place. Deltas older than the snapshot
+ * are ignored and cleaned up.
+ */
+class FProgressSaveWriter
+{
+public:
+	explicit FProgressSaveWriter(const FString& InDirectory) :
+	Directory(InDirectory),
+	Sequence(0),
+	NumDeltas(0),
+	bForceSnapshot(false)
+	{}
+
+	bool Read(TMap<uint64, FProgressRecord>& OutRecords, FWorldStateSnapshot& OutWorldState);
+	void Write(const TArray<FProgressRecord>& Captured, const FWorldStateSnapshot& WorldState, FProgressSaveStats& OutStats);
+
+private:
+	FString GetSnapshotFilename() const { return Directory / TEXT("Progress.snap"); }
+	FString GetWorldStateFilename() const { return Directory / TEXT("Progress.world"); }
+	FString GetDeltaFilename(uint32 InSequence) const { return Directory / FString::Printf(TEXT("Progress.%08u.delta"), InSequence); }
+	static FString GetBackupFilename(const FString& Filename) { return Filename + TEXT(".bak"); }
+
+	bool WriteFile(const FString& Filename, ProgressSaveFormat::EFileKind Kind, const TArray<FProgressRecord>& Records, int64& OutBytes) const;
+	bool WritePayload(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32 NumRecords, const TArray<uint8>& Payload, int64& OutBytes) const;
+	bool ReadFile(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32& OutSequence, TArray<FProgressRecord>& OutRecords) const;
+	bool ReadPayload(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32& OutSequence, uint32& OutNumRecords, TArray<uint8>& OutPayload) const;
+	void FindDeltas(TArray<uint32>& OutSequences) const;
+
+	FString Directory;
+
+	// What the files on disk hold, by ID.
+	TMap<uint64, FProgressRecord> Saved;
+	FWorldStateSnapshot SavedWorldState;
+	uint32 Sequence;
+	int32 NumDeltas;
+	bool bForceSnapshot;
+};
+
+bool FProgressSaveWriter::WriteFile(const FString& Filename, ProgressSaveFormat::EFileKind Kind, const TArray<FProgressRecord>& Records, int64& OutBytes) const
+{
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadWriter(Payload);
+	for (FProgressRecord Record : Records)
+		PayloadWriter << Record;
+
+	return WritePayload(Filename, Kind, Records.Num(), Payload, OutBytes);
+}
+
+bool FProgressSaveWriter::WritePayload(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32 NumRecords, const TArray<uint8>& Payload, int64& OutBytes) const
+{
+	using namespace ProgressSaveFormat;
+
+	FHeader Header;
+	Header.Kind = Kind;
+	Header.Sequence = Sequence;
+	Header.NumRecords = NumRecords;
+	Header.Crc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Header;
+	Bytes.Append(Payload);
+
+	IFileManager& FileManager = IFileManager::Get();
+	const FString TempFilename = Filename + TEXT(".tmp");
+	const FString BackupFilename = GetBackupFilename(Filename);
+
+	bool bFlushed = false;
+	if (IFileHandle* File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*TempFilename))
+	{
+		bFlushed = File->Write(Bytes.GetData(), Bytes.Num()) && File->Flush(true);
+		delete File;
+	}
+	if (!bFlushed)
+	{
+		FileManager.Delete(*TempFilename, false, true, true);
+		return false;
+	}
+
+	// Until the new file is in place the old one is only ever renamed, never deleted.
+	const bool bHadOld = FileManager.FileExists(*Filename);
+	if (bHadOld && !FileManager.Move(*BackupFilename, *Filename, true, true))
+	{
+		FileManager.Delete(*TempFilename, false, true, true);
+		return false;
+	}
+	if (!FileManager.Move(*Filename, *TempFilename, true, true))
+	{
+		if (bHadOld)
+			FileManager.Move(*Filename, *BackupFilename, true, true);
+		FileManager.Delete(*TempFilename, false, true, true);
+		return false;
+	}
+	FileManager.Delete(*BackupFilename, false, true, true);
+
+	OutBytes += Bytes.Num();
+	return true;
+}
+
+bool FProgressSaveWriter::ReadFile(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32& OutSequence, TArray<FProgressRecord>& OutRecords) const
+{
+	TArray<uint8> Payload;
+	uint32 NumRecords = 0;
+	if (!ReadPayload(Filename, Kind, OutSequence, NumRecords, Payload))
+		return false;
+
+	FMemoryReader Reader(Payload);
+	OutRecords.SetNum(FMath::Min<uint32>(NumRecords, Payload.Num()));
+	for (FProgressRecord& Record : OutRecords)
+		Reader << Record;
+
+	return !Reader.IsError();
+}
+
+bool FProgressSaveWriter::ReadPayload(const FString& Filename, ProgressSaveFormat::EFileKind Kind, uint32& OutSequence, uint32& OutNumRecords, TArray<uint8>& OutPayload) const
+{
+	using namespace ProgressSaveFormat;
+
+	// A write that was cut off between moving the old file aside and the new one into place leaves only the .bak.
+	for (const FString& Candidate : { Filename, GetBackupFilename(Filename) })
+	{
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *Candidate, FILEREAD_Silent))
+			continue;
+
+		FMemoryReader Reader(Bytes);
+		FHeader Header;
+		Reader << Header;
+
+		const int64 PayloadOffset = Reader.Tell();
+		if (Reader.IsError() || Header.Magic != Magic || Header.Version != Version || Header.Kind != Kind ||
+			Header.Crc != FCrc::MemCrc32(Bytes.GetData() + PayloadOffset, int32(Bytes.Num() - PayloadOffset)))
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s is not a valid save file, ignoring it."), *Candidate);
+			continue;
+		}
+
+		OutPayload.Append(Bytes.GetData() + PayloadOffset, int32(Bytes.Num() - PayloadOffset));
+		OutSequence = Header.Sequence;
+		OutNumRecords = Header.NumRecords;
+		return true;
+	}
+	return false;
+}
+
+void FProgressSaveWriter::FindDeltas(TArray<uint32>& OutSequences) const
+{
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Directory / TEXT("Progress.*.delta")), true, false);
+
+	for (const FString& File : Files)
+	{
+		const FString Number = FPaths::GetBaseFilename(File).RightChop(9); // "Progress."
+		if (Number.IsNumeric())
+			OutSequences.Add(uint32(FCString::Strtoui64(*Number, nullptr, 10)));
+	}
+	OutSequences.Sort();
+}
+
+/*
+ * Function:  Read
+ * --------------------
+ * 1) Read the snapshot.
+ * 2) Apply every delta after it in order, stopping at the first missing or broken one.
+ *
+ */
+bool FProgressSaveWriter::Read(TMap<uint64, FProgressRecord>& OutRecords, FWorldStateSnapshot& OutWorldState)
+{
+	using namespace ProgressSaveFormat;
+
+	Saved.Reset();
+	SavedWorldState = FWorldStateSnapshot();
+	Sequence = 0;
+	NumDeltas = 0;
+
+	TArray<uint8> WorldStatePayload;
+	uint32 WorldStateSequence = 0;
+	uint32 Unused = 0;
+	if (ReadPayload(GetWorldStateFilename(), EFileKind::WorldState, WorldStateSequence, Unused, WorldStatePayload))
+	{
+		FMemoryReader Reader(WorldStatePayload);
+		Reader << SavedWorldState;
+		if (Reader.IsError())
+			SavedWorldState = FWorldStateSnapshot();
+	}
+	OutWorldState = SavedWorldState;
+
+	TArray<FProgressRecord> Records;
+	const bool bHasSnapshot = ReadFile(GetSnapshotFilename(), EFileKind::Snapshot, Sequence, Records);
+	for (const FProgressRecord& Record : Records)
+		Saved.Add(Record.ID, Record);
+
+	TArray<uint32> Deltas;
+	FindDeltas(Deltas);
+
+	for (uint32 DeltaSequence : Deltas)
+	{
+		if (DeltaSequence <= Sequence)
+			continue;
+
+		uint32 FileSequence = 0;
+		if (DeltaSequence != Sequence + 1 || !ReadFile(GetDeltaFilename(DeltaSequence), EFileKind::Delta, FileSequence, Records) || FileSequence != DeltaSequence)
+			break;
+
+		for (const FProgressRecord& Record : Records)
+			Saved.Add(Record.ID, Record);
+		Sequence = DeltaSequence;
+		NumDeltas++;
+	}
+
+	// Anything after a gap can't be trusted, so the next save starts over with a snapshot.
+	bForceSnapshot = Deltas.Num() > 0 && Deltas.Last() > Sequence;
+
+	OutRecords = Saved;
+	return bHasSnapshot || NumDeltas > 0 || WorldStatePayload.Num() > 0;
+}
+
+/*
+ * Function:  Write
+ * --------------------
+ * 1) Keep only the records that differ from what is on disk.
+ * 2) Write them as a delta, or write a snapshot if the deltas pile up or most records changed.
+ * 3) Rewrite the world state if any flag or counter changed, it's a few hundred bytes at most.
+ *
+ * This runs on a worker thread.
+ */
+void FProgressSaveWriter::Write(const TArray<FProgressRecord>& Captured, const FWorldStateSnapshot& WorldState, FProgressSaveStats& OutStats)
+{
+	using namespace ProgressSaveFormat;
+
+	const double StartTime = FPlatformTime::Seconds();
+	OutStats.RecordsCaptured = Captured.Num();
+
+	if (!(WorldState == SavedWorldState))
+	{
+		FWorldStateSnapshot Copy = WorldState;
+		TArray<uint8> Payload;
+		FMemoryWriter PayloadWriter(Payload);
+		PayloadWriter << Copy;
+
+		IFileManager::Get().MakeDirectory(*Directory, true);
+		if (WritePayload(GetWorldStateFilename(), EFileKind::WorldState, 0, Payload, OutStats.BytesWritten))
+			SavedWorldState = WorldState;
+		else
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write the world state to %s."), *Directory);
+	}
+
+	TArray<FProgressRecord> Changed;
+	for (const FProgressRecord& Record : Captured)
+	{
+		const FProgressRecord* Previous = Saved.Find(Record.ID);
+		if (Previous == nullptr || *Previous != Record)
+		{
+			Changed.Add(Record);
+			Saved.Add(Record.ID, Record);
+		}
+	}
+
+	if (Changed.Num() > 0 || bForceSnapshot)
+	{
+		IFileManager::Get().MakeDirectory(*Directory, true);
+		Sequence++;
+
+		OutStats.bSnapshot = bForceSnapshot || NumDeltas >= MaxDeltas || Changed.Num() * 2 > Saved.Num();
+		bool bWritten;
+		if (OutStats.bSnapshot)
+		{
+			TArray<FProgressRecord> All;
+			Saved.GenerateValueArray(All);
+			bWritten = WriteFile(GetSnapshotFilename(), EFileKind::Snapshot, All, OutStats.BytesWritten);
+			OutStats.RecordsWritten = All.Num();
+
+			// The deltas only go once the new snapshot is on disk, until then the old snapshot still needs them.
+			if (bWritten)
+			{
+				TArray<uint32> Deltas;
+				FindDeltas(Deltas);
+				for (uint32 DeltaSequence : Deltas)
+				{
+					if (DeltaSequence <= Sequence)
+						IFileManager::Get().Delete(*GetDeltaFilename(DeltaSequence), false, true, true);
+				}
+				NumDeltas = 0;
+			}
+		}
+		else
+		{
+			bWritten = WriteFile(GetDeltaFilename(Sequence), EFileKind::Delta, Changed, OutStats.BytesWritten);
+			OutStats.RecordsWritten = Changed.Num();
+			if (bWritten)
+				NumDeltas++;
+		}
+
+		// Saved already holds the new state, so after a failed write only a full snapshot brings the disk back in line.
+		bForceSnapshot = !bWritten;
+		if (!bWritten)
+		{
+			Sequence--;
+			OutStats.RecordsWritten = 0;
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write the save to %s."), *Directory);
+		}
+	}
+
+	OutStats.WriteSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+/*
+ * Function:  UProgressSaveSubsystem
+ * --------------------
+ * This is the constructor.
+ */
+UProgressSaveSubsystem::UProgressSaveSubsystem() :
+bSavePending(false),
+bSaving(false)
+{}
+
+void UProgressSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Collection.InitializeDependency(UWorldStateSubsystem::StaticClass());
+
+	Writer = MakeShared<FProgressSaveWriter, ESPMode::ThreadSafe>(FPaths::ProjectSavedDir() / TEXT("SaveGames") / TEXT("Progress"));
+	ReadFromDisk();
+
+	FGameplayEventBus::Get().Subscribe<FProgressSavedEvent>(this, [this](const FProgressSavedEvent& Event)
+	{
+		if (Event.Subsystem == this)
+			FinishWrite(Event.Result);
+	});
+}
+
+void UProgressSaveSubsystem::Deinitialize()
+{
+	FGameplayEventBus::Get().UnsubscribeAll(this);
+	if (InFlight.IsValid())
+		InFlight.Wait();
+
+	if (bSavePending)
+	{
+		FProgressSaveStats Result;
+		Writer->Write(PendingRecords, PendingWorldState, Result);
+		bSavePending = false;
+	}
+
+	Super::Deinitialize();
+}
+
+UProgressSaveSubsystem* UProgressSaveSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UProgressSaveSubsystem>() : nullptr;
+}
+
+uint64 UProgressSaveSubsystem::GetActorID(const AActor* Actor)
+{
+	const FString Path = UWorld::RemovePIEPrefix(Actor->GetPathName());
+	return CityHash64(reinterpret_cast<const char*>(*Path), Path.Len() * sizeof(TCHAR));
+}
+
+/*
+ * Function:  Capture
+ * --------------------
+ * This is all the game thread does for a save: copy a few bytes out of every actor.
+ *
+ */
+void UProgressSaveSubsystem::Capture(TArray<FProgressRecord>& OutRecords) const
+{
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr)
+		return;
+
+	for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+	{
+		FProgressRecord& Record = OutRecords.AddDefaulted_GetRef();
+		Record.ID = GetActorID(*It);
+		Record.Kind = FProgressRecord::EKind::Conversation;
+		Record.Flags = (It->bFinished ? FProgressRecord::Finished : 0) | (It->bAllowRepeat ? FProgressRecord::AllowRepeat : 0);
+		Record.Nodes[0] = uint16(It->CurrentConversationNodeID);
+		Record.Nodes[1] = uint16(It->NextConversationNodeID);
+		Record.Nodes[2] = uint16(It->CurrentDialogueNodeID);
+		Record.Nodes[3] = uint16(It->CurrentSubtitleNodeID);
+	}
+
+	for (TActorIterator<AAInfoBox> It(World); It; ++It)
+	{
+		FProgressRecord& Record = OutRecords.AddDefaulted_GetRef();
+		Record.ID = GetActorID(*It);
+		Record.Kind = FProgressRecord::EKind::InfoBox;
+		Record.Flags = It->bFinished ? FProgressRecord::Finished : 0;
+		Record.Phase = uint8(It->CurrentPhase);
+	}
+}
+
+/*
+ * Function:  Save
+ * --------------------
+ * The records are handed to a worker thread, which compares them with the save and writes the difference.
+ *
+ */
+void UProgressSaveSubsystem::Save()
+{
+	HB_HITCH_SCOPE("Save.Capture");
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<FProgressRecord> Captured;
+	Capture(Captured);
+	for (const FProgressRecord& Record : Captured)
+		Records.Add(Record.ID, Record);
+
+	FWorldStateSnapshot WorldState;
+	if (const UWorldStateSubsystem* WorldStateSubsystem = GetGameInstance()->GetSubsystem<UWorldStateSubsystem>())
+		WorldStateSubsystem->CreateSnapshot(WorldState);
+
+	Stats.CaptureSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (bSaving)
+	{
+		// Only the newest state matters, so a queued save simply replaces the one before it.
+		PendingRecords = MoveTemp(Captured);
+		PendingWorldState = MoveTemp(WorldState);
+		bSavePending = true;
+		return;
+	}
+
+	StartWrite(MoveTemp(Captured), MoveTemp(WorldState));
+}
+
+void UProgressSaveSubsystem::StartWrite(TArray<FProgressRecord>&& Captured, FWorldStateSnapshot&& WorldState)
+{
+	bSaving = true;
+
+	TSharedPtr<FProgressSaveWriter, ESPMode::ThreadSafe> SaveWriter = Writer;
+	TWeakObjectPtr<UProgressSaveSubsystem> WeakThis(this);
+
+	InFlight = Async(EAsyncExecution::ThreadPool, [SaveWriter, WeakThis, Captured = MoveTemp(Captured), WorldState = MoveTemp(WorldState)]()
+	{
+		FProgressSavedEvent Event;
+		Event.Subsystem = WeakThis;
+		SaveWriter->Write(Captured, WorldState, Event.Result);
+		FGameplayEventBus::Get().Post(Event);
+	});
+}
+
+void UProgressSaveSubsystem::FinishWrite(const FProgressSaveStats& Result)
+{
+	bSaving = false;
+
+	Stats.Saves++;
+	Stats.RecordsCaptured = Result.RecordsCaptured;
+	Stats.RecordsWritten = Result.RecordsWritten;
+	Stats.BytesWritten = Result.BytesWritten;
+	Stats.bSnapshot = Result.bSnapshot;
+	Stats.WriteSeconds = Result.WriteSeconds;
+
+	UE_LOG(LogHeavenlyBlue, Log, TEXT("Saved %d of %d records as a %s (%lld bytes): %.3f ms on the game thread, %.2f ms on a worker."),
+		Stats.RecordsWritten, Stats.RecordsCaptured, Stats.bSnapshot ? TEXT("snapshot") : TEXT("delta"), Stats.BytesWritten,
+		Stats.CaptureSeconds * 1000.0, Stats.WriteSeconds * 1000.0);
+
+	if (bSavePending)
+	{
+		bSavePending = false;
+		StartWrite(MoveTemp(PendingRecords), MoveTemp(PendingWorldState));
+	}
+}
+
+bool UProgressSaveSubsystem::ReadFromDisk()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FWorldStateSnapshot WorldState;
+	const bool bRead = Writer->Read(Records, WorldState);
+	Stats.LoadSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (UWorldStateSubsystem* WorldStateSubsystem = GetGameInstance()->GetSubsystem<UWorldStateSubsystem>())
+		WorldStateSubsystem->ApplySnapshot(WorldState);
+	return bRead;
+}
+
+/*
+ * Function:  Load
+ * --------------------
+ * Any save in flight is finished first, so the files read are complete.
+ *
+ */
+bool UProgressSaveSubsystem::Load()
+{
+	HB_HITCH_SCOPE("Save.Load");
+	if (InFlight.IsValid())
+		InFlight.Wait();
+	if (bSavePending)
+	{
+		FProgressSaveStats Result;
+		Writer->Write(PendingRecords, PendingWorldState, Result);
+		bSavePending = false;
+	}
+
+	if (!ReadFromDisk())
+		return false;
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	int32 Restored = 0;
+	if (World != nullptr)
+	{
+		for (TActorIterator<AAConversationInstance> It(World); It; ++It)
+			Restored += Restore(**It) ? 1 : 0;
+		for (TActorIterator<AAInfoBox> It(World); It; ++It)
+			Restored += Restore(**It) ? 1 : 0;
+	}
+
+	UE_LOG(LogHeavenlyBlue, Log, TEXT("Loaded %d records in %.2f ms, restored %d actors."), Records.Num(), Stats.LoadSeconds * 1000.0, Restored);
+	return true;
+}
+
+bool UProgressSaveSubsystem::Restore(AAConversationInstance& Instance) const
+{
+	const FProgressRecord* Record = Records.Find(GetActorID(&Instance));
+	if (Record == nullptr || Record->Kind != FProgressRecord::EKind::Conversation)
+		return false;
+
+	Instance.SetNodeID(Record->Nodes[0], Record->Nodes[2], Record->Nodes[3]);
+	Instance.NextConversationNodeID = Record->Nodes[1];
+	Instance.ResetIteration();
+	Instance.bFinished = (Record->Flags & FProgressRecord::Finished) != 0;
+	Instance.bAllowRepeat = (Record->Flags & FProgressRecord::AllowRepeat) != 0;
+	return true;
+}
+
+bool UProgressSaveSubsystem::Restore(AAInfoBox& InfoBox) const
+{
+	const FProgressRecord* Record = Records.Find(GetActorID(&InfoBox));
+	if (Record == nullptr || Record->Kind != FProgressRecord::EKind::InfoBox)
+		return false;
+
+	InfoBox.CurrentPhase = EInteractablePhase(Record->Phase);
+	InfoBox.bFinished = (Record->Flags & FProgressRecord::Finished) != 0;
+	return true;
+}
+
+/*
+ * Console Command:  HB.Save / HB.Load
+ * --------------------
+ * Saves or loads the conversation and info box progress of the current game.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GProgressSaveCommand(
+	TEXT("HB.Save"),
+	TEXT("Saves conversation and info box progress."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(World))
+			SaveSubsystem->Save();
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs GProgressLoadCommand(
+	TEXT("HB.Load"),
+	TEXT("Restores conversation and info box progress from the save."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UProgressSaveSubsystem* SaveSubsystem = UProgressSaveSubsystem::Get(World))
+			SaveSubsystem->Load();
+	})
+);
@@ -0,0 +1,141 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : ProgressSaveSubsystem
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class saves how far the player got in every conversation
+*				   and info box, and the world state. Only what changed since
+*				   the last save is written, on a worker thread, and every file
+*				   is swapped in whole so a crash mid save never leaves a
+*				   broken save behind.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "GameplayEvents.h"
+#include "WorldStateSubsystem.h"
+#include "ProgressSaveSubsystem.generated.h"
+
+class AAConversationInstance;
+class AAInfoBox;
+class FProgressSaveWriter;
+
+/*
+ * Struct:  FProgressRecord
+ * --------------------
+ * The saved state of one conversation instance or info box.
+ */
+struct FProgressRecord
+{
+	enum class EKind : uint8
+	{
+		Conversation,
+		InfoBox,
+	};
+
+	enum EFlags : uint8
+	{
+		Finished = 1 << 0,
+		AllowRepeat = 1 << 1,
+	};
+
+	// See UProgressSaveSubsystem::GetActorID.
+	uint64 ID = 0;
+	EKind Kind = EKind::Conversation;
+	uint8 Flags = 0;
+	// EInteractablePhase of an info box.
+	uint8 Phase = 0;
+	// Current conversation, next conversation, dialogue and subtitle node of a conversation.
+	uint16 Nodes[4] = {};
+
+	bool operator==(const FProgressRecord& Other) const;
+	bool operator!=(const FProgressRecord& Other) const { return !(*this == Other); }
+
+	friend FArchive& operator<<(FArchive& Ar, FProgressRecord& Record);
+};
+
+struct FProgressSaveStats
+{
+	int32 Saves = 0;
+	int32 RecordsCaptured = 0;
+	int32 RecordsWritten = 0;
+	int64 BytesWritten = 0;
+	bool bSnapshot = false;
+	double CaptureSeconds = 0.0;
+	double WriteSeconds = 0.0;
+	double LoadSeconds = 0.0;
+};
+
+// Posted by the worker that wrote a save, the subsystem finishes the save when it's dispatched.
+struct FProgressSavedEvent
+{
+	static constexpr EGameplayEventType Type = EGameplayEventType::ProgressSaved;
+
+	TWeakObjectPtr<class UProgressSaveSubsystem> Subsystem;
+	FProgressSaveStats Result;
+};
+
+UCLASS()
+class HEAVENLYBLUE_API UProgressSaveSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UProgressSaveSubsystem();
+
+	// Reads the save from disk, actors pick their state up in BeginPlay.
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	// Finishes the save in flight, so quitting right after saving never loses it.
+	virtual void Deinitialize() override;
+
+	static UProgressSaveSubsystem* Get(const UObject* WorldContextObject);
+
+	// Captures every conversation and info box of the world and writes what changed on a worker thread.
+	// Saving while a save is in flight queues one more save with the newest state.
+	void Save();
+
+	// Reads the save again and restores every conversation and info box of the world.
+	bool Load();
+
+	// False when the save has no record of the actor.
+	bool Restore(AAConversationInstance& Instance) const;
+	bool Restore(AAInfoBox& InfoBox) const;
+
+	bool IsSaving() const { return bSaving; }
+	const FProgressSaveStats& GetStats() const { return Stats; }
+
+	// Stable between runs and PIE sessions: a hash of the actor's path in its level.
+	static uint64 GetActorID(const AActor* Actor);
+
+private:
+	void Capture(TArray<FProgressRecord>& OutRecords) const;
+	bool ReadFromDisk();
+	void StartWrite(TArray<FProgressRecord>&& Records, FWorldStateSnapshot&& WorldState);
+	void FinishWrite(const FProgressSaveStats& Result);
+
+	// Only touched by one worker task at a time, or by the game thread while no task is in flight.
+	TSharedPtr<FProgressSaveWriter, ESPMode::ThreadSafe> Writer;
+
+	// The newest known state of every actor, by ID.
+	TMap<uint64, FProgressRecord> Records;
+
+	TArray<FProgressRecord> PendingRecords;
+	FWorldStateSnapshot PendingWorldState;
+	bool bSavePending;
+	bool bSaving;
+	TFuture<void> InFlight;
+
+	FProgressSaveStats Stats;
+};
@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StartupProfiler.h"
+#include "HeavenlyBlue.h"
+#include "CoreGlobals.h"
+#include "Engine/World.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace StartupProfiling
+{
+	FString Escape(const FString& Text)
+	{
+		return Text.Replace(TEXT("\\"), TEXT("\\\\")).Replace(TEXT("\""), TEXT("\\\""));
+	}
+
+	// Chrome traces count in microseconds.
+	int64 ToMicroseconds(double Seconds)
+	{
+		return int64(Seconds * 1000000.0);
+	}
+}
+
+FStartupProfiler& FStartupProfiler::Get()
+{
+	static FStartupProfiler Profiler;
+	return Profiler;
+}
+
+FStartupProfiler::FStartupProfiler() :
+MapLoadStart(0.0),
+bRecording(false)
+{}
+
+double FStartupProfiler::Now()
+{
+	return FPlatformTime::Seconds() - GStartTime;
+}
+
+/*
+ * Function:  Start
+ * --------------------
+ * 1) Record everything before the game module as one span, with the modules that were already loaded.
+ * 2) List the enabled plugins, they're what a lean configuration trims.
+ * 3) Listen for module loads, package loads, map loads and frames until the first playable frame.
+ *
+ */
+void FStartupProfiler::Start()
+{
+	if (bRecording || !FParse::Param(FCommandLine::Get(), TEXT("ProfileStartup")))
+		return;
+
+	bRecording = true;
+	FirstPlayableMap.Reset();
+	GConfig->GetString(TEXT("/Script/HeavenlyBlue.StartupProfiler"), TEXT("FirstPlayableMap"), FirstPlayableMap, GGameIni);
+
+	TArray<FModuleStatus> Modules;
+	FModuleManager::Get().QueryModules(Modules);
+	int32 LoadedModules = 0;
+	for (const FModuleStatus& Module : Modules)
+		LoadedModules += Module.bIsLoaded ? 1 : 0;
+
+	AddSpan(TEXT("Engine"), FString::Printf(TEXT("Engine pre-init (%d modules loaded)"), LoadedModules), 0.0, Now());
+
+	EnabledPlugins.Reset();
+	for (const TSharedRef<IPlugin>& Plugin : IPluginManager::Get().GetEnabledPlugins())
+		EnabledPlugins.Add(Plugin->GetName());
+	EnabledPlugins.Sort();
+
+	FModuleManager::Get().OnModulesChanged().AddRaw(this, &FStartupProfiler::HandleModulesChanged);
+	FCoreDelegates::OnSyncLoadPackage.AddRaw(this, &FStartupProfiler::HandlePackageLoadRequested, TEXT("Sync load"));
+	FCoreDelegates::OnAsyncLoadPackage.AddRaw(this, &FStartupProfiler::HandlePackageLoadRequested, TEXT("Async load"));
+	FCoreUObjectDelegates::OnAssetLoaded.AddRaw(this, &FStartupProfiler::HandleAssetLoaded);
+	FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FStartupProfiler::HandlePreLoadMap);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FStartupProfiler::HandlePostLoadMap);
+	FCoreDelegates::OnPostEngineInit.AddRaw(this, &FStartupProfiler::AddInstant, TEXT("Engine"), FString(TEXT("Engine init done")));
+	FCoreDelegates::OnFEngineLoopInitComplete.AddRaw(this, &FStartupProfiler::AddInstant, TEXT("Engine"), FString(TEXT("Engine loop init done")));
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FStartupProfiler::HandleEndFrame);
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Profiling startup until the first frame in %s."), FirstPlayableMap.IsEmpty() ? TEXT("the first map") : *FirstPlayableMap);
+}
+
+void FStartupProfiler::Stop()
+{
+	if (!bRecording)
+		return;
+
+	bRecording = false;
+	FModuleManager::Get().OnModulesChanged().RemoveAll(this);
+	FCoreDelegates::OnSyncLoadPackage.RemoveAll(this);
+	FCoreDelegates::OnAsyncLoadPackage.RemoveAll(this);
+	FCoreUObjectDelegates::OnAssetLoaded.RemoveAll(this);
+	FCoreUObjectDelegates::PreLoadMap.RemoveAll(this);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.RemoveAll(this);
+	FCoreDelegates::OnPostEngineInit.RemoveAll(this);
+	FCoreDelegates::OnFEngineLoopInitComplete.RemoveAll(this);
+	FCoreDelegates::OnEndFrame.RemoveAll(this);
+}
+
+void FStartupProfiler::AddSpan(const TCHAR* Category, FString Name, double StartSeconds, double EndSeconds)
+{
+	if (!bRecording)
+		return;
+
+	FScopeLock Lock(&EventsMutex);
+	FStartupProfilerEvent& Event = Events.AddDefaulted_GetRef();
+	Event.Name = MoveTemp(Name);
+	Event.Category = Category;
+	Event.Start = StartSeconds;
+	Event.Duration = FMath::Max(EndSeconds - StartSeconds, 0.0);
+}
+
+void FStartupProfiler::AddInstant(const TCHAR* Category, FString Name)
+{
+	if (!bRecording)
+		return;
+
+	FScopeLock Lock(&EventsMutex);
+	FStartupProfilerEvent& Event = Events.AddDefaulted_GetRef();
+	Event.Name = MoveTemp(Name);
+	Event.Category = Category;
+	Event.Start = Now();
+}
+
+void FStartupProfiler::HandleModulesChanged(FName ModuleName, EModuleChangeReason Reason)
+{
+	if (Reason == EModuleChangeReason::ModuleLoaded)
+		AddInstant(TEXT("Module"), ModuleName.ToString());
+}
+
+void FStartupProfiler::HandlePackageLoadRequested(const FString& PackageName, const TCHAR* Kind)
+{
+	AddInstant(TEXT("Package"), FString::Printf(TEXT("%s %s"), Kind, *PackageName));
+}
+
+void FStartupProfiler::HandleAssetLoaded(UObject* Asset)
+{
+	if (Asset != nullptr)
+		AddInstant(TEXT("Asset"), Asset->GetPathName());
+}
+
+void FStartupProfiler::HandlePreLoadMap(const FString& MapName)
+{
+	LoadingMap = MapName;
+	MapLoadStart = Now();
+}
+
+/*
+ * Function:  HandlePostLoadMap
+ * --------------------
+ * The map has loaded and its actors have begun play. The next frame to end in it is the first playable one.
+ *
+ */
+void FStartupProfiler::HandlePostLoadMap(UWorld* World)
+{
+	const FString MapName = World ? UWorld::RemovePIEPrefix(World->GetMapName()) : LoadingMap;
+	AddSpan(TEXT("Map"), TEXT("Load ") + MapName, MapLoadStart, Now());
+
+	if (World != nullptr && (FirstPlayableMap.IsEmpty() || MapName == FirstPlayableMap))
+		PlayableWorld = World;
+}
+
+void FStartupProfiler::HandleEndFrame()
+{
+	UWorld* World = PlayableWorld.Get();
+	if (World != nullptr && World->HasBegunPlay())
+	{
+		AddInstant(TEXT("Frame"), TEXT("First playable frame"));
+		Finish();
+	}
+}
+
+/*
+ * Function:  Finish
+ * --------------------
+ * Writes the timeline and logs how long the milestones took.
+ *
+ */
+void FStartupProfiler::Finish()
+{
+	double FirstFrame = 0.0, MapLoad = 0.0, BeginPlay = 0.0;
+	int32 Packages = 0;
+	{
+		FScopeLock Lock(&EventsMutex);
+		for (const FStartupProfilerEvent& Event : Events)
+		{
+			const FString Category = Event.Category;
+			if (Category == TEXT("Frame"))
+				FirstFrame = Event.Start;
+			else if (Category == TEXT("Map"))
+				MapLoad += Event.Duration;
+			else if (Category == TEXT("BeginPlay"))
+				BeginPlay += Event.Duration;
+			else if (Category == TEXT("Package"))
+				Packages++;
+		}
+	}
+
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("Startup-%s.json"), *FDateTime::Now().ToString());
+	Write(Filename);
+	Stop();
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Startup: first playable frame at %.3f s, map loads %.3f s, BeginPlay %.3f s, %d package loads, %d plugins. Timeline: %s"),
+		FirstFrame, MapLoad, BeginPlay, Packages, EnabledPlugins.Num(), *Filename);
+}
+
+/*
+ * Function:  Write
+ * --------------------
+ * Writes the events in the Chrome trace format. Every category gets its own row, the plugins go in the metadata.
+ *
+ */
+bool FStartupProfiler::Write(const FString& Filename) const
+{
+	using namespace StartupProfiling;
+
+	FScopeLock Lock(&EventsMutex);
+
+	TArray<const TCHAR*> Rows;
+	TArray<FString> Entries;
+	for (const FStartupProfilerEvent& Event : Events)
+	{
+		int32 Row = Rows.IndexOfByPredicate([&Event](const TCHAR* Category) { return FCString::Strcmp(Category, Event.Category) == 0; });
+		if (Row == INDEX_NONE)
+			Row = Rows.Add(Event.Category);
+
+		FString Entry = FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":0,\"tid\":%d,\"ts\":%lld,"), *Escape(Event.Name), Event.Category, Row, ToMicroseconds(Event.Start));
+		Entry += Event.Duration >= 0.0 ? FString::Printf(TEXT("\"ph\":\"X\",\"dur\":%lld}"), ToMicroseconds(Event.Duration)) : FString(TEXT("\"ph\":\"i\",\"s\":\"t\"}"));
+		Entries.Add(MoveTemp(Entry));
+	}
+
+	for (int32 Row = 0; Row < Rows.Num(); Row++)
+		Entries.Add(FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}"), Row, Rows[Row]));
+
+	TArray<FString> Plugins;
+	for (const FString& Plugin : EnabledPlugins)
+		Plugins.Add(TEXT("\"") + Escape(Plugin) + TEXT("\""));
+
+	const FString Json = TEXT("{\"traceEvents\":[\n") + FString::Join(Entries, TEXT(",\n")) + TEXT("\n],\"metadata\":{\"plugins\":[") + FString::Join(Plugins, TEXT(",")) + TEXT("]}}\n");
+	return FFileHelper::SaveStringToFile(Json, *Filename);
+}
+
+FStartupProfilerScope::FStartupProfilerScope(const TCHAR* InCategory, const UObject* Object) :
+Category(InCategory),
+StartTime(-1.0)
+{
+	if (FStartupProfiler::Get().IsRecording())
+	{
+		Name = Object ? Object->GetName() : FString();
+		StartTime = FStartupProfiler::Now();
+	}
+}
+
+FStartupProfilerScope::~FStartupProfilerScope()
+{
+	if (StartTime >= 0.0)
+		FStartupProfiler::Get().AddSpan(Category, MoveTemp(Name), StartTime, FStartupProfiler::Now());
+}
@@ -0,0 +1,105 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : StartupProfiler
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This records what happens between the process starting and the
+*				   first playable frame: engine init, the modules loaded, map and
+*				   package loads and the BeginPlay of the game's actors. The
+*				   timeline is written as a Chrome trace (chrome://tracing, Perfetto).
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+class UWorld;
+
+/*
+ * Struct:  FStartupProfilerEvent
+ * --------------------
+ * Times are in seconds since the process started. Instant events have a negative duration.
+ */
+struct FStartupProfilerEvent
+{
+	FString Name;
+	const TCHAR* Category = TEXT("");
+	double Start = 0.0;
+	double Duration = -1.0;
+};
+
+/*
+ * Class:  FStartupProfiler
+ * --------------------
+ * Only records when the game is started with -ProfileStartup. It stops at the first frame played in
+ * [/Script/HeavenlyBlue.StartupProfiler] FirstPlayableMap and writes Saved/Profiling/Startup-<date>.json.
+ */
+class HEAVENLYBLUE_API FStartupProfiler
+{
+public:
+	static FStartupProfiler& Get();
+
+	// Called by the game module as it starts up, the earliest point the game's code runs.
+	void Start();
+	void Stop();
+	bool IsRecording() const { return bRecording; }
+
+	// Seconds since the process started.
+	static double Now();
+
+	void AddSpan(const TCHAR* Category, FString Name, double StartSeconds, double EndSeconds);
+	void AddInstant(const TCHAR* Category, FString Name);
+
+	bool Write(const FString& Filename) const;
+
+private:
+	FStartupProfiler();
+
+	void HandleModulesChanged(FName ModuleName, EModuleChangeReason Reason);
+	void HandlePackageLoadRequested(const FString& PackageName, const TCHAR* Kind);
+	void HandleAssetLoaded(UObject* Asset);
+	void HandlePreLoadMap(const FString& MapName);
+	void HandlePostLoadMap(UWorld* World);
+	void HandleEndFrame();
+
+	// Writes the timeline and logs the milestones, once the first playable frame has been reached.
+	void Finish();
+
+	TArray<FStartupProfilerEvent> Events;
+	// Packages may be requested from the loading thread.
+	mutable FCriticalSection EventsMutex;
+
+	TArray<FString> EnabledPlugins;
+	FString FirstPlayableMap;
+	FString LoadingMap;
+	double MapLoadStart;
+	TWeakObjectPtr<UWorld> PlayableWorld;
+	bool bRecording;
+};
+
+/*
+ * Struct:  FStartupProfilerScope
+ * --------------------
+ * Adds a span for its lifetime, named after the object it measures.
+ */
+struct FStartupProfilerScope
+{
+	FStartupProfilerScope(const TCHAR* InCategory, const UObject* Object);
+	~FStartupProfilerScope();
+
+	const TCHAR* Category;
+	FString Name;
+	double StartTime;
+};
+
+#define HB_STARTUP_SCOPE(Category, Object) FStartupProfilerScope ANONYMOUS_VARIABLE(StartupScope)(TEXT(Category), Object)
@@ -0,0 +1,493 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SubtitlePresenter.h"
+#include "HeavenlyBlue.h"
+#include "HeavenlyBlueMemory.h"
+#include "Engine/GameInstance.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/World.h"
+#include "Fonts/FontCache.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Rendering/DrawElements.h"
+#include "Rendering/SlateRenderer.h"
+#include "Styling/CoreStyle.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("Subtitle Layout"), STAT_SubtitleLayout, STATGROUP_Slate);
+DECLARE_CYCLE_STAT(TEXT("Subtitle Paint"), STAT_SubtitlePaint, STATGROUP_Slate);
+
+/*
+ * Function:  Build
+ * --------------------
+ * 1) Shape the whole string once.
+ * 2) Walk the glyphs to find where each character ends.
+ * 3) Break lines at the last space before the wrap width, or at a line break.
+ * Each line keeps its slice of the shaped glyphs, so painting never shapes or measures again.
+ */
+void FSubtitleLayout::Build(const FString& InText, const FSlateFontInfo& Font, float InWrapWidth, float InFontScale, FSlateFontCache& FontCache)
+{
+	Text = InText;
+	WrapWidth = InWrapWidth;
+	FontScale = InFontScale;
+	Lines.Reset();
+	Size = FVector2D::ZeroVector;
+
+	const FShapedGlyphSequenceRef Shaped = FontCache.ShapeBidirectionalText(Text, Font, FontScale, TextBiDi::ETextDirection::LeftToRight, ETextShapingMethod::Auto);
+	LineHeight = Shaped->GetMaxTextHeight();
+
+	TArray<float, TInlineAllocator<256>> Ends;
+	Ends.SetNumZeroed(Text.Len());
+	float PenX = 0.0f;
+	for (const FShapedGlyphEntry& Glyph : Shaped->GetGlyphsToRender())
+	{
+		PenX += Glyph.XAdvance;
+		for (int32 i = 0; i < FMath::Max<int32>(Glyph.NumCharactersInGlyph, 1); i++)
+		{
+			if (Ends.IsValidIndex(Glyph.SourceIndex + i))
+				Ends[Glyph.SourceIndex + i] = PenX;
+		}
+	}
+	// Characters without a glyph of their own end where the one before them does.
+	for (int32 i = 1; i < Ends.Num(); i++)
+		Ends[i] = FMath::Max(Ends[i], Ends[i - 1]);
+
+	auto AddLine = [&](int32 Begin, int32 End)
+	{
+		FLine& Line = Lines.AddDefaulted_GetRef();
+		Line.FirstCharacter = Begin;
+		Line.Y = (Lines.Num() - 1) * LineHeight;
+
+		const float StartX = Begin > 0 ? Ends[Begin - 1] : 0.0f;
+		Line.CharacterEnds.Reserve(End - Begin);
+		for (int32 i = Begin; i < End; i++)
+			Line.CharacterEnds.Add(Ends[i] - StartX);
+
+		if (End > Begin)
+		{
+			Line.Glyphs = Shaped->GetSubSequence(Begin, End);
+			// A glyph cluster crossed the break, shape the line on its own.
+			if (!Line.Glyphs.IsValid())
+				Line.Glyphs = FontCache.ShapeBidirectionalText(Text.Mid(Begin, End - Begin), Font, FontScale, TextBiDi::ETextDirection::LeftToRight, ETextShapingMethod::Auto);
+			Size.X = FMath::Max(Size.X, Line.CharacterEnds.Last());
+		}
+	};
+
+	int32 LineBegin = 0;
+	int32 LastSpace = INDEX_NONE;
+	for (int32 i = 0; i < Text.Len(); i++)
+	{
+		const float LineStart = LineBegin > 0 ? Ends[LineBegin - 1] : 0.0f;
+		if (Text[i] == '\n')
+		{
+			AddLine(LineBegin, i);
+			LineBegin = i + 1;
+			LastSpace = INDEX_NONE;
+		}
+		else if (FChar::IsWhitespace(Text[i]))
+		{
+			LastSpace = i;
+		}
+		else if (WrapWidth > 0.0f && Ends[i] - LineStart > WrapWidth && LastSpace != INDEX_NONE)
+		{
+			AddLine(LineBegin, LastSpace);
+			LineBegin = LastSpace + 1;
+			LastSpace = INDEX_NONE;
+		}
+	}
+	AddLine(LineBegin, Text.Len());
+
+	Size.Y = Lines.Num() * LineHeight;
+}
+
+SIZE_T FSubtitleLayout::GetAllocatedSize() const
+{
+	SIZE_T Bytes = Text.GetAllocatedSize() + Lines.GetAllocatedSize();
+	for (const FLine& Line : Lines)
+	{
+		Bytes += Line.CharacterEnds.GetAllocatedSize();
+		if (Line.Glyphs.IsValid())
+			Bytes += sizeof(FShapedGlyphSequence) + Line.Glyphs->GetGlyphsToRender().GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void SSubtitlePresenter::Construct(const FArguments& InArgs)
+{
+	Font = InArgs._Font;
+	VisibleCharacters = INDEX_NONE;
+	// Unknown until the first paint, which lays out what's on screen again.
+	WrapWidth = 0.0f;
+	FontScale = 1.0f;
+}
+
+/*
+ * Function:  ShowLine
+ * --------------------
+ * Lines are laid out here, when they start, for the size of the last paint. A line shown before
+ * (a repeated conversation, a speaker's name) comes out of the cache.
+ */
+void SSubtitlePresenter::ShowLine(FDialogueStringHandle Speaker, FDialogueStringHandle Text, int32 InVisibleCharacters)
+{
+	SpeakerHandle = Speaker;
+	TextHandle = Text;
+	VisibleCharacters = InVisibleCharacters;
+	SpeakerLayout = FindOrBuildLayout(SpeakerHandle);
+	TextLayout = FindOrBuildLayout(TextHandle);
+	HideChoices();
+}
+
+// The only thing a typewriter step changes.
+void SSubtitlePresenter::SetVisibleCharacters(int32 InVisibleCharacters)
+{
+	VisibleCharacters = InVisibleCharacters;
+	Stats.Steps++;
+}
+
+void SSubtitlePresenter::ShowChoices(const TArray<FDialogueStringHandle>& Options)
+{
+	ChoiceHandles = Options;
+	ChoiceLayouts.Reset(Options.Num());
+	for (FDialogueStringHandle Option : ChoiceHandles)
+		ChoiceLayouts.Add(FindOrBuildLayout(Option));
+}
+
+void SSubtitlePresenter::HideChoices()
+{
+	ChoiceHandles.Reset();
+	ChoiceLayouts.Reset();
+}
+
+void SSubtitlePresenter::Hide()
+{
+	SpeakerHandle = FDialogueStringHandle();
+	TextHandle = FDialogueStringHandle();
+	SpeakerLayout.Reset();
+	TextLayout.Reset();
+	HideChoices();
+}
+
+/*
+ * Function:  FindOrBuildLayout
+ * --------------------
+ * A cached layout is used if it was built for the same size and the handle still holds the same text.
+ * Comparing the text is cheap next to shaping it, and catches handles reused after a culture change.
+ */
+TSharedPtr<FSubtitleLayout> SSubtitlePresenter::FindOrBuildLayout(FDialogueStringHandle Handle) const
+{
+	if (Handle.IsEmpty() || !FSlateApplication::IsInitialized() || FSlateApplication::Get().GetRenderer() == nullptr)
+		return nullptr;
+
+	HB_LLM_SCOPE(Subtitles);
+	const FString& Text = FDialogueStringTable::ResolveText(Handle);
+	if (Layouts.Num() >= MaxCachedLayouts && !Layouts.Contains(Handle))
+		Layouts.Reset();
+
+	TSharedPtr<FSubtitleLayout>& Layout = Layouts.FindOrAdd(Handle);
+	if (Layout.IsValid() && Layout->WrapWidth == WrapWidth && Layout->FontScale == FontScale && Layout->Text.Equals(Text, ESearchCase::CaseSensitive))
+	{
+		Stats.CacheHits++;
+		return Layout;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_SubtitleLayout);
+	const double StartTime = FPlatformTime::Seconds();
+
+	if (!Layout.IsValid())
+		Layout = MakeShared<FSubtitleLayout>();
+	Layout->Build(Text, Font, WrapWidth, FontScale, FSlateApplication::Get().GetRenderer()->GetFontCache().Get());
+
+	Stats.Layouts++;
+	Stats.LayoutSeconds += FPlatformTime::Seconds() - StartTime;
+	return Layout;
+}
+
+SIZE_T SSubtitlePresenter::GetAllocatedSize() const
+{
+	SIZE_T Bytes = Layouts.GetAllocatedSize() + ChoiceHandles.GetAllocatedSize() + ChoiceLayouts.GetAllocatedSize();
+	for (const TPair<FDialogueStringHandle, TSharedPtr<FSubtitleLayout>>& Layout : Layouts)
+	{
+		if (Layout.Value.IsValid())
+			Bytes += sizeof(FSubtitleLayout) + Layout.Value->GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void SSubtitlePresenter::RebuildVisibleLayouts() const
+{
+	SpeakerLayout = FindOrBuildLayout(SpeakerHandle);
+	TextLayout = FindOrBuildLayout(TextHandle);
+	for (int32 i = 0; i < ChoiceLayouts.Num(); i++)
+		ChoiceLayouts[i] = FindOrBuildLayout(ChoiceHandles[i]);
+}
+
+/*
+ * Function:  OnPaint
+ * --------------------
+ * Draws the box, the speaker, the visible part of the subtitle and the choices from the cached layouts.
+ * Layouts are in pixels at the geometry's scale, so they're drawn with the inverse scale.
+ */
+int32 SSubtitlePresenter::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+	int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	if (!TextLayout.IsValid() && ChoiceLayouts.Num() == 0)
+		return LayerId;
+
+	SCOPE_CYCLE_COUNTER(STAT_SubtitlePaint);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const float Padding = 16.0f;
+	const FVector2D LocalSize = AllottedGeometry.GetLocalSize();
+	const float BoxWidth = LocalSize.X * 0.6f;
+	const float Scale = AllottedGeometry.Scale;
+
+	const float NewWrapWidth = FMath::RoundToFloat((BoxWidth - Padding * 2.0f) * Scale);
+	if (NewWrapWidth != WrapWidth || Scale != FontScale)
+	{
+		WrapWidth = NewWrapWidth;
+		FontScale = Scale;
+		RebuildVisibleLayouts();
+	}
+
+	float Height = 0.0f;
+	Height += SpeakerLayout.IsValid() ? SpeakerLayout->Size.Y / Scale : 0.0f;
+	Height += TextLayout.IsValid() ? TextLayout->Size.Y / Scale : 0.0f;
+	for (const TSharedPtr<FSubtitleLayout>& Layout : ChoiceLayouts)
+		Height += Layout.IsValid() ? Layout->Size.Y / Scale : 0.0f;
+	if (ChoiceLayouts.Num() > 0)
+		Height += Padding * 0.5f;
+
+	const FVector2D BoxPosition((LocalSize.X - BoxWidth) * 0.5f, LocalSize.Y - Height - Padding * 4.0f);
+	FSlateDrawElement::MakeBox(OutDrawElements, LayerId, AllottedGeometry.ToPaintGeometry(BoxPosition, FVector2D(BoxWidth, Height + Padding * 2.0f)),
+		FCoreStyle::Get().GetBrush("WhiteBrush"), ESlateDrawEffect::None, FLinearColor(0.0f, 0.0f, 0.0f, 0.6f));
+
+	FVector2D Position = BoxPosition + FVector2D(Padding, Padding);
+	if (SpeakerLayout.IsValid())
+		Position.Y += PaintLayout(*SpeakerLayout, AllottedGeometry, Position, INDEX_NONE, FLinearColor(1.0f, 0.85f, 0.4f), OutDrawElements, LayerId + 1);
+	if (TextLayout.IsValid())
+		Position.Y += PaintLayout(*TextLayout, AllottedGeometry, Position, VisibleCharacters, FLinearColor::White, OutDrawElements, LayerId + 1);
+
+	Position.Y += Padding * 0.5f;
+	for (const TSharedPtr<FSubtitleLayout>& Layout : ChoiceLayouts)
+	{
+		if (Layout.IsValid())
+			Position.Y += PaintLayout(*Layout, AllottedGeometry, Position, INDEX_NONE, FLinearColor(0.6f, 0.8f, 1.0f), OutDrawElements, LayerId + 1);
+	}
+
+	Stats.Paints++;
+	Stats.PaintSeconds += FPlatformTime::Seconds() - StartTime;
+	return LayerId + 1;
+}
+
+/*
+ * Function:  PaintLayout
+ * --------------------
+ * Whole lines are drawn as they are, the line the typewriter is on is clipped after its last visible character.
+ * Returns the height of the layout in local units.
+ */
+float SSubtitlePresenter::PaintLayout(const FSubtitleLayout& Layout, const FGeometry& AllottedGeometry, FVector2D Position, int32 InVisibleCharacters, const FLinearColor& Color,
+	FSlateWindowElementList& OutDrawElements, int32 LayerId) const
+{
+	const float InverseScale = 1.0f / Layout.FontScale;
+
+	for (const FSubtitleLayout::FLine& Line : Layout.Lines)
+	{
+		const int32 NumCharacters = Line.CharacterEnds.Num();
+		const int32 Visible = InVisibleCharacters == INDEX_NONE ? NumCharacters : FMath::Clamp(InVisibleCharacters - Line.FirstCharacter, 0, NumCharacters);
+		if (!Line.Glyphs.IsValid() || Visible == 0)
+			continue;
+
+		const FVector2D LinePosition = Position + FVector2D(0.0f, Line.Y * InverseScale);
+		const FVector2D LineSize = FVector2D(Line.CharacterEnds.Last(), Layout.LineHeight) * InverseScale;
+		const bool bClip = Visible < NumCharacters;
+
+		if (bClip)
+		{
+			const FVector2D ClipEnd = LinePosition + FVector2D(Line.CharacterEnds[Visible - 1] * InverseScale, LineSize.Y);
+			OutDrawElements.PushClip(FSlateClippingZone(FSlateRect(AllottedGeometry.LocalToAbsolute(LinePosition), AllottedGeometry.LocalToAbsolute(ClipEnd))));
+		}
+
+		FSlateDrawElement::MakeShapedText(OutDrawElements, LayerId, AllottedGeometry.ToPaintGeometry(LineSize, FSlateLayoutTransform(InverseScale, LinePosition)),
+			Line.Glyphs.ToSharedRef(), ESlateDrawEffect::None, Color, FLinearColor::Transparent);
+
+		if (bClip)
+			OutDrawElements.PopClip();
+	}
+
+	return Layout.Size.Y * InverseScale;
+}
+
+void USubtitleSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bAddedToViewport = false;
+	FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &USubtitleSubsystem::HandlePostLoadMap);
+}
+
+void USubtitleSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.RemoveAll(this);
+	UGameViewportClient* Viewport = GetGameInstance()->GetGameViewportClient();
+	if (bAddedToViewport && Viewport != nullptr)
+		Viewport->RemoveViewportWidgetContent(Presenter.ToSharedRef());
+
+	Presenter.Reset();
+	bAddedToViewport = false;
+	Super::Deinitialize();
+}
+
+USubtitleSubsystem* USubtitleSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<USubtitleSubsystem>() : nullptr;
+}
+
+/*
+ * Function:  GetPresenter
+ * --------------------
+ * The widget is made the first time a line is shown and stays in the viewport, empty while nothing is said.
+ * After a map load HandlePostLoadMap puts it back.
+ */
+SSubtitlePresenter& USubtitleSubsystem::GetPresenter()
+{
+	if (!Presenter.IsValid())
+	{
+		int32 FontSize = 20;
+		GConfig->GetInt(TEXT("/Script/HeavenlyBlue.SubtitlePresenter"), TEXT("FontSize"), FontSize, GGameIni);
+
+		Presenter = SNew(SSubtitlePresenter).Font(FCoreStyle::GetDefaultFontStyle("Regular", FontSize));
+		Presenter->SetVisibility(EVisibility::HitTestInvisible);
+	}
+
+	UGameViewportClient* Viewport = GetGameInstance()->GetGameViewportClient();
+	if (!bAddedToViewport && Viewport != nullptr)
+	{
+		Viewport->AddViewportWidgetContent(Presenter.ToSharedRef(), 10);
+		bAddedToViewport = true;
+	}
+
+	return *Presenter;
+}
+
+/*
+ * Function:  HandlePostLoadMap
+ * --------------------
+ * 1) LoadMap cleared the viewport, so the presenter is no longer in it whatever bAddedToViewport says.
+ * 2) A line whose owner went with the old map is cleared, then the presenter is added back.
+ *
+ */
+void USubtitleSubsystem::HandlePostLoadMap(UWorld* World)
+{
+	if (World == nullptr || World->GetGameInstance() != GetGameInstance())
+		return;
+
+	bAddedToViewport = false;
+	if (!Presenter.IsValid())
+		return;
+
+	if (!LineOwner.IsValid())
+	{
+		Presenter->Hide();
+		LineOwner.Reset();
+	}
+	GetPresenter();
+}
+
+void USubtitleSubsystem::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	if (Presenter.IsValid())
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(sizeof(SSubtitlePresenter) + Presenter->GetAllocatedSize());
+}
+
+void USubtitleSubsystem::ShowLine(const UObject* Owner, FDialogueStringHandle Speaker, FDialogueStringHandle Text, int32 VisibleCharacters)
+{
+	LineOwner = Owner;
+	GetPresenter().ShowLine(Speaker, Text, VisibleCharacters);
+}
+
+void USubtitleSubsystem::SetVisibleCharacters(const UObject* Owner, int32 VisibleCharacters)
+{
+	if (IsShowing(Owner))
+		GetPresenter().SetVisibleCharacters(VisibleCharacters);
+}
+
+void USubtitleSubsystem::ShowChoices(const UObject* Owner, const TArray<FDialogueStringHandle>& Options)
+{
+	if (IsShowing(Owner))
+		GetPresenter().ShowChoices(Options);
+}
+
+void USubtitleSubsystem::Hide(const UObject* Owner)
+{
+	if (IsShowing(Owner))
+	{
+		GetPresenter().Hide();
+		LineOwner.Reset();
+	}
+}
+
+/*
+ * Console Command:  HB.Subtitle.Stats [reset]
+ * --------------------
+ * Logs how many lines were laid out or came from the cache, and what layout and painting cost.
+ * Painting runs under -nullrhi as well, so this measures the presenter's CPU cost on its own.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GSubtitleStatsCommand(
+	TEXT("HB.Subtitle.Stats"),
+	TEXT("Logs the subtitle presenter's layout and paint cost. Usage: HB.Subtitle.Stats [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USubtitleSubsystem* Subtitles = USubtitleSubsystem::Get(World);
+		if (Subtitles == nullptr)
+			return;
+
+		SSubtitlePresenter& Presenter = Subtitles->GetPresenter();
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			Presenter.ResetStats();
+			return;
+		}
+
+		const FSubtitlePresenterStats& Stats = Presenter.GetStats();
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Subtitles: %d layouts (%.1f us each), %d cache hits, %d typewriter steps, %d paints (%.2f us each)."),
+			Stats.Layouts, Stats.LayoutSeconds * 1e6 / FMath::Max(Stats.Layouts, 1), Stats.CacheHits, Stats.Steps,
+			Stats.Paints, Stats.PaintSeconds * 1e6 / FMath::Max(Stats.Paints, 1));
+	})
+);
+
+/*
+ * Console Command:  HB.Subtitle.Benchmark [Lines]
+ * --------------------
+ * Shapes and wraps lines of typical length, to compare with a cache hit and a typewriter step (which cost nothing to lay out).
+ */
+static FAutoConsoleCommand GSubtitleBenchmarkCommand(
+	TEXT("HB.Subtitle.Benchmark"),
+	TEXT("Times laying out subtitle lines. Usage: HB.Subtitle.Benchmark [Lines=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (!FSlateApplication::IsInitialized() || FSlateApplication::Get().GetRenderer() == nullptr)
+			return;
+
+		const int32 NumLines = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+		const FSlateFontInfo Font = FCoreStyle::GetDefaultFontStyle("Regular", 20);
+		FSlateFontCache& FontCache = FSlateApplication::Get().GetRenderer()->GetFontCache().Get();
+
+		int32 NumWrapped = 0;
+		FSubtitleLayout Layout;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLines; i++)
+		{
+			const FString Text = FString::Printf(TEXT("Line %d: I left the notes on the desk by the window, but when I came back from the lab the whole dorm hallway smelled like burnt toast."), i);
+			Layout.Build(Text, Font, 900.0f, 1.0f, FontCache);
+			NumWrapped += Layout.Lines.Num() > 1 ? 1 : 0;
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Laid out %d lines (%d wrapped) in %.2f ms: %.1f us per line."),
+			NumLines, NumWrapped, Seconds * 1000.0, Seconds * 1e6 / NumLines);
+	})
+);
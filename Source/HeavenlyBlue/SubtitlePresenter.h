@@ -0,0 +1,166 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : SubtitlePresenter
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class draws the speaker, the subtitle and the choices of
+*				   the current conversation. A line is shaped and wrapped once
+*				   when it starts and cached by its string handle, the typewriter
+*				   only changes how much of it is drawn.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Fonts/ShapedTextFwd.h"
+#include "Fonts/SlateFontInfo.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Widgets/SLeafWidget.h"
+#include "DialogueStringTable.h"
+#include "SubtitlePresenter.generated.h"
+
+class FSlateFontCache;
+
+/*
+ * Struct:  FSubtitleLayout
+ * --------------------
+ * A string shaped and broken into lines for one wrap width and font scale. Sizes are in pixels.
+ */
+struct FSubtitleLayout
+{
+	struct FLine
+	{
+		FShapedGlyphSequencePtr Glyphs;
+		int32 FirstCharacter = 0;
+		// Where each character of the line ends, from the start of the line. The typewriter clips the line there.
+		TArray<float> CharacterEnds;
+		float Y = 0.0f;
+	};
+
+	// The text it was built from. A handle may be reused for other text once its table is reset.
+	FString Text;
+	TArray<FLine> Lines;
+	FVector2D Size = FVector2D::ZeroVector;
+	float LineHeight = 0.0f;
+	float WrapWidth = 0.0f;
+	float FontScale = 1.0f;
+
+	void Build(const FString& InText, const FSlateFontInfo& Font, float InWrapWidth, float InFontScale, FSlateFontCache& FontCache);
+	SIZE_T GetAllocatedSize() const;
+};
+
+struct FSubtitlePresenterStats
+{
+	int32 Layouts = 0;
+	int32 CacheHits = 0;
+	int32 Steps = 0;
+	int32 Paints = 0;
+	double LayoutSeconds = 0.0;
+	double PaintSeconds = 0.0;
+};
+
+/*
+ * Class:  SSubtitlePresenter
+ * --------------------
+ * Covers the viewport and draws the subtitle box along its bottom edge.
+ */
+class HEAVENLYBLUE_API SSubtitlePresenter : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SSubtitlePresenter) {}
+		SLATE_ARGUMENT(FSlateFontInfo, Font)
+	SLATE_END_ARGS()
+
+	// Cached layouts are dropped past this many, the ones on screen are kept.
+	static const int32 MaxCachedLayouts = 256;
+
+	void Construct(const FArguments& InArgs);
+
+	// VisibleCharacters of INDEX_NONE shows the whole line at once.
+	void ShowLine(FDialogueStringHandle Speaker, FDialogueStringHandle Text, int32 VisibleCharacters = INDEX_NONE);
+	void SetVisibleCharacters(int32 VisibleCharacters);
+	void ShowChoices(const TArray<FDialogueStringHandle>& Options);
+	void HideChoices();
+	void Hide();
+
+	bool IsShowingLine() const { return TextLayout.IsValid(); }
+
+	const FSubtitlePresenterStats& GetStats() const { return Stats; }
+	void ResetStats() { Stats = FSubtitlePresenterStats(); }
+
+	// The cached layouts and what's on screen.
+	SIZE_T GetAllocatedSize() const;
+
+	// SWidget
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+		int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override { return FVector2D::ZeroVector; }
+
+private:
+	TSharedPtr<FSubtitleLayout> FindOrBuildLayout(FDialogueStringHandle Handle) const;
+	// Builds what's on screen again, after the viewport size or DPI scale changed.
+	void RebuildVisibleLayouts() const;
+	float PaintLayout(const FSubtitleLayout& Layout, const FGeometry& AllottedGeometry, FVector2D Position, int32 VisibleCharacters, const FLinearColor& Color,
+		FSlateWindowElementList& OutDrawElements, int32 LayerId) const;
+
+	FSlateFontInfo Font;
+
+	FDialogueStringHandle SpeakerHandle;
+	FDialogueStringHandle TextHandle;
+	TArray<FDialogueStringHandle> ChoiceHandles;
+	int32 VisibleCharacters;
+
+	// What's on screen. Painting only reads these.
+	mutable TSharedPtr<FSubtitleLayout> SpeakerLayout;
+	mutable TSharedPtr<FSubtitleLayout> TextLayout;
+	mutable TArray<TSharedPtr<FSubtitleLayout>> ChoiceLayouts;
+
+	mutable TMap<FDialogueStringHandle, TSharedPtr<FSubtitleLayout>> Layouts;
+	// The wrap width and scale of the last paint, new lines are laid out for these.
+	mutable float WrapWidth;
+	mutable float FontScale;
+
+	mutable FSubtitlePresenterStats Stats;
+};
+
+UCLASS()
+class HEAVENLYBLUE_API USubtitleSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	static USubtitleSubsystem* Get(const UObject* WorldContextObject);
+
+	// Owner is whoever shows the line, only it can hide it again.
+	void ShowLine(const UObject* Owner, FDialogueStringHandle Speaker, FDialogueStringHandle Text, int32 VisibleCharacters = INDEX_NONE);
+	void SetVisibleCharacters(const UObject* Owner, int32 VisibleCharacters);
+	void ShowChoices(const UObject* Owner, const TArray<FDialogueStringHandle>& Options);
+	void Hide(const UObject* Owner);
+
+	bool IsShowing(const UObject* Owner) const { return Owner != nullptr && LineOwner.Get() == Owner; }
+
+	// The presenter's layout cache, for the memory report.
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	SSubtitlePresenter& GetPresenter();
+
+private:
+	// Loading a map removes every viewport widget, the presenter goes back in after it.
+	void HandlePostLoadMap(UWorld* World);
+
+	TSharedPtr<SSubtitlePresenter> Presenter;
+	TWeakObjectPtr<const UObject> LineOwner;
+	bool bAddedToViewport;
+};
@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VoiceBlipSynth.h"
+#include "HeavenlyBlue.h"
+#include "Math/VectorRegister.h"
+#include "Misc/ConfigCacheIni.h"
+
+namespace VoiceBlips
+{
+	TArray<FVoiceTimbre> LoadTimbres()
+	{
+		TArray<FString> Lines;
+		GConfig->GetArray(TEXT("/Script/HeavenlyBlue.VoiceBlips"), TEXT("Timbre"), Lines, GGameIni);
+
+		TArray<FVoiceTimbre> Timbres;
+		for (const FString& Line : Lines)
+		{
+			FVoiceTimbre Timbre;
+			if (FVoiceTimbre::StaticStruct()->ImportText(*Line, &Timbre, nullptr, PPF_None, GLog, TEXT("Timbre")) != nullptr)
+				Timbres.Add(Timbre);
+			else
+				UE_LOG(LogHeavenlyBlue, Warning, TEXT("Could not read the voice timbre %s."), *Line);
+		}
+		return Timbres;
+	}
+
+	// A pentatonic scale and its octave, so any run of letters sounds like speech rather than a tune.
+	const float ScaleSteps[] = { 0.0f, 2.0f, 4.0f, 7.0f, 9.0f, 12.0f };
+}
+
+const FVoiceTimbre& FVoiceTimbre::Find(const FString& Speaker)
+{
+	static const TArray<FVoiceTimbre> Timbres = VoiceBlips::LoadTimbres();
+	static const FVoiceTimbre Fallback;
+
+	const FVoiceTimbre* Default = &Fallback;
+	for (const FVoiceTimbre& Timbre : Timbres)
+	{
+		if (!Speaker.IsEmpty() && Timbre.Speaker == Speaker)
+			return Timbre;
+		if (Timbre.Speaker.IsEmpty())
+			Default = &Timbre;
+	}
+	return *Default;
+}
+
+FVoiceBlipSynth::FVoiceBlipSynth() :
+SampleRate(48000.0f),
+Phase(0.0f),
+PhaseIncrement(0.0f),
+TargetPhaseIncrement(0.0f),
+GlideDecay(0.0f),
+BlipSample(0),
+BlipLength(0),
+InvAttackSamples(1.0f),
+InvReleaseSamples(1.0f)
+{}
+
+void FVoiceBlipSynth::Init(float InSampleRate)
+{
+	SampleRate = InSampleRate;
+	BlipSample = BlipLength = 0;
+	SetTimbre(Timbre);
+}
+
+/*
+ * Function:  SetTimbre
+ * --------------------
+ * The envelope is worked out in samples here, so rendering only multiplies.
+ *
+ */
+void FVoiceBlipSynth::SetTimbre(const FVoiceTimbre& InTimbre)
+{
+	Timbre = InTimbre;
+
+	const float SamplesPerMs = SampleRate / 1000.0f;
+	InvAttackSamples = 1.0f / FMath::Max(Timbre.AttackMs * SamplesPerMs, 1.0f);
+	InvReleaseSamples = 1.0f / FMath::Max(Timbre.ReleaseMs * SamplesPerMs, 1.0f);
+
+	// The glide is mostly over a third of the way into the blip.
+	const float GlideSamples = FMath::Max(Timbre.BlipMs * SamplesPerMs / 3.0f, 4.0f);
+	GlideDecay = FMath::Exp(-4.0f / GlideSamples);
+}
+
+bool FVoiceBlipSynth::IsVoiced(TCHAR Character)
+{
+	// Letters and digits, and everything outside ASCII (kana, accented letters...).
+	return FChar::IsAlnum(Character) || uint32(Character) >= 0x80;
+}
+
+float FVoiceBlipSynth::GetPitch(TCHAR Character, const FVoiceTimbre& Timbre)
+{
+	const uint32 Hash = uint32(FChar::ToLower(Character)) * 2654435761u;
+	const float Step = VoiceBlips::ScaleSteps[(Hash >> 16) % ARRAY_COUNT(VoiceBlips::ScaleSteps)];
+	const float Semitones = Step / 12.0f * Timbre.PitchRangeSemitones;
+	return Timbre.BasePitchHz * FMath::Pow(2.0f, Semitones / 12.0f);
+}
+
+/*
+ * Function:  Trigger
+ * --------------------
+ * The phase carries on from the last blip so the waveform doesn't jump, only the envelope starts over.
+ *
+ */
+void FVoiceBlipSynth::Trigger(TCHAR Character)
+{
+	if (!IsVoiced(Character))
+		return;
+
+	TargetPhaseIncrement = GetPitch(Character, Timbre) / SampleRate;
+	PhaseIncrement = TargetPhaseIncrement * (1.0f + Timbre.Glide);
+	BlipSample = 0;
+	BlipLength = FMath::Max(FMath::RoundToInt(Timbre.BlipMs * SampleRate / 1000.0f), 4);
+}
+
+/*
+ * Function:  RenderBlock
+ * --------------------
+ * 1) The phase of each of the 4 samples, wrapped to [0, 1).
+ * 2) A triangle wave blended towards a square wave by the brightness.
+ * 3) The envelope: a linear attack and release, whichever is lower.
+ * The pitch glide is stepped once per block, a 4 sample step isn't audible.
+ *
+ */
+void FVoiceBlipSynth::RenderBlock(float* OutAudio)
+{
+	const VectorRegister Lanes = MakeVectorRegister(0.0f, 1.0f, 2.0f, 3.0f);
+	const VectorRegister One = VectorOne();
+	const VectorRegister Half = VectorSetFloat1(0.5f);
+
+	VectorRegister Phases = VectorMultiplyAdd(Lanes, VectorSetFloat1(PhaseIncrement), VectorSetFloat1(Phase));
+	Phases = VectorSubtract(Phases, VectorTruncate(Phases));
+
+	const VectorRegister Triangle = VectorSubtract(One, VectorMultiply(VectorSetFloat1(4.0f), VectorAbs(VectorSubtract(Phases, Half))));
+	const VectorRegister Square = VectorSelect(VectorCompareGE(Phases, Half), VectorNegate(One), One);
+	const VectorRegister Wave = VectorMultiplyAdd(VectorSubtract(Square, Triangle), VectorSetFloat1(Timbre.Brightness), Triangle);
+
+	const VectorRegister Time = VectorAdd(Lanes, VectorSetFloat1(float(BlipSample)));
+	const VectorRegister Attack = VectorMin(VectorMultiply(Time, VectorSetFloat1(InvAttackSamples)), One);
+	const VectorRegister Release = VectorMultiply(VectorSubtract(VectorSetFloat1(float(BlipLength)), Time), VectorSetFloat1(InvReleaseSamples));
+	const VectorRegister Envelope = VectorMax(VectorMin(Attack, Release), VectorZero());
+
+	VectorStore(VectorMultiply(Wave, VectorMultiply(Envelope, VectorSetFloat1(Timbre.Volume))), OutAudio);
+
+	Phase = FMath::Frac(Phase + 4.0f * PhaseIncrement);
+	PhaseIncrement = TargetPhaseIncrement + (PhaseIncrement - TargetPhaseIncrement) * GlideDecay;
+	BlipSample += 4;
+}
+
+/*
+ * Function:  Render
+ * --------------------
+ * The mixer's buffers are a multiple of 4 samples. Anything left over is rendered as a whole block
+ * and cut, which only happens when rendering offline.
+ *
+ */
+void FVoiceBlipSynth::Render(float* OutAudio, int32 NumSamples)
+{
+	int32 Index = 0;
+	for (; Index + 4 <= NumSamples && IsPlaying(); Index += 4)
+		RenderBlock(OutAudio + Index);
+
+	if (Index < NumSamples && IsPlaying())
+	{
+		float Tail[4];
+		RenderBlock(Tail);
+		FMemory::Memcpy(OutAudio + Index, Tail, (NumSamples - Index) * sizeof(float));
+		Index = NumSamples;
+	}
+
+	if (Index < NumSamples)
+		FMemory::Memzero(OutAudio + Index, (NumSamples - Index) * sizeof(float));
+}
+
+void FVoiceBlipSynth::RenderLine(const FString& Text, const FVoiceTimbre& Timbre, float SampleRate, float SecondsPerCharacter, TArray<float>& OutAudio)
+{
+	FVoiceBlipSynth Synth;
+	Synth.Init(SampleRate);
+	Synth.SetTimbre(Timbre);
+
+	const int32 SamplesPerCharacter = FMath::Max(FMath::RoundToInt(SecondsPerCharacter * SampleRate), 1);
+	const int32 TailSamples = FMath::RoundToInt(Timbre.BlipMs * SampleRate / 1000.0f);
+	OutAudio.SetNumUninitialized(Text.Len() * SamplesPerCharacter + TailSamples);
+
+	float* Cursor = OutAudio.GetData();
+	for (TCHAR Character : Text)
+	{
+		Synth.Trigger(Character);
+		Synth.Render(Cursor, SamplesPerCharacter);
+		Cursor += SamplesPerCharacter;
+	}
+	Synth.Render(Cursor, TailSamples);
+}
+
+UVoiceBlipComponent::UVoiceBlipComponent(const FObjectInitializer& ObjectInitializer) :
+Super(ObjectInitializer)
+{
+	NumChannels = 1;
+	bAutoActivate = false;
+	bIsUISound = true;
+}
+
+bool UVoiceBlipComponent::Init(int32& SampleRate)
+{
+	NumChannels = 1;
+	Synth.Init(float(SampleRate));
+	return true;
+}
+
+int32 UVoiceBlipComponent::OnGenerateAudio(float* OutAudio, int32 NumSamples)
+{
+	Synth.Render(OutAudio, NumSamples);
+	return NumSamples;
+}
+
+void UVoiceBlipComponent::SetSpeaker(const FString& Speaker)
+{
+	if (Speaker.IsEmpty() || Speaker == CurrentSpeaker)
+		return;
+
+	CurrentSpeaker = Speaker;
+	const FVoiceTimbre Timbre = FVoiceTimbre::Find(Speaker);
+	SynthCommand([this, Timbre]()
+	{
+		Synth.SetTimbre(Timbre);
+	});
+}
+
+/*
+ * Function:  PlayCharacter
+ * --------------------
+ * The synth keeps running between letters, it's started with the first one.
+ *
+ */
+void UVoiceBlipComponent::PlayCharacter(TCHAR Character)
+{
+	if (!FVoiceBlipSynth::IsVoiced(Character))
+		return;
+
+	if (!IsPlaying())
+		Start();
+
+	SynthCommand([this, Character]()
+	{
+		Synth.Trigger(Character);
+	});
+}
@@ -0,0 +1,149 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : VoiceBlipSynth
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This synthesizes the typewriter's voice. Every letter gets a
+*				   short blip whose pitch comes from the letter, in the timbre of
+*				   whoever is speaking, so a line sounds the same every time it's
+*				   played without a sound wave per line.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SynthComponent.h"
+#include "VoiceBlipSynth.generated.h"
+
+/*
+ * Struct:  FVoiceTimbre
+ * --------------------
+ * How one speaker sounds. Listed in [/Script/HeavenlyBlue.VoiceBlips] in DefaultGame.ini.
+ */
+USTRUCT()
+struct FVoiceTimbre
+{
+	GENERATED_BODY()
+
+	// The speaker's name as written in the script. The timbre without one is used for everyone not listed.
+	UPROPERTY()
+	FString Speaker;
+
+	// The pitch of the lowest letter.
+	UPROPERTY()
+	float BasePitchHz = 220.0f;
+
+	// Letters are spread over this many semitones above BasePitchHz.
+	UPROPERTY()
+	float PitchRangeSemitones = 7.0f;
+
+	// 0 is a soft triangle wave, 1 a buzzy square wave.
+	UPROPERTY()
+	float Brightness = 0.3f;
+
+	// Each blip starts this much higher (as a fraction of its pitch) and slides down.
+	UPROPERTY()
+	float Glide = 0.15f;
+
+	UPROPERTY()
+	float BlipMs = 55.0f;
+
+	UPROPERTY()
+	float AttackMs = 3.0f;
+
+	UPROPERTY()
+	float ReleaseMs = 30.0f;
+
+	UPROPERTY()
+	float Volume = 0.25f;
+
+	// The timbre of the speaker, or the default one.
+	static const FVoiceTimbre& Find(const FString& Speaker);
+};
+
+/*
+ * Class:  FVoiceBlipSynth
+ * --------------------
+ * The generator itself, mono. It doesn't depend on the audio mixer, so a line can be rendered
+ * to a buffer anywhere (see UVoiceRenderCommandlet).
+ */
+class HEAVENLYBLUE_API FVoiceBlipSynth
+{
+public:
+	FVoiceBlipSynth();
+
+	void Init(float InSampleRate);
+	void SetTimbre(const FVoiceTimbre& InTimbre);
+
+	// Starts the blip of a letter, cutting off the one before. Spaces and punctuation are silent.
+	void Trigger(TCHAR Character);
+
+	// Writes NumSamples samples, silence once the blip is over.
+	void Render(float* OutAudio, int32 NumSamples);
+
+	bool IsPlaying() const { return BlipSample < BlipLength; }
+
+	static bool IsVoiced(TCHAR Character);
+	// The same letter always gets the same pitch, so words keep their melody.
+	static float GetPitch(TCHAR Character, const FVoiceTimbre& Timbre);
+
+	// Renders a whole line the way the typewriter plays it, one letter every SecondsPerCharacter.
+	static void RenderLine(const FString& Text, const FVoiceTimbre& Timbre, float SampleRate, float SecondsPerCharacter, TArray<float>& OutAudio);
+
+private:
+	// Renders 4 samples, the oscillator and envelope run on 4 lanes at once.
+	void RenderBlock(float* OutAudio);
+
+	FVoiceTimbre Timbre;
+	float SampleRate;
+
+	// In cycles, [0, 1).
+	float Phase;
+	float PhaseIncrement;
+	float TargetPhaseIncrement;
+	// How much of the glide is left after each block of 4 samples.
+	float GlideDecay;
+
+	int32 BlipSample;
+	int32 BlipLength;
+	float InvAttackSamples;
+	float InvReleaseSamples;
+};
+
+/*
+ * Class:  UVoiceBlipComponent
+ * --------------------
+ * One voice per conversation. Letters are handed to the audio render thread as commands,
+ * no sound is loaded and no source is started per letter.
+ */
+UCLASS(ClassGroup = Synth, meta = (BlueprintSpawnableComponent))
+class HEAVENLYBLUE_API UVoiceBlipComponent : public USynthComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVoiceBlipComponent(const FObjectInitializer& ObjectInitializer);
+
+	// Switches to the speaker's timbre. An empty name keeps the current one.
+	void SetSpeaker(const FString& Speaker);
+	void PlayCharacter(TCHAR Character);
+
+protected:
+	virtual bool Init(int32& SampleRate) override;
+	virtual int32 OnGenerateAudio(float* OutAudio, int32 NumSamples) override;
+
+private:
+	// Only touched on the audio render thread once the synth is running.
+	FVoiceBlipSynth Synth;
+
+	FString CurrentSpeaker;
+};
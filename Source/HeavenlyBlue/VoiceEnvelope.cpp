@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VoiceEnvelope.h"
+#include "HeavenlyBlue.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Sound/SoundWave.h"
+
+namespace VoiceEnvelopeFormat
+{
+	static const uint32 Magic = 0x45564248; // "HBVE"
+	static const uint32 Version = 1;
+
+	// The loudness range the 7 bits cover, below the loudest frame.
+	const float RangeDb = 60.0f;
+	// Onsets closer together than this are one syllable.
+	const int32 MinOnsetSpacingFrames = 5;
+	// How far after an onset its syllable may become speech.
+	const int32 OnsetSnapFrames = 2;
+	// How far a word may move to start on a syllable.
+	const int32 WordSnapFrames = 10;
+}
+
+const float FVoiceEnvelope::FrameSeconds = 0.01f;
+
+/*
+ * Function:  FromAnalysis
+ * --------------------
+ * 1) Loudness relative to the loudest frame, so a quiet recording paces like a loud one.
+ * 2) Each onset goes on its frame if that frame is speech, at most one every MinOnsetSpacingFrames.
+ *
+ */
+FVoiceEnvelope FVoiceEnvelope::FromAnalysis(const TArray<float>& FrameDecibels, const TArray<float>& OnsetSeconds)
+{
+	using namespace VoiceEnvelopeFormat;
+
+	FVoiceEnvelope Envelope;
+	if (FrameDecibels.Num() == 0)
+		return Envelope;
+
+	float PeakDb = -200.0f;
+	for (const float Db : FrameDecibels)
+		PeakDb = FMath::Max(PeakDb, Db);
+	const float FloorDb = PeakDb - RangeDb;
+
+	Envelope.Frames.SetNumUninitialized(FrameDecibels.Num());
+	for (int32 Frame = 0; Frame < FrameDecibels.Num(); Frame++)
+		Envelope.Frames[Frame] = uint8(FMath::RoundToInt((FMath::Max(FrameDecibels[Frame], FloorDb) - FloorDb) / RangeDb * LoudnessMask));
+
+	TArray<float> SortedOnsets = OnsetSeconds;
+	SortedOnsets.Sort();
+	int32 LastOnset = -MinOnsetSpacingFrames;
+	for (const float Seconds : SortedOnsets)
+	{
+		const int32 Frame = FMath::RoundToInt(Seconds / FrameSeconds);
+		if (!Envelope.Frames.IsValidIndex(Frame) || Frame - LastOnset < MinOnsetSpacingFrames)
+			continue;
+
+		// The analyzer may place a syllable a frame or two before its sound gets loud.
+		for (int32 Voiced = Frame; Voiced < FMath::Min(Frame + OnsetSnapFrames + 1, Envelope.Frames.Num()); Voiced++)
+		{
+			if (Envelope.GetLoudness(Voiced) >= VoicedLoudness)
+			{
+				Envelope.Frames[Voiced] |= OnsetBit;
+				LastOnset = Voiced;
+				break;
+			}
+		}
+	}
+
+	return Envelope;
+}
+
+/*
+ * Function:  GetCharacterTimes
+ * --------------------
+ * 1) Count the speech frames, the characters are spread evenly over those rather than over the whole line.
+ * 2) The first letter of a word moves to an onset within WordSnapFrames, if there is one.
+ * 3) Times never go backwards, a snapped word can only hold the letters after it.
+ * A line without any speech in it is revealed evenly over its length.
+ *
+ */
+void FVoiceEnvelope::GetCharacterTimes(const FString& Text, TArray<float>& OutTimes) const
+{
+	using namespace VoiceEnvelopeFormat;
+
+	OutTimes.SetNumUninitialized(Text.Len());
+	if (Text.Len() == 0)
+		return;
+
+	// Speech frames up to and including each frame.
+	TArray<int32> Voiced;
+	Voiced.SetNumUninitialized(Frames.Num());
+	int32 TotalVoiced = 0;
+	for (int32 Frame = 0; Frame < Frames.Num(); Frame++)
+	{
+		TotalVoiced += GetLoudness(Frame) >= VoicedLoudness ? 1 : 0;
+		Voiced[Frame] = TotalVoiced;
+	}
+
+	for (int32 Index = 0; Index < Text.Len(); Index++)
+	{
+		float Time = GetDuration() * Index / Text.Len();
+		if (TotalVoiced > 0)
+		{
+			const int32 Target = int32(int64(Index) * TotalVoiced / Text.Len()) + 1;
+			const int32 Frame = Algo::LowerBound(Voiced, Target);
+			Time = Frame * FrameSeconds;
+
+			const bool bWordStart = Index > 0 && FChar::IsWhitespace(Text[Index - 1]) && !FChar::IsWhitespace(Text[Index]);
+			if (bWordStart)
+			{
+				int32 Nearest = INDEX_NONE;
+				for (int32 Candidate = FMath::Max(Frame - WordSnapFrames, 0); Candidate <= FMath::Min(Frame + WordSnapFrames, Frames.Num() - 1); Candidate++)
+				{
+					if (IsOnset(Candidate) && (Nearest == INDEX_NONE || FMath::Abs(Candidate - Frame) < FMath::Abs(Nearest - Frame)))
+						Nearest = Candidate;
+				}
+				if (Nearest != INDEX_NONE)
+					Time = Nearest * FrameSeconds;
+			}
+		}
+
+		OutTimes[Index] = Index > 0 ? FMath::Max(Time, OutTimes[Index - 1]) : Time;
+	}
+}
+
+/*
+ * Function:  Get
+ * --------------------
+ * This returns the game's table. The first call reads the file named in the config, a game without voice lines doesn't have one.
+ *
+ */
+FVoiceEnvelopeTable& FVoiceEnvelopeTable::Get()
+{
+	static FVoiceEnvelopeTable Table;
+	static bool bLoaded = false;
+	if (!bLoaded)
+	{
+		bLoaded = true;
+
+		FString File = TEXT("Dialogue/VoiceEnvelopes.hbve");
+		GConfig->GetString(TEXT("/Script/HeavenlyBlue.VoiceEnvelopes"), TEXT("File"), File, GGameIni);
+		Table.Load(FPaths::ProjectContentDir() / File);
+	}
+	return Table;
+}
+
+const FVoiceEnvelope* FVoiceEnvelopeTable::Find(const USoundWave* Sound) const
+{
+	if (Sound == nullptr || Envelopes.Num() == 0)
+		return nullptr;
+
+	return Envelopes.Find(FName(*Sound->GetPathName()));
+}
+
+bool FVoiceEnvelopeTable::Load(const FString& Filename)
+{
+	Envelopes.Reset();
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename, FILEREAD_Silent))
+		return false;
+
+	FMemoryReader Reader(Data);
+	uint32 Magic = 0, Version = 0;
+	int32 Count = 0;
+	Reader << Magic << Version << Count;
+	if (Magic != VoiceEnvelopeFormat::Magic || Version != VoiceEnvelopeFormat::Version || Count < 0)
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s is not a valid voice envelope table."), *Filename);
+		return false;
+	}
+
+	Envelopes.Reserve(Count);
+	for (int32 Index = 0; Index < Count && !Reader.IsError(); Index++)
+	{
+		FString Path;
+		FVoiceEnvelope Envelope;
+		Reader << Path << Envelope;
+		Envelopes.Add(FName(*Path), MoveTemp(Envelope));
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogHeavenlyBlue, Warning, TEXT("%s is truncated."), *Filename);
+		Envelopes.Reset();
+		return false;
+	}
+	return true;
+}
+
+bool FVoiceEnvelopeTable::Write(const TMap<FName, FVoiceEnvelope>& Envelopes, const FString& Filename)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = VoiceEnvelopeFormat::Magic, Version = VoiceEnvelopeFormat::Version;
+	int32 Count = Envelopes.Num();
+	Writer << Magic << Version << Count;
+	for (const TPair<FName, FVoiceEnvelope>& Pair : Envelopes)
+	{
+		FString Path = Pair.Key.ToString();
+		FVoiceEnvelope Envelope = Pair.Value;
+		Writer << Path << Envelope;
+	}
+
+	return FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+SIZE_T FVoiceEnvelopeTable::GetAllocatedSize() const
+{
+	SIZE_T Size = Envelopes.GetAllocatedSize();
+	for (const TPair<FName, FVoiceEnvelope>& Pair : Envelopes)
+		Size += Pair.Value.Frames.GetAllocatedSize();
+	return Size;
+}
@@ -0,0 +1,83 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : VoiceEnvelope
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This holds the loudness and onsets of each recorded voice
+*				   line, baked offline by the VoiceEnvelopeBake commandlet, so
+*				   the typewriter can reveal a subtitle in step with its audio
+*				   without analysing anything while the game runs.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USoundWave;
+
+/*
+ * Struct:  FVoiceEnvelope
+ * --------------------
+ * One byte per 10 ms frame: the loudness in the low 7 bits, 0 to 127 for 60 dB below the line's
+ * loudest frame up to it, and whether a syllable starts in the frame in the top bit.
+ */
+struct HEAVENLYBLUE_API FVoiceEnvelope
+{
+	static const float FrameSeconds;
+	static const uint8 OnsetBit = 0x80;
+	static const uint8 LoudnessMask = 0x7F;
+	// Frames from 35 dB below the loudest frame up count as speech, quieter ones are pauses.
+	static const uint8 VoicedLoudness = 53;
+
+	TArray<uint8> Frames;
+
+	float GetDuration() const { return Frames.Num() * FrameSeconds; }
+	uint8 GetLoudness(int32 Frame) const { return Frames[Frame] & LoudnessMask; }
+	bool IsOnset(int32 Frame) const { return (Frames[Frame] & OnsetBit) != 0; }
+
+	// Quantizes an analysis of a line: its level in dB every FrameSeconds, and the times syllables start.
+	// Onsets in pauses are dropped, and ones closer together than a syllable are merged.
+	static FVoiceEnvelope FromAnalysis(const TArray<float>& FrameDecibels, const TArray<float>& OnsetSeconds);
+
+	// When each character of Text should appear, in seconds from the start of the line. The text
+	// only advances while the line is audible, and words start on the syllable nearest them.
+	void GetCharacterTimes(const FString& Text, TArray<float>& OutTimes) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FVoiceEnvelope& Envelope)
+	{
+		return Ar << Envelope.Frames;
+	}
+};
+
+/*
+ * Class:  FVoiceEnvelopeTable
+ * --------------------
+ * The envelopes of every baked line, by the sound wave's path. The whole file is read on first use,
+ * see [/Script/HeavenlyBlue.VoiceEnvelopes] in DefaultGame.ini.
+ */
+class HEAVENLYBLUE_API FVoiceEnvelopeTable
+{
+public:
+	static FVoiceEnvelopeTable& Get();
+
+	// Null if the sound has no baked envelope, then it isn't a voice line.
+	const FVoiceEnvelope* Find(const USoundWave* Sound) const;
+
+	bool Load(const FString& Filename);
+	static bool Write(const TMap<FName, FVoiceEnvelope>& Envelopes, const FString& Filename);
+
+	int32 Num() const { return Envelopes.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	TMap<FName, FVoiceEnvelope> Envelopes;
+};
@@ -0,0 +1,390 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VoiceEnvelopeBakeCommandlet.h"
+#include "HeavenlyBlue.h"
+#include "VoiceEnvelope.h"
+#include "AConversationInstance.h"
+#include "DialogueBank.h"
+#include "DialogueScriptImporter.h"
+#include "Audio.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Paths.h"
+#include "Sound/SoundWave.h"
+#include "UObject/Package.h"
+
+#if WITH_EDITOR
+#include "LoudnessNRTFactory.h"
+#include "OnsetNRTFactory.h"
+#endif
+
+/*
+ * Function:  UVoiceEnvelopeBakeCommandlet
+ * --------------------
+ * The bake reads the imported source audio, it needs neither a renderer nor an audio device.
+ *
+ */
+UVoiceEnvelopeBakeCommandlet::UVoiceEnvelopeBakeCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+#if WITH_EDITOR
+namespace VoiceEnvelopeBake
+{
+	/*
+	 * Function:  AnalyzeSamples
+	 * --------------------
+	 * 1) Run AudioSynesthesia's loudness analyzer over the line, one window per envelope frame, and its onset analyzer on the mix.
+	 * 2) Turn each window's energy into dB, frames the analyzer didn't reach are silent.
+	 * 3) Quantize both into an envelope.
+	 *
+	 * Samples: Interleaved, -1 to 1.
+	 *
+	 */
+	FVoiceEnvelope AnalyzeSamples(const TArray<float>& Samples, int32 NumChannels, float SampleRate)
+	{
+		if (NumChannels <= 0 || SampleRate <= 0.0f || Samples.Num() < NumChannels)
+			return FVoiceEnvelope();
+
+		const Audio::FAnalyzerNRTParameters Parameters(SampleRate, NumChannels);
+
+		Audio::FLoudnessNRTSettings LoudnessSettings;
+		LoudnessSettings.AnalysisPeriod = FVoiceEnvelope::FrameSeconds;
+		Audio::FLoudnessNRTFactory LoudnessFactory;
+		TUniquePtr<Audio::IAnalyzerNRTResult> LoudnessResult = LoudnessFactory.NewResult();
+		TUniquePtr<Audio::IAnalyzerNRTWorker> LoudnessWorker = LoudnessFactory.NewWorker(Parameters, &LoudnessSettings);
+		LoudnessWorker->Analyze(MakeArrayView(Samples), LoudnessResult.Get());
+		LoudnessWorker->Finalize(LoudnessResult.Get());
+
+		Audio::FOnsetNRTSettings OnsetSettings;
+		OnsetSettings.bDownmixToMono = true;
+		Audio::FOnsetNRTFactory OnsetFactory;
+		TUniquePtr<Audio::IAnalyzerNRTResult> OnsetResult = OnsetFactory.NewResult();
+		TUniquePtr<Audio::IAnalyzerNRTWorker> OnsetWorker = OnsetFactory.NewWorker(Parameters, &OnsetSettings);
+		OnsetWorker->Analyze(MakeArrayView(Samples), OnsetResult.Get());
+		OnsetWorker->Finalize(OnsetResult.Get());
+
+		const int32 NumFrames = FMath::CeilToInt(Samples.Num() / NumChannels / (SampleRate * FVoiceEnvelope::FrameSeconds));
+		TArray<float> FrameDecibels;
+		FrameDecibels.Init(-200.0f, NumFrames);
+		const Audio::FLoudnessNRTResult& Loudness = static_cast<const Audio::FLoudnessNRTResult&>(*LoudnessResult);
+		for (const Audio::FLoudnessDatum& Datum : Loudness.GetChannelLoudnessArray(Audio::FLoudnessNRTResult::ChannelIndexOverall))
+		{
+			const int32 Frame = FMath::FloorToInt(Datum.Timestamp / FVoiceEnvelope::FrameSeconds);
+			if (FrameDecibels.IsValidIndex(Frame))
+				FrameDecibels[Frame] = 10.0f * FMath::LogX(10.0f, FMath::Max(Datum.Energy, 1e-20f));
+		}
+
+		TArray<float> OnsetSeconds;
+		const Audio::FOnsetNRTResult& Onsets = static_cast<const Audio::FOnsetNRTResult&>(*OnsetResult);
+		for (const Audio::FOnset& Onset : Onsets.GetOnsetsForChannel(0))
+			OnsetSeconds.Add(Onset.Timestamp);
+
+		return FVoiceEnvelope::FromAnalysis(FrameDecibels, OnsetSeconds);
+	}
+
+	/*
+	 * Function:  RunSelfTest
+	 * --------------------
+	 * 1) Synthesize four syllables of a 200 Hz tone, 150 ms each, 300 ms apart, in stereo.
+	 * 2) Each has to give one onset within OnsetSlack frames of its start, and none anywhere else. The middle of
+	 *    each syllable has to be speech and the middle of each gap a pause, the analysis windows blur the edges.
+	 * 3) The same line 20 dB quieter has to give the same envelope, loudness is relative to the line.
+	 * 4) The words of a four word line have to start on the syllables.
+	 *
+	 */
+	bool RunSelfTest()
+	{
+		const int32 SampleRate = 16000;
+		const int32 FrameLength = FMath::RoundToInt(SampleRate * FVoiceEnvelope::FrameSeconds);
+		const int32 SyllableFrames[] = { 20, 50, 80, 110 };
+		const int32 SyllableLength = 15;
+		const int32 NumFrames = 140;
+		const int32 OnsetSlack = 2;
+
+		auto Synthesize = [&](float Amplitude)
+		{
+			TArray<float> Samples;
+			Samples.SetNumZeroed(NumFrames * FrameLength * 2);
+			for (const int32 First : SyllableFrames)
+			{
+				for (int32 Sample = First * FrameLength; Sample < (First + SyllableLength) * FrameLength; Sample++)
+				{
+					const float Value = Amplitude * FMath::Sin(2.0f * PI * 200.0f * Sample / SampleRate);
+					Samples[Sample * 2] = Value;
+					Samples[Sample * 2 + 1] = Value;
+				}
+			}
+			return AnalyzeSamples(Samples, 2, SampleRate);
+		};
+
+		int32 Failures = 0;
+		const FVoiceEnvelope Loud = Synthesize(0.5f);
+		if (Loud.Frames.Num() != NumFrames)
+		{
+			UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: %d frames instead of %d."), Loud.Frames.Num(), NumFrames);
+			return false;
+		}
+
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			// How far into the nearest syllable the frame is, negative before it.
+			int32 Offset = MAX_int32;
+			for (const int32 First : SyllableFrames)
+			{
+				if (FMath::Abs(Frame - First) < FMath::Abs(Offset) || (Frame >= First && Frame < First + SyllableLength))
+					Offset = Frame - First;
+			}
+
+			const bool bSpeech = Offset >= OnsetSlack && Offset < SyllableLength - OnsetSlack;
+			const bool bPause = Offset < -OnsetSlack || Offset >= SyllableLength + OnsetSlack;
+			const bool bVoiced = Loud.GetLoudness(Frame) >= FVoiceEnvelope::VoicedLoudness;
+			if ((bSpeech && !bVoiced) || (bPause && bVoiced))
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: frame %d has loudness %d, expected %s."), Frame, Loud.GetLoudness(Frame), bSpeech ? TEXT("speech") : TEXT("a pause"));
+				Failures++;
+			}
+			if (Loud.IsOnset(Frame) && FMath::Abs(Offset) > OnsetSlack)
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: frame %d has an onset, %d frames from the nearest syllable."), Frame, Offset);
+				Failures++;
+			}
+		}
+
+		for (const int32 First : SyllableFrames)
+		{
+			int32 Found = 0;
+			for (int32 Frame = First - OnsetSlack; Frame <= First + OnsetSlack; Frame++)
+				Found += Loud.IsOnset(Frame) ? 1 : 0;
+			if (Found != 1)
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: the syllable at frame %d has %d onsets."), First, Found);
+				Failures++;
+			}
+		}
+
+		const FVoiceEnvelope Quiet = Synthesize(0.05f);
+		for (int32 Frame = 0; Frame < FMath::Min(Quiet.Frames.Num(), NumFrames); Frame++)
+		{
+			if (Quiet.IsOnset(Frame) != Loud.IsOnset(Frame) || FMath::Abs(Quiet.GetLoudness(Frame) - Loud.GetLoudness(Frame)) > 2)
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: frame %d of the quiet line differs from the loud one."), Frame);
+				Failures++;
+			}
+		}
+
+		const FString Text = TEXT("one two six ten");
+		TArray<float> Times;
+		Loud.GetCharacterTimes(Text, Times);
+		for (int32 Index = 0; Index < Text.Len(); Index++)
+		{
+			if (Index > 0 && Times[Index] < Times[Index - 1])
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: letter %d appears before the one in front of it."), Index);
+				Failures++;
+			}
+
+			const bool bWordStart = Index > 0 && Text[Index - 1] == TEXT(' ') && Text[Index] != TEXT(' ');
+			const int32 Frame = FMath::RoundToInt(Times[Index] / FVoiceEnvelope::FrameSeconds);
+			if (bWordStart && !(Loud.Frames.IsValidIndex(Frame) && Loud.IsOnset(Frame)))
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Self test: the word at letter %d starts at %.2f s, not on a syllable."), Index, Times[Index]);
+				Failures++;
+			}
+		}
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("Voice envelope self test %s (%d failures)."), Failures == 0 ? TEXT("passed") : TEXT("failed"), Failures);
+		return Failures == 0;
+	}
+
+	void AddSubtitleSounds(const TArray<FConversationNode>& ConversationList, TSet<FString>& OutSounds)
+	{
+		for (const FConversationNode& Conversation : ConversationList)
+		{
+			for (const FDialogueNode& Dialogue : Conversation.DialougeNodes)
+			{
+				for (const FSubtitleNode& Subtitle : Dialogue.SubtitlesNodes)
+				{
+					if (Subtitle.SubtitleSound != nullptr)
+						OutSounds.Add(Subtitle.SubtitleSound->GetPathName());
+				}
+			}
+		}
+	}
+
+	void AddScriptSounds(const FString& Script, TSet<FString>& ImportedScripts, TSet<FString>& OutSounds)
+	{
+		const FString Filename = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Script);
+		if (Script.IsEmpty() || ImportedScripts.Contains(Filename))
+			return;
+		ImportedScripts.Add(Filename);
+
+		FDialogueScriptImporter Importer;
+		TMap<FName, FImportedConversation> Conversations;
+		if (!Importer.ImportFile(Filename, Conversations))
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Couldn't import %s."), *Filename);
+			return;
+		}
+		for (const TPair<FName, FImportedConversation>& Conversation : Conversations)
+			AddSubtitleSounds(Conversation.Value.ConversationList, OutSounds);
+	}
+
+	bool AnalyzeWave(USoundWave* Wave, FVoiceEnvelope& OutEnvelope)
+	{
+		const int32 RawSize = Wave->RawData.GetBulkDataSize();
+		if (RawSize <= 0)
+			return false;
+
+		const uint8* RawData = (const uint8*)Wave->RawData.LockReadOnly();
+		FWaveModInfo WaveInfo;
+		const bool bValid = WaveInfo.ReadWaveInfo(RawData, RawSize) && *WaveInfo.pBitsPerSample == 16;
+		TArray<float> Samples;
+		if (bValid)
+		{
+			const int16* Pcm = (const int16*)WaveInfo.SampleDataStart;
+			Samples.SetNumUninitialized(WaveInfo.SampleDataSize / sizeof(int16));
+			for (int32 Sample = 0; Sample < Samples.Num(); Sample++)
+				Samples[Sample] = Pcm[Sample] / 32768.0f;
+		}
+		Wave->RawData.Unlock();
+
+		if (!bValid)
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Skipping %s, its source audio is not 16-bit PCM."), *Wave->GetPathName());
+			return false;
+		}
+
+		OutEnvelope = AnalyzeSamples(Samples, *WaveInfo.pChannels, *WaveInfo.pSamplesPerSec);
+		return true;
+	}
+}
+#endif
+
+/*
+ * Function:  Main
+ * --------------------
+ * 1) Gather the sounds subtitles play: from the dialogue bank, the scripts given, and the conversations placed in the maps given.
+ * 2) Analyse the source audio of those long enough to be voice lines with AudioSynesthesia into an envelope.
+ * 3) Write them all into one table.
+ *
+ * Params: The command line, see the header for the switches.
+ *
+ */
+int32 UVoiceEnvelopeBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace VoiceEnvelopeBake;
+
+	if (FParse::Param(*Params, TEXT("SelfTest")))
+		return RunSelfTest() ? 0 : 1;
+
+	float MinSeconds = 1.0f;
+	FString ScriptList;
+	FString MapList;
+	FString TableFile = TEXT("Dialogue/VoiceEnvelopes.hbve");
+	GConfig->GetString(TEXT("/Script/HeavenlyBlue.VoiceEnvelopes"), TEXT("File"), TableFile, GGameIni);
+	FString OutFilename = FPaths::ProjectContentDir() / TableFile;
+	FParse::Value(*Params, TEXT("MinSeconds="), MinSeconds);
+	FParse::Value(*Params, TEXT("Script="), ScriptList);
+	FParse::Value(*Params, TEXT("Map="), MapList);
+	FParse::Value(*Params, TEXT("Out="), OutFilename);
+
+	const double StartTime = FPlatformTime::Seconds();
+	TSet<FString> SoundPaths;
+	TSet<FString> ImportedScripts;
+
+	TArray<FName> Keys;
+	FDialogueBank::Get().GetConversationKeys(Keys);
+	for (const FName Key : Keys)
+	{
+		TArray<FConversationNode> ConversationList;
+		TArray<FQuestionNode> QuestionList;
+		if (FDialogueBank::Get().DecodeConversation(Key, ConversationList, QuestionList))
+			AddSubtitleSounds(ConversationList, SoundPaths);
+	}
+
+	TArray<FString> Scripts;
+	ScriptList.ParseIntoArray(Scripts, TEXT("+"));
+	for (const FString& Script : Scripts)
+		AddScriptSounds(Script, ImportedScripts, SoundPaths);
+
+	// Placed conversations have their own nodes or a script of their own.
+	TArray<FString> Maps;
+	MapList.ParseIntoArray(Maps, TEXT("+"));
+	for (const FString& Map : Maps)
+	{
+		UPackage* Package = LoadPackage(nullptr, *Map, LOAD_None);
+		UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr || World->PersistentLevel == nullptr)
+		{
+			UE_LOG(LogHeavenlyBlue, Warning, TEXT("Couldn't load the map %s."), *Map);
+			continue;
+		}
+
+		for (AActor* Actor : World->PersistentLevel->Actors)
+		{
+			if (AAConversationInstance* Conversation = Cast<AAConversationInstance>(Actor))
+			{
+				AddSubtitleSounds(Conversation->ConversationList, SoundPaths);
+				AddScriptSounds(Conversation->ScriptFile.FilePath, ImportedScripts, SoundPaths);
+			}
+		}
+	}
+	FDialogueStringTable::Get().Reset();
+
+	TArray<FString> SortedPaths = SoundPaths.Array();
+	SortedPaths.Sort();
+
+	TMap<FName, FVoiceEnvelope> Envelopes;
+	int32 Skipped = 0, Onsets = 0;
+	float TotalSeconds = 0.0f;
+	for (const FString& Path : SortedPaths)
+	{
+		// Short sounds are blips played per letter, not recorded lines.
+		USoundWave* Wave = LoadObject<USoundWave>(nullptr, *Path);
+		if (Wave == nullptr || Wave->Duration < MinSeconds)
+		{
+			Skipped++;
+			continue;
+		}
+
+		FVoiceEnvelope Envelope;
+		if (!AnalyzeWave(Wave, Envelope))
+		{
+			Skipped++;
+			continue;
+		}
+
+		int32 LineOnsets = 0;
+		for (int32 Frame = 0; Frame < Envelope.Frames.Num(); Frame++)
+			LineOnsets += Envelope.IsOnset(Frame) ? 1 : 0;
+
+		UE_LOG(LogHeavenlyBlue, Verbose, TEXT("%s: %.2f s, %d onsets."), *Wave->GetName(), Envelope.GetDuration(), LineOnsets);
+		Onsets += LineOnsets;
+		TotalSeconds += Envelope.GetDuration();
+		Envelopes.Add(FName(*Path), MoveTemp(Envelope));
+	}
+
+	if (!FVoiceEnvelopeTable::Write(Envelopes, OutFilename))
+	{
+		UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write %s."), *OutFilename);
+		return 1;
+	}
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Baked %d voice lines (%.1f s of audio, %d onsets, %d subtitle sounds skipped) from %d conversations, %d scripts and %d maps in %.2f s into %s (%lld bytes)."),
+		Envelopes.Num(), TotalSeconds, Onsets, Skipped, Keys.Num(), ImportedScripts.Num(), Maps.Num(), FPlatformTime::Seconds() - StartTime,
+		*OutFilename, IFileManager::Get().FileSize(*OutFilename));
+	return 0;
+#else
+	UE_LOG(LogHeavenlyBlue, Error, TEXT("The voice envelope bake needs editor data, run it from the editor executable."));
+	return 1;
+#endif
+}
@@ -0,0 +1,48 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : VoiceEnvelopeBakeCommandlet
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This commandlet analyses every recorded voice line and writes
+*				   their loudness and onset envelopes into the table the
+*				   typewriter paces subtitles with (see FVoiceEnvelopeTable).
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VoiceEnvelopeBakeCommandlet.generated.h"
+
+/*
+ * Usage:
+ *   UE4Editor-Cmd HeavenlyBlue.uproject -run=VoiceEnvelopeBake -nullrhi -nosound
+ *		[-Script=<A.csv>[+<B.csv>]]	Scripts whose subtitle sounds are baked too, the dialogue bank's always are.
+ *		[-Map=/Game/Maps/A[+...]]		Maps whose placed conversations' own nodes and scripts are baked too.
+ *		[-MinSeconds=1.0]			Shorter subtitle sounds are blips, not lines, and get no envelope.
+ *		[-Out=<file>]				Defaults to the table the game reads, see [/Script/HeavenlyBlue.VoiceEnvelopes].
+ *		[-SelfTest]					Only checks the analysis against a synthesized line, returns 1 if it fails.
+ *
+ * Only sounds subtitles play are baked, music and ambience never get an envelope.
+ * The source audio has to be 16-bit PCM, which is what the editor keeps for imported waves. It is
+ * analysed with the AudioSynesthesia plugin's loudness and onset analyzers, so the plugin has to be enabled.
+ */
+UCLASS()
+class HEAVENLYBLUE_API UVoiceEnvelopeBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVoiceEnvelopeBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VoiceRenderCommandlet.h"
+#include "HeavenlyBlue.h"
+#include "VoiceBlipSynth.h"
+#include "Audio.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/*
+ * Function:  UVoiceRenderCommandlet
+ * --------------------
+ * The synth renders to memory, it needs neither a renderer nor an audio device.
+ *
+ */
+UVoiceRenderCommandlet::UVoiceRenderCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+/*
+ * Function:  Main
+ * --------------------
+ * 1) Render the line with the speaker's timbre, timing how long that takes.
+ * 2) Check the samples: anything not finite, past full scale or all silence fails.
+ * 3) Save it as a 16-bit mono wave file.
+ *
+ * Params: The command line, see the header for the switches.
+ *
+ */
+int32 UVoiceRenderCommandlet::Main(const FString& Params)
+{
+	FString Text;
+	FString Speaker;
+	float SecondsPerCharacter = 0.05f;
+	int32 SampleRate = 48000;
+	FParse::Value(*Params, TEXT("Text="), Text);
+	FParse::Value(*Params, TEXT("Speaker="), Speaker);
+	FParse::Value(*Params, TEXT("CharSeconds="), SecondsPerCharacter);
+	FParse::Value(*Params, TEXT("Rate="), SampleRate);
+
+	FString OutPath = FPaths::ProjectSavedDir() / TEXT("Voice") / (Speaker.IsEmpty() ? TEXT("Default") : *Speaker) + TEXT(".wav");
+	FParse::Value(*Params, TEXT("Out="), OutPath);
+
+	if (Text.IsEmpty() || SampleRate <= 0 || SecondsPerCharacter <= 0.0f)
+	{
+		UE_LOG(LogHeavenlyBlue, Error, TEXT("Nothing to render, see UVoiceRenderCommandlet for the switches."));
+		return 1;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<float> Samples;
+	FVoiceBlipSynth::RenderLine(Text, FVoiceTimbre::Find(Speaker), float(SampleRate), SecondsPerCharacter, Samples);
+	const double RenderSeconds = FPlatformTime::Seconds() - StartTime;
+
+	float Peak = 0.0f;
+	double SumSquares = 0.0;
+	bool bFinite = true;
+	for (float Sample : Samples)
+	{
+		bFinite &= FMath::IsFinite(Sample);
+		Peak = FMath::Max(Peak, FMath::Abs(Sample));
+		SumSquares += Sample * Sample;
+	}
+	const float Rms = Samples.Num() > 0 ? float(FMath::Sqrt(SumSquares / Samples.Num())) : 0.0f;
+	const double LineSeconds = double(Samples.Num()) / SampleRate;
+
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Rendered %d characters, %.2f s of audio in %.3f ms (%.0fx realtime): peak %.3f, RMS %.3f."),
+		Text.Len(), LineSeconds, RenderSeconds * 1000.0, RenderSeconds > 0.0 ? LineSeconds / RenderSeconds : 0.0, Peak, Rms);
+
+	TArray<int16> PCM;
+	PCM.SetNumUninitialized(Samples.Num());
+	for (int32 Index = 0; Index < Samples.Num(); Index++)
+		PCM[Index] = int16(FMath::Clamp(Samples[Index], -1.0f, 1.0f) * 32767.0f);
+
+	TArray<uint8> WaveFile;
+	SerializeWaveFile(WaveFile, (const uint8*)PCM.GetData(), PCM.Num() * sizeof(int16), 1, SampleRate);
+	if (!FFileHelper::SaveArrayToFile(WaveFile, *OutPath))
+	{
+		UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not write %s."), *OutPath);
+		return 1;
+	}
+	UE_LOG(LogHeavenlyBlue, Display, TEXT("Saved %s."), *OutPath);
+
+	if (!bFinite || Peak > 1.0f || Peak <= 0.0f)
+	{
+		UE_LOG(LogHeavenlyBlue, Error, TEXT("The line is %s."), !bFinite ? TEXT("not finite") : Peak > 1.0f ? TEXT("clipping") : TEXT("silent"));
+		return 1;
+	}
+	return 0;
+}
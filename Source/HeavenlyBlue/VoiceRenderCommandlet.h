@@ -0,0 +1,45 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : VoiceRenderCommandlet
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This commandlet renders a line of dialogue with the voice
+*				   synth to a wave file, without an audio device, so timbres can
+*				   be listened to and checked on a build machine.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VoiceRenderCommandlet.generated.h"
+
+/*
+ * Usage:
+ *   UE4Editor-Cmd HeavenlyBlue.uproject -run=VoiceRender -nullrhi -nosound -Text="Hello there!"
+ *		[-Speaker=<name>]			Timbre from [/Script/HeavenlyBlue.VoiceBlips], the default one if not listed.
+ *		[-CharSeconds=0.05]			Time between letters, as the typewriter would play them.
+ *		[-Rate=48000]				Sample rate of the wave file.
+ *		[-Out=<file>]				Defaults to Saved/Voice/<Speaker>.wav.
+ *
+ * Returns 1 if the line rendered silent, clipped or not finite.
+ */
+UCLASS()
+class HEAVENLYBLUE_API UVoiceRenderCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVoiceRenderCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,869 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldStateScript.h"
+#include "HeavenlyBlue.h"
+#include "WorldStateSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+
+namespace WorldStateScriptPrivate
+{
+	// An instruction is one word: the op in the low 8 bits, a signed 24 bit operand above it.
+	enum EOp : uint8
+	{
+		Op_PushInt,
+		// The value is the next word, for numbers that don't fit the operand.
+		Op_PushWide,
+		Op_PushFlag,
+		Op_PushCounter,
+		Op_PushItems,
+		Op_Not,
+		Op_Neg,
+		Op_Add,
+		Op_Sub,
+		Op_Equal,
+		Op_NotEqual,
+		Op_Less,
+		Op_LessEqual,
+		Op_Greater,
+		Op_GreaterEqual,
+		// and/or: if the top decides the result, jump and keep it, otherwise pop it and go on.
+		Op_JumpIfFalse,
+		Op_JumpIfTrue,
+		Op_SetFlag,
+		Op_SetCounter,
+		Op_AddItems,
+		Op_Return,
+	};
+
+	const TCHAR* OpNames[] = { TEXT("PushInt"), TEXT("PushWide"), TEXT("PushFlag"), TEXT("PushCounter"), TEXT("PushItems"), TEXT("Not"), TEXT("Neg"),
+		TEXT("Add"), TEXT("Sub"), TEXT("Equal"), TEXT("NotEqual"), TEXT("Less"), TEXT("LessEqual"), TEXT("Greater"), TEXT("GreaterEqual"),
+		TEXT("JumpIfFalse"), TEXT("JumpIfTrue"), TEXT("SetFlag"), TEXT("SetCounter"), TEXT("AddItems"), TEXT("Return") };
+	static_assert(ARRAY_COUNT(OpNames) == Op_Return + 1, "Every op needs a name.");
+
+	const int32 MinOperand = -(1 << 23);
+	const int32 MaxOperand = (1 << 23) - 1;
+
+	uint32 Encode(EOp Op, int32 Operand) { return uint32(Op) | (uint32(Operand) << 8); }
+	int32 DecodeOperand(uint32 Word) { return int32(Word) >> 8; }
+
+	enum class ETokenKind : uint8
+	{
+		End,
+		Name,
+		Number,
+		LeftParen,
+		RightParen,
+		Comma,
+		Semicolon,
+		Not,
+		And,
+		Or,
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Plus,
+		Minus,
+		Assign,
+		PlusAssign,
+		MinusAssign,
+		Invalid,
+	};
+
+	enum class ENodeKind : uint8
+	{
+		Number,
+		Bool,
+		Name,
+		Items,
+		Not,
+		Neg,
+		Binary,
+		And,
+		Or,
+	};
+
+	struct FNode
+	{
+		ENodeKind Kind = ENodeKind::Number;
+		// Add, Sub or a comparison, for Binary nodes.
+		EOp Op = Op_Add;
+		// The number, bool or item ID.
+		int32 Value = 0;
+		FName Name;
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+	};
+
+	/*
+	 * Class:  FCompiler
+	 * --------------------
+	 * Parses the source into a small tree first, since whether a name is a flag or a counter
+	 * depends on what's around it, then emits the tree. Only used while loading.
+	 */
+	class FCompiler
+	{
+	public:
+		FCompiler(const FString& InSource, UWorldStateSubsystem& InWorldState, TArray<uint32>& InCode) :
+		Source(*InSource),
+		Cursor(*InSource),
+		WorldState(InWorldState),
+		Code(InCode),
+		Depth(0)
+		{
+			Next();
+		}
+
+		bool CompileCondition();
+		bool CompileAction();
+
+		FString Error;
+
+	private:
+		void Next();
+		bool Accept(ETokenKind Kind);
+		bool Expect(ETokenKind Kind, const TCHAR* What);
+		bool Fail(const FString& Message);
+
+		int32 AddNode(ENodeKind Kind, int32 Value = 0, int32 Left = INDEX_NONE, int32 Right = INDEX_NONE);
+		int32 ParseOr();
+		int32 ParseAnd();
+		int32 ParseNot();
+		int32 ParseCompare();
+		int32 ParseSum();
+		int32 ParseUnary();
+		int32 ParsePrimary();
+		int32 ParseItem();
+		int32 ParseItemCall(bool bHas);
+
+		bool IsBool(int32 Node) const;
+		void Emit(int32 Node, bool bWantBool);
+		void EmitOp(EOp Op, int32 Operand = 0);
+		void EmitInt(int32 Value);
+
+		const TCHAR* Source;
+		const TCHAR* Cursor;
+		ETokenKind Token;
+		const TCHAR* TokenBegin;
+		int32 TokenLength;
+		int64 TokenNumber;
+
+		UWorldStateSubsystem& WorldState;
+		TArray<uint32>& Code;
+		TArray<FNode, TInlineAllocator<32>> Nodes;
+		int32 Depth;
+	};
+
+	void FCompiler::Next()
+	{
+		while (FChar::IsWhitespace(*Cursor))
+			Cursor++;
+
+		TokenBegin = Cursor;
+		TokenLength = 0;
+		const TCHAR Char = *Cursor;
+
+		if (Char == '\0')
+		{
+			Token = ETokenKind::End;
+			return;
+		}
+
+		if (FChar::IsAlpha(Char) || Char == '_')
+		{
+			while (FChar::IsAlnum(*Cursor) || *Cursor == '_' || *Cursor == '.')
+				Cursor++;
+			TokenLength = int32(Cursor - TokenBegin);
+
+			const FString Word(TokenLength, TokenBegin);
+			if (Word == TEXT("and"))
+				Token = ETokenKind::And;
+			else if (Word == TEXT("or"))
+				Token = ETokenKind::Or;
+			else if (Word == TEXT("not"))
+				Token = ETokenKind::Not;
+			else
+				Token = ETokenKind::Name;
+			return;
+		}
+
+		if (FChar::IsDigit(Char))
+		{
+			// Anything past MAX_int32 is rejected later, so the value stops one past it instead of overflowing.
+			// The test runs before the multiply, the multiply itself can't overflow.
+			const int64 Saturated = int64(MAX_int32) + 1;
+			TokenNumber = 0;
+			while (FChar::IsDigit(*Cursor))
+			{
+				const int32 Digit = *Cursor - '0';
+				TokenNumber = TokenNumber > (Saturated - Digit) / 10 ? Saturated : TokenNumber * 10 + Digit;
+				Cursor++;
+			}
+			TokenLength = int32(Cursor - TokenBegin);
+			Token = ETokenKind::Number;
+			return;
+		}
+
+		struct FSymbol
+		{
+			const TCHAR* Text;
+			ETokenKind Kind;
+		};
+		// Longer symbols first, so "<=" isn't read as "<".
+		static const FSymbol Symbols[] =
+		{
+			{ TEXT("&&"), ETokenKind::And }, { TEXT("||"), ETokenKind::Or }, { TEXT("=="), ETokenKind::Equal }, { TEXT("!="), ETokenKind::NotEqual },
+			{ TEXT("<="), ETokenKind::LessEqual }, { TEXT(">="), ETokenKind::GreaterEqual }, { TEXT("+="), ETokenKind::PlusAssign }, { TEXT("-="), ETokenKind::MinusAssign },
+			{ TEXT("("), ETokenKind::LeftParen }, { TEXT(")"), ETokenKind::RightParen }, { TEXT(","), ETokenKind::Comma }, { TEXT(";"), ETokenKind::Semicolon },
+			{ TEXT("!"), ETokenKind::Not }, { TEXT("<"), ETokenKind::Less }, { TEXT(">"), ETokenKind::Greater }, { TEXT("+"), ETokenKind::Plus },
+			{ TEXT("-"), ETokenKind::Minus }, { TEXT("="), ETokenKind::Assign },
+		};
+
+		for (const FSymbol& Symbol : Symbols)
+		{
+			const int32 Length = FCString::Strlen(Symbol.Text);
+			if (FCString::Strncmp(Cursor, Symbol.Text, Length) == 0)
+			{
+				Cursor += Length;
+				TokenLength = Length;
+				Token = Symbol.Kind;
+				return;
+			}
+		}
+
+		Cursor++;
+		TokenLength = 1;
+		Token = ETokenKind::Invalid;
+	}
+
+	bool FCompiler::Accept(ETokenKind Kind)
+	{
+		if (Token != Kind)
+			return false;
+		Next();
+		return true;
+	}
+
+	bool FCompiler::Expect(ETokenKind Kind, const TCHAR* What)
+	{
+		return Accept(Kind) || Fail(FString::Printf(TEXT("expected %s"), What));
+	}
+
+	// Keeps the first error only, everything after it tends to be noise.
+	bool FCompiler::Fail(const FString& Message)
+	{
+		if (Error.IsEmpty())
+		{
+			Error = Token == ETokenKind::End ? FString::Printf(TEXT("%s at the end"), *Message)
+				: FString::Printf(TEXT("%s at column %d ('%s')"), *Message, int32(TokenBegin - Source) + 1, *FString(TokenLength, TokenBegin));
+		}
+		return false;
+	}
+
+	int32 FCompiler::AddNode(ENodeKind Kind, int32 Value, int32 Left, int32 Right)
+	{
+		FNode& Node = Nodes.AddDefaulted_GetRef();
+		Node.Kind = Kind;
+		Node.Value = Value;
+		Node.Left = Left;
+		Node.Right = Right;
+		return Nodes.Num() - 1;
+	}
+
+	int32 FCompiler::ParseOr()
+	{
+		int32 Left = ParseAnd();
+		while (Left != INDEX_NONE && Accept(ETokenKind::Or))
+		{
+			const int32 Right = ParseAnd();
+			Left = Right == INDEX_NONE ? INDEX_NONE : AddNode(ENodeKind::Or, 0, Left, Right);
+		}
+		return Left;
+	}
+
+	int32 FCompiler::ParseAnd()
+	{
+		int32 Left = ParseNot();
+		while (Left != INDEX_NONE && Accept(ETokenKind::And))
+		{
+			const int32 Right = ParseNot();
+			Left = Right == INDEX_NONE ? INDEX_NONE : AddNode(ENodeKind::And, 0, Left, Right);
+		}
+		return Left;
+	}
+
+	int32 FCompiler::ParseNot()
+	{
+		if (Accept(ETokenKind::Not))
+		{
+			const int32 Child = ParseNot();
+			return Child == INDEX_NONE ? INDEX_NONE : AddNode(ENodeKind::Not, 0, Child);
+		}
+		return ParseCompare();
+	}
+
+	int32 FCompiler::ParseCompare()
+	{
+		const int32 Left = ParseSum();
+		if (Left == INDEX_NONE)
+			return INDEX_NONE;
+
+		EOp Op;
+		switch (Token)
+		{
+			case ETokenKind::Equal:			Op = Op_Equal; break;
+			case ETokenKind::NotEqual:		Op = Op_NotEqual; break;
+			case ETokenKind::Less:			Op = Op_Less; break;
+			case ETokenKind::LessEqual:		Op = Op_LessEqual; break;
+			case ETokenKind::Greater:		Op = Op_Greater; break;
+			case ETokenKind::GreaterEqual:	Op = Op_GreaterEqual; break;
+			default:						return Left;
+		}
+		Next();
+
+		const int32 Right = ParseSum();
+		if (Right == INDEX_NONE)
+			return INDEX_NONE;
+
+		const int32 Node = AddNode(ENodeKind::Binary, 0, Left, Right);
+		Nodes[Node].Op = Op;
+		return Node;
+	}
+
+	int32 FCompiler::ParseSum()
+	{
+		int32 Left = ParseUnary();
+		while (Left != INDEX_NONE && (Token == ETokenKind::Plus || Token == ETokenKind::Minus))
+		{
+			const EOp Op = Token == ETokenKind::Plus ? Op_Add : Op_Sub;
+			Next();
+			const int32 Right = ParseUnary();
+			if (Right == INDEX_NONE)
+				return INDEX_NONE;
+			Left = AddNode(ENodeKind::Binary, 0, Left, Right);
+			Nodes[Left].Op = Op;
+		}
+		return Left;
+	}
+
+	int32 FCompiler::ParseUnary()
+	{
+		if (Accept(ETokenKind::Minus))
+		{
+			const int32 Child = ParseUnary();
+			return Child == INDEX_NONE ? INDEX_NONE : AddNode(ENodeKind::Neg, 0, Child);
+		}
+		return ParsePrimary();
+	}
+
+	int32 FCompiler::ParsePrimary()
+	{
+		if (Token == ETokenKind::Number)
+		{
+			if (TokenNumber > MAX_int32)
+			{
+				Fail(TEXT("number too large"));
+				return INDEX_NONE;
+			}
+			const int32 Node = AddNode(ENodeKind::Number, int32(TokenNumber));
+			Next();
+			return Node;
+		}
+
+		if (Accept(ETokenKind::LeftParen))
+		{
+			const int32 Node = ParseOr();
+			if (Node == INDEX_NONE || !Expect(ETokenKind::RightParen, TEXT("')'")))
+				return INDEX_NONE;
+			return Node;
+		}
+
+		if (Token != ETokenKind::Name)
+		{
+			Fail(TEXT("expected a name, number or '('"));
+			return INDEX_NONE;
+		}
+
+		const FString Word(TokenLength, TokenBegin);
+		Next();
+
+		if (Word == TEXT("true") || Word == TEXT("false"))
+			return AddNode(ENodeKind::Bool, Word == TEXT("true") ? 1 : 0);
+		if (Word == TEXT("has") && Token == ETokenKind::LeftParen)
+			return ParseItemCall(true);
+		if (Word == TEXT("count") && Token == ETokenKind::LeftParen)
+			return ParseItemCall(false);
+
+		const int32 Node = AddNode(ENodeKind::Name);
+		Nodes[Node].Name = FName(*Word);
+		return Node;
+	}
+
+	// An item ID, or a name the inventory knows.
+	int32 FCompiler::ParseItem()
+	{
+		int32 ItemID = INDEX_NONE;
+		if (Token == ETokenKind::Number && TokenNumber <= MaxOperand)
+		{
+			ItemID = int32(TokenNumber);
+		}
+		else if (Token == ETokenKind::Name)
+		{
+			IWorldStateItems* Items = WorldState.GetItems();
+			ItemID = Items ? Items->FindItemID(FName(TokenLength, TokenBegin)) : INDEX_NONE;
+		}
+
+		if (ItemID < 0 || ItemID > MaxOperand)
+		{
+			Fail(TEXT("unknown item"));
+			return INDEX_NONE;
+		}
+
+		Next();
+		return ItemID;
+	}
+
+	// has(Item[, Count]) or count(Item).
+	int32 FCompiler::ParseItemCall(bool bHas)
+	{
+		Next();
+		const int32 ItemID = ParseItem();
+		if (ItemID == INDEX_NONE)
+			return INDEX_NONE;
+
+		const int32 Items = AddNode(ENodeKind::Items, ItemID);
+		int32 Result = Items;
+		if (bHas)
+		{
+			int32 Count = INDEX_NONE;
+			if (Accept(ETokenKind::Comma))
+				Count = ParseSum();
+			else
+				Count = AddNode(ENodeKind::Number, 1);
+			if (Count == INDEX_NONE)
+				return INDEX_NONE;
+
+			Result = AddNode(ENodeKind::Binary, 0, Items, Count);
+			Nodes[Result].Op = Op_GreaterEqual;
+		}
+
+		return Expect(ETokenKind::RightParen, TEXT("')'")) ? Result : INDEX_NONE;
+	}
+
+	bool FCompiler::IsBool(int32 Node) const
+	{
+		const FNode& Info = Nodes[Node];
+		switch (Info.Kind)
+		{
+			case ENodeKind::Bool:
+			case ENodeKind::Not:
+			case ENodeKind::And:
+			case ENodeKind::Or:
+				return true;
+			case ENodeKind::Binary:
+				return Info.Op != Op_Add && Info.Op != Op_Sub;
+			default:
+				return false;
+		}
+	}
+
+	void FCompiler::EmitOp(EOp Op, int32 Operand)
+	{
+		switch (Op)
+		{
+			case Op_PushInt:
+			case Op_PushWide:
+			case Op_PushFlag:
+			case Op_PushCounter:
+			case Op_PushItems:
+				if (++Depth > FWorldStateScript::MaxStackDepth)
+					Fail(FString::Printf(TEXT("nested more than %d deep"), FWorldStateScript::MaxStackDepth));
+				break;
+			case Op_Not:
+			case Op_Neg:
+			case Op_Return:
+				break;
+			default:
+				Depth--;
+				break;
+		}
+
+		Code.Add(Encode(Op, Operand));
+	}
+
+	void FCompiler::EmitInt(int32 Value)
+	{
+		if (Value >= MinOperand && Value <= MaxOperand)
+		{
+			EmitOp(Op_PushInt, Value);
+		}
+		else
+		{
+			EmitOp(Op_PushWide);
+			Code.Add(uint32(Value));
+		}
+	}
+
+	void FCompiler::Emit(int32 Node, bool bWantBool)
+	{
+		const FNode& Info = Nodes[Node];
+		switch (Info.Kind)
+		{
+			case ENodeKind::Number:
+			case ENodeKind::Bool:
+				EmitInt(Info.Value);
+				break;
+
+			case ENodeKind::Name:
+				if (bWantBool)
+					EmitOp(Op_PushFlag, WorldState.FindOrAddFlag(Info.Name).Index);
+				else
+					EmitOp(Op_PushCounter, WorldState.FindOrAddCounter(Info.Name).Index);
+				break;
+
+			case ENodeKind::Items:
+				EmitOp(Op_PushItems, Info.Value);
+				break;
+
+			case ENodeKind::Not:
+				Emit(Info.Left, true);
+				EmitOp(Op_Not);
+				break;
+
+			case ENodeKind::Neg:
+				Emit(Info.Left, false);
+				EmitOp(Op_Neg);
+				break;
+
+			case ENodeKind::Binary:
+				Emit(Info.Left, false);
+				Emit(Info.Right, false);
+				EmitOp(Info.Op);
+				break;
+
+			case ENodeKind::And:
+			case ENodeKind::Or:
+			{
+				Emit(Info.Left, true);
+				const int32 Jump = Code.Num();
+				EmitOp(Info.Kind == ENodeKind::And ? Op_JumpIfFalse : Op_JumpIfTrue);
+				Emit(Info.Right, true);
+				Code[Jump] = Encode(EOp(Code[Jump] & 0xFF), Code.Num() - (Jump + 1));
+				break;
+			}
+		}
+	}
+
+	/*
+	 * Function:  CompileCondition
+	 * --------------------
+	 * Condition := Or
+	 * Or        := And { (or | ||) And }
+	 * And       := Not { (and | &&) Not }
+	 * Not       := (not | !) Not | Compare
+	 * Compare   := Sum [ (== | != | < | <= | > | >=) Sum ]
+	 * Sum       := Unary { (+ | -) Unary }
+	 * Unary     := - Unary | Primary
+	 * Primary   := Number | true | false | Name | has(Item[, Sum]) | count(Item) | ( Or )
+	 */
+	bool FCompiler::CompileCondition()
+	{
+		const int32 Root = ParseOr();
+		if (Root == INDEX_NONE)
+			return false;
+		if (Token != ETokenKind::End)
+			return Fail(TEXT("expected the end of the condition"));
+
+		Emit(Root, true);
+		EmitOp(Op_Return);
+		return Error.IsEmpty();
+	}
+
+	/*
+	 * Function:  CompileAction
+	 * --------------------
+	 * Action    := Statement { ; Statement } [;]
+	 * Statement := Name = Or | Name += Sum | Name -= Sum | give(Item[, Sum]) | take(Item[, Sum])
+	 */
+	bool FCompiler::CompileAction()
+	{
+		while (Token != ETokenKind::End)
+		{
+			if (Token != ETokenKind::Name)
+				return Fail(TEXT("expected a name"));
+
+			const FString Word(TokenLength, TokenBegin);
+			const FName Name(*Word);
+			Next();
+
+			if ((Word == TEXT("give") || Word == TEXT("take")) && Accept(ETokenKind::LeftParen))
+			{
+				const int32 ItemID = ParseItem();
+				if (ItemID == INDEX_NONE)
+					return false;
+
+				const int32 Count = Accept(ETokenKind::Comma) ? ParseSum() : AddNode(ENodeKind::Number, 1);
+				if (Count == INDEX_NONE || !Expect(ETokenKind::RightParen, TEXT("')'")))
+					return false;
+
+				Emit(Count, false);
+				if (Word == TEXT("take"))
+					EmitOp(Op_Neg);
+				EmitOp(Op_AddItems, ItemID);
+			}
+			else if (Accept(ETokenKind::Assign))
+			{
+				const int32 Value = ParseOr();
+				if (Value == INDEX_NONE)
+					return false;
+
+				if (IsBool(Value))
+				{
+					Emit(Value, true);
+					EmitOp(Op_SetFlag, WorldState.FindOrAddFlag(Name).Index);
+				}
+				else
+				{
+					Emit(Value, false);
+					EmitOp(Op_SetCounter, WorldState.FindOrAddCounter(Name).Index);
+				}
+			}
+			else if (Token == ETokenKind::PlusAssign || Token == ETokenKind::MinusAssign)
+			{
+				const EOp Op = Token == ETokenKind::PlusAssign ? Op_Add : Op_Sub;
+				Next();
+				const int32 Value = ParseSum();
+				if (Value == INDEX_NONE)
+					return false;
+
+				const int32 Counter = WorldState.FindOrAddCounter(Name).Index;
+				EmitOp(Op_PushCounter, Counter);
+				Emit(Value, false);
+				EmitOp(Op);
+				EmitOp(Op_SetCounter, Counter);
+			}
+			else
+			{
+				return Fail(TEXT("expected '=', '+=' or '-='"));
+			}
+
+			if (!Accept(ETokenKind::Semicolon) && Token != ETokenKind::End)
+				return Fail(TEXT("expected ';'"));
+		}
+
+		EmitOp(Op_Return);
+		return Error.IsEmpty();
+	}
+
+	typedef bool (FCompiler::*FCompileFunction)();
+
+	FWorldStateProgram Compile(FCompileFunction Function, const FString& Source, UWorldStateSubsystem& WorldState, TArray<uint32>& Code, FString* OutError)
+	{
+		FWorldStateProgram Program;
+		if (Source.TrimStartAndEnd().IsEmpty())
+			return Program;
+
+		const int32 Start = Code.Num();
+		FCompiler Compiler(Source, WorldState, Code);
+		if ((Compiler.*Function)())
+		{
+			Program.Offset = Start;
+		}
+		else
+		{
+			Code.SetNum(Start, false);
+			if (OutError)
+				*OutError = Compiler.Error;
+		}
+		return Program;
+	}
+}
+
+using namespace WorldStateScriptPrivate;
+
+FWorldStateProgram FWorldStateScript::CompileCondition(const FString& Source, UWorldStateSubsystem& WorldState, FString* OutError)
+{
+	return Compile(&FCompiler::CompileCondition, Source, WorldState, Code, OutError);
+}
+
+FWorldStateProgram FWorldStateScript::CompileAction(const FString& Source, UWorldStateSubsystem& WorldState, FString* OutError)
+{
+	return Compile(&FCompiler::CompileAction, Source, WorldState, Code, OutError);
+}
+
+bool FWorldStateScript::Evaluate(FWorldStateProgram Program, const UWorldStateSubsystem& WorldState) const
+{
+	return !Program.IsValid() || Run(Program.Offset, WorldState, nullptr) != 0;
+}
+
+void FWorldStateScript::Execute(FWorldStateProgram Program, UWorldStateSubsystem& WorldState) const
+{
+	if (Program.IsValid())
+		Run(Program.Offset, WorldState, &WorldState);
+}
+
+/*
+ * Function:  Run
+ * --------------------
+ * The interpreter. The stack lives on the C++ stack, its depth was checked when compiling,
+ * and every flag and counter index was resolved then too. Math wraps instead of overflowing.
+ *
+ * Target: The world state to write to, only actions have ops that write.
+ */
+int32 FWorldStateScript::Run(int32 Offset, const UWorldStateSubsystem& WorldState, UWorldStateSubsystem* Target) const
+{
+	int32 Stack[MaxStackDepth];
+	int32 Depth = 0;
+	const uint32* Pc = Code.GetData() + Offset;
+	const uint32* Flags = WorldState.FlagWords.GetData();
+	const int32* Counters = WorldState.Counters.GetData();
+	IWorldStateItems* Items = WorldState.GetItems();
+
+	for (;;)
+	{
+		const uint32 Word = *Pc++;
+		const int32 Operand = DecodeOperand(Word);
+
+		switch (EOp(Word & 0xFF))
+		{
+			case Op_PushInt:		Stack[Depth++] = Operand; break;
+			case Op_PushWide:		Stack[Depth++] = int32(*Pc++); break;
+			case Op_PushFlag:		Stack[Depth++] = (Flags[Operand >> 5] >> (Operand & 31)) & 1; break;
+			case Op_PushCounter:	Stack[Depth++] = Counters[Operand]; break;
+			case Op_PushItems:		Stack[Depth++] = Items ? Items->GetItemCount(Operand) : 0; break;
+			case Op_Not:			Stack[Depth - 1] = Stack[Depth - 1] == 0; break;
+			case Op_Neg:			Stack[Depth - 1] = int32(0u - uint32(Stack[Depth - 1])); break;
+			case Op_Add:			Depth--; Stack[Depth - 1] = int32(uint32(Stack[Depth - 1]) + uint32(Stack[Depth])); break;
+			case Op_Sub:			Depth--; Stack[Depth - 1] = int32(uint32(Stack[Depth - 1]) - uint32(Stack[Depth])); break;
+			case Op_Equal:			Depth--; Stack[Depth - 1] = Stack[Depth - 1] == Stack[Depth]; break;
+			case Op_NotEqual:		Depth--; Stack[Depth - 1] = Stack[Depth - 1] != Stack[Depth]; break;
+			case Op_Less:			Depth--; Stack[Depth - 1] = Stack[Depth - 1] < Stack[Depth]; break;
+			case Op_LessEqual:		Depth--; Stack[Depth - 1] = Stack[Depth - 1] <= Stack[Depth]; break;
+			case Op_Greater:		Depth--; Stack[Depth - 1] = Stack[Depth - 1] > Stack[Depth]; break;
+			case Op_GreaterEqual:	Depth--; Stack[Depth - 1] = Stack[Depth - 1] >= Stack[Depth]; break;
+
+			case Op_JumpIfFalse:
+				if (Stack[Depth - 1] == 0)
+					Pc += Operand;
+				else
+					Depth--;
+				break;
+
+			case Op_JumpIfTrue:
+				if (Stack[Depth - 1] != 0)
+					Pc += Operand;
+				else
+					Depth--;
+				break;
+
+			case Op_SetFlag:
+				check(Target);
+				Target->SetFlag(FWorldFlag{ Operand }, Stack[--Depth] != 0);
+				break;
+
+			case Op_SetCounter:
+				check(Target);
+				Target->SetCounter(FWorldCounter{ Operand }, Stack[--Depth]);
+				break;
+
+			case Op_AddItems:
+				check(Target);
+				if (Items)
+					Items->AddItem(Operand, Stack[--Depth]);
+				else
+					Depth--;
+				// The inventory may have added names of its own.
+				Flags = WorldState.FlagWords.GetData();
+				Counters = WorldState.Counters.GetData();
+				break;
+
+			case Op_Return:
+				return Depth > 0 ? Stack[Depth - 1] : 0;
+
+			default:
+				checkNoEntry();
+				return 0;
+		}
+	}
+}
+
+FString FWorldStateScript::Disassemble(FWorldStateProgram Program) const
+{
+	FString Result;
+	for (int32 i = Program.Offset; Program.IsValid() && Code.IsValidIndex(i); i++)
+	{
+		const EOp Op = EOp(Code[i] & 0xFF);
+		Result += FString::Printf(TEXT("%4d  %-12s %d\n"), i - Program.Offset, OpNames[Op], Op == Op_PushWide ? int32(Code[i + 1]) : DecodeOperand(Code[i]));
+		if (Op == Op_PushWide)
+			i++;
+		if (Op == Op_Return)
+			break;
+	}
+	return Result;
+}
+
+/*
+ * Console Command:  HB.WorldState.Benchmark [Checks]
+ * --------------------
+ * Evaluates a handful of typical conditions against a throwaway world state (so the save isn't touched)
+ * and logs how many checks run per millisecond.
+ */
+static FAutoConsoleCommand GWorldStateBenchmarkCommand(
+	TEXT("HB.WorldState.Benchmark"),
+	TEXT("Times the condition evaluator. Usage: HB.WorldState.Benchmark [Checks=10000000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		struct FBenchmarkItems : public IWorldStateItems
+		{
+			virtual int32 FindItemID(FName ItemName) const override { return ItemName == TEXT("Key") ? 7 : INDEX_NONE; }
+			virtual int32 GetItemCount(int32 ItemID) const override { return ItemID & 3; }
+			virtual void AddItem(int32 ItemID, int32 Count) override {}
+		};
+
+		const int32 NumChecks = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000000;
+
+		FBenchmarkItems Items;
+		UWorldStateSubsystem* WorldState = NewObject<UWorldStateSubsystem>(GetTransientPackage());
+		WorldState->SetItems(&Items);
+
+		static const TCHAR* Conditions[] =
+		{
+			TEXT("Door_Open and Visits > 3"),
+			TEXT("has(Key) and Door_Open or Visits > 3"),
+			TEXT("not Met_Mika or (Gold + 5 >= 20 and count(3) < 2)"),
+			TEXT("Visits == 4 || !Door_Open && Chapter >= 2"),
+		};
+
+		FWorldStateScript Script;
+		FWorldStateProgram Programs[ARRAY_COUNT(Conditions)];
+		for (int32 i = 0; i < ARRAY_COUNT(Conditions); i++)
+		{
+			FString Error;
+			Programs[i] = Script.CompileCondition(Conditions[i], *WorldState, &Error);
+			if (!Programs[i].IsValid())
+			{
+				UE_LOG(LogHeavenlyBlue, Error, TEXT("Could not compile \"%s\": %s."), Conditions[i], *Error);
+				return;
+			}
+		}
+
+		const FWorldStateProgram Setup = Script.CompileAction(TEXT("Door_Open = true; Visits = 4; Gold += 12; Chapter = 2"), *WorldState);
+		Script.Execute(Setup, *WorldState);
+
+		int32 Passed = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumChecks; i++)
+			Passed += Script.Evaluate(Programs[i & 3], *WorldState) ? 1 : 0;
+		const double Seconds = FMath::Max(FPlatformTime::Seconds() - StartTime, 1e-9);
+
+		UE_LOG(LogHeavenlyBlue, Display, TEXT("%d condition checks (%d passed) in %.2f ms: %.0f checks/ms, %d words of code.\n%s"),
+			NumChecks, Passed, Seconds * 1000.0, NumChecks / (Seconds * 1000.0), Script.Num(), *Script.Disassemble(Programs[1]));
+
+		WorldState->SetItems(nullptr);
+		WorldState->MarkPendingKill();
+	})
+);
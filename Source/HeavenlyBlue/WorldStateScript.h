@@ -0,0 +1,73 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : WorldStateScript
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class compiles the conditions and actions written on
+*				   question options and info boxes into a small stack bytecode.
+*				   Names are resolved when compiling, so running a program never
+*				   allocates or compares strings.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorldStateSubsystem;
+
+/*
+ * Syntax:
+ *
+ *   Condition:  has(Key) and Door_Open or Visits > 3
+ *   Action:     Door_Open = true; Visits += 1; give(Key); take(Coin, 2)
+ *
+ * A name is a flag where a bool is expected and a counter where a number is (comparisons, + and -).
+ * and/or/not may also be written &&/||/!. has(Item[, Count]) and count(Item) ask the inventory,
+ * items are named or given by ID. An action assigns a flag when the right side is a bool
+ * (true, false, a comparison...) and a counter otherwise.
+ */
+
+// A compiled condition or action, an offset into the FWorldStateScript that compiled it.
+struct FWorldStateProgram
+{
+	int32 Offset = INDEX_NONE;
+	bool IsValid() const { return Offset != INDEX_NONE; }
+};
+
+class HEAVENLYBLUE_API FWorldStateScript
+{
+public:
+	// Programs needing a deeper stack than this are rejected when compiling.
+	static const int32 MaxStackDepth = 16;
+
+	// Both return an invalid program for empty source, or if it doesn't compile (OutError says why).
+	// Names are added to the world state, so their indices are fixed from here on.
+	FWorldStateProgram CompileCondition(const FString& Source, UWorldStateSubsystem& WorldState, FString* OutError = nullptr);
+	FWorldStateProgram CompileAction(const FString& Source, UWorldStateSubsystem& WorldState, FString* OutError = nullptr);
+
+	// An invalid program is always true.
+	bool Evaluate(FWorldStateProgram Program, const UWorldStateSubsystem& WorldState) const;
+	void Execute(FWorldStateProgram Program, UWorldStateSubsystem& WorldState) const;
+
+	void Reset() { Code.Reset(); }
+	int32 Num() const { return Code.Num(); }
+	SIZE_T GetAllocatedSize() const { return Code.GetAllocatedSize(); }
+
+	// Lists the instructions of a program, for the log.
+	FString Disassemble(FWorldStateProgram Program) const;
+
+private:
+	int32 Run(int32 Offset, const UWorldStateSubsystem& WorldState, UWorldStateSubsystem* Target) const;
+
+	// Every program compiled by this script, each ending with a Return.
+	TArray<uint32> Code;
+};
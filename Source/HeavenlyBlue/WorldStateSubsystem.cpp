@@ -0,0 +1,246 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldStateSubsystem.h"
+#include "HeavenlyBlue.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+
+bool FWorldStateSnapshot::operator==(const FWorldStateSnapshot& Other) const
+{
+	return FlagNames == Other.FlagNames && CounterNames == Other.CounterNames && FlagWords == Other.FlagWords && Counters == Other.Counters;
+}
+
+// Plain archives (memory, file) don't write FNames, so names go through as strings.
+static void SerializeNames(FArchive& Ar, TArray<FName>& Names)
+{
+	int32 Num = Names.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+		Names.SetNum(FMath::Max(Num, 0));
+
+	for (FName& Name : Names)
+	{
+		FString String = Name.ToString();
+		Ar << String;
+		if (Ar.IsLoading())
+			Name = FName(*String);
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FWorldStateSnapshot& Snapshot)
+{
+	SerializeNames(Ar, Snapshot.FlagNames);
+	SerializeNames(Ar, Snapshot.CounterNames);
+	Ar << Snapshot.FlagWords << Snapshot.Counters;
+	return Ar;
+}
+
+/*
+ * Function:  Initialize
+ * --------------------
+ * Flags and counters named in the config get the first indices, anything else is added the first time it's used.
+ *
+ */
+void UWorldStateSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TArray<FString> Names;
+	GConfig->GetArray(TEXT("/Script/HeavenlyBlue.WorldState"), TEXT("Flag"), Names, GGameIni);
+	for (const FString& Name : Names)
+		FindOrAddFlag(FName(*Name));
+
+	Names.Reset();
+	GConfig->GetArray(TEXT("/Script/HeavenlyBlue.WorldState"), TEXT("Counter"), Names, GGameIni);
+	for (const FString& Name : Names)
+		FindOrAddCounter(FName(*Name));
+
+	// Nobody has been told about anything yet.
+	ChangedFlags.Reset();
+	ChangedCounters.Reset();
+}
+
+UWorldStateSubsystem* UWorldStateSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<UWorldStateSubsystem>() : nullptr;
+}
+
+FWorldFlag UWorldStateSubsystem::FindOrAddFlag(FName Name)
+{
+	FWorldFlag Flag = FindFlag(Name);
+	if (!Flag.IsValid() && !Name.IsNone())
+	{
+		Flag.Index = FlagNames.Add(Name);
+		FlagIndices.Add(Name, Flag.Index);
+		if ((Flag.Index >> 5) >= FlagWords.Num())
+		{
+			FlagWords.Add(0);
+			ChangedFlagWords.Add(0);
+		}
+	}
+	return Flag;
+}
+
+FWorldCounter UWorldStateSubsystem::FindOrAddCounter(FName Name)
+{
+	FWorldCounter Counter = FindCounter(Name);
+	if (!Counter.IsValid() && !Name.IsNone())
+	{
+		Counter.Index = CounterNames.Add(Name);
+		CounterIndices.Add(Name, Counter.Index);
+		Counters.Add(0);
+		if ((Counter.Index >> 5) >= ChangedCounterWords.Num())
+			ChangedCounterWords.Add(0);
+	}
+	return Counter;
+}
+
+FWorldFlag UWorldStateSubsystem::FindFlag(FName Name) const
+{
+	FWorldFlag Flag;
+	if (const int32* Index = FlagIndices.Find(Name))
+		Flag.Index = *Index;
+	return Flag;
+}
+
+FWorldCounter UWorldStateSubsystem::FindCounter(FName Name) const
+{
+	FWorldCounter Counter;
+	if (const int32* Index = CounterIndices.Find(Name))
+		Counter.Index = *Index;
+	return Counter;
+}
+
+void UWorldStateSubsystem::SetFlag(FWorldFlag Flag, bool bValue)
+{
+	if (!Flag.IsValid() || GetFlag(Flag) == bValue)
+		return;
+
+	FlagWords[Flag.Index >> 5] ^= 1u << (Flag.Index & 31);
+	MarkFlagChanged(Flag.Index);
+}
+
+void UWorldStateSubsystem::SetCounter(FWorldCounter Counter, int32 Value)
+{
+	if (!Counter.IsValid() || Counters[Counter.Index] == Value)
+		return;
+
+	Counters[Counter.Index] = Value;
+	MarkCounterChanged(Counter.Index);
+}
+
+/*
+ * Function:  MarkFlagChanged/MarkCounterChanged
+ * --------------------
+ * A value changed several times in one frame is only reported once. The changed bits keep the lists free of duplicates.
+ *
+ */
+void UWorldStateSubsystem::MarkFlagChanged(int32 Index)
+{
+	uint32& Word = ChangedFlagWords[Index >> 5];
+	const uint32 Bit = 1u << (Index & 31);
+	if ((Word & Bit) == 0)
+	{
+		Word |= Bit;
+		ChangedFlags.Add(FWorldFlag{ Index });
+	}
+}
+
+void UWorldStateSubsystem::MarkCounterChanged(int32 Index)
+{
+	uint32& Word = ChangedCounterWords[Index >> 5];
+	const uint32 Bit = 1u << (Index & 31);
+	if ((Word & Bit) == 0)
+	{
+		Word |= Bit;
+		ChangedCounters.Add(FWorldCounter{ Index });
+	}
+}
+
+/*
+ * Function:  Tick
+ * --------------------
+ * This sends the changes of the frame. Only ticks on frames where something changed.
+ *
+ */
+void UWorldStateSubsystem::Tick(float DeltaTime)
+{
+	TArray<FWorldFlag> Flags = MoveTemp(ChangedFlags);
+	TArray<FWorldCounter> CounterList = MoveTemp(ChangedCounters);
+	FMemory::Memzero(ChangedFlagWords.GetData(), ChangedFlagWords.Num() * sizeof(uint32));
+	FMemory::Memzero(ChangedCounterWords.GetData(), ChangedCounterWords.Num() * sizeof(uint32));
+
+	// Listeners may change more values, those go out next frame.
+	WorldStateChangedEvent.Broadcast(Flags, CounterList);
+}
+
+TStatId UWorldStateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWorldStateSubsystem, STATGROUP_Tickables);
+}
+
+void UWorldStateSubsystem::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(FlagNames.GetAllocatedSize() + FlagIndices.GetAllocatedSize() + FlagWords.GetAllocatedSize() +
+		ChangedFlagWords.GetAllocatedSize() + ChangedFlags.GetAllocatedSize() + CounterNames.GetAllocatedSize() + CounterIndices.GetAllocatedSize() +
+		Counters.GetAllocatedSize() + ChangedCounterWords.GetAllocatedSize() + ChangedCounters.GetAllocatedSize());
+}
+
+void UWorldStateSubsystem::CreateSnapshot(FWorldStateSnapshot& OutSnapshot) const
+{
+	OutSnapshot.FlagNames = FlagNames;
+	OutSnapshot.CounterNames = CounterNames;
+	OutSnapshot.FlagWords = FlagWords;
+	OutSnapshot.Counters = Counters;
+}
+
+void UWorldStateSubsystem::ApplySnapshot(const FWorldStateSnapshot& Snapshot)
+{
+	for (int32 i = 0; i < Snapshot.FlagNames.Num(); i++)
+	{
+		const bool bValue = Snapshot.FlagWords.IsValidIndex(i >> 5) && (Snapshot.FlagWords[i >> 5] & (1u << (i & 31))) != 0;
+		SetFlag(FindOrAddFlag(Snapshot.FlagNames[i]), bValue);
+	}
+
+	for (int32 i = 0; i < Snapshot.CounterNames.Num(); i++)
+		SetCounter(FindOrAddCounter(Snapshot.CounterNames[i]), Snapshot.Counters.IsValidIndex(i) ? Snapshot.Counters[i] : 0);
+}
+
+/*
+ * Console Command:  HB.WorldState [Name] [Value]
+ * --------------------
+ * Lists every flag and counter, or sets one. Values other than true/false set a counter.
+ */
+static FAutoConsoleCommandWithWorldAndArgs GWorldStateCommand(
+	TEXT("HB.WorldState"),
+	TEXT("Lists or sets world state flags and counters. Usage: HB.WorldState [Name] [true/false/Number]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UWorldStateSubsystem* WorldState = UWorldStateSubsystem::Get(World);
+		if (WorldState == nullptr)
+			return;
+
+		if (Args.Num() >= 2)
+		{
+			if (Args[1] == TEXT("true") || Args[1] == TEXT("false"))
+				WorldState->SetFlag(WorldState->FindOrAddFlag(FName(*Args[0])), Args[1] == TEXT("true"));
+			else
+				WorldState->SetCounter(WorldState->FindOrAddCounter(FName(*Args[0])), FCString::Atoi(*Args[1]));
+			return;
+		}
+
+		FWorldStateSnapshot Snapshot;
+		WorldState->CreateSnapshot(Snapshot);
+		for (int32 i = 0; i < Snapshot.FlagNames.Num(); i++)
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("Flag %s = %s"), *Snapshot.FlagNames[i].ToString(), WorldState->GetFlag(FWorldFlag{ i }) ? TEXT("true") : TEXT("false"));
+		for (int32 i = 0; i < Snapshot.CounterNames.Num(); i++)
+			UE_LOG(LogHeavenlyBlue, Display, TEXT("Counter %s = %d"), *Snapshot.CounterNames[i].ToString(), Snapshot.Counters[i]);
+	})
+);
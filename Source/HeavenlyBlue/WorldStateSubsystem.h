@@ -0,0 +1,143 @@
+/*
+**********************************************************************;
+*	Project      : HeavenlyBlue
+*
+*	Program name : WorldStateSubsystem
+*
+*	Author		 : ResponsibleFile (Dawson McThay)
+*
+*	Date created : 10/19/2026
+*
+*	Purpose		 : This class stores the global bools and counters that quests and
+*				   dialogue choices set. Names are turned into indices once, the
+*				   values themselves are packed bits and a flat array of ints.
+*
+*	Revisions	 : 10/19/2026
+*
+**********************************************************************;
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "WorldStateSubsystem.generated.h"
+
+// A resolved flag or counter name. Resolve names once (at BeginPlay, on load) and keep the handle.
+struct FWorldFlag
+{
+	int32 Index = INDEX_NONE;
+	bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+struct FWorldCounter
+{
+	int32 Index = INDEX_NONE;
+	bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+// Implemented by the inventory, so conditions and actions can check and hand out items (see FWorldStateScript).
+class IWorldStateItems
+{
+public:
+	virtual ~IWorldStateItems() {}
+
+	// Returns INDEX_NONE for an unknown name.
+	virtual int32 FindItemID(FName ItemName) const = 0;
+	virtual int32 GetItemCount(int32 ItemID) const = 0;
+	virtual void AddItem(int32 ItemID, int32 Count) = 0;
+};
+
+/*
+ * Struct:  FWorldStateSnapshot
+ * --------------------
+ * A copy of every value, taken for the save. The names are kept so indices may change between versions of the game.
+ */
+struct FWorldStateSnapshot
+{
+	TArray<FName> FlagNames;
+	TArray<FName> CounterNames;
+	TArray<uint32> FlagWords;
+	TArray<int32> Counters;
+
+	bool operator==(const FWorldStateSnapshot& Other) const;
+	friend FArchive& operator<<(FArchive& Ar, FWorldStateSnapshot& Snapshot);
+};
+
+UCLASS()
+class HEAVENLYBLUE_API UWorldStateSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// The changes of one frame, sent once at the end of it.
+	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnWorldStateChanged, const TArray<FWorldFlag>& /*ChangedFlags*/, const TArray<FWorldCounter>& /*ChangedCounters*/);
+
+	// Registers the names listed in [/Script/HeavenlyBlue.WorldState], in order, so their indices are known up front.
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	static UWorldStateSubsystem* Get(const UObject* WorldContextObject);
+
+	FWorldFlag FindOrAddFlag(FName Name);
+	FWorldCounter FindOrAddCounter(FName Name);
+	FWorldFlag FindFlag(FName Name) const;
+	FWorldCounter FindCounter(FName Name) const;
+
+	FName GetFlagName(FWorldFlag Flag) const { return FlagNames.IsValidIndex(Flag.Index) ? FlagNames[Flag.Index] : NAME_None; }
+	FName GetCounterName(FWorldCounter Counter) const { return CounterNames.IsValidIndex(Counter.Index) ? CounterNames[Counter.Index] : NAME_None; }
+
+	bool GetFlag(FWorldFlag Flag) const
+	{
+		return Flag.IsValid() && (FlagWords[Flag.Index >> 5] & (1u << (Flag.Index & 31))) != 0;
+	}
+	int32 GetCounter(FWorldCounter Counter) const
+	{
+		return Counter.IsValid() ? Counters[Counter.Index] : 0;
+	}
+
+	void SetFlag(FWorldFlag Flag, bool bValue);
+	void SetCounter(FWorldCounter Counter, int32 Value);
+	void AddToCounter(FWorldCounter Counter, int32 Delta) { SetCounter(Counter, GetCounter(Counter) + Delta); }
+
+	FOnWorldStateChanged& OnWorldStateChanged() { return WorldStateChangedEvent; }
+
+	void SetItems(IWorldStateItems* InItems) { Items = InItems; }
+	IWorldStateItems* GetItems() const { return Items; }
+
+	void CreateSnapshot(FWorldStateSnapshot& OutSnapshot) const;
+	// Sets every value from a snapshot, matching names. Everything it changes is reported like any other change.
+	void ApplySnapshot(const FWorldStateSnapshot& Snapshot);
+
+	// The name tables and value arrays, for the memory report.
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return ChangedFlags.Num() > 0 || ChangedCounters.Num() > 0; }
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+private:
+	// Programs read the arrays directly.
+	friend class FWorldStateScript;
+
+	void MarkFlagChanged(int32 Index);
+	void MarkCounterChanged(int32 Index);
+
+	TArray<FName> FlagNames;
+	TMap<FName, int32> FlagIndices;
+	TArray<uint32> FlagWords;
+	TArray<uint32> ChangedFlagWords;
+	TArray<FWorldFlag> ChangedFlags;
+
+	TArray<FName> CounterNames;
+	TMap<FName, int32> CounterIndices;
+	TArray<int32> Counters;
+	TArray<uint32> ChangedCounterWords;
+	TArray<FWorldCounter> ChangedCounters;
+
+	FOnWorldStateChanged WorldStateChangedEvent;
+
+	IWorldStateItems* Items = nullptr;
+};